@@ -2,6 +2,7 @@
 
 /* Vrui includes */
 #include <Vrui/LocatorTool.h>
+#include <Vrui/Vrui.h>
 #include <Geometry/Point.h>
 #include <Geometry/Vector.h>
 #include <Geometry/OrthogonalTransformation.h>
@@ -20,19 +21,8 @@
 ClippingPlaneLocator::ClippingPlaneLocator(Vrui::LocatorTool * locatorTool,
 		ExampleVTKReader* ExampleVTKReader) :
 	BaseLocator(locatorTool, ExampleVTKReader), clippingPlane(0) {
-	/* Find a clipping plane index for this locator: */
-	ClippingPlane * clippingPlanes = ExampleVTKReader->getClippingPlanes();
-	for (int i=0; i<ExampleVTKReader->getNumberOfClippingPlanes(); ++i)
-		if (!clippingPlanes[i].isAllocated()) {
-			clippingPlane=&clippingPlanes[i];
-			break;
-		}
-
-	/* Allocate the clipping plane: */
-	if (clippingPlane!=0) {
-		clippingPlane->setActive(false);
-		clippingPlane->setAllocated(true);
-	}
+	/* Allocate a clipping plane for this locator: */
+	clippingPlane=ExampleVTKReader->allocateClippingPlane();
 } // end ClippingPlaneLocator()
 
 /*
@@ -58,6 +48,7 @@ void ClippingPlaneLocator::motionCallback(
 						1, 0));
 		Vrui::Point planePoint=callbackData->currentTransformation.getOrigin();
 		clippingPlane->setPlane(Vrui::Plane(planeNormal, planePoint));
+		Vrui::requestUpdate();
 	}
 } // end motionCallback()
 
@@ -68,8 +59,10 @@ void ClippingPlaneLocator::motionCallback(
  */
 void ClippingPlaneLocator::buttonPressCallback(
 		Vrui::LocatorTool::ButtonPressCallbackData* callbackData) {
-	if (clippingPlane!=0)
+	if (clippingPlane!=0) {
 		clippingPlane->setActive(true);
+		Vrui::requestUpdate();
+	}
 } // end buttonPressCallback()
 
 /*
@@ -79,6 +72,8 @@ void ClippingPlaneLocator::buttonPressCallback(
  */
 void ClippingPlaneLocator::buttonReleaseCallback(
 		Vrui::LocatorTool::ButtonReleaseCallbackData* callbackData) {
-	if (clippingPlane!=0)
+	if (clippingPlane!=0) {
 		clippingPlane->setActive(false);
+		Vrui::requestUpdate();
+	}
 } // end buttonReleaseCallback()
@@ -636,18 +636,19 @@ void ColorMap::drawMargin(void) const {
 }
 
 /*
- * exportColorMap - Export the current color map.
+ * exportColorMap - Export the current color map. The values of the entries
+ * increase, so the control points are walked once for all of them.
  *
  * parameter colormap - double*
+ * parameter numberOfEntries - int
  */
-void ColorMap::exportColorMap(double* colormap) const {
-	int numberOfEntries=256;
+void ColorMap::exportColorMap(double* colormap, int numberOfEntries) const {
+	ControlPoint* previousControlPoint=first;
+	ControlPoint* nextControlPoint=previousControlPoint->right;
 	for (int i=0; i<numberOfEntries; ++i) {
 		double value=double(i)*(valueRange.second-valueRange.first)/double(numberOfEntries-1)+valueRange.first;
-		ControlPoint* previousControlPoint=first;
-		ControlPoint* nextControlPoint;
-		for (nextControlPoint=previousControlPoint->right; nextControlPoint!=last&&nextControlPoint->value<value;
-				previousControlPoint =nextControlPoint, nextControlPoint=nextControlPoint->right)
+		for (; nextControlPoint!=last&&nextControlPoint->value<value;
+				previousControlPoint=nextControlPoint, nextControlPoint=nextControlPoint->right)
 			;
 		GLfloat w2=GLfloat((value-previousControlPoint->value)/(nextControlPoint->value-previousControlPoint->value));
 		GLfloat w1=GLfloat((nextControlPoint->value-value)/(nextControlPoint->value-previousControlPoint->value));
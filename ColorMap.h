@@ -172,7 +172,7 @@ public:
 	void drawColorMap(void) const;
 	void drawControlPoints(void) const;
 	void drawMargin(void) const;
-	void exportColorMap(double* colormap) const;
+	void exportColorMap(double* colormap, int numberOfEntries=256) const;
 	virtual bool findRecipient(GLMotif::Event& event);
 	Storage* getColorMap(void) const;
 	void setColorMap(Storage* _colorMap);
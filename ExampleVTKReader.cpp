@@ -1,5 +1,7 @@
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <string>
@@ -44,50 +46,66 @@
 #include "ExampleVTKReader.h"
 #include "Isosurfaces.h"
 #include "FreeSliceLocator.h"
+#include "ROILocator.h"
 #include "ScalarWidget.h"
 #include "Slices.h"
 #include "TransferFunction1D.h"
+#include "TransferFunction2D.h"
 #include "volApplicationState.h"
+#include "volBrickCache.h"
+#include "volBrickFile.h"
+#include "volBrickPager.h"
 #include "volContextState.h"
 #include "volContours.h"
+#include "volFrameRateController.h"
 #include "volFreeSlice.h"
 #include "volGeometry.h"
+#include "volGradientVolume.h"
 #include "volIsosurface.h"
+#include "volJointHistogram.h"
+#include "volMemoryManager.h"
 #include "volOutline.h"
 #include "volReader.h"
+#include "volSidecarCache.h"
 #include "volSlices.h"
+#include "volTimeSeries.h"
 #include "volVolume.h"
 
 //----------------------------------------------------------------------------
 ExampleVTKReader::ExampleVTKReader(int& argc,char**& argv)
   : Superclass(argc, argv, new volApplicationState),
     m_volState(*static_cast<volApplicationState*>(m_state)),
-    ClippingPlanes(NULL),
+    Centered(false),
+    compressionValue(NULL),
     ContoursDialog(NULL),
     FileName(0),
     FirstFrame(true),
+    isosurfacesDialog(NULL),
+    LastNavigationTime(0.0),
+    LastStepTime(0.0),
     mainMenu(NULL),
-    NumberOfClippingPlanes(6),
     opacityValue(NULL),
+    PlaybackRate(10.0),
+    playbackRateValue(NULL),
+    Playing(false),
+    PreviousRenderMode(-1),
     renderingDialog(NULL),
     resolutionValue(NULL),
     slicesDialog(NULL),
+    timeDialog(NULL),
+    timeSlider(NULL),
+    timeValue(NULL),
+    TransferFunction2DChanged(false),
+    transferFunction2DDialog(NULL),
     transferFunctionDialog(NULL),
     Verbose(false)
 {
+  this->LastNavigation.fill(0.0);
   this->Histogram = new float[256];
   for(int j = 0; j < 256; ++j)
     {
     this->Histogram[j] = 0.0;
     }
-
-  /* Initialize the clipping planes */
-  ClippingPlanes = new ClippingPlane[NumberOfClippingPlanes];
-  for(int i = 0; i < NumberOfClippingPlanes; ++i)
-    {
-    ClippingPlanes[i].setAllocated(false);
-    ClippingPlanes[i].setActive(false);
-    }
 }
 
 //----------------------------------------------------------------------------
@@ -97,6 +115,10 @@ ExampleVTKReader::~ExampleVTKReader(void)
     {
     delete[] this->Histogram;
     }
+  for (size_t i = 0; i < this->ClippingPlanes.size(); ++i)
+    {
+    delete this->ClippingPlanes[i];
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -107,28 +129,21 @@ void ExampleVTKReader::initialize(void)
   // Start async file read.
   m_volState.reader().setFileName(this->FileName);
   m_volState.reader().update(m_volState);
+  if (this->TimeSeries)
+    {
+    this->TimeSeries->setSampleRate(m_volState.reader().sampleRate());
+    }
 
   /* Create the user interface: */
   renderingDialog = createRenderingDialog();
-  mainMenu = createMainMenu();
-  Vrui::setMainMenu(mainMenu);
-
-  // TODO This is ugly, it'd be great to find a way around this.
-  // Force sync reader output:
-  while (m_volState.reader().running(std::chrono::seconds(1)))
+  if (this->TimeSeries)
     {
-    std::cout << "Waiting for initial file read to complete..." << std::endl;
+    timeDialog = createTimeDialog();
     }
+  mainMenu = createMainMenu();
+  Vrui::setMainMenu(mainMenu);
 
-  // Update cached data object, start reducer
-  m_volState.reader().update(m_volState);
-
-  // Wait for reduced data, too
-  while (m_volState.reader().reducing(std::chrono::seconds(1)))
-    {
-    std::cout << "Waiting for initial file read to complete..." << std::endl;
-    }
-  m_volState.reader().update(m_volState); // Update cached data object
+  /* Don't wait for the read: frame() shows a preview until it completes. */
 }
 
 //----------------------------------------------------------------------------
@@ -146,12 +161,99 @@ void ExampleVTKReader::setFileName(const char* name)
   strcpy(this->FileName, name);
 }
 
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setTimeSeries(const std::vector<std::string> &fileNames)
+{
+  if (fileNames.empty())
+    {
+    return;
+    }
+  this->setFileName(fileNames[0].c_str());
+  if (fileNames.size() > 1)
+    {
+    this->TimeSeries = std::make_shared<volTimeSeries>();
+    this->TimeSeries->setFileNames(fileNames);
+    m_volState.reader().setTimeSeries(this->TimeSeries);
+    }
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setTimeStep(size_t step)
+{
+  if (!this->TimeSeries || step >= this->TimeSeries->numberOfSteps())
+    {
+    return;
+    }
+  this->TimeSeries->setCurrentStep(step);
+  m_volState.reader().setFileName(this->TimeSeries->fileNames()[step].c_str());
+  if (timeSlider)
+    {
+    timeSlider->setValue(static_cast<double>(step));
+    timeValue->setValue(static_cast<int>(step));
+    }
+  Vrui::requestUpdate();
+}
+
 //----------------------------------------------------------------------------
 const char* ExampleVTKReader::getFileName(void)
 {
   return this->FileName;
 }
 
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setOutOfCore(bool outOfCore)
+{
+  m_volState.reader().setOutOfCore(outOfCore);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setBrickBudget(int megabytes)
+{
+  m_volState.reader().setBrickBudget(static_cast<size_t>(megabytes) << 20);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setSidecarCacheEnabled(bool enabled)
+{
+  m_volState.reader().setSidecarCacheEnabled(enabled);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setFileWatchingEnabled(bool enabled)
+{
+  m_volState.reader().setFileWatchingEnabled(enabled);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setMemoryBudget(int megabytes)
+{
+  m_volState.memoryManager().setBudget(static_cast<size_t>(megabytes) << 20);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setTargetFrameRate(double framesPerSecond)
+{
+  m_volState.frameRateController().setTargetFrameRate(framesPerSecond);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setColorMapResolution(int entries)
+{
+  m_volState.setColorMapResolution(static_cast<size_t>(std::max(entries, 2)));
+}
+
+//----------------------------------------------------------------------------
+int ExampleVTKReader::getColorMapResolution(void) const
+{
+  return static_cast<int>(m_volState.colorMapResolution());
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setSharedMemoryName(const std::string &name)
+{
+  m_volState.reader().setSharedMemoryName(name);
+}
+
 //----------------------------------------------------------------------------
 void ExampleVTKReader::setVerbose(bool verbose)
 {
@@ -222,6 +324,13 @@ GLMotif::PopupMenu* ExampleVTKReader::createMainMenu(void)
   showTransferFunctionDialog->getValueChangedCallbacks().add(
     this, &ExampleVTKReader::showTransferFunctionDialogCallback);
 
+  GLMotif::ToggleButton * showTransferFunction2DDialog =
+    new GLMotif::ToggleButton("ShowTransferFunction2DDialog", mainMenu,
+    "2D Transfer Function");
+  showTransferFunction2DDialog->setToggle(false);
+  showTransferFunction2DDialog->getValueChangedCallbacks().add(
+    this, &ExampleVTKReader::showTransferFunction2DDialogCallback);
+
   GLMotif::ToggleButton * showRenderingDialog = new GLMotif::ToggleButton(
     "ShowRenderingDialog", mainMenu,
     "Rendering");
@@ -229,6 +338,16 @@ GLMotif::PopupMenu* ExampleVTKReader::createMainMenu(void)
   showRenderingDialog->getValueChangedCallbacks().add(
     this, &ExampleVTKReader::showRenderingDialogCallback);
 
+  if (this->TimeSeries)
+    {
+    GLMotif::ToggleButton * showTimeDialog = new GLMotif::ToggleButton(
+      "ShowTimeDialog", mainMenu,
+      "Time Series");
+    showTimeDialog->setToggle(false);
+    showTimeDialog->getValueChangedCallbacks().add(
+      this, &ExampleVTKReader::showTimeDialogCallback);
+    }
+
   mainMenu->manageChild();
   return mainMenuPopup;
 }
@@ -308,6 +427,10 @@ GLMotif::Popup * ExampleVTKReader::createAnalysisToolsMenu(void)
     "FreeSlice",analysisTools_RadioBox,"Free Slice");
   showFreeSlice->getValueChangedCallbacks().add(
     this,&ExampleVTKReader::changeAnalysisToolsCallback);
+  GLMotif::ToggleButton* showRegionOfInterest=new GLMotif::ToggleButton(
+    "RegionOfInterest",analysisTools_RadioBox,"Region of Interest");
+  showRegionOfInterest->getValueChangedCallbacks().add(
+    this,&ExampleVTKReader::changeAnalysisToolsCallback);
 
   analysisTools_RadioBox->setSelectionMode(GLMotif::RadioBox::ALWAYS_ONE);
   analysisTools_RadioBox->setSelectedToggle(showClippingPlane);
@@ -435,17 +558,173 @@ GLMotif::PopupWindow* ExampleVTKReader::createRenderingDialog(void)
   resolutionValue->setPrecision(1);
   resolutionValue->setValue(static_cast<float>(
                               m_volState.reader().sampleRate()));
+
+  /* Create shading toggle */
+  new GLMotif::Label("ShadingLabel", dialog, "Shading:");
+  GLMotif::ToggleButton * shading = new GLMotif::ToggleButton(
+    "Shading", dialog, "Gradient Lighting");
+  shading->setToggle(m_volState.volume().shading());
+  shading->getValueChangedCallbacks().add(this,
+    &ExampleVTKReader::changeShadingCallback);
+  new GLMotif::Label("ShadingStatus", dialog, "");
   dialog->manageChild();
 
   return dialogPopup;
 }
 
+//----------------------------------------------------------------------------
+GLMotif::PopupWindow* ExampleVTKReader::createTimeDialog(void)
+{
+  const GLMotif::StyleSheet& ss = *Vrui::getWidgetManager()->getStyleSheet();
+  GLMotif::PopupWindow * dialogPopup = new GLMotif::PopupWindow(
+    "TimeDialogPopup", Vrui::getWidgetManager(),
+    "Time Series");
+  GLMotif::RowColumn * dialog = new GLMotif::RowColumn(
+    "TimeDialog", dialogPopup, false);
+  dialog->setOrientation(GLMotif::RowColumn::VERTICAL);
+  dialog->setNumMinorWidgets(GLsizei(3));
+
+  const size_t numSteps = this->TimeSeries->numberOfSteps();
+
+  /* Create timestep slider */
+  GLMotif::ToggleButton * play = new GLMotif::ToggleButton(
+    "Play", dialog, "Play");
+  play->setToggle(this->Playing);
+  play->getValueChangedCallbacks().add(this, &ExampleVTKReader::playCallback);
+  timeSlider = new GLMotif::Slider("TimeSlider", dialog,
+    GLMotif::Slider::HORIZONTAL, ss.fontHeight * 10.0f);
+  timeSlider->setValueRange(0.0, static_cast<double>(numSteps - 1), 1.0);
+  timeSlider->setValue(static_cast<double>(this->TimeSeries->currentStep()));
+  timeSlider->getValueChangedCallbacks().add(this,
+    &ExampleVTKReader::timeStepSliderCallback);
+  timeValue = new GLMotif::TextField("TimeValue", dialog, 6);
+  timeValue->setFieldWidth(6);
+  timeValue->setValue(static_cast<int>(this->TimeSeries->currentStep()));
+
+  /* Create playback rate slider */
+  GLMotif::Label* rate_Label = new GLMotif::Label("PlaybackRate", dialog,
+    "Steps/s:");
+  GLMotif::Slider * rateSlider = new GLMotif::Slider("PlaybackRateSlider",
+    dialog, GLMotif::Slider::HORIZONTAL, ss.fontHeight * 10.0f);
+  rateSlider->setValueRange(1.0, 30.0, 1.0);
+  rateSlider->setValue(this->PlaybackRate);
+  rateSlider->getValueChangedCallbacks().add(this,
+    &ExampleVTKReader::playbackRateSliderCallback);
+  playbackRateValue = new GLMotif::TextField("PlaybackRateValue", dialog, 6);
+  playbackRateValue->setFieldWidth(6);
+  playbackRateValue->setPrecision(0);
+  playbackRateValue->setValue(this->PlaybackRate);
+
+  /* Show how well the steps read so far compress in memory */
+  GLMotif::Label* compression_Label = new GLMotif::Label("Compression",
+    dialog, "Compression:");
+  compressionValue = new GLMotif::TextField("CompressionValue", dialog, 6);
+  compressionValue->setFieldWidth(6);
+  compressionValue->setPrecision(1);
+  compressionValue->setValue(
+    this->TimeSeries->store().compressionRatio());
+  GLMotif::Label* compressionUnit_Label = new GLMotif::Label(
+    "CompressionUnit", dialog, ": 1");
+  dialog->manageChild();
+
+  return dialogPopup;
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::updateTimeSeries(void)
+{
+  /* Compute the visible isosurfaces of upcoming steps ahead of time: */
+  std::vector<double> contours;
+  volIsosurface *isosurfaces[3] = { &m_volState.isosurfaceA(),
+                                    &m_volState.isosurfaceB(),
+                                    &m_volState.isosurfaceC() };
+  for (int i = 0; i < 3; ++i)
+    {
+    if (isosurfaces[i]->visible())
+      {
+      contours.push_back(isosurfaces[i]->contourValue());
+      }
+    }
+  this->TimeSeries->setSpeculativeContours(contours);
+
+  if (compressionValue)
+    {
+    compressionValue->setValue(
+      this->TimeSeries->store().compressionRatio());
+    }
+
+  if (!this->Playing)
+    {
+    return;
+    }
+
+  /* Only advance once the current step is shown, and only to a step that has
+   * been decoded, so playback never waits on the disk: */
+  const size_t current = this->TimeSeries->currentStep();
+  const size_t next = this->TimeSeries->nextStep(current);
+  const double now = Vrui::getApplicationTime();
+  const double interval = 1.0 / this->PlaybackRate;
+  if (m_volState.reader().dataFileName() ==
+        this->TimeSeries->fileNames()[current] &&
+      this->TimeSeries->isReady(next) &&
+      now - this->LastStepTime >= interval)
+    {
+    this->setTimeStep(next);
+    this->LastStepTime = now;
+    }
+  Vrui::scheduleUpdate(now + interval);
+}
+
 //----------------------------------------------------------------------------
 void ExampleVTKReader::frame(void)
 {
+  if (m_volState.reader().updatePreview())
+    {
+    Vrui::requestUpdate();
+    }
   m_volState.reader().update(m_volState);
+  m_volState.reader().setGradientsEnabled(m_volState.volume().needsGradients());
+  if (m_volState.reader().updateGradients())
+    {
+    Vrui::requestUpdate();
+    }
+
+  if (this->TimeSeries)
+    {
+    this->updateTimeSeries();
+    }
 
-  if(this->FirstFrame)
+  /* Stay within the memory budget: */
+  m_volState.memoryManager().update(m_volState);
+
+  /* Hand the active clipping planes to the data pipelines: */
+  std::vector<volApplicationState::ClipPlane> planes;
+  for (size_t i = 0; i < this->ClippingPlanes.size(); ++i)
+    {
+    if (this->ClippingPlanes[i]->isActive())
+      {
+      Vrui::Plane plane = this->ClippingPlanes[i]->getPlane();
+      volApplicationState::ClipPlane p;
+      for (int j = 0; j < 3; ++j)
+        {
+        p[j] = plane.getNormal()[j];
+        }
+      p[3] = plane.getOffset();
+      planes.push_back(p);
+      }
+    }
+  m_volState.setClippingPlanes(planes);
+
+  /* Initialize Vrui navigation transformation: */
+  if (!this->Centered && m_volState.reader().bounds().IsValid())
+    {
+    centerDisplayCallback(0);
+    this->Centered = true;
+    }
+  this->updateInteraction();
+
+  /* The dialogs show the histogram and range of the data: */
+  if(this->FirstFrame && this->updateHistogram())
     {
     transferFunctionDialog = new TransferFunction1D(this);
     transferFunctionDialog->createTransferFunction1D(CINVERSE_RAINBOW,
@@ -454,30 +733,42 @@ void ExampleVTKReader::frame(void)
       this, &ExampleVTKReader::volumeColorMapChangedCallback);
     transferFunctionDialog->getAlphaChangedCallbacks().add(this,
       &ExampleVTKReader::alphaChangedCallback);
-    updateVolumeColorMap();
-    updateAlpha();
+    TransferFunction1D *volumeDialog = transferFunctionDialog;
+    m_volState.setColorMapSource(volApplicationState::VolumeColorMap,
+      [volumeDialog](double *rgba)
+        {
+        volumeDialog->exportColorMap(rgba);
+        volumeDialog->exportAlpha(rgba);
+        });
+    m_volState.colorMapModified();
+
+    this->transferFunction2DDialog = new TransferFunction2D;
+    this->transferFunction2DDialog->getChangedCallbacks().add(this,
+      &ExampleVTKReader::transferFunction2DChangedCallback);
+    this->TransferFunction2DChanged = true;
 
     this->slicesDialog = new Slices(m_volState.sliceColorMap().data(), this);
     this->slicesDialog->setSlicesColorMap(CINVERSE_RAINBOW, 0.0, 1.0);
-    this->slicesDialog->exportSlicesColorMap(m_volState.sliceColorMap().data());
-    this->updateSliceColorMap(m_volState.sliceColorMap().data());
+    Slices *slices = this->slicesDialog;
+    m_volState.setColorMapSource(volApplicationState::SliceColorMap,
+      [slices](double *rgba) { slices->exportSlicesColorMap(rgba); });
     m_volState.sliceColorMapModified();
 
     this->isosurfacesDialog = new Isosurfaces(
           m_volState.isosurfaceColorMap().data(), this);
     this->isosurfacesDialog->setIsosurfacesColorMap(CINVERSE_RAINBOW, 0.0, 1.0);
-    this->isosurfacesDialog->exportIsosurfacesColorMap(
-          m_volState.isosurfaceColorMap().data());
-    updateIsosurfaceColorMap(m_volState.isosurfaceColorMap().data());
+    Isosurfaces *isosurfaces = this->isosurfacesDialog;
+    m_volState.setColorMapSource(volApplicationState::IsosurfaceColorMap,
+      [isosurfaces](double *rgba)
+        {
+        isosurfaces->exportIsosurfacesColorMap(rgba);
+        });
     m_volState.isosurfaceColorMapModified();
 
     this->ContoursDialog = new Contours(this);
     this->ContoursDialog->getAlphaChangedCallbacks().add(this,
       &ExampleVTKReader::contourValueChangedCallback);
 
-    /* Initialize Vrui navigation transformation: */
-    centerDisplayCallback(0);
-
     double midPoint = static_cast<double>(this->getDataMidPoint());
     m_volState.isosurfaceA().setContourValue(midPoint);
     m_volState.isosurfaceB().setContourValue(midPoint);
@@ -485,73 +776,215 @@ void ExampleVTKReader::frame(void)
     this->FirstFrame = false;
     }
 
+  /* Rebuild the color maps edited since the last frame, once each: */
+  m_volState.applyColorMapEdits();
+  this->updateTransferFunction2D();
+
+  /* Keep polling the reader until the file is read and reduced, and its
+     gradients are computed and binned: */
+  if (this->FirstFrame || m_volState.reader().previewing() ||
+      m_volState.reader().computingGradients() ||
+      this->JointHistogramTask.valid())
+    {
+    Vrui::scheduleUpdate(Vrui::getApplicationTime() + 0.1);
+    }
+
+  /* Watch for the next step of a simulation: */
+  if (!m_volState.reader().sharedMemoryName().empty())
+    {
+    Vrui::scheduleUpdate(Vrui::getApplicationTime() + 1.0 / 30.0);
+    }
+  /* Notice when the file is rewritten: */
+  else if (m_volState.reader().fileWatchingEnabled() && !this->TimeSeries &&
+           !m_volState.reader().dataFileName().empty())
+    {
+    Vrui::scheduleUpdate(Vrui::getApplicationTime() + 0.5);
+    }
+
   this->Superclass::frame();
+
+  /* Build the bricks the pipelines asked for as they were synced above, and
+     poll until they are built: */
+  if (m_volState.reader().updateBrickCaches())
+    {
+    Vrui::requestUpdate();
+    }
+  if (m_volState.reader().buildingBrickCaches())
+    {
+    Vrui::scheduleUpdate(Vrui::getApplicationTime() + 0.1);
+    }
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::initContext(GLContextData& contextData) const
+void ExampleVTKReader::updateInteraction(void)
 {
-  this->Superclass::initContext(contextData);
+  /* The view counts as still once it has not moved for this long: */
+  const double settleTime = 0.3;
 
-  // Created by superclass:
-  volContextState *context =
-      contextData.retrieveDataItem<volContextState>(this);
-  assert("volContextState initialized by vvApplication." && context);
+  const Vrui::NavTransform &navigation = Vrui::getNavigationTransformation();
+  std::array<double, 8> current;
+  for (int i = 0; i < 3; ++i)
+    {
+    current[i] = navigation.getTranslation()[i];
+    }
+  const Vrui::Scalar *quaternion = navigation.getRotation().getQuaternion();
+  for (int i = 0; i < 4; ++i)
+    {
+    current[3 + i] = quaternion[i];
+    }
+  current[7] = navigation.getScaling();
+
+  const double now = Vrui::getApplicationTime();
+  if (current != this->LastNavigation)
+    {
+    this->LastNavigation = current;
+    this->LastNavigationTime = now;
+    }
 
-  std::array<int, 3> dims = m_volState.reader().dimensions();
+  /* Keep the frame rate while the view moves, and render at full quality
+   * once more when it comes to rest: */
+  const bool interacting = now - this->LastNavigationTime < settleTime;
+  m_volState.frameRateController().update(m_volState, Vrui::getFrameTime(),
+                                          interacting);
+  if (interacting)
+    {
+    Vrui::scheduleUpdate(this->LastNavigationTime + settleTime);
+    }
+}
 
-  vtkImageData *imageData = m_volState.reader().typedDataObject();
-  for (int i = 0; i < dims[0]; ++i)
+//----------------------------------------------------------------------------
+bool ExampleVTKReader::updateHistogram(void)
+{
+  const volReader &reader = m_volState.reader();
+  if (!this->HistogramTask.valid())
     {
-    for (int j = 0; j < dims[1]; ++j)
+    // Out of core, the full resolution data holds no scalars, but the brick
+    // file was binned when it was written:
+    if (reader.brickPager())
+      {
+      const std::vector<float> &bins = reader.brickPager()->file().histogram();
+      std::copy(bins.begin(), bins.end(), this->Histogram);
+      return true;
+      }
+
+    vtkSmartPointer<vtkImageData> imageData = reader.typedDataObject();
+    if (!imageData)
+      {
+      return false;
+      }
+    std::shared_ptr<volSidecarCache> cache = reader.sidecarCache();
+
+    /* Scan the data in the background, frames keep going meanwhile: */
+    this->HistogramTask = std::async(std::launch::async,
+      [imageData, cache]() -> std::vector<float>
       {
-      for (int k = 0; k < dims[2]; ++k)
+      /* Reuse the histogram of an earlier run if the file did not change: */
+      std::vector<float> bins;
+      if (cache && cache->histogram(1, bins) && bins.size() == 256)
         {
-        unsigned char *pixel =
-            static_cast<unsigned char *>(imageData->GetScalarPointer(i,j,k));
-        this->Histogram[static_cast<int>(pixel[0])] += 1;
+        return bins;
         }
-      }
+
+      bins.assign(256, 0.f);
+      std::array<int, 3> dims;
+      imageData->GetDimensions(dims.data());
+      for (int i = 0; i < dims[0]; ++i)
+        {
+        for (int j = 0; j < dims[1]; ++j)
+          {
+          for (int k = 0; k < dims[2]; ++k)
+            {
+            // Don't assume unsigned char scalars:
+            const double value =
+                imageData->GetScalarComponentAsDouble(i,j,k,0);
+            bins[std::min(std::max(static_cast<int>(value), 0), 255)] += 1;
+            }
+          }
+        }
+      if (cache)
+        {
+        cache->storeHistogram(1, bins);
+        }
+      return bins;
+      });
+    return false;
     }
+
+  if (this->HistogramTask.wait_for(std::chrono::seconds(0)) !=
+      std::future_status::ready)
+    {
+    return false;
+    }
+
+  std::vector<float> bins = this->HistogramTask.get();
+  std::copy(bins.begin(), bins.end(), this->Histogram);
+  return true;
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::display(GLContextData& contextData) const
+void ExampleVTKReader::updateTransferFunction2D(void)
 {
-  int numberOfSupportedClippingPlanes;
-  glGetIntegerv(GL_MAX_CLIP_PLANES, &numberOfSupportedClippingPlanes);
-  int clippingPlaneIndex = 0;
-  for (int i = 0; i < NumberOfClippingPlanes &&
-    clippingPlaneIndex < numberOfSupportedClippingPlanes; ++i)
+  if (!this->transferFunction2DDialog)
     {
-    if (ClippingPlanes[i].isActive())
-      {
-      /* Enable the clipping plane: */
-      glEnable(GL_CLIP_PLANE0 + clippingPlaneIndex);
-      GLdouble clippingPlane[4];
-      for (int j = 0; j < 3; ++j)
-          clippingPlane[j] = ClippingPlanes[i].getPlane().getNormal()[j];
-      clippingPlane[3] = -ClippingPlanes[i].getPlane().getOffset();
-      glClipPlane(GL_CLIP_PLANE0 + clippingPlaneIndex, clippingPlane);
-      /* Go to the next clipping plane: */
-      ++clippingPlaneIndex;
-      }
+    return;
     }
 
-  this->Superclass::display(contextData);
+  /* Apply the regions edited since the last frame, once: */
+  if (this->TransferFunction2DChanged)
+    {
+    m_volState.transferFunction2D().setRegions(
+      this->transferFunction2DDialog->getRegions());
+    this->TransferFunction2DChanged = false;
+    }
 
-  clippingPlaneIndex = 0;
-  for (int i = 0; i < NumberOfClippingPlanes &&
-    clippingPlaneIndex < numberOfSupportedClippingPlanes; ++i)
+  /* Show the joint histogram once it is binned: */
+  if (this->JointHistogramTask.valid())
     {
-    if (ClippingPlanes[i].isActive())
+    if (this->JointHistogramTask.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready)
       {
-      /* Disable the clipping plane: */
-      glDisable(GL_CLIP_PLANE0 + clippingPlaneIndex);
-      /* Go to the next clipping plane: */
-      ++clippingPlaneIndex;
+      return;
       }
+    this->transferFunction2DDialog->setHistogram(
+      *this->JointHistogramTask.get());
+    Vrui::requestUpdate();
+    }
+  if (m_volState.volume().renderMode() !=
+      volVolume::RenderMode::TransferFunction2D)
+    {
+    return;
+    }
+
+  /* Bin the full resolution data once its gradients are ready, the reduced
+   * data until then (and always out of core): */
+  const volReader &reader = m_volState.reader();
+  std::shared_ptr<const volBrickCache> volume = reader.brickCache();
+  std::shared_ptr<const volGradientVolume> gradients = reader.gradients();
+  if (!volume || !gradients || !gradients->isGradientOf(volume))
+    {
+    volume = reader.reducedBrickCache();
+    gradients = reader.reducedGradients();
+    }
+  if (!volume || !gradients || !gradients->isGradientOf(volume) ||
+      gradients == this->JointHistogramGradients.lock())
+    {
+    return;
     }
+  this->JointHistogramGradients = gradients;
+  const std::array<double, 2> range = reader.scalarRange();
+  this->JointHistogramTask = std::async(std::launch::async,
+    [volume, gradients, range]() -> std::shared_ptr<const volJointHistogram>
+    {
+    return std::make_shared<volJointHistogram>(*volume, *gradients, range);
+    });
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::display(GLContextData& contextData) const
+{
+  // Clipping planes are applied by the data pipelines and the volume mapper,
+  // see volDataClipper.
+  this->Superclass::display(contextData);
 }
 
 //----------------------------------------------------------------------------
@@ -585,6 +1018,10 @@ void ExampleVTKReader::changeSamplingCallback(
   resolutionValue->setValue(callBackData->value);
 
   m_volState.reader().setSampleRate(sampling);
+  if (this->TimeSeries)
+    {
+    this->TimeSeries->setSampleRate(sampling);
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -648,7 +1085,7 @@ void ExampleVTKReader::changeAnalysisToolsCallback(
     {
     this->analysisTool = 1;
     }
-  else if (strcmp(callBackData->toggle->getName(), "Other") == 0)
+  else if (strcmp(callBackData->toggle->getName(), "RegionOfInterest") == 0)
     {
     this->analysisTool = 2;
     }
@@ -661,7 +1098,12 @@ void ExampleVTKReader::showSlicesDialogCallback(
   /* open/close slices dialog based on which toggle button changed state: */
   if (strcmp(callBackData->toggle->getName(), "ShowSlicesDialog") == 0)
     {
-    if (callBackData->set)
+    if (callBackData->set && !slicesDialog)
+      {
+      /* Not created until the file is read: */
+      callBackData->toggle->setToggle(false);
+      }
+    else if (callBackData->set)
       {
       /* Open the slices dialog at the same position as the main menu: */
       Vrui::getWidgetManager()->popupPrimaryWidget(slicesDialog,
@@ -681,7 +1123,10 @@ void ExampleVTKReader::showIsosurfacesDialogCallback(
 {
     /* open/close isosurfaces dialog based on which toggle button changed state: */
   if (strcmp(callBackData->toggle->getName(), "ShowIsosurfacesDialog") == 0) {
-    if (callBackData->set) {
+    if (callBackData->set && !isosurfacesDialog) {
+      /* Not created until the file is read: */
+      callBackData->toggle->setToggle(false);
+    } else if (callBackData->set) {
       /* Open the isosurfaces dialog at the same position as the main menu: */
       Vrui::getWidgetManager()->popupPrimaryWidget(
         isosurfacesDialog, Vrui::getWidgetManager()->calcWidgetTransformation(mainMenu));
@@ -699,7 +1144,12 @@ void ExampleVTKReader::showContoursDialogCallback(
   /* open/close slices dialog based on which toggle button changed state: */
   if (strcmp(callBackData->toggle->getName(), "ShowContoursDialog") == 0)
     {
-    if (callBackData->set)
+    if (callBackData->set && !ContoursDialog)
+      {
+      /* Not created until the file is read: */
+      callBackData->toggle->setToggle(false);
+      }
+    else if (callBackData->set)
       {
       /* Open the slices dialog at the same position as the main menu: */
       Vrui::getWidgetManager()->popupPrimaryWidget(ContoursDialog,
@@ -720,7 +1170,12 @@ void ExampleVTKReader::showTransferFunctionDialogCallback(
   /* open/close transfer function dialog based on which toggle button changed state: */
   if (strcmp(callBackData->toggle->getName(), "ShowTransferFunctionDialog") == 0)
     {
-    if (callBackData->set)
+    if (callBackData->set && !transferFunctionDialog)
+      {
+      /* Not created until the file is read: */
+      callBackData->toggle->setToggle(false);
+      }
+    else if (callBackData->set)
       {
       /* Open the transfer function dialog at the same position as the main menu: */
       Vrui::getWidgetManager()->popupPrimaryWidget(transferFunctionDialog,
@@ -734,6 +1189,37 @@ void ExampleVTKReader::showTransferFunctionDialogCallback(
   }
 }
 
+//----------------------------------------------------------------------------
+void ExampleVTKReader::showTransferFunction2DDialogCallback(
+  GLMotif::ToggleButton::ValueChangedCallbackData* callBackData)
+{
+  /* open/close 2D transfer function dialog based on which toggle button changed state: */
+  if (strcmp(callBackData->toggle->getName(), "ShowTransferFunction2DDialog") == 0)
+    {
+    if (callBackData->set && !transferFunction2DDialog)
+      {
+      /* Not created until the file is read: */
+      callBackData->toggle->setToggle(false);
+      }
+    else if (callBackData->set)
+      {
+      /* Render with the 2D transfer function while it is edited: */
+      this->PreviousRenderMode = this->getRequestedRenderMode();
+      this->setRequestedRenderMode(
+        static_cast<int>(volVolume::RenderMode::TransferFunction2D));
+      /* Open the 2D transfer function dialog at the same position as the main menu: */
+      Vrui::getWidgetManager()->popupPrimaryWidget(transferFunction2DDialog,
+        Vrui::getWidgetManager()->calcWidgetTransformation(mainMenu));
+      }
+    else
+      {
+      /* Close the 2D transfer function dialog: */
+      Vrui::popdownPrimaryWidget(transferFunction2DDialog);
+      this->setRequestedRenderMode(this->PreviousRenderMode);
+      }
+    }
+}
+
 //----------------------------------------------------------------------------
 void ExampleVTKReader::showRenderingDialogCallback(
   GLMotif::ToggleButton::ValueChangedCallbackData* callBackData)
@@ -756,15 +1242,73 @@ void ExampleVTKReader::showRenderingDialogCallback(
 }
 
 //----------------------------------------------------------------------------
-ClippingPlane * ExampleVTKReader::getClippingPlanes(void)
+void ExampleVTKReader::showTimeDialogCallback(
+  GLMotif::ToggleButton::ValueChangedCallbackData* callBackData)
 {
-  return this->ClippingPlanes;
+  if (callBackData->set)
+    {
+    /* Open the time dialog at the same position as the main menu: */
+    Vrui::getWidgetManager()->popupPrimaryWidget(timeDialog,
+      Vrui::getWidgetManager()->calcWidgetTransformation(mainMenu));
+    }
+  else
+    {
+    Vrui::popdownPrimaryWidget(timeDialog);
+    }
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::playCallback(
+  GLMotif::ToggleButton::ValueChangedCallbackData* callBackData)
+{
+  this->Playing = callBackData->set;
+  this->LastStepTime = Vrui::getApplicationTime();
+  Vrui::requestUpdate();
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::timeStepSliderCallback(
+  GLMotif::Slider::ValueChangedCallbackData* callBackData)
+{
+  this->setTimeStep(static_cast<size_t>(callBackData->value + 0.5));
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::playbackRateSliderCallback(
+  GLMotif::Slider::ValueChangedCallbackData* callBackData)
+{
+  this->PlaybackRate = callBackData->value;
+  playbackRateValue->setValue(callBackData->value);
+}
+
+//----------------------------------------------------------------------------
+ClippingPlane * ExampleVTKReader::allocateClippingPlane(void)
+{
+  ClippingPlane *plane = NULL;
+  for (size_t i = 0; i < this->ClippingPlanes.size(); ++i)
+    {
+    if (!this->ClippingPlanes[i]->isAllocated())
+      {
+      plane = this->ClippingPlanes[i];
+      break;
+      }
+    }
+
+  if (!plane)
+    {
+    plane = new ClippingPlane;
+    this->ClippingPlanes.push_back(plane);
+    }
+
+  plane->setActive(false);
+  plane->setAllocated(true);
+  return plane;
 }
 
 //----------------------------------------------------------------------------
 int ExampleVTKReader::getNumberOfClippingPlanes(void)
 {
-  return this->NumberOfClippingPlanes;
+  return static_cast<int>(this->ClippingPlanes.size());
 }
 
 //----------------------------------------------------------------------------
@@ -789,6 +1333,12 @@ void ExampleVTKReader::toolCreationCallback(
        * associate it with the new tool: */
       newLocator = new FreeSliceLocator(locatorTool, this);
       }
+    else if (analysisTool == 2)
+      {
+      /* Create a region of interest locator object and
+       * associate it with the new tool: */
+      newLocator = new ROILocator(locatorTool, this);
+      }
 
       /* Add new locator to list: */
       baseLocators.push_back(newLocator);
@@ -862,44 +1412,87 @@ void ExampleVTKReader::showCIsosurface(bool visible)
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::setFreeSliceVisibility(bool vis)
+void ExampleVTKReader::setRegionOfInterest(const double *bounds)
+{
+  volApplicationState::RegionOfInterest roi;
+  std::copy(bounds, bounds + 6, roi.begin());
+  m_volState.setRegionOfInterest(roi);
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::clearRegionOfInterest(void)
+{
+  m_volState.clearRegionOfInterest();
+}
+
+//----------------------------------------------------------------------------
+unsigned long int ExampleVTKReader::getRegionOfInterestTimeStamp(void) const
+{
+  return m_volState.regionOfInterestTimeStamp();
+}
+
+//----------------------------------------------------------------------------
+int ExampleVTKReader::allocateFreeSlice()
+{
+  for (size_t i = 0; i < m_volState.numberOfFreeSlices(); ++i)
+    {
+    if (!m_volState.freeSlice(i).allocated())
+      {
+      m_volState.freeSlice(i).setAllocated(true);
+      m_volState.freeSlice(i).setVisible(false);
+      return static_cast<int>(i);
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::releaseFreeSlice(int slice)
+{
+  m_volState.freeSlice(slice).setVisible(false);
+  m_volState.freeSlice(slice).setAllocated(false);
+  Vrui::requestUpdate();
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::setFreeSliceVisibility(int slice, bool vis)
 {
-  m_volState.freeSlice().setVisible(vis);
+  m_volState.freeSlice(slice).setVisible(vis);
   Vrui::requestUpdate();
 }
 
 //----------------------------------------------------------------------------
-bool ExampleVTKReader::getFreeSliceVisibility()
+bool ExampleVTKReader::getFreeSliceVisibility(int slice)
 {
-  return m_volState.freeSlice().visible();
+  return m_volState.freeSlice(slice).visible();
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::setFreeSliceOrigin(const double *origin)
+void ExampleVTKReader::setFreeSliceOrigin(int slice, const double *origin)
 {
   std::array<double, 3> o{origin[0], origin[1], origin[2]};
-  m_volState.freeSlice().setOrigin(o);
+  m_volState.freeSlice(slice).setOrigin(o);
   Vrui::requestUpdate();
 }
 
 //----------------------------------------------------------------------------
-const double *ExampleVTKReader::getFreeSliceOrigin()
+const double *ExampleVTKReader::getFreeSliceOrigin(int slice)
 {
-  return m_volState.freeSlice().origin().data();
+  return m_volState.freeSlice(slice).origin().data();
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::setFreeSliceNormal(const double *normal)
+void ExampleVTKReader::setFreeSliceNormal(int slice, const double *normal)
 {
   std::array<double, 3> n{normal[0], normal[1], normal[2]};
-  m_volState.freeSlice().setNormal(n);
+  m_volState.freeSlice(slice).setNormal(n);
   Vrui::requestUpdate();
 }
 
 //----------------------------------------------------------------------------
-const double *ExampleVTKReader::getFreeSliceNormal()
+const double *ExampleVTKReader::getFreeSliceNormal(int slice)
 {
-  return m_volState.freeSlice().normal().data();
+  return m_volState.freeSlice(slice).normal().data();
 }
 
 //----------------------------------------------------------------------------
@@ -1005,27 +1598,17 @@ int ExampleVTKReader::getHeight(void)
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::updateIsosurfaceColorMap(double* IsosurfaceColormap)
+void ExampleVTKReader::updateIsosurfaceColorMap(double*)
 {
-  // TODO There was a leak here before the vtkVRUI refactor:
-//  this->IsosurfaceColormap = IsosurfaceColormap;
-  // Check that the input argument is cleaned up properly when called.
-
-  std::copy(IsosurfaceColormap, IsosurfaceColormap + 256,
-            m_volState.isosurfaceColorMap().data());
+  // Exported from the dialog by the map's source, once per frame:
   m_volState.isosurfaceColorMapModified();
   Vrui::requestUpdate();
 }
 
 //----------------------------------------------------------------------------
-void ExampleVTKReader::updateSliceColorMap(double* SliceColormap)
+void ExampleVTKReader::updateSliceColorMap(double*)
 {
-  // TODO There was a leak here before the vtkVRUI refactor:
-  //  this->SliceColormap = SliceColormap;
-  // Check that the input argument is cleaned up properly when called.
-
-  std::copy(SliceColormap, SliceColormap + 256,
-            m_volState.sliceColorMap().data());
+  // Exported from the dialog by the map's source, once per frame:
   m_volState.sliceColorMapModified();
   Vrui::requestUpdate();
 }
@@ -1033,7 +1616,6 @@ void ExampleVTKReader::updateSliceColorMap(double* SliceColormap)
 //----------------------------------------------------------------------------
 void ExampleVTKReader::alphaChangedCallback(Misc::CallbackData* callBackData)
 {
-  transferFunctionDialog->exportAlpha(m_volState.colorMap().data());
   m_volState.colorMapModified();
   Vrui::requestUpdate();
 }
@@ -1049,16 +1631,21 @@ void ExampleVTKReader::contourValueChangedCallback(Misc::CallbackData*)
 void ExampleVTKReader::volumeColorMapChangedCallback(
   Misc::CallbackData* callBackData)
 {
-  transferFunctionDialog->exportColorMap(m_volState.colorMap().data());
   m_volState.colorMapModified();
-  this->updateAlpha();
+  Vrui::requestUpdate();
+}
+
+//----------------------------------------------------------------------------
+void ExampleVTKReader::transferFunction2DChangedCallback(
+  Misc::CallbackData* callBackData)
+{
+  this->TransferFunction2DChanged = true;
   Vrui::requestUpdate();
 }
 
 //----------------------------------------------------------------------------
 void ExampleVTKReader::updateAlpha(void)
 {
-  transferFunctionDialog->exportAlpha(m_volState.colorMap().data());
   m_volState.colorMapModified();
   Vrui::requestUpdate();
 }
@@ -1066,7 +1653,6 @@ void ExampleVTKReader::updateAlpha(void)
 //----------------------------------------------------------------------------
 void ExampleVTKReader::updateVolumeColorMap(void)
 {
-  transferFunctionDialog->exportColorMap(m_volState.colorMap().data());
   m_volState.colorMapModified();
   Vrui::requestUpdate();
 }
@@ -1075,6 +1661,11 @@ void ExampleVTKReader::updateVolumeColorMap(void)
 void ExampleVTKReader::changeAlphaCallback(
   GLMotif::RadioBox::ValueChangedCallbackData* callBackData)
 {
+  if (!transferFunctionDialog)
+    {
+    /* Not created until the file is read: */
+    return;
+    }
   int value = callBackData->radioBox->getToggleIndex(
     callBackData->newSelectedToggle);
   transferFunctionDialog->changeAlpha(value);
@@ -1086,6 +1677,11 @@ void ExampleVTKReader::changeAlphaCallback(
 void ExampleVTKReader::changeColorMapCallback(
   GLMotif::RadioBox::ValueChangedCallbackData* callBackData)
 {
+  if (!transferFunctionDialog)
+    {
+    /* Not created until the file is read: */
+    return;
+    }
   int value = callBackData->radioBox->getToggleIndex(
     callBackData->newSelectedToggle);
   transferFunctionDialog->changeColorMap(value);
@@ -1106,6 +1702,15 @@ void ExampleVTKReader::changeResolutionCallback(
   Vrui::requestUpdate();
 }
 
+//----------------------------------------------------------------------------
+void ExampleVTKReader::changeShadingCallback(
+  GLMotif::ToggleButton::ValueChangedCallbackData* callBackData)
+{
+  /* The ray cast modes shade with the reader's gradients: */
+  m_volState.volume().setShading(callBackData->set);
+  Vrui::requestUpdate();
+}
+
 //----------------------------------------------------------------------------
 float ExampleVTKReader::getDataMinimum(void)
 {
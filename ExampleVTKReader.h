@@ -2,6 +2,10 @@
 #define _EXAMPLEVTKREADER_H
 
 // STL includes
+#include <array>
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 
 // OpenGL/Motif includes
@@ -35,7 +39,11 @@ class ExternalVTKWidget;
 class Isosurfaces;
 class Slices;
 class TransferFunction1D;
+class TransferFunction2D;
 class volApplicationState;
+class volGradientVolume;
+class volJointHistogram;
+class volTimeSeries;
 
 class ExampleVTKReader : public vvApplication
 {
@@ -58,12 +66,39 @@ private:
   GLMotif::PopupWindow* createRenderingDialog(void);
   GLMotif::TextField* opacityValue;
   GLMotif::TextField* resolutionValue;
+  GLMotif::PopupWindow* timeDialog;
+  GLMotif::PopupWindow* createTimeDialog(void);
+  GLMotif::Slider* timeSlider;
+  GLMotif::TextField* timeValue;
+  GLMotif::TextField* playbackRateValue;
+  GLMotif::TextField* compressionValue;
 
   /* Name of file to load */
   char* FileName;
 
+  /* Time series playback */
+  std::shared_ptr<volTimeSeries> TimeSeries;
+  bool Playing;
+  double PlaybackRate; // steps per second
+  double LastStepTime;
+  void updateTimeSeries(void);
+
+  /* Navigation -- the volume is rendered coarser while the view moves */
+  std::array<double, 8> LastNavigation; // translation, rotation, scaling
+  double LastNavigationTime;
+  void updateInteraction(void);
+
   TransferFunction1D* transferFunctionDialog;
 
+  /* 2D Transfer Function -- edits are applied once per frame; the joint
+   * histogram is binned in the background from the finest gradients ready */
+  TransferFunction2D* transferFunction2DDialog;
+  bool TransferFunction2DChanged;
+  int PreviousRenderMode; // restored when the dialog closes
+  std::future<std::shared_ptr<const volJointHistogram> > JointHistogramTask;
+  std::weak_ptr<const volGradientVolume> JointHistogramGradients;
+  void updateTransferFunction2D(void);
+
   Slices* slicesDialog;
 
   Isosurfaces* isosurfacesDialog;
@@ -71,18 +106,21 @@ private:
   /* Contours */
   Contours* ContoursDialog;
   float* Histogram;
+  std::future<std::vector<float> > HistogramTask;
+  bool updateHistogram(void);
 
-  /* First Frame */
+  /* First Frame -- the dialogs wait for the file to be read, the view is
+   * centered as soon as its bounds are known */
   bool FirstFrame;
+  bool Centered;
 
   BaseLocatorList baseLocators;
 
   /* Analysis Tools */
   int analysisTool;
 
-  /* Clipping Plane */
-  ClippingPlane * ClippingPlanes;
-  int NumberOfClippingPlanes;
+  /* Clipping Planes -- grown on demand, there is no upper limit */
+  std::vector<ClippingPlane*> ClippingPlanes;
 
   /* Verbose */
   bool Verbose;
@@ -98,14 +136,43 @@ public:
   void setFileName(const char* name);
   const char* getFileName(void);
 
+  /* Load the files as the timesteps of a time series, starting at the first.
+   * Must be called before initialize(). */
+  void setTimeSeries(const std::vector<std::string> &fileNames);
+  /* Show the given timestep */
+  void setTimeStep(size_t step);
+
   /* Methods to set/get the requested render mode */
   void setRequestedRenderMode(int mode);
   int getRequestedRenderMode(void) const;
 
   /* Clipping Planes */
-  ClippingPlane * getClippingPlanes(void);
+  ClippingPlane * allocateClippingPlane(void);
   int getNumberOfClippingPlanes(void);
 
+  /* Page the data in from a brick file rather than loading it all. Must be
+   * set before initialize(). */
+  void setOutOfCore(bool outOfCore);
+  /* Memory, in megabytes, used for paged bricks when out of core */
+  void setBrickBudget(int megabytes);
+  /* Keep derived data in a cache directory next to the file (default on) */
+  void setSidecarCacheEnabled(bool enabled);
+  /* Reread the file when another program rewrites it (default on) */
+  void setFileWatchingEnabled(bool enabled);
+  /* Memory, in megabytes, the viewer may hold before evicting caches and
+   * hidden results; 0 for no limit. Defaults to half the physical memory. */
+  void setMemoryBudget(int megabytes);
+  /* Frames per second to keep while the view is navigated, by lowering the
+   * volume's quality; 0 to always render at full quality. Defaults to 60. */
+  void setTargetFrameRate(double framesPerSecond);
+  /* Entries of the color maps (default 256); more resolve finer features of
+   * 16-bit and float data. Must be set before the first frame. */
+  void setColorMapResolution(int entries);
+  int getColorMapResolution(void) const;
+  /* Show the steps a running simulation publishes in the named shared
+   * memory segment instead of a file. Must be set before initialize(). */
+  void setSharedMemoryName(const std::string &name);
+
   /* Methods to set/get verbosity */
   void setVerbose(bool);
   bool getVerbose(void);
@@ -123,18 +190,27 @@ public:
   std::vector<double> getContourValues();
   float * getHistogram();
 
+  /* Region of interest: xmin, xmax, ymin, ymax, zmin, zmax */
+  void setRegionOfInterest(const double *bounds);
+  void clearRegionOfInterest(void);
+  /* Changes whenever the region of interest is set or cleared */
+  unsigned long int getRegionOfInterestTimeStamp(void) const;
+
+  /* Claim/release one of the free slices. Returns -1 if all are in use. */
+  int allocateFreeSlice();
+  void releaseFreeSlice(int slice);
+
   /* Get Free Slice visibility, origin and normal*/
-  void setFreeSliceVisibility(bool vis);
-  bool getFreeSliceVisibility();
-  void setFreeSliceOrigin(const double *normal);
-  const double* getFreeSliceOrigin();
-  void setFreeSliceNormal(const double *normal);
-  const double* getFreeSliceNormal();
+  void setFreeSliceVisibility(int slice, bool vis);
+  bool getFreeSliceVisibility(int slice);
+  void setFreeSliceOrigin(int slice, const double *normal);
+  const double* getFreeSliceOrigin(int slice);
+  void setFreeSliceNormal(int slice, const double *normal);
+  const double* getFreeSliceNormal(int slice);
 
   void initialize() override;
 
   /* Methods to manage render context */
-  void initContext(GLContextData& contextData) const override;
   void display(GLContextData& contextData) const override;
   void frame() override;
 
@@ -146,12 +222,18 @@ public:
   void showSlicesDialogCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
   void showContoursDialogCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
   void showTransferFunctionDialogCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
+  void showTransferFunction2DDialogCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
   void showRenderingDialogCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
+  void showTimeDialogCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
+  void playCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
+  void timeStepSliderCallback(GLMotif::Slider::ValueChangedCallbackData* callBackData);
+  void playbackRateSliderCallback(GLMotif::Slider::ValueChangedCallbackData* callBackData);
   void changeAnalysisToolsCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
   void changeColorMapCallback(GLMotif::RadioBox::ValueChangedCallbackData* callBackData);
   void changeAlphaCallback(GLMotif::RadioBox::ValueChangedCallbackData* callBackData);
   void changeResolutionCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
   void changeSamplingCallback(GLMotif::Slider::ValueChangedCallbackData* callBackData);
+  void changeShadingCallback(GLMotif::ToggleButton::ValueChangedCallbackData* callBackData);
 
   virtual void toolCreationCallback(Vrui::ToolManager::ToolCreationCallbackData* cbData);
   virtual void toolDestructionCallback(Vrui::ToolManager::ToolDestructionCallbackData* cbData);
@@ -165,6 +247,7 @@ public:
   void alphaChangedCallback(Misc::CallbackData* callBackData);
   void contourValueChangedCallback(Misc::CallbackData* callBackData);
   void volumeColorMapChangedCallback(Misc::CallbackData* callBackData);
+  void transferFunction2DChangedCallback(Misc::CallbackData* callBackData);
   void updateAlpha(void);
   void updateContourValue(void);
   void updateVolumeColorMap(void);
@@ -22,14 +22,24 @@
  */
 FreeSliceLocator::FreeSliceLocator(Vrui::LocatorTool * locatorTool,
   ExampleVTKReader* ExampleVTKReader) :
-  BaseLocator(locatorTool, ExampleVTKReader)
+  BaseLocator(locatorTool, ExampleVTKReader), freeSlice(-1)
 {
+  /* Claim a free slice for this locator: */
+  freeSlice = ExampleVTKReader->allocateFreeSlice();
+  if (freeSlice < 0)
+    {
+    std::cerr << "All free slices are in use." << std::endl;
+    }
 } // end FreeSliceLocator()
 
 /*
  * ~FreeSliceLocator - Destructor for FreeSliceLocator class.
  */
 FreeSliceLocator::~FreeSliceLocator(void) {
+  if (freeSlice >= 0)
+    {
+    this->application->releaseFreeSlice(freeSlice);
+    }
 } // end ~FreeSliceLocator()
 
 /*
@@ -39,11 +49,17 @@ FreeSliceLocator::~FreeSliceLocator(void) {
  */
 void FreeSliceLocator::motionCallback(
 		Vrui::LocatorTool::MotionCallbackData* callbackData) {
+          if (freeSlice < 0)
+            {
+            return;
+            }
           Vrui::Point position = callbackData->currentTransformation.getOrigin();
           Vrui::Vector planeNormal =
             callbackData->currentTransformation.transform(Vrui::Vector(0,1,0));
-          this->application->setFreeSliceOrigin(position.getComponents());
-          this->application->setFreeSliceNormal(planeNormal.getComponents());
+          this->application->setFreeSliceOrigin(freeSlice,
+                                                position.getComponents());
+          this->application->setFreeSliceNormal(freeSlice,
+                                                planeNormal.getComponents());
 } // end motionCallback()
 
 /*
@@ -54,7 +70,10 @@ void FreeSliceLocator::motionCallback(
 void FreeSliceLocator::buttonPressCallback(
 		Vrui::LocatorTool::ButtonPressCallbackData* callbackData)
 {
-  this->application->setFreeSliceVisibility(true);
+  if (freeSlice >= 0)
+    {
+    this->application->setFreeSliceVisibility(freeSlice, true);
+    }
 } // end buttonPressCallback()
 
 /*
@@ -65,5 +84,8 @@ void FreeSliceLocator::buttonPressCallback(
 void FreeSliceLocator::buttonReleaseCallback(
 		Vrui::LocatorTool::ButtonReleaseCallbackData* callbackData)
 {
-  this->application->setFreeSliceVisibility(false);
+  if (freeSlice >= 0)
+    {
+    this->application->setFreeSliceVisibility(freeSlice, false);
+    }
 } // end buttonReleaseCallback()
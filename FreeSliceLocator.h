@@ -24,5 +24,9 @@ public:
     Vrui::LocatorTool::ButtonReleaseCallbackData* callbackData);
   virtual void motionCallback(
     Vrui::LocatorTool::MotionCallbackData* callbackData);
+
+private:
+  /* Index of the free slice driven by this locator, or -1 if none was free */
+  int freeSlice;
 };
 #endif //__FREESLICELOCATOR_H_
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Gaussian.h"
+#include "GaussianEvaluator.h"
+
+/*
+ * GaussianEvaluator - Constructor for GaussianEvaluator class.
+ */
+GaussianEvaluator::GaussianEvaluator(void) {
+} // end GaussianEvaluator()
+
+/*
+ * ~GaussianEvaluator - Destructor for GaussianEvaluator class.
+ */
+GaussianEvaluator::~GaussianEvaluator(void) {
+} // end ~GaussianEvaluator()
+
+/*
+ * evaluate - Evaluate the maximum of the Gaussians, and 0, at entries equally
+ * spaced values in [0, 1].
+ *
+ * parameter opacities - float*
+ * parameter entries - int
+ */
+void GaussianEvaluator::evaluate(float* opacities, int entries) const {
+    std::fill(opacities, opacities + entries, 0.0f);
+    if (entries < 2)
+        return;
+    const float step = 1.0f / float(entries - 1);
+    for (size_t p = 0; p < positions.size(); ++p) {
+        // Only the entries within position +/- width are covered:
+        int begin = std::max(int(std::ceil((positions[p] - widths[p]) * float(entries - 1))), 0);
+        int end = std::min(int(std::floor((positions[p] + widths[p]) * float(entries - 1))) + 1, entries);
+        const float center = centers[p];
+        // the right scale for d > 0, the left one for d < 0:
+        const float middleScale = 0.5f * (rightScales[p] + leftScales[p]);
+        const float halfScaleDifference = 0.5f * (rightScales[p] - leftScales[p]);
+        const float gaussianWeight = gaussianWeights[p];
+        const float parabolaWeight = parabolaWeights[p];
+        const float constant = constants[p];
+        for (int i = begin; i < end; ++i) {
+            // translate x based on the xbias, and normalize to -1,1
+            float d = float(i) * step - center;
+            float x1 = d * (middleScale + std::copysign(1.0f, d) * halfScaleDifference);
+            float x2 = x1 * x1;
+            // a gaussian, a parabola and a step function, mixed by the ybias
+            float h = gaussianWeight * fastExp(-4.0f * x2) + parabolaWeight * (1.0f - x2) + constant;
+            // perform the MAX over different gaussians, not the sum
+            opacities[i] = opacities[i] > h ? opacities[i] : h;
+        }
+    }
+} // end evaluate()
+
+/*
+ * fastExp - exp(x) for x in [-87, 0], as 2^n * 2^f with n integer and f in
+ * [-0.5, 0.5]; 2^f is approximated by a degree 6 polynomial. Has no branches,
+ * so loops calling it are vectorized.
+ *
+ * parameter x - float
+ * return - float
+ */
+float GaussianEvaluator::fastExp(float x) {
+    const float y = x * 1.44269504088896341f; // log2(e)
+    const int n = int(y - 0.5f); // rounds to nearest, as y <= 0
+    const float f = y - float(n);
+    // Taylor series of 2^f; the first term left out is below 1.2e-7
+    float p = 1.5403530e-4f;
+    p = p * f + 1.3333558e-3f;
+    p = p * f + 9.6181291e-3f;
+    p = p * f + 5.5504109e-2f;
+    p = p * f + 2.4022651e-1f;
+    p = p * f + 6.9314718e-1f;
+    p = p * f + 1.0f;
+    // scale by 2^n through the exponent bits:
+    int bits;
+    std::memcpy(&bits, &p, sizeof(bits));
+    bits += n * (1 << 23);
+    std::memcpy(&p, &bits, sizeof(p));
+    return p;
+} // end fastExp()
+
+/*
+ * setGaussians - Set the Gaussians to evaluate.
+ *
+ * parameter gaussians - const Gaussian*
+ * parameter numberOfGaussians - int
+ */
+void GaussianEvaluator::setGaussians(const Gaussian* gaussians, int numberOfGaussians) {
+    positions.resize(numberOfGaussians);
+    widths.resize(numberOfGaussians);
+    centers.resize(numberOfGaussians);
+    leftScales.resize(numberOfGaussians);
+    rightScales.resize(numberOfGaussians);
+    gaussianWeights.resize(numberOfGaussians);
+    parabolaWeights.resize(numberOfGaussians);
+    constants.resize(numberOfGaussians);
+    for (int p = 0; p < numberOfGaussians; ++p) {
+        float position = gaussians[p].getX();
+        float height = gaussians[p].getH();
+        float width = gaussians[p].getW();
+        float xbias = gaussians[p].getBx();
+        float ybias = gaussians[p].getBy();
+        // non-zero width
+        if (width == 0)
+            width = .00001;
+        positions[p] = position;
+        widths[p] = width;
+        // x is stretched away from position + xbias, to +/- width; a bias
+        // reaching a side collapses that side onto position
+        centers[p] = position + xbias;
+        leftScales[p] = xbias <= -width ? 0.0f : 1.0f / (width + xbias);
+        rightScales[p] = xbias >= width ? 0.0f : 1.0f / (width - xbias);
+        // linear interpolation between:
+        //    a gaussian and a parabola        if 0<ybias<1
+        //    a parabola and a step function   if 1<ybias<2
+        if (ybias < 1) {
+            gaussianWeights[p] = height * (1 - ybias);
+            parabolaWeights[p] = height * ybias;
+            constants[p] = 0.0f;
+        } else {
+            gaussianWeights[p] = 0.0f;
+            parabolaWeights[p] = height * (2 - ybias);
+            constants[p] = height * (ybias - 1);
+        }
+    }
+} // end setGaussians()
@@ -0,0 +1,36 @@
+#ifndef GAUSSIANEVALUATOR_H_
+#define GAUSSIANEVALUATOR_H_
+
+#include <vector>
+
+class Gaussian;
+
+/*
+ * GaussianEvaluator - Evaluates the opacity of a set of Gaussians at equally
+ * spaced values in [0, 1], for any number of entries.
+ *
+ * The parameters of the Gaussians are kept as one array per parameter, with
+ * the biases folded into per-Gaussian scales and weights, so the loop over the
+ * entries a Gaussian covers has no branches and is vectorized by the
+ * compiler. exp() is replaced by a polynomial approximation with a relative
+ * error below 5e-7 -- a few float ulps -- on the range it is used on.
+ */
+class GaussianEvaluator {
+public:
+    GaussianEvaluator(void);
+    ~GaussianEvaluator(void);
+    void evaluate(float* opacities, int entries) const;
+    static float fastExp(float x);
+    void setGaussians(const Gaussian* gaussians, int numberOfGaussians);
+private:
+    std::vector<float> positions;
+    std::vector<float> widths;
+    std::vector<float> centers;
+    std::vector<float> leftScales;
+    std::vector<float> rightScales;
+    std::vector<float> gaussianWeights;
+    std::vector<float> parabolaWeights;
+    std::vector<float> constants;
+};
+
+#endif /* GAUSSIANEVALUATOR_H_ */
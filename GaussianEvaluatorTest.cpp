@@ -0,0 +1,174 @@
+/*
+ * GaussianEvaluatorTest - Checks GaussianEvaluator against the original per
+ * entry evaluation of ScalarWidget::getOpacities, and times both.
+ *
+ * usage: GaussianEvaluatorTest [gaussians] [repetitions]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Gaussian.h"
+#include "GaussianEvaluator.h"
+
+namespace {
+
+/* the largest absolute difference accepted between both evaluations */
+const float Tolerance = 1e-5f;
+
+/*
+ * referenceOpacities - The original evaluation, one exp() per Gaussian and
+ * entry, at entries equally spaced values in [0, 1].
+ *
+ * parameter gaussians - const std::vector<Gaussian>&
+ * parameter opacities - float*
+ * parameter entries - int
+ */
+void referenceOpacities(const std::vector<Gaussian>& gaussians, float* opacities, int entries) {
+    std::fill(opacities, opacities + entries, 0.0f);
+    for (size_t p = 0; p < gaussians.size(); ++p) {
+        float position = gaussians[p].getX();
+        float height = gaussians[p].getH();
+        float width = gaussians[p].getW();
+        float xbias = gaussians[p].getBx();
+        float ybias = gaussians[p].getBy();
+        for (int i = 0; i < entries; i++) {
+            float x = float(i) / float(entries - 1);
+            // clamp non-zero values to pos +/- width
+            if (x > position + width || x < position - width) {
+                opacities[i] = opacities[i] > 0.0 ? opacities[i] : 0.0f;
+                continue;
+            }
+
+            // non-zero width
+            if (width == 0)
+                width = .00001;
+
+            // translate the original x to a new x based on the xbias
+            float x0;
+            if (xbias == 0 || x == position + xbias) {
+                x0 = x;
+            } else if (x > position + xbias) {
+                if (width == xbias)
+                    x0 = position;
+                else
+                    x0 = position + (x - position - xbias) * (width / (width - xbias));
+            } else // (x < pos+xbias)
+            {
+                if (-width == xbias)
+                    x0 = position;
+                else
+                    x0 = position - (x - position - xbias) * (width / (width + xbias));
+            }
+
+            // center around 0 and normalize to -1,1
+            float x1 = (x0 - position) / width;
+
+            // do a linear interpolation between:
+            //    a gaussian and a parabola        if 0<ybias<1
+            //    a parabola and a step function   if 1<ybias<2
+            float h0a = exp(-(4 * x1 * x1));
+            float h0b = 1. - x1 * x1;
+            float h0c = 1.;
+            float h1;
+            if (ybias < 1)
+                h1 = ybias * h0b + (1 - ybias) * h0a;
+            else
+                h1 = (2 - ybias) * h0b + (ybias - 1) * h0c;
+            float h2 = height * h1;
+
+            // perform the MAX over different gaussians, not the sum
+            opacities[i] = opacities[i] > h2 ? opacities[i] : h2;
+        }
+    }
+} // end referenceOpacities()
+
+/*
+ * randomGaussians - Gaussians spread over [0, 1] the way the scalar widget
+ * allows them to be edited, with a fixed seed so failures reproduce.
+ *
+ * parameter numberOfGaussians - int
+ * return - std::vector<Gaussian>
+ */
+std::vector<Gaussian> randomGaussians(int numberOfGaussians) {
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Gaussian> gaussians;
+    for (int p = 0; p < numberOfGaussians; ++p) {
+        float width = 0.01f + 0.3f * unit(generator);
+        float xbias = (2.0f * unit(generator) - 1.0f) * width;
+        gaussians.push_back(Gaussian(unit(generator), unit(generator), width, xbias, 2.0f * unit(generator)));
+    }
+    // the edge cases: zero width, and biases reaching either side; centers
+    // are kept off the entries, where the original skips the xbias stretch
+    gaussians.push_back(Gaussian(0.5f, 0.7f, 0.0f, 0.0f, 0.5f));
+    gaussians.push_back(Gaussian(0.31f, 0.9f, 0.1f, 0.1f, 0.2f));
+    gaussians.push_back(Gaussian(0.71f, 0.8f, 0.1f, -0.1f, 1.5f));
+    return gaussians;
+} // end randomGaussians()
+
+/*
+ * microseconds - Time the best of repetitions runs of evaluate.
+ *
+ * parameter evaluate - const Evaluate&
+ * parameter repetitions - int
+ * return - double
+ */
+template<class Evaluate>
+double microseconds(const Evaluate& evaluate, int repetitions) {
+    double best = 0.0;
+    for (int r = 0; r < repetitions; ++r) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        evaluate();
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+} // end microseconds()
+
+} // end anon namespace
+
+/*
+ * main - Compare both evaluations at the table sizes in use, and fail when
+ * they differ by more than the tolerance.
+ *
+ * parameter argc - int
+ * parameter argv - char**
+ * return - int
+ */
+int main(int argc, char** argv) {
+    int numberOfGaussians = argc > 1 ? std::atoi(argv[1]) : 20;
+    int repetitions = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 50;
+    const std::vector<Gaussian> gaussians = randomGaussians(numberOfGaussians);
+    GaussianEvaluator evaluator;
+    evaluator.setGaussians(gaussians.data(), int(gaussians.size()));
+
+    bool passed = true;
+    const int sizes[] = { 256, 4096, 65536 };
+    std::printf("%8s %12s %12s %12s\n", "entries", "max diff", "reference us", "evaluator us");
+    for (int s = 0; s < 3; ++s) {
+        const int entries = sizes[s];
+        std::vector<float> reference(entries);
+        std::vector<float> opacities(entries);
+        double referenceTime = microseconds([&]() {
+            referenceOpacities(gaussians, reference.data(), entries);
+        }, repetitions);
+        double evaluatorTime = microseconds([&]() {
+            evaluator.evaluate(opacities.data(), entries);
+        }, repetitions);
+        float difference = 0.0f;
+        for (int i = 0; i < entries; ++i)
+            difference = std::max(difference, std::fabs(opacities[i] - reference[i]));
+        std::printf("%8d %12.3g %12.1f %12.1f\n", entries, difference, referenceTime, evaluatorTime);
+        if (!(difference <= Tolerance)) {
+            std::fprintf(stderr, "%d entries differ by %g, more than %g\n", entries, difference, Tolerance);
+            passed = false;
+        }
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+} // end main()
@@ -51,7 +51,6 @@ void Isosurfaces::changeIsosurfacesColorMapCallback(GLMotif::RadioBox::ValueChan
     /* Set the new isosurfaces colormap */
     int value = callBackData->radioBox->getToggleIndex(callBackData->newSelectedToggle);
     changeIsosurfacesColorMap(value);
-    exportIsosurfacesColorMap(isosurfaceColormap);
     exampleVTKReader->updateIsosurfaceColorMap(isosurfaceColormap);
     Vrui::requestUpdate();
 } // end changeIsosurfacesColorMapCallback()
@@ -373,7 +372,7 @@ void Isosurfaces::createCIsosurfaces(GLMotif::RowColumn * & abcIsosurfacesRowCol
  * parameter colormap - unsigned char *
  */
 void Isosurfaces::exportIsosurfacesColorMap(double* colormap) const {
-    colorMap->exportColorMap(colormap);
+    colorMap->exportColorMap(colormap, exampleVTKReader->getColorMapResolution());
 } // end exportIsosurfacesColorMap()
 
 /*
@@ -457,7 +456,6 @@ void Isosurfaces::removeControlPointCallback(Misc::CallbackData* _callbackData)
  * parameter callBackData - Misc::CallbackData *
  */
 void Isosurfaces::isosurfaceColorMapChangedCallback(Misc::CallbackData * callBackData) {
-    exportIsosurfacesColorMap(isosurfaceColormap);
     exampleVTKReader->updateIsosurfaceColorMap(isosurfaceColormap);
     Vrui::requestUpdate();
 } // end isosurfaceColorMapChangedCallback()
@@ -0,0 +1,85 @@
+#include <algorithm>
+
+/* Vrui includes */
+#include <Vrui/LocatorTool.h>
+#include <Vrui/Vrui.h>
+#include <Geometry/Point.h>
+#include <Geometry/OrthogonalTransformation.h>
+
+#include "BaseLocator.h"
+#include "ExampleVTKReader.h"
+#include "ROILocator.h"
+
+/*
+ * ROILocator - Constructor for ROILocator class.
+ *
+ * parameter locatorTool - Vrui::LocatorTool *
+ * parameter ExampleVTKReader - ExampleVTKReader *
+ */
+ROILocator::ROILocator(Vrui::LocatorTool * locatorTool,
+		ExampleVTKReader* ExampleVTKReader) :
+	BaseLocator(locatorTool, ExampleVTKReader), dragging(false),
+			dragged(false), placed(0) {
+} // end ROILocator()
+
+/*
+ * ~ROILocator - Destructor for ROILocator class.
+ */
+ROILocator::~ROILocator(void) {
+	/* The region of interest goes away with the tool that placed it, unless
+	 * another tool has set or cleared it since: */
+	if (placed != 0
+			&& placed == this->application->getRegionOfInterestTimeStamp()) {
+		this->application->clearRegionOfInterest();
+	}
+} // end ~ROILocator()
+
+/*
+ * motionCallback
+ *
+ * parameter callbackData - Vrui::LocatorTool::MotionCallbackData *
+ */
+void ROILocator::motionCallback(
+		Vrui::LocatorTool::MotionCallbackData* callbackData) {
+	if (dragging) {
+		Vrui::Point position=callbackData->currentTransformation.getOrigin();
+		double bounds[6];
+		for (int i=0; i<3; ++i) {
+			bounds[2*i]=std::min(anchor[i], position[i]);
+			bounds[2*i+1]=std::max(anchor[i], position[i]);
+			dragged=dragged||bounds[2*i+1]>bounds[2*i];
+		}
+		if (dragged) {
+			this->application->setRegionOfInterest(bounds);
+			placed=this->application->getRegionOfInterestTimeStamp();
+			Vrui::requestUpdate();
+		}
+	}
+} // end motionCallback()
+
+/*
+ * buttonPressCallback
+ *
+ * parameter callbackData - Vrui::LocatorTool::ButtonPressCallbackData *
+ */
+void ROILocator::buttonPressCallback(
+		Vrui::LocatorTool::ButtonPressCallbackData* callbackData) {
+	anchor=callbackData->currentTransformation.getOrigin();
+	dragging=true;
+	dragged=false;
+} // end buttonPressCallback()
+
+/*
+ * buttonReleaseCallback
+ *
+ * parameter callbackData - Vrui::LocatorTool::ButtonReleaseCallbackData *
+ */
+void ROILocator::buttonReleaseCallback(
+		Vrui::LocatorTool::ButtonReleaseCallbackData* callbackData) {
+	dragging=false;
+	if (!dragged) {
+		this->application->clearRegionOfInterest();
+		placed=0;
+		Vrui::requestUpdate();
+	}
+} // end buttonReleaseCallback()
@@ -0,0 +1,34 @@
+#ifndef ROILOCATOR_H_
+#define ROILOCATOR_H_
+
+#include "BaseLocator.h"
+#include "ExampleVTKReader.h"
+
+/* Vrui includes */
+#include <Vrui/LocatorTool.h>
+
+/*
+ * ROILocator - Drags out an axis-aligned region of interest box between the
+ * positions where the button was pressed and where it currently is. A click
+ * without dragging clears the region of interest.
+ */
+class ROILocator : public BaseLocator {
+public:
+	ROILocator(Vrui::LocatorTool* locatorTool,
+			ExampleVTKReader * ExampleVTKReader);
+	~ROILocator(void);
+	virtual void buttonPressCallback(
+			Vrui::LocatorTool::ButtonPressCallbackData* callbackData);
+	virtual void buttonReleaseCallback(
+			Vrui::LocatorTool::ButtonReleaseCallbackData* callbackData);
+	virtual void motionCallback(
+			Vrui::LocatorTool::MotionCallbackData* callbackData);
+private:
+	bool dragging;
+	bool dragged;
+	Vrui::Point anchor;
+	/* Time stamp of the region of interest this locator set, or 0 */
+	unsigned long int placed;
+};
+
+#endif /*ROILOCATOR_H_*/
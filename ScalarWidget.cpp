@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <fstream>
@@ -10,6 +11,7 @@
 #include <Math/Math.h>
 #include <Misc/File.h>
 
+#include "GaussianEvaluator.h"
 #include "ScalarWidgetChangedCallbackData.h"
 #include "ScalarWidgetControlPoint.h"
 #include "ScalarWidgetControlPointChangedCallbackData.h"
@@ -795,27 +797,13 @@ void ScalarWidget::drawMargin(void) const {
  * exportScalar - Export the current scalar component.
  *
  * parameter colormap - double*
+ * parameter entries - int
  */
-void ScalarWidget::exportScalar(double* colormap) const {
-    if (!gaussian) {
-        for (int i = 0; i < numberOfEntries; ++i) {
-            double value = double(i) * (valueRange.second - valueRange.first) / double(numberOfEntries - 1) + valueRange.first;
-            ScalarWidgetControlPoint* previousControlPoint = first;
-            ScalarWidgetControlPoint* nextControlPoint;
-            for (nextControlPoint = previousControlPoint->right; nextControlPoint != last && nextControlPoint->getValue() < value; previousControlPoint
-                    = nextControlPoint, nextControlPoint = nextControlPoint->right)
-                ;
-            GLfloat w2 = GLfloat((value - previousControlPoint->getValue()) / (nextControlPoint->getValue()
-                    - previousControlPoint->getValue()));
-            GLfloat w1 = GLfloat((nextControlPoint->getValue() - value) / (nextControlPoint->getValue()
-                    - previousControlPoint->getValue()));
-            colormap[4*i + component] = (double) (previousControlPoint->getScalar() * w1
-                    + nextControlPoint->getScalar() * w2);
-        }
-    } else {
-        for (int i = 0; i < 256; i++)
-            colormap[4*i + component] = (double) (opacities[i]);
-    }
+void ScalarWidget::exportScalar(double* colormap, int entries) const {
+    if (!gaussian)
+        evaluateControlPoints(colormap + component, 4, entries);
+    else
+        evaluateGaussians(colormap + component, 4, entries);
 } // end exportScalar()
 
 std::vector<double> ScalarWidget::exportControlPointValues( void )
@@ -845,33 +833,59 @@ std::vector<double> ScalarWidget::exportControlPointValues( void )
  *
  * parameter colormap - double*
  * parameter component - int
+ * parameter entries - int
  */
-void ScalarWidget::exportScalar(double* colormap, int component) {
+void ScalarWidget::exportScalar(double* colormap, int component, int entries) {
     saveState();
     updatePointers(component);
-    if (!gaussian) {
-        for (int i = 0; i < numberOfEntries; ++i) {
-            double value = double(i) * (valueRange.second - valueRange.first) / double(numberOfEntries - 1) + valueRange.first;
-            ScalarWidgetControlPoint* previousControlPoint = first;
-            ScalarWidgetControlPoint* nextControlPoint;
-            for (nextControlPoint = previousControlPoint->right; nextControlPoint != last && nextControlPoint->getValue() < value; previousControlPoint
-                    = nextControlPoint, nextControlPoint = nextControlPoint->right)
-                ;
-            GLfloat w2 = GLfloat((value - previousControlPoint->getValue()) / (nextControlPoint->getValue()
-                    - previousControlPoint->getValue()));
-            GLfloat w1 = GLfloat((nextControlPoint->getValue() - value) / (nextControlPoint->getValue()
-                    - previousControlPoint->getValue()));
-            colormap[4*i + component] = (double) (previousControlPoint->getScalar() * w1
-                    + nextControlPoint->getScalar() * w2);
-        }
-    } else {
-        getOpacities();
-        for (int i = 0; i < 256; i++)
-            colormap[4*i + component] = (double) (opacities[i]);
-    }
+    if (!gaussian)
+        evaluateControlPoints(colormap + component, 4, entries);
+    else
+        evaluateGaussians(colormap + component, 4, entries);
     updatePointers(this->component);
 } // end exportScalar()
 
+/*
+ * evaluateControlPoints - Interpolate the scalars of the control points at
+ * entries equally spaced values of the value range. The values increase, so
+ * the control points are walked once for all of them.
+ *
+ * parameter values - double*
+ * parameter stride - int
+ * parameter entries - int
+ */
+void ScalarWidget::evaluateControlPoints(double* values, int stride, int entries) const {
+    ScalarWidgetControlPoint* previousControlPoint = first;
+    ScalarWidgetControlPoint* nextControlPoint = previousControlPoint->right;
+    for (int i = 0; i < entries; ++i) {
+        double value = double(i) * (valueRange.second - valueRange.first) / double(entries - 1) + valueRange.first;
+        for (; nextControlPoint != last && nextControlPoint->getValue() < value; previousControlPoint = nextControlPoint, nextControlPoint
+                = nextControlPoint->right)
+            ;
+        GLfloat w2 = GLfloat((value - previousControlPoint->getValue()) / (nextControlPoint->getValue()
+                - previousControlPoint->getValue()));
+        GLfloat w1 = GLfloat((nextControlPoint->getValue() - value) / (nextControlPoint->getValue()
+                - previousControlPoint->getValue()));
+        values[i * stride] = (double) (previousControlPoint->getScalar() * w1 + nextControlPoint->getScalar() * w2);
+    }
+} // end evaluateControlPoints()
+
+/*
+ * evaluateGaussians - Evaluate the Gaussians at entries equally spaced values.
+ *
+ * parameter values - double*
+ * parameter stride - int
+ * parameter entries - int
+ */
+void ScalarWidget::evaluateGaussians(double* values, int stride, int entries) const {
+    GaussianEvaluator evaluator;
+    evaluator.setGaussians(gaussians, numberOfGaussians);
+    std::vector<float> gaussianOpacities(entries);
+    evaluator.evaluate(&gaussianOpacities[0], entries);
+    for (int i = 0; i < entries; ++i)
+        values[i * stride] = (double) (gaussianOpacities[i]);
+} // end evaluateGaussians()
+
 /*
  * findGaussianControlPoint
  *
@@ -1074,63 +1088,9 @@ void ScalarWidget::setGaussian(bool gaussian) {
  * getOpacities
  */
 void ScalarWidget::getOpacities(void) {
-    for (int i = 0; i < 256; i++)
-        opacities[i] = float(0);
-    for (int p = 0; p < numberOfGaussians; p++) {
-        float position = gaussians[p].getX();
-        float height = gaussians[p].getH();
-        float width = gaussians[p].getW();
-        float xbias = gaussians[p].getBx();
-        float ybias = gaussians[p].getBy();
-        for (int i = 0; i < 256; i++) {
-            float x = float(i) / float(255);
-            // clamp non-zero values to pos +/- width
-            if (x > position + width || x < position - width) {
-                opacities[i] = opacities[i] > 0.0 ? opacities[i] : 0.0f;
-                continue;
-            }
-
-            // non-zero width
-            if (width == 0)
-                width = .00001;
-
-            // translate the original x to a new x based on the xbias
-            float x0;
-            if (xbias == 0 || x == position + xbias) {
-                x0 = x;
-            } else if (x > position + xbias) {
-                if (width == xbias)
-                    x0 = position;
-                else
-                    x0 = position + (x - position - xbias) * (width / (width - xbias));
-            } else // (x < pos+xbias)
-            {
-                if (-width == xbias)
-                    x0 = position;
-                else
-                    x0 = position - (x - position - xbias) * (width / (width + xbias));
-            }
-
-            // center around 0 and normalize to -1,1
-            float x1 = (x0 - position) / width;
-
-            // do a linear interpolation between:
-            //    a gaussian and a parabola        if 0<ybias<1
-            //    a parabola and a step function   if 1<ybias<2
-            float h0a = exp(-(4 * x1 * x1));
-            float h0b = 1. - x1 * x1;
-            float h0c = 1.;
-            float h1;
-            if (ybias < 1)
-                h1 = ybias * h0b + (1 - ybias) * h0a;
-            else
-                h1 = (2 - ybias) * h0b + (ybias - 1) * h0c;
-            float h2 = height * h1;
-
-            // perform the MAX over different gaussians, not the sum
-            opacities[i] = opacities[i] > h2 ? opacities[i] : h2;
-        }
-    }
+    GaussianEvaluator evaluator;
+    evaluator.setGaussians(gaussians, numberOfGaussians);
+    evaluator.evaluate(opacities, 256);
 } // end getOpacities()
 
 /*
@@ -1189,12 +1149,12 @@ void ScalarWidget::setPreferredSize(const GLMotif::Vector& _preferredSize) {
  * parameter _scalar - float*
  */
 void ScalarWidget::getScalar(float* _scalar) {
+    ScalarWidgetControlPoint* previousControlPoint = first;
+    ScalarWidgetControlPoint* nextControlPoint = previousControlPoint->right;
     for (int i = 0; i < numberOfEntries; ++i) {
         double value = double(i) * (valueRange.second - valueRange.first) / double(numberOfEntries - 1) + valueRange.first;
-        ScalarWidgetControlPoint* previousControlPoint = first;
-        ScalarWidgetControlPoint* nextControlPoint;
-        for (nextControlPoint = previousControlPoint->right; nextControlPoint != last && nextControlPoint->getValue() < value; previousControlPoint
-                = nextControlPoint, nextControlPoint = nextControlPoint->right)
+        for (; nextControlPoint != last && nextControlPoint->getValue() < value; previousControlPoint = nextControlPoint, nextControlPoint
+                = nextControlPoint->right)
             ;
         double w2 = (value - previousControlPoint->getValue()) / (nextControlPoint->getValue() - previousControlPoint->getValue());
         double w1 = (nextControlPoint->getValue() - value) / (nextControlPoint->getValue() - previousControlPoint->getValue());
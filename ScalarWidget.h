@@ -57,8 +57,8 @@ public:
     void drawLine(void) const;
     void drawMargin(void) const;
     std::vector<double> exportControlPointValues(void);
-    void exportScalar(double* _scalar) const;
-    void exportScalar(double* colormap, int component);
+    void exportScalar(double* colormap, int entries = 256) const;
+    void exportScalar(double* colormap, int component, int entries);
     bool findGaussianControlPoint(float x, float y, float z);
     virtual bool findRecipient(GLMotif::Event& event);
     Misc::CallbackList& getChangedCallbacks(void);
@@ -141,6 +141,8 @@ private:
     float * redOpacities;
     bool unselected;
     std::pair<double,double> valueRange;
+    void evaluateControlPoints(double* values, int stride, int entries) const;
+    void evaluateGaussians(double* values, int stride, int entries) const;
     void saveState(void);
     void updateControlPoints(void);
     void updatePointers(int component);
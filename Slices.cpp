@@ -51,7 +51,6 @@ void Slices::changeSlicesColorMapCallback(GLMotif::RadioBox::ValueChangedCallbac
     /* Set the new slices colormap */
     int value = callBackData->radioBox->getToggleIndex(callBackData->newSelectedToggle);
     changeSlicesColorMap(value);
-    exportSlicesColorMap(sliceColormap);
     exampleVTKReader->updateSliceColorMap(sliceColormap);
     Vrui::requestUpdate();
 } // end changeSlicesColorMapCallback()
@@ -373,7 +372,7 @@ void Slices::createZSlices(GLMotif::RowColumn * & xyzSlicesRowColumn, const GLMo
  * parameter colormap - unsigned char *
  */
 void Slices::exportSlicesColorMap(double* colormap) const {
-    colorMap->exportColorMap(colormap);
+    colorMap->exportColorMap(colormap, exampleVTKReader->getColorMapResolution());
 } // end exportSlicesColorMap()
 
 /*
@@ -457,7 +456,6 @@ void Slices::removeControlPointCallback(Misc::CallbackData* _callbackData) {
  * parameter callBackData - Misc::CallbackData *
  */
 void Slices::sliceColorMapChangedCallback(Misc::CallbackData * callBackData) {
-    exportSlicesColorMap(sliceColormap);
     exampleVTKReader->updateSliceColorMap(sliceColormap);
     Vrui::requestUpdate();
 } // end sliceColorMapChangedCallback()
@@ -285,7 +285,7 @@ void TransferFunction1D::createTransferFunction1D(int colorMapCreationType, int
  * parameter colormap - double*
  */
 void TransferFunction1D::exportAlpha(double* colormap) const {
-    alphaComponent->exportScalar(colormap);
+    alphaComponent->exportScalar(colormap, exampleVTKReader->getColorMapResolution());
 } // end exportAlpha()
 
 /*
@@ -294,7 +294,7 @@ void TransferFunction1D::exportAlpha(double* colormap) const {
  * parameter colormap - double*
  */
 void TransferFunction1D::exportColorMap(double* colormap) const {
-    colorMap->exportColorMap(colormap);
+    colorMap->exportColorMap(colormap, exampleVTKReader->getColorMapResolution());
 }
 
 /*
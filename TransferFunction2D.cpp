@@ -0,0 +1,225 @@
+/* Vrui includes */
+#include <GLMotif/Button.h>
+#include <GLMotif/Label.h>
+#include <GLMotif/WidgetManager.h>
+
+/* Vrui includes to use the Vrui interface */
+#include <Vrui/Vrui.h>
+
+#include "TransferFunction2D.h"
+#include "TransferFunction2DWidget.h"
+#include "volJointHistogram.h"
+
+/*
+ * TransferFunction2D - Constructor for TransferFunction2D class.
+ * 		extends GLMotif::PopupWindow
+ */
+TransferFunction2D::TransferFunction2D(void) :
+    GLMotif::PopupWindow("TransferFunction2DPopup", Vrui::getWidgetManager(), "2D Transfer Function Editor") {
+    initialize();
+}
+
+/*
+ * ~TransferFunction2D - Destructor for TransferFunction2D class.
+ */
+TransferFunction2D::~TransferFunction2D(void) {
+}
+
+/*
+ * clearCallback - Remove all regions.
+ *
+ * parameter _callbackData - Misc::CallbackData*
+ */
+void TransferFunction2D::clearCallback(Misc::CallbackData* _callbackData) {
+    regionsWidget->setRegions(std::vector<volTransferFunction2D::Region>());
+} // end clearCallback()
+
+/*
+ * colorSliderCallback - Callback of change to color or opacity slider value.
+ *
+ * parameter _callbackData - Misc::CallbackData*
+ */
+void TransferFunction2D::colorSliderCallback(Misc::CallbackData* _callbackData) {
+    double rgba[4];
+    for (int i = 0; i < 4; ++i) {
+        rgba[i] = colorSliders[i]->getValue();
+    }
+    colorPane->setBackgroundColor(GLMotif::Color(float(rgba[0]), float(rgba[1]), float(rgba[2])));
+    regionsWidget->setSelectedColor(rgba);
+} // end colorSliderCallback()
+
+/*
+ * createButtonBox - Create a box to hold buttons.
+ *
+ * parameter transferFunctionDialog - GLMotif::RowColumn*&
+ * return - GLMotif::RowColumn*
+ */
+GLMotif::RowColumn* TransferFunction2D::createButtonBox(GLMotif::RowColumn*& transferFunctionDialog) {
+    GLMotif::RowColumn* buttonBox = new GLMotif::RowColumn("ButtonBox", transferFunctionDialog, false);
+    buttonBox->setOrientation(GLMotif::RowColumn::HORIZONTAL);
+    buttonBox->setPacking(GLMotif::RowColumn::PACK_GRID);
+    GLMotif::Button* removeRegionButton = new GLMotif::Button("RemoveRegionButton", buttonBox, "Remove Region");
+    removeRegionButton->getSelectCallbacks().add(this, &TransferFunction2D::removeRegionCallback);
+    GLMotif::Button* clearButton = new GLMotif::Button("ClearButton", buttonBox, "Clear");
+    clearButton->getSelectCallbacks().add(this, &TransferFunction2D::clearCallback);
+    return buttonBox;
+} // end createButtonBox()
+
+/*
+ * createColorPanel - Create the color pane of the selected region and the
+ *                    sliders of its color and opacity.
+ *
+ * parameter styleSheet - const GLMotif::StyleSheet&
+ * parameter transferFunctionDialog - GLMotif::RowColumn*&
+ */
+void TransferFunction2D::createColorPanel(const GLMotif::StyleSheet& styleSheet, GLMotif::RowColumn*& transferFunctionDialog) {
+    GLMotif::RowColumn* colorPanel = new GLMotif::RowColumn("ColorPanel", transferFunctionDialog, false);
+    colorPanel->setOrientation(GLMotif::RowColumn::HORIZONTAL);
+    colorPanel->setMarginWidth(styleSheet.size);
+    colorPane = new GLMotif::Blind("ColorPane", colorPanel);
+    colorPane->setBorderWidth(styleSheet.size * 0.5f);
+    colorPane->setBorderType(GLMotif::Widget::LOWERED);
+    colorPane->setBackgroundColor(GLMotif::Color(1.0f, 1.0f, 1.0f));
+    colorPane->setPreferredSize(GLMotif::Vector(styleSheet.fontHeight * 5.0f, styleSheet.fontHeight * 5.0f, 0.0f));
+    GLMotif::RowColumn* colorSlidersBox = new GLMotif::RowColumn("ColorSliders", colorPanel, false);
+    colorSlidersBox->setOrientation(GLMotif::RowColumn::HORIZONTAL);
+    colorSlidersBox->setPacking(GLMotif::RowColumn::PACK_GRID);
+    colorSliders[0] = createColorSlider("RedSlider", GLMotif::Color(1.0f, 0.0f, 0.0f), styleSheet, colorSlidersBox);
+    colorSliders[1] = createColorSlider("GreenSlider", GLMotif::Color(0.0f, 1.0f, 0.0f), styleSheet, colorSlidersBox);
+    colorSliders[2] = createColorSlider("BlueSlider", GLMotif::Color(0.0f, 0.0f, 1.0f), styleSheet, colorSlidersBox);
+    colorSliders[3] = createColorSlider("OpacitySlider", GLMotif::Color(0.5f, 0.5f, 0.5f), styleSheet, colorSlidersBox);
+    colorSliders[3]->setValue(0.5f);
+    colorSlidersBox->manageChild();
+    new GLMotif::Blind("Filler", colorPanel);
+    colorPanel->manageChild();
+} // end createColorPanel()
+
+/*
+ * createColorSlider - Create color slider.
+ *
+ * parameter title - const char*
+ * parameter color - GLMotif::Color
+ * parameter styleSheet - const GLMotif::StyleSheet&
+ * parameter colorSliderBox - GLMotif::RowColumn*
+ * return - GLMotif::Slider*
+ */
+GLMotif::Slider* TransferFunction2D::createColorSlider(const char* title, GLMotif::Color color,
+        const GLMotif::StyleSheet& styleSheet, GLMotif::RowColumn* colorSlidersBox) {
+    GLMotif::Slider* colorSlider = new GLMotif::Slider(title, colorSlidersBox, GLMotif::Slider::VERTICAL, styleSheet.fontHeight
+            * 5.0f);
+    colorSlider->setSliderColor(color);
+    colorSlider->setValueRange(0.0f, 1.0f, 0.01f);
+    colorSlider->setValue(1.0f);
+    colorSlider->getValueChangedCallbacks().add(this, &TransferFunction2D::colorSliderCallback);
+    return colorSlider;
+} // end createColorSlider()
+
+/*
+ * createRegionsWidget - Create the widget to draw the regions over the
+ *                       histogram, with one region around the middle value to
+ *                       start from.
+ *
+ * parameter styleSheet - const GLMotif::StyleSheet&
+ * parameter transferFunctionDialog - GLMotif::RowColumn*&
+ */
+void TransferFunction2D::createRegionsWidget(const GLMotif::StyleSheet& styleSheet, GLMotif::RowColumn*& transferFunctionDialog) {
+    regionsWidget = new TransferFunction2DWidget("RegionsWidget", transferFunctionDialog);
+    regionsWidget->setBorderWidth(styleSheet.size * 0.5f);
+    regionsWidget->setBorderType(GLMotif::Widget::LOWERED);
+    regionsWidget->setMarginWidth(styleSheet.size);
+    regionsWidget->setPreferredSize(GLMotif::Vector(styleSheet.fontHeight * 20.0, styleSheet.fontHeight * 10.0, 0.0f));
+    regionsWidget->getSelectionChangedCallbacks().add(this, &TransferFunction2D::selectionChangedCallback);
+    volTransferFunction2D::Region region;
+    region.value[0] = 0.4;
+    region.value[1] = 0.6;
+    region.magnitude[0] = 0.2;
+    region.magnitude[1] = 1.0;
+    region.rgba[0] = 1.0;
+    region.rgba[1] = 1.0;
+    region.rgba[2] = 1.0;
+    region.rgba[3] = 0.5;
+    regionsWidget->setRegions(std::vector<volTransferFunction2D::Region>(1, region));
+} // end createRegionsWidget()
+
+/*
+ * createTransferFunctionDialog - Create the transfer function dialog.
+ *
+ * parameter styleSheet - const GLMotif::StyleSheet&
+ */
+void TransferFunction2D::createTransferFunctionDialog(const GLMotif::StyleSheet& styleSheet) {
+    GLMotif::RowColumn* transferFunctionDialog = new GLMotif::RowColumn("TransferFunction2DDialog", this, false);
+    new GLMotif::Label("RegionsLabel", transferFunctionDialog, "Value (across) by Gradient Magnitude (up):");
+    createRegionsWidget(styleSheet, transferFunctionDialog);
+    GLMotif::RowColumn* buttonBox = createButtonBox(transferFunctionDialog);
+    buttonBox->manageChild();
+    createColorPanel(styleSheet, transferFunctionDialog);
+    transferFunctionDialog->manageChild();
+} // end createTransferFunctionDialog()
+
+/*
+ * getChangedCallbacks - Called whenever the regions change.
+ *
+ * return - Misc::CallbackList&
+ */
+Misc::CallbackList& TransferFunction2D::getChangedCallbacks(void) {
+    return regionsWidget->getChangedCallbacks();
+} // end getChangedCallbacks()
+
+/*
+ * getRegions
+ *
+ * return - const std::vector<volTransferFunction2D::Region>&
+ */
+const std::vector<volTransferFunction2D::Region>& TransferFunction2D::getRegions(void) const {
+    return regionsWidget->getRegions();
+} // end getRegions()
+
+/*
+ * initialize - Initialize the GUI for the TransferFunction2D class.
+ */
+void TransferFunction2D::initialize(void) {
+    const GLMotif::StyleSheet& styleSheet = *Vrui::getWidgetManager()->getStyleSheet();
+    createTransferFunctionDialog(styleSheet);
+} // end initialize()
+
+/*
+ * isDragging
+ *
+ * return - bool
+ */
+bool TransferFunction2D::isDragging(void) const {
+    return regionsWidget->isDragging();
+} // end isDragging()
+
+/*
+ * removeRegionCallback - Remove the selected region.
+ *
+ * parameter _callbackData - Misc::CallbackData*
+ */
+void TransferFunction2D::removeRegionCallback(Misc::CallbackData* _callbackData) {
+    regionsWidget->removeSelectedRegion();
+} // end removeRegionCallback()
+
+/*
+ * selectionChangedCallback - Show the color and opacity of the selected region.
+ *
+ * parameter _callbackData - Misc::CallbackData*
+ */
+void TransferFunction2D::selectionChangedCallback(Misc::CallbackData* _callbackData) {
+    int selected = regionsWidget->getSelectedRegion();
+    if (selected < 0)
+        return;
+    const volTransferFunction2D::Region& region = regionsWidget->getRegions()[selected];
+    for (int i = 0; i < 4; ++i)
+        colorSliders[i]->setValue(region.rgba[i]);
+    colorPane->setBackgroundColor(GLMotif::Color(float(region.rgba[0]), float(region.rgba[1]), float(region.rgba[2])));
+} // end selectionChangedCallback()
+
+/*
+ * setHistogram - Show the joint histogram of the data behind the regions.
+ *
+ * parameter histogram - const volJointHistogram&
+ */
+void TransferFunction2D::setHistogram(const volJointHistogram& histogram) {
+    regionsWidget->setHistogram(histogram.logScaled(), volJointHistogram::ValueBins, volJointHistogram::MagnitudeBins);
+} // end setHistogram()
@@ -0,0 +1,46 @@
+#ifndef TRANSFERFUNCTION2D_INCLUDED
+#define TRANSFERFUNCTION2D_INCLUDED
+
+#include <vector>
+
+/* Vrui includes */
+#include <GLMotif/Blind.h>
+#include <GLMotif/PopupWindow.h>
+#include <GLMotif/RowColumn.h>
+#include <GLMotif/Slider.h>
+#include <GLMotif/StyleSheet.h>
+#include <Misc/CallbackData.h>
+#include <Misc/CallbackList.h>
+
+#include "volTransferFunction2D.h"
+
+// begin Forward Declarations
+class TransferFunction2DWidget;
+class volJointHistogram;
+
+class TransferFunction2D: public GLMotif::PopupWindow {
+public:
+    TransferFunction2D(void);
+    virtual ~TransferFunction2D(void);
+    Misc::CallbackList& getChangedCallbacks(void);
+    const std::vector<volTransferFunction2D::Region>& getRegions(void) const;
+    bool isDragging(void) const;
+    void setHistogram(const volJointHistogram& histogram);
+private:
+    GLMotif::Blind* colorPane;
+    GLMotif::Slider* colorSliders[4];
+    TransferFunction2DWidget* regionsWidget;
+    void clearCallback(Misc::CallbackData* _callbackData);
+    void colorSliderCallback(Misc::CallbackData* _callbackData);
+    GLMotif::RowColumn* createButtonBox(GLMotif::RowColumn*& transferFunctionDialog);
+    void createColorPanel(const GLMotif::StyleSheet& styleSheet, GLMotif::RowColumn*& transferFunctionDialog);
+    GLMotif::Slider* createColorSlider(const char* title, GLMotif::Color color, const GLMotif::StyleSheet& styleSheet,
+            GLMotif::RowColumn* colorSlidersBox);
+    void createRegionsWidget(const GLMotif::StyleSheet& styleSheet, GLMotif::RowColumn*& transferFunctionDialog);
+    void createTransferFunctionDialog(const GLMotif::StyleSheet& styleSheet);
+    void initialize(void);
+    void removeRegionCallback(Misc::CallbackData* _callbackData);
+    void selectionChangedCallback(Misc::CallbackData* _callbackData);
+};
+
+#endif
@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <cmath>
+
+/* Vrui includes */
+#include <GL/GLColorTemplates.h>
+#include <GL/GLVertexTemplates.h>
+
+#include "TransferFunction2DWidget.h"
+
+/* Size of the corner handles of the selected region, in function units */
+static const double handleSize = 0.03;
+
+/* Regions narrower or lower than this, in function units, are dropped */
+static const double minimumRegionSize = 1.0 / 256.0;
+
+/*
+ * TransferFunction2DWidget - Constructor for the TransferFunction2DWidget class.
+ *
+ * parameter _name - const char*
+ * parameter _parent - GLMotif::Container*
+ * parameter _manageChild - bool
+ */
+TransferFunction2DWidget::TransferFunction2DWidget(const char* _name, GLMotif::Container* _parent, bool _manageChild) :
+	GLMotif::Widget(_name, _parent, false) {
+	columns = 0;
+	rows = 0;
+	marginWidth = 0.0f;
+	preferredSize[0] = 0.0f;
+	preferredSize[1] = 0.0f;
+	preferredSize[2] = 0.0f;
+	selected = -1;
+	newColor[0] = 1.0;
+	newColor[1] = 1.0;
+	newColor[2] = 1.0;
+	newColor[3] = 0.5;
+	dragMode = dragNone;
+	anchor[0] = anchor[1] = 0.0;
+	dragOffset[0] = dragOffset[1] = 0.0;
+	if (_manageChild)
+		manageChild();
+} // end TransferFunction2DWidget()
+
+/*
+ * ~TransferFunction2DWidget - Destructor for the TransferFunction2DWidget class.
+ */
+TransferFunction2DWidget::~TransferFunction2DWidget(void) {
+} // end ~TransferFunction2DWidget()
+
+/*
+ * calcNaturalSize - Determine the natural size of the widget. A virtual function of GLMotif::Widget base.
+ *
+ * return - GLMotif::Vector
+ */
+GLMotif::Vector TransferFunction2DWidget::calcNaturalSize(void) const {
+	GLMotif::Vector result = preferredSize;
+	result[0] += 2.0f * marginWidth;
+	result[1] += 2.0f * marginWidth;
+	return calcExteriorSize(result);
+} // end calcNaturalSize()
+
+/*
+ * draw - Draw the histogram and the regions over it.
+ *
+ * parameter glContextData - GLContextData&
+ */
+void TransferFunction2DWidget::draw(GLContextData& glContextData) const {
+	Widget::draw(glContextData);
+	GLfloat x1 = histogramAreaBox.getCorner(0)[0];
+	GLfloat x2 = histogramAreaBox.getCorner(1)[0];
+	GLfloat y1 = histogramAreaBox.getCorner(0)[1];
+	GLfloat y2 = histogramAreaBox.getCorner(2)[1];
+	GLfloat z = histogramAreaBox.getCorner(0)[2];
+	drawMargin();
+	GLboolean lightingEnabled = glIsEnabled(GL_LIGHTING);
+	if (lightingEnabled)
+		glDisable(GL_LIGHTING);
+	drawHistogram(x1, y1, z, x2 - x1, y2 - y1);
+	GLfloat lineWidth;
+	glGetFloatv(GL_LINE_WIDTH, &lineWidth);
+	drawRegions(x1, y1, z, x2 - x1, y2 - y1);
+	glLineWidth(lineWidth);
+	if (lightingEnabled)
+		glEnable(GL_LIGHTING);
+} // end draw()
+
+/*
+ * drawHistogram - Draw the log scaled histogram in shades of gray over a black area.
+ *
+ * parameter x - GLfloat
+ * parameter y - GLfloat
+ * parameter z - GLfloat
+ * parameter width - GLfloat
+ * parameter height - GLfloat
+ */
+void TransferFunction2DWidget::drawHistogram(GLfloat x, GLfloat y, GLfloat z, GLfloat width, GLfloat height) const {
+	glColor3f(0.0f, 0.0f, 0.0f);
+	glBegin(GL_QUADS);
+	glNormal3f(0.0f, 0.0f, 1.0f);
+	glVertex(histogramAreaBox.getCorner(0));
+	glVertex(histogramAreaBox.getCorner(1));
+	glVertex(histogramAreaBox.getCorner(3));
+	glVertex(histogramAreaBox.getCorner(2));
+	glEnd();
+	/* Most bins are empty; only the others are drawn: */
+	glBegin(GL_QUADS);
+	for (int row = 0; row < rows; row++) {
+		GLfloat _y1 = GLfloat(float(row) / float(rows) * height + y);
+		GLfloat _y2 = GLfloat(float(row + 1) / float(rows) * height + y);
+		for (int column = 0; column < columns; column++) {
+			float value = histogram[column + columns * row];
+			if (value <= 0.0f)
+				continue;
+			GLfloat _x1 = GLfloat(float(column) / float(columns) * width + x);
+			GLfloat _x2 = GLfloat(float(column + 1) / float(columns) * width + x);
+			glColor3f(value, value, value);
+			glVertex3f(_x1, _y1, z);
+			glVertex3f(_x2, _y1, z);
+			glVertex3f(_x2, _y2, z);
+			glVertex3f(_x1, _y2, z);
+		}
+	}
+	glEnd();
+} // end drawHistogram()
+
+/*
+ * drawMargin - Draw margin area in background color.
+ */
+void TransferFunction2DWidget::drawMargin(void) const {
+	glColor(backgroundColor);
+	glBegin(GL_QUADS);
+	glNormal3f(0.0f, 0.0f, 1.0f);
+	glVertex(getInterior().getCorner(0));
+	glVertex(histogramAreaBox.getCorner(0));
+	glVertex(histogramAreaBox.getCorner(2));
+	glVertex(getInterior().getCorner(2));
+	glVertex(getInterior().getCorner(1));
+	glVertex(getInterior().getCorner(3));
+	glVertex(histogramAreaBox.getCorner(3));
+	glVertex(histogramAreaBox.getCorner(1));
+	glVertex(getInterior().getCorner(0));
+	glVertex(getInterior().getCorner(1));
+	glVertex(histogramAreaBox.getCorner(1));
+	glVertex(histogramAreaBox.getCorner(0));
+	glVertex(getInterior().getCorner(2));
+	glVertex(histogramAreaBox.getCorner(2));
+	glVertex(histogramAreaBox.getCorner(3));
+	glVertex(getInterior().getCorner(3));
+	glEnd();
+} // end drawMargin()
+
+/*
+ * drawRegions - Draw the outline of each region in its color, with a line at
+ *               its center value where its opacity peaks, and the corner
+ *               handles of the selected region.
+ *
+ * parameter x - GLfloat
+ * parameter y - GLfloat
+ * parameter z - GLfloat
+ * parameter width - GLfloat
+ * parameter height - GLfloat
+ */
+void TransferFunction2DWidget::drawRegions(GLfloat x, GLfloat y, GLfloat z, GLfloat width, GLfloat height) const {
+	for (size_t i = 0; i < regions.size(); i++) {
+		const volTransferFunction2D::Region& region = regions[i];
+		GLfloat _x1 = GLfloat(region.value[0] * width + x);
+		GLfloat _x2 = GLfloat(region.value[1] * width + x);
+		GLfloat _xc = GLfloat(0.5f * (_x1 + _x2));
+		GLfloat _y1 = GLfloat(region.magnitude[0] * height + y);
+		GLfloat _y2 = GLfloat(region.magnitude[1] * height + y);
+		if (int(i) == selected) {
+			glLineWidth(3.0f);
+			glColor3f(1.0f, 1.0f, 1.0f);
+		} else {
+			glLineWidth(1.0f);
+			glColor3f(GLfloat(region.rgba[0]), GLfloat(region.rgba[1]), GLfloat(region.rgba[2]));
+		}
+		glBegin(GL_LINE_LOOP);
+		glVertex3f(_x1, _y1, z);
+		glVertex3f(_x2, _y1, z);
+		glVertex3f(_x2, _y2, z);
+		glVertex3f(_x1, _y2, z);
+		glEnd();
+		glColor3f(GLfloat(region.rgba[0]), GLfloat(region.rgba[1]), GLfloat(region.rgba[2]));
+		glBegin(GL_LINES);
+		glVertex3f(_xc, _y1, z);
+		glVertex3f(_xc, _y2, z);
+		glEnd();
+		if (int(i) == selected) {
+			GLfloat _w = GLfloat(handleSize * width * 0.5);
+			GLfloat _h = GLfloat(handleSize * height * 0.5);
+			GLfloat _cx[2] = { _x1, _x2 };
+			GLfloat _cy[2] = { _y1, _y2 };
+			glColor3f(1.0f, 1.0f, 1.0f);
+			glBegin(GL_QUADS);
+			for (int corner = 0; corner < 4; corner++) {
+				GLfloat _x = _cx[corner % 2];
+				GLfloat _y = _cy[corner / 2];
+				glVertex3f(_x - _w, _y - _h, z);
+				glVertex3f(_x + _w, _y - _h, z);
+				glVertex3f(_x + _w, _y + _h, z);
+				glVertex3f(_x - _w, _y + _h, z);
+			}
+			glEnd();
+		}
+	}
+} // end drawRegions()
+
+/*
+ * findRecipient - Determine which is the applicable widget of the event. A virtual function of GLMotif::Widget base.
+ *
+ * parameter event - GLMotif::Event&
+ * return - bool
+ */
+bool TransferFunction2DWidget::findRecipient(GLMotif::Event& event) {
+	if (dragMode != dragNone) {
+		return event.setTargetWidget(this, event.calcWidgetPoint(this));
+	} else
+		return GLMotif::Widget::findRecipient(event);
+} // end findRecipient()
+
+/*
+ * getChangedCallbacks - Called whenever the regions change.
+ *
+ * return - Misc::CallbackList&
+ */
+Misc::CallbackList& TransferFunction2DWidget::getChangedCallbacks(void) {
+	return changedCallbacks;
+} // end getChangedCallbacks()
+
+/*
+ * getSelectionChangedCallbacks - Called whenever another region is selected.
+ *
+ * return - Misc::CallbackList&
+ */
+Misc::CallbackList& TransferFunction2DWidget::getSelectionChangedCallbacks(void) {
+	return selectionChangedCallbacks;
+} // end getSelectionChangedCallbacks()
+
+/*
+ * setHistogram - Set the histogram to draw, values in [0, 1] of _columns value
+ *                bins by _rows magnitude bins, the rows one after the other.
+ *
+ * parameter _histogram - const std::vector<float>&
+ * parameter _columns - int
+ * parameter _rows - int
+ */
+void TransferFunction2DWidget::setHistogram(const std::vector<float>& _histogram, int _columns, int _rows) {
+	histogram = _histogram;
+	columns = _columns;
+	rows = _rows;
+} // end setHistogram()
+
+/*
+ * setMarginWidth - Set the margin width.
+ *
+ * parameter _marginWidth - GLfloat
+ */
+void TransferFunction2DWidget::setMarginWidth(GLfloat _marginWidth) {
+	marginWidth = _marginWidth;
+	if (isManaged) {
+		parent->requestResize(this, calcNaturalSize());
+	} else
+		resize(GLMotif::Box(GLMotif::Vector(0.0f, 0.0f, 0.0f), calcNaturalSize()));
+} // end setMarginWidth()
+
+/*
+ * setPreferredSize - Set the preferred size of the histogram area.
+ *
+ * parameter _preferredSize - const GLMotif::Vector&
+ */
+void TransferFunction2DWidget::setPreferredSize(const GLMotif::Vector& _preferredSize) {
+	preferredSize = _preferredSize;
+	if (isManaged) {
+		parent->requestResize(this, calcNaturalSize());
+	} else
+		resize(GLMotif::Box(GLMotif::Vector(0.0f, 0.0f, 0.0f), calcNaturalSize()));
+} // end setPreferredSize()
+
+/*
+ * getRegions
+ *
+ * return - const std::vector<volTransferFunction2D::Region>&
+ */
+const std::vector<volTransferFunction2D::Region>& TransferFunction2DWidget::getRegions(void) const {
+	return regions;
+} // end getRegions()
+
+/*
+ * setRegions - Replace the regions, selecting none.
+ *
+ * parameter _regions - const std::vector<volTransferFunction2D::Region>&
+ */
+void TransferFunction2DWidget::setRegions(const std::vector<volTransferFunction2D::Region>& _regions) {
+	regions = _regions;
+	selected = -1;
+	Misc::CallbackData callbackData;
+	selectionChangedCallbacks.call(&callbackData);
+	changedCallbacks.call(&callbackData);
+} // end setRegions()
+
+/*
+ * getSelectedRegion
+ *
+ * return - int - index of the selected region, -1 if none
+ */
+int TransferFunction2DWidget::getSelectedRegion(void) const {
+	return selected;
+} // end getSelectedRegion()
+
+/*
+ * setSelectedColor - Set the color and opacity of the selected region, and of
+ *                    the regions drawn next.
+ *
+ * parameter rgba - const double*
+ */
+void TransferFunction2DWidget::setSelectedColor(const double* rgba) {
+	std::copy(rgba, rgba + 4, newColor);
+	if (selected >= 0) {
+		std::copy(rgba, rgba + 4, regions[selected].rgba.begin());
+		Misc::CallbackData callbackData;
+		changedCallbacks.call(&callbackData);
+	}
+} // end setSelectedColor()
+
+/*
+ * removeSelectedRegion
+ */
+void TransferFunction2DWidget::removeSelectedRegion(void) {
+	if (selected < 0)
+		return;
+	regions.erase(regions.begin() + selected);
+	selected = -1;
+	Misc::CallbackData callbackData;
+	selectionChangedCallbacks.call(&callbackData);
+	changedCallbacks.call(&callbackData);
+} // end removeSelectedRegion()
+
+/*
+ * isDragging
+ *
+ * return - bool
+ */
+bool TransferFunction2DWidget::isDragging(void) const {
+	return dragMode != dragNone;
+} // end isDragging()
+
+/*
+ * pointerButtonDown - Pointer button down event handler. A virtual function of GLMotif::Widget base.
+ *
+ * parameter event - GLMotif::Event&
+ */
+void TransferFunction2DWidget::pointerButtonDown(GLMotif::Event& event) {
+	double point[2];
+	toFunction(event, point);
+	int corner = findCorner(point);
+	if (corner >= 0) {
+		/* Resize the selected region, keeping the opposite corner in place: */
+		const volTransferFunction2D::Region& region = regions[selected];
+		anchor[0] = region.value[1 - corner % 2];
+		anchor[1] = region.magnitude[1 - corner / 2];
+		dragMode = dragResize;
+		return;
+	}
+	int region = findRegion(point);
+	if (region >= 0) {
+		/* Move the region under the pointer: */
+		selected = region;
+		dragOffset[0] = point[0] - regions[region].value[0];
+		dragOffset[1] = point[1] - regions[region].magnitude[0];
+		dragMode = dragMove;
+	} else {
+		/* Draw a new region from here: */
+		volTransferFunction2D::Region newRegion;
+		newRegion.value[0] = newRegion.value[1] = point[0];
+		newRegion.magnitude[0] = newRegion.magnitude[1] = point[1];
+		std::copy(newColor, newColor + 4, newRegion.rgba.begin());
+		regions.push_back(newRegion);
+		selected = int(regions.size()) - 1;
+		anchor[0] = point[0];
+		anchor[1] = point[1];
+		dragMode = dragResize;
+	}
+	Misc::CallbackData callbackData;
+	selectionChangedCallbacks.call(&callbackData);
+} // end pointerButtonDown()
+
+/*
+ * pointerButtonUp - Pointer button up event handler. A virtual function of GLMotif::Widget base.
+ *
+ * parameter event - GLMotif::Event&
+ */
+void TransferFunction2DWidget::pointerButtonUp(GLMotif::Event& event) {
+	if (dragMode == dragResize && selected >= 0) {
+		const volTransferFunction2D::Region& region = regions[selected];
+		if (region.value[1] - region.value[0] < minimumRegionSize ||
+		    region.magnitude[1] - region.magnitude[0] < minimumRegionSize) {
+			/* A click, not a drag: */
+			dragMode = dragNone;
+			removeSelectedRegion();
+			return;
+		}
+	}
+	dragMode = dragNone;
+} // end pointerButtonUp()
+
+/*
+ * pointerMotion - Pointer motion event handler. A virtual function of GLMotif::Widget base.
+ *
+ * parameter event - GLMotif::Event&
+ */
+void TransferFunction2DWidget::pointerMotion(GLMotif::Event& event) {
+	if (dragMode == dragNone || selected < 0)
+		return;
+	double point[2];
+	toFunction(event, point);
+	volTransferFunction2D::Region& region = regions[selected];
+	if (dragMode == dragResize) {
+		region.value[0] = std::min(anchor[0], point[0]);
+		region.value[1] = std::max(anchor[0], point[0]);
+		region.magnitude[0] = std::min(anchor[1], point[1]);
+		region.magnitude[1] = std::max(anchor[1], point[1]);
+	} else {
+		double width = region.value[1] - region.value[0];
+		double height = region.magnitude[1] - region.magnitude[0];
+		region.value[0] = std::min(std::max(point[0] - dragOffset[0], 0.0), 1.0 - width);
+		region.value[1] = region.value[0] + width;
+		region.magnitude[0] = std::min(std::max(point[1] - dragOffset[1], 0.0), 1.0 - height);
+		region.magnitude[1] = region.magnitude[0] + height;
+	}
+	Misc::CallbackData callbackData;
+	changedCallbacks.call(&callbackData);
+} // end pointerMotion()
+
+/*
+ * resize - Resize the widget. A virtual function of GLMotif::Widget base.
+ *
+ * parameter _exterior - const GLMotif::Box&
+ */
+void TransferFunction2DWidget::resize(const GLMotif::Box& _exterior) {
+	GLMotif::Widget::resize(_exterior);
+	histogramAreaBox = getInterior();
+	histogramAreaBox.doInset(GLMotif::Vector(marginWidth, marginWidth, 0.0f));
+} // end resize()
+
+/*
+ * toFunction - Convert the event's position to value and magnitude in [0, 1].
+ *
+ * parameter event - const GLMotif::Event&
+ * parameter point - double[2]
+ */
+void TransferFunction2DWidget::toFunction(const GLMotif::Event& event, double point[2]) const {
+	GLfloat x1 = histogramAreaBox.getCorner(0)[0];
+	GLfloat x2 = histogramAreaBox.getCorner(1)[0];
+	GLfloat y1 = histogramAreaBox.getCorner(0)[1];
+	GLfloat y2 = histogramAreaBox.getCorner(2)[1];
+	double _x = event.getWidgetPoint().getPoint()[0];
+	double _y = event.getWidgetPoint().getPoint()[1];
+	point[0] = std::min(std::max((_x - x1) / (x2 - x1), 0.0), 1.0);
+	point[1] = std::min(std::max((_y - y1) / (y2 - y1), 0.0), 1.0);
+} // end toFunction()
+
+/*
+ * findCorner - Find the corner handle of the selected region at point.
+ *
+ * parameter point - const double[2]
+ * return - int - corner, the lowest value and magnitude first, -1 if none
+ */
+int TransferFunction2DWidget::findCorner(const double point[2]) const {
+	if (selected < 0)
+		return -1;
+	const volTransferFunction2D::Region& region = regions[selected];
+	for (int corner = 0; corner < 4; corner++) {
+		if (std::fabs(point[0] - region.value[corner % 2]) <= handleSize * 0.5 &&
+		    std::fabs(point[1] - region.magnitude[corner / 2]) <= handleSize * 0.5)
+			return corner;
+	}
+	return -1;
+} // end findCorner()
+
+/*
+ * findRegion - Find the topmost region (the last drawn) containing point.
+ *
+ * parameter point - const double[2]
+ * return - int - index of the region, -1 if none
+ */
+int TransferFunction2DWidget::findRegion(const double point[2]) const {
+	for (int i = int(regions.size()) - 1; i >= 0; i--) {
+		const volTransferFunction2D::Region& region = regions[i];
+		if (point[0] >= region.value[0] && point[0] <= region.value[1] &&
+		    point[1] >= region.magnitude[0] && point[1] <= region.magnitude[1])
+			return i;
+	}
+	return -1;
+} // end findRegion()
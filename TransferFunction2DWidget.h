@@ -0,0 +1,70 @@
+#ifndef TRANSFERFUNCTION2DWIDGET_INCLUDED
+#define TRANSFERFUNCTION2DWIDGET_INCLUDED
+
+#include <GL/gl.h>
+#include <vector>
+
+/* Vrui includes */
+#include <GLMotif/Container.h>
+#include <GLMotif/Event.h>
+#include <GLMotif/Types.h>
+#include <GLMotif/Widget.h>
+#include <Misc/CallbackList.h>
+
+#include "volTransferFunction2D.h"
+
+/*
+ * TransferFunction2DWidget - Paints the regions of a 2D transfer function
+ * over the joint histogram of value (horizontal) and gradient magnitude
+ * (vertical). Dragging in an empty area draws a new region, dragging a region
+ * moves it, and dragging a corner of the selected region resizes it.
+ */
+class TransferFunction2DWidget : public GLMotif::Widget {
+public:
+	TransferFunction2DWidget(const char* _name, GLMotif::Container* _parent, bool _manageChild=true);
+	virtual ~TransferFunction2DWidget(void);
+	virtual GLMotif::Vector calcNaturalSize(void) const;
+	virtual void draw(GLContextData& contextData) const;
+	void drawHistogram(GLfloat x, GLfloat y, GLfloat z, GLfloat width, GLfloat height) const;
+	void drawMargin(void) const;
+	void drawRegions(GLfloat x, GLfloat y, GLfloat z, GLfloat width, GLfloat height) const;
+	virtual bool findRecipient(GLMotif::Event& event);
+	Misc::CallbackList& getChangedCallbacks(void);
+	Misc::CallbackList& getSelectionChangedCallbacks(void);
+	void setHistogram(const std::vector<float>& _histogram, int _columns, int _rows);
+	void setMarginWidth(GLfloat _marginWidth);
+	void setPreferredSize(const GLMotif::Vector& _preferredSize);
+	const std::vector<volTransferFunction2D::Region>& getRegions(void) const;
+	void setRegions(const std::vector<volTransferFunction2D::Region>& _regions);
+	int getSelectedRegion(void) const;
+	void setSelectedColor(const double* rgba);
+	void removeSelectedRegion(void);
+	bool isDragging(void) const;
+	virtual void pointerButtonDown(GLMotif::Event& event);
+	virtual void pointerButtonUp(GLMotif::Event& event);
+	virtual void pointerMotion(GLMotif::Event& event);
+	virtual void resize(const GLMotif::Box& _exterior);
+private:
+	enum DragMode {
+		dragNone, dragMove, dragResize
+	};
+	GLMotif::Box histogramAreaBox;
+	Misc::CallbackList changedCallbacks;
+	Misc::CallbackList selectionChangedCallbacks;
+	std::vector<float> histogram;
+	int columns;
+	int rows;
+	GLfloat marginWidth;
+	GLMotif::Vector preferredSize;
+	std::vector<volTransferFunction2D::Region> regions;
+	int selected;
+	double newColor[4];
+	DragMode dragMode;
+	double anchor[2];
+	double dragOffset[2];
+	void toFunction(const GLMotif::Event& event, double point[2]) const;
+	int findCorner(const double point[2]) const;
+	int findRegion(const double point[2]) const;
+};
+
+#endif
@@ -1,9 +1,11 @@
 // STD includes
 #include <iostream>
 #include <string>
+#include <vector>
 
 // ExampleVTKReader includes
 #include "ExampleVTKReader.h"
+#include "volTimeSeries.h"
 
 void printUsage(void)
 {
@@ -12,8 +14,34 @@ void printUsage(void)
   std::cout << "\nWhere:" << std::endl;
   std::cout << "\t-f <string>, -fileName <string>" << std::endl;
   std::cout << "\tName of VTK file to load using VTK.\n" << std::endl;
+  std::cout << "\t-t <pattern>, -timeSeries <pattern>" << std::endl;
+  std::cout << "\tTimesteps to load, e.g. \"run/*.vti\" or \"run/step_%04d.vti\"." << std::endl;
+  std::cout << "\tMay be given several times; the files are played in order.\n" << std::endl;
+  std::cout << "\t-shm <string>, -sharedMemory <string>" << std::endl;
+  std::cout << "\tShow the steps a running simulation publishes in the shared" << std::endl;
+  std::cout << "\tmemory segment, e.g. /volumeviewer (see volShmProducer).\n" << std::endl;
   std::cout << "\t-r <digit>, -renderMode <digit>" << std::endl;
-  std::cout << "\tRender mode to request for vtkSmartVolumeMapper.\n" << std::endl;
+  std::cout << "\tRender mode to request for vtkSmartVolumeMapper (0-4), or to" << std::endl;
+  std::cout << "\tray cast on the CPU: 5 pre-integrated, 6 post-classified," << std::endl;
+  std::cout << "\t7-9 maximum, minimum and average intensity projection, or" << std::endl;
+  std::cout << "\t10 with the 2D transfer function (value and gradient).\n" << std::endl;
+  std::cout << "\t-outOfCore" << std::endl;
+  std::cout << "\tPage the data in from a brick file instead of loading it.\n" << std::endl;
+  std::cout << "\t-brickBudget <MB>" << std::endl;
+  std::cout << "\tMemory used for paged bricks when out of core.\n" << std::endl;
+  std::cout << "\t-colorMapResolution <entries>" << std::endl;
+  std::cout << "\tEntries of the color maps; more than the default 256 resolve" << std::endl;
+  std::cout << "\tfiner features of 16-bit and float data.\n" << std::endl;
+  std::cout << "\t-memoryBudget <MB>" << std::endl;
+  std::cout << "\tMemory held before caches and hidden results are evicted;" << std::endl;
+  std::cout << "\t0 for no limit. Defaults to half the physical memory.\n" << std::endl;
+  std::cout << "\t-targetFrameRate <fps>" << std::endl;
+  std::cout << "\tFrame rate to keep while navigating by lowering the volume's" << std::endl;
+  std::cout << "\tquality; 0 to always render at full quality. Defaults to 60.\n" << std::endl;
+  std::cout << "\t-noCache" << std::endl;
+  std::cout << "\tDon't keep derived data in <file>.cache for the next run.\n" << std::endl;
+  std::cout << "\t-noWatch" << std::endl;
+  std::cout << "\tDon't reread the file when it is rewritten.\n" << std::endl;
   std::cout << "\t-showfps" << std::endl;
   std::cout << "\tShow the FPS display by default.\n" << std::endl;
   std::cout << "\t-hidebgnotifs" << std::endl;
@@ -38,10 +66,19 @@ int main(int argc, char* argv[])
   try
     {
     std::string name;
+    std::vector<std::string> timeSteps;
     bool showFPS = false;
     int renderMode = -1;
     bool verbose = false;
     bool hidebgnotifs = false;
+    bool outOfCore = false;
+    int brickBudget = -1;
+    int memoryBudget = -1;
+    double targetFrameRate = -1.0;
+    int colorMapResolution = -1;
+    bool sidecarCache = true;
+    bool watchFile = true;
+    std::string sharedMemory;
     if(argc > 1)
       {
       /* Parse the command-line arguments */
@@ -52,11 +89,55 @@ int main(int argc, char* argv[])
           name.assign(argv[i+1]);
           ++i;
           }
+        if(strcmp(argv[i], "-t")==0 || strcmp(argv[i], "-timeSeries")==0)
+          {
+          std::vector<std::string> files =
+            volTimeSeries::expandPattern(argv[i+1]);
+          timeSteps.insert(timeSteps.end(), files.begin(), files.end());
+          ++i;
+          }
+        if(strcmp(argv[i], "-shm")==0 || strcmp(argv[i], "-sharedMemory")==0)
+          {
+          sharedMemory.assign(argv[i+1]);
+          ++i;
+          }
         if(strcmp(argv[i], "-r")==0 || strcmp(argv[i], "-renderMode")==0)
           {
           renderMode = atoi(argv[i+1]);
           ++i;
           }
+        if(strcmp(argv[i], "-outOfCore")==0)
+          {
+          outOfCore = true;
+          }
+        if(strcmp(argv[i], "-brickBudget")==0)
+          {
+          brickBudget = atoi(argv[i+1]);
+          ++i;
+          }
+        if(strcmp(argv[i], "-colorMapResolution")==0)
+          {
+          colorMapResolution = atoi(argv[i+1]);
+          ++i;
+          }
+        if(strcmp(argv[i], "-memoryBudget")==0)
+          {
+          memoryBudget = atoi(argv[i+1]);
+          ++i;
+          }
+        if(strcmp(argv[i], "-targetFrameRate")==0)
+          {
+          targetFrameRate = atof(argv[i+1]);
+          ++i;
+          }
+        if(strcmp(argv[i], "-noCache")==0)
+          {
+          sidecarCache = false;
+          }
+        if(strcmp(argv[i], "-noWatch")==0)
+          {
+          watchFile = false;
+          }
         if(strcmp(argv[i], "-showfps")==0)
           {
           showFPS = true;
@@ -78,7 +159,12 @@ int main(int argc, char* argv[])
       }
 
     ExampleVTKReader application(argc, argv);
-    if(!name.empty())
+    if(!timeSteps.empty())
+      {
+      application.setTimeSeries(timeSteps);
+      application.setVerbose(verbose);
+      }
+    else if(!name.empty())
       {
       application.setFileName(name.c_str());
       application.setVerbose(verbose);
@@ -87,6 +173,30 @@ int main(int argc, char* argv[])
       {
       application.setRequestedRenderMode(renderMode);
       }
+    application.setOutOfCore(outOfCore);
+    if(brickBudget > 0)
+      {
+      application.setBrickBudget(brickBudget);
+      }
+    if(memoryBudget >= 0)
+      {
+      application.setMemoryBudget(memoryBudget);
+      }
+    if(targetFrameRate >= 0.0)
+      {
+      application.setTargetFrameRate(targetFrameRate);
+      }
+    if(colorMapResolution > 0)
+      {
+      application.setColorMapResolution(colorMapResolution);
+      }
+    application.setSidecarCacheEnabled(sidecarCache);
+    application.setFileWatchingEnabled(watchFile);
+    if(!sharedMemory.empty())
+      {
+      application.setSharedMemoryName(sharedMemory);
+      application.setVerbose(verbose);
+      }
     application.setShowFPS(showFPS);
     application.setProgressVisibility(!hidebgnotifs);
     application.initialize();
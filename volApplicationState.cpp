@@ -1,12 +1,16 @@
 #include "volApplicationState.h"
 
 #include "volContours.h"
+#include "volFrameRateController.h"
 #include "volFreeSlice.h"
 #include "volGeometry.h"
 #include "volIsosurface.h"
+#include "volMemoryManager.h"
 #include "volOutline.h"
 #include "volReader.h"
 #include "volSlices.h"
+#include "volTransferFunction.h"
+#include "volTransferFunction2D.h"
 #include "volVolume.h"
 
 #include <algorithm>
@@ -14,20 +18,34 @@
 volApplicationState::volApplicationState()
   : Superclass(),
     m_forceLowResolution(true),
+    m_colorMapResolution(volTransferFunction::DefaultResolution),
     m_contours(new volContours),
-    m_freeSlice(new volFreeSlice),
+    m_frameRateController(new volFrameRateController),
     m_geometry(new volGeometry),
     m_isosurfaces({new volIsosurface, new volIsosurface, new volIsosurface}),
+    m_isosurfaceTransferFunction(new volTransferFunction),
+    m_memoryManager(new volMemoryManager),
     m_outline(new volOutline),
     m_reader(new volReader),
+    m_hasRegionOfInterest(false),
     m_slices(new volSlices),
+    m_sliceTransferFunction(new volTransferFunction),
+    m_transferFunction(new volTransferFunction),
+    m_transferFunction2D(new volTransferFunction2D),
     m_volume(new volVolume)
 {
-  std::fill(m_colorMap.begin(), m_colorMap.end(), 0.);
-  std::fill(m_sliceColorMap.begin(), m_sliceColorMap.end(), 0.);
+  m_colorMap.assign(4 * m_colorMapResolution, 0.);
+  m_isosurfaceColorMap.assign(4 * m_colorMapResolution, 0.);
+  m_sliceColorMap.assign(4 * m_colorMapResolution, 0.);
+  m_colorMapEdited.fill(false);
+  std::fill(m_regionOfInterest.begin(), m_regionOfInterest.end(), 0.);
 
   m_objects.push_back(m_contours);
-  m_objects.push_back(m_freeSlice);
+  for (size_t i = 0; i < MaxFreeSlices; ++i)
+    {
+    m_freeSlices.push_back(new volFreeSlice);
+    m_objects.push_back(m_freeSlices.back());
+    }
   m_objects.push_back(m_geometry);
   m_objects.push_back(m_isosurfaces[0]);
   m_objects.push_back(m_isosurfaces[1]);
@@ -40,13 +58,130 @@ volApplicationState::volApplicationState()
 volApplicationState::~volApplicationState()
 {
   delete m_contours;
-  delete m_freeSlice;
+  delete m_frameRateController;
+  for (size_t i = 0; i < m_freeSlices.size(); ++i)
+    {
+    delete m_freeSlices[i];
+    }
   delete m_geometry;
   delete m_isosurfaces[0];
   delete m_isosurfaces[1];
   delete m_isosurfaces[2];
+  delete m_isosurfaceTransferFunction;
+  delete m_memoryManager;
   delete m_outline;
   delete m_reader;
   delete m_slices;
+  delete m_sliceTransferFunction;
+  delete m_transferFunction;
+  delete m_transferFunction2D;
   delete m_volume;
 }
+
+//------------------------------------------------------------------------------
+void volApplicationState::setColorMapResolution(size_t entries)
+{
+  entries = std::max(entries, size_t(2));
+  if (entries == m_colorMapResolution)
+    {
+    return;
+    }
+  m_colorMapResolution = entries;
+  m_colorMap.assign(4 * entries, 0.);
+  m_isosurfaceColorMap.assign(4 * entries, 0.);
+  m_sliceColorMap.assign(4 * entries, 0.);
+  m_transferFunction->setResolution(entries);
+  m_isosurfaceTransferFunction->setResolution(entries);
+  m_sliceTransferFunction->setResolution(entries);
+  this->colorMapModified();
+  this->isosurfaceColorMapModified();
+  this->sliceColorMapModified();
+}
+
+//------------------------------------------------------------------------------
+void volApplicationState::colorMapModified()
+{
+  m_colorMapEdited[VolumeColorMap] = true;
+  ++m_colorMapEditStatistics.edits;
+}
+
+//------------------------------------------------------------------------------
+void volApplicationState::isosurfaceColorMapModified()
+{
+  m_colorMapEdited[IsosurfaceColorMap] = true;
+  ++m_colorMapEditStatistics.edits;
+}
+
+//------------------------------------------------------------------------------
+void volApplicationState::sliceColorMapModified()
+{
+  m_colorMapEdited[SliceColorMap] = true;
+  ++m_colorMapEditStatistics.edits;
+}
+
+//------------------------------------------------------------------------------
+void volApplicationState::setColorMapSource(ColorMapId map,
+                                            const ColorMapSource &source)
+{
+  m_colorMapSources[map] = source;
+}
+
+//------------------------------------------------------------------------------
+bool volApplicationState::applyColorMapEdits()
+{
+  ColorMap *maps[NumberOfColorMaps] = { &m_colorMap,
+                                        &m_isosurfaceColorMap,
+                                        &m_sliceColorMap };
+  volTransferFunction *functions[NumberOfColorMaps] = {
+    m_transferFunction, m_isosurfaceTransferFunction, m_sliceTransferFunction };
+  vtkTimeStamp *timeStamps[NumberOfColorMaps] = {
+    &m_colorMapTimeStamp, &m_isosurfaceColorMapTimeStamp,
+    &m_sliceColorMapTimeStamp };
+
+  bool rebuilt = false;
+  for (int i = 0; i < NumberOfColorMaps; ++i)
+    {
+    if (!m_colorMapEdited[i])
+      {
+      continue;
+      }
+    if (m_colorMapSources[i])
+      {
+      m_colorMapSources[i](maps[i]->data());
+      }
+    functions[i]->setTable(maps[i]->data(), maps[i]->size() / 4);
+    timeStamps[i]->Modified();
+    m_colorMapEdited[i] = false;
+    ++m_colorMapEditStatistics.rebuilds;
+    rebuilt = true;
+    }
+  return rebuilt;
+}
+
+void volApplicationState::setClippingPlanes(const std::vector<ClipPlane> &planes)
+{
+  if (planes != m_clippingPlanes)
+    {
+    m_clippingPlanes = planes;
+    m_clippingPlanesTimeStamp.Modified();
+    }
+}
+
+void volApplicationState::setRegionOfInterest(const RegionOfInterest &roi)
+{
+  if (!m_hasRegionOfInterest || roi != m_regionOfInterest)
+    {
+    m_hasRegionOfInterest = true;
+    m_regionOfInterest = roi;
+    m_regionOfInterestTimeStamp.Modified();
+    }
+}
+
+void volApplicationState::clearRegionOfInterest()
+{
+  if (m_hasRegionOfInterest)
+    {
+    m_hasRegionOfInterest = false;
+    m_regionOfInterestTimeStamp.Modified();
+    }
+}
@@ -6,16 +6,21 @@
 #include <vtkTimeStamp.h>
 
 #include <array>
+#include <functional>
 #include <string>
 #include <vector>
 
 class volContours;
+class volFrameRateController;
 class volFreeSlice;
 class volGeometry;
 class volIsosurface;
+class volMemoryManager;
 class volOutline;
 class volSlices;
 class volReader;
+class volTransferFunction;
+class volTransferFunction2D;
 class volVolume;
 
 /**
@@ -25,7 +30,34 @@ class volApplicationState : public vvApplicationState
 {
 public:
   using Superclass = vvApplicationState;
-  using ColorMap = std::array<double, 4 * 256>; //! 256 RGBA [0., 1.] values
+  //! colorMapResolution() RGBA [0., 1.] values
+  using ColorMap = std::vector<double>;
+
+  enum ColorMapId
+    {
+    VolumeColorMap = 0,
+    IsosurfaceColorMap,
+    SliceColorMap,
+    NumberOfColorMaps
+    };
+
+  //! Writes the current RGBA values of a color map, e.g. from its dialog.
+  using ColorMapSource = std::function<void(double *rgba)>;
+
+  struct ColorMapEditStatistics
+  {
+    size_t edits{0};    // *ColorMapModified() calls
+    size_t rebuilds{0}; // transfer functions rebuilt for them
+  };
+
+  //! Clipping plane nx, ny, nz, offset. Points x with n.x >= offset are kept.
+  using ClipPlane = std::array<double, 4>;
+
+  //! Box xmin, xmax, ymin, ymax, zmin, zmax in world coordinates.
+  using RegionOfInterest = std::array<double, 6>;
+
+  /** Number of free slices that may be shown at once. */
+  static const size_t MaxFreeSlices = 8;
 
   volApplicationState();
   ~volApplicationState();
@@ -34,19 +66,85 @@ public:
   bool forceLowResolution() const { return m_forceLowResolution; }
   void setForceLowResolution(bool force) { m_forceLowResolution = force; }
 
+  /**
+   * Active clipping planes. These are applied by the data pipelines (see
+   * volDataClipper) and the volume mapper; any number of planes may be set.
+   */
+  const std::vector<ClipPlane>& clippingPlanes() const
+  {
+    return m_clippingPlanes;
+  }
+  void setClippingPlanes(const std::vector<ClipPlane> &planes);
+  unsigned long int clippingPlanesTimeStamp() const;
+
+  /**
+   * Entries of each color map (256 by default). The transfer function dialogs
+   * export into the color maps directly, so this must be set before they are
+   * created. Resets the color maps.
+   */
+  size_t colorMapResolution() const { return m_colorMapResolution; }
+  void setColorMapResolution(size_t entries);
+
+  /**
+   * Color map edits are coalesced: colorMapModified() and its isosurface and
+   * slice counterparts only record that a map changed, and
+   * applyColorMapEdits() -- called once per frame -- exports each recorded
+   * map from its source, if it has one, and rebuilds its transfer function.
+   * A drag firing change callbacks on every pointer motion then costs one
+   * rebuild per frame. Returns true if any map was rebuilt.
+   */
+  void setColorMapSource(ColorMapId map, const ColorMapSource &source);
+  bool applyColorMapEdits();
+  const ColorMapEditStatistics& colorMapEditStatistics() const
+  {
+    return m_colorMapEditStatistics;
+  }
+
   /** RGBA color map for geometry/volume rendering. See usage for details. */
   ColorMap& colorMap() { return m_colorMap; }
   const ColorMap& colorMap() const { return m_colorMap; }
-  void colorMapModified() { m_colorMapTimeStamp.Modified(); }
+  void colorMapModified();
   unsigned long int colorMapTimeStamp() const;
 
+  /** colorMap() as rendered, updated by applyColorMapEdits(). */
+  volTransferFunction& transferFunction() { return *m_transferFunction; }
+  const volTransferFunction& transferFunction() const
+  {
+    return *m_transferFunction;
+  }
+
+  /**
+   * Color and opacity over value and gradient magnitude, for the volume's
+   * TransferFunction2D render mode. Edited by the 2D transfer function
+   * dialog through setRegions().
+   */
+  volTransferFunction2D& transferFunction2D() { return *m_transferFunction2D; }
+  const volTransferFunction2D& transferFunction2D() const
+  {
+    return *m_transferFunction2D;
+  }
+
   /** Contour rendering */
   volContours& contours() { return *m_contours; }
   const volContours& contours() const { return *m_contours; }
 
-  /** Free slice rendering */
-  volFreeSlice& freeSlice() { return *m_freeSlice; }
-  const volFreeSlice& freeSlice() const { return *m_freeSlice; }
+  /** Volume rendering quality while the view is navigated. */
+  volFrameRateController& frameRateController()
+  {
+    return *m_frameRateController;
+  }
+  const volFrameRateController& frameRateController() const
+  {
+    return *m_frameRateController;
+  }
+
+  /**
+   * Free slice rendering. A fixed pool of slices is created up front; each
+   * FreeSliceLocator claims one of them (see volFreeSlice::allocated()).
+   */
+  size_t numberOfFreeSlices() const { return m_freeSlices.size(); }
+  volFreeSlice& freeSlice(size_t i) { return *m_freeSlices[i]; }
+  const volFreeSlice& freeSlice(size_t i) const { return *m_freeSlices[i]; }
 
   /** Geometry rendering */
   volGeometry& geometry() { return *m_geometry; }
@@ -63,9 +161,23 @@ public:
   /** RGBA color map for geometry/volume rendering. See usage for details. */
   ColorMap& isosurfaceColorMap() { return m_isosurfaceColorMap; }
   const ColorMap& isosurfaceColorMap() const { return m_isosurfaceColorMap; }
-  void isosurfaceColorMapModified() { m_isosurfaceColorMapTimeStamp.Modified(); }
+  void isosurfaceColorMapModified();
   unsigned long int isosurfaceColorMapTimeStamp() const;
 
+  /** isosurfaceColorMap() as rendered. */
+  volTransferFunction& isosurfaceTransferFunction()
+  {
+    return *m_isosurfaceTransferFunction;
+  }
+  const volTransferFunction& isosurfaceTransferFunction() const
+  {
+    return *m_isosurfaceTransferFunction;
+  }
+
+  /** Accounting and budget of the memory held by the objects below. */
+  volMemoryManager& memoryManager() { return *m_memoryManager; }
+  const volMemoryManager& memoryManager() const { return *m_memoryManager; }
+
   /** Outline rendering */
   volOutline &outline() { return *m_outline; }
   const volOutline &outline() const { return *m_outline; }
@@ -74,6 +186,20 @@ public:
   volReader& reader() { return *m_reader; }
   const volReader& reader() const { return *m_reader; }
 
+  /**
+   * Region of interest. When set, the HiRes data pipelines only process the
+   * part of the full resolution data inside this box, while the LoRes
+   * pipelines (and forceLowResolution()) keep covering the whole domain.
+   */
+  bool hasRegionOfInterest() const { return m_hasRegionOfInterest; }
+  const RegionOfInterest& regionOfInterest() const
+  {
+    return m_regionOfInterest;
+  }
+  void setRegionOfInterest(const RegionOfInterest &roi);
+  void clearRegionOfInterest();
+  unsigned long int regionOfInterestTimeStamp() const;
+
   /** Slice rendering. */
   volSlices& slices() { return *m_slices; }
   const volSlices& slices() const { return *m_slices; }
@@ -81,9 +207,19 @@ public:
   /** RGBA color map for geometry/volume rendering. See usage for details. */
   ColorMap& sliceColorMap() { return m_sliceColorMap; }
   const ColorMap& sliceColorMap() const { return m_sliceColorMap; }
-  void sliceColorMapModified() { m_sliceColorMapTimeStamp.Modified(); }
+  void sliceColorMapModified();
   unsigned long int sliceColorMapTimeStamp() const;
 
+  /** sliceColorMap() as rendered. */
+  volTransferFunction& sliceTransferFunction()
+  {
+    return *m_sliceTransferFunction;
+  }
+  const volTransferFunction& sliceTransferFunction() const
+  {
+    return *m_sliceTransferFunction;
+  }
+
   /** Volume rendering */
   volVolume& volume() { return *m_volume; }
   const volVolume& volume() const { return *m_volume; }
@@ -95,22 +231,42 @@ private:
 
   bool m_forceLowResolution;
 
+  std::vector<ClipPlane> m_clippingPlanes;
+  vtkTimeStamp m_clippingPlanesTimeStamp;
+  size_t m_colorMapResolution;
+  std::array<bool, NumberOfColorMaps> m_colorMapEdited;
+  std::array<ColorMapSource, NumberOfColorMaps> m_colorMapSources;
+  ColorMapEditStatistics m_colorMapEditStatistics;
   ColorMap m_colorMap;
   vtkTimeStamp m_colorMapTimeStamp;
   volContours *m_contours;
-  volFreeSlice *m_freeSlice;
+  volFrameRateController *m_frameRateController;
+  std::vector<volFreeSlice*> m_freeSlices;
   volGeometry *m_geometry;
   std::array<volIsosurface*, 3> m_isosurfaces;
   ColorMap m_isosurfaceColorMap;
   vtkTimeStamp m_isosurfaceColorMapTimeStamp;
+  volTransferFunction *m_isosurfaceTransferFunction;
+  volMemoryManager *m_memoryManager;
   volOutline *m_outline;
   volReader *m_reader;
+  bool m_hasRegionOfInterest;
+  RegionOfInterest m_regionOfInterest;
+  vtkTimeStamp m_regionOfInterestTimeStamp;
   volSlices *m_slices;
   ColorMap m_sliceColorMap;
   vtkTimeStamp m_sliceColorMapTimeStamp;
+  volTransferFunction *m_sliceTransferFunction;
+  volTransferFunction *m_transferFunction;
+  volTransferFunction2D *m_transferFunction2D;
   volVolume *m_volume;
 };
 
+inline unsigned long int volApplicationState::clippingPlanesTimeStamp() const
+{
+  return m_clippingPlanesTimeStamp.GetMTime();
+}
+
 inline unsigned long int volApplicationState::colorMapTimeStamp() const
 {
   return m_colorMapTimeStamp.GetMTime();
@@ -121,6 +277,11 @@ inline unsigned long volApplicationState::isosurfaceColorMapTimeStamp() const
   return m_isosurfaceColorMapTimeStamp.GetMTime();
 }
 
+inline unsigned long int volApplicationState::regionOfInterestTimeStamp() const
+{
+  return m_regionOfInterestTimeStamp.GetMTime();
+}
+
 inline unsigned long int volApplicationState::sliceColorMapTimeStamp() const
 {
   return m_sliceColorMapTimeStamp.GetMTime();
@@ -0,0 +1,233 @@
+#include "volArrayPool.h"
+
+#include <vtkDataArray.h>
+#include <vtkVersion.h>
+
+#include <cstdlib>
+#include <new>
+
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 1)
+#define VOL_HAVE_ARRAY_FREE_FUNCTION
+#endif
+
+namespace {
+
+// Smallest size class; smaller requests get a block of this size.
+const int MinimumClassExponent = 12;
+
+// Blocks start with their size class; the array's values follow, aligned
+// like malloc()'s.
+union BlockHeader
+{
+  size_t sizeClass;
+  long double alignment;
+};
+
+//------------------------------------------------------------------------------
+size_t classSize(size_t sizeClass)
+{
+  const int exponent = MinimumClassExponent + static_cast<int>(sizeClass / 4);
+  const size_t base = size_t(1) << exponent;
+  return base + (sizeClass % 4) * (base >> 2);
+}
+
+//------------------------------------------------------------------------------
+// The smallest size class holding bytes.
+size_t sizeClassOf(size_t bytes)
+{
+  int exponent = MinimumClassExponent;
+  while ((size_t(1) << (exponent + 1)) <= bytes)
+    {
+    ++exponent;
+    }
+  const size_t base = size_t(1) << exponent;
+  if (bytes <= base)
+    {
+    return static_cast<size_t>(exponent - MinimumClassExponent) * 4;
+    }
+  const size_t quarter = base >> 2;
+  const size_t steps = (bytes - base + quarter - 1) / quarter;
+  return static_cast<size_t>(exponent - MinimumClassExponent) * 4 + steps;
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volArrayPool::volArrayPool()
+  : m_capacity(DefaultCapacity),
+    m_pooledBytes(0),
+    m_usedBytes(0),
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+//------------------------------------------------------------------------------
+volArrayPool::~volArrayPool()
+{
+  this->trim();
+}
+
+//------------------------------------------------------------------------------
+volArrayPool &volArrayPool::instance()
+{
+  // Never destroyed: arrays released during static destruction still return
+  // their memory here.
+  static volArrayPool *pool = new volArrayPool;
+  return *pool;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray> volArrayPool::newArray(int dataType,
+                                                     vtkIdType tuples,
+                                                     int components)
+{
+  vtkSmartPointer<vtkDataArray> array;
+  array.TakeReference(vtkDataArray::CreateDataArray(dataType));
+  array->SetNumberOfComponents(components);
+
+#ifdef VOL_HAVE_ARRAY_FREE_FUNCTION
+  const vtkIdType values = tuples * components;
+  if (values > 0)
+    {
+    void *memory = this->allocate(static_cast<size_t>(values) *
+                                  static_cast<size_t>(
+                                    array->GetDataTypeSize()));
+    array->SetVoidArray(memory, values, 0);
+    array->SetArrayFreeFunction(&volArrayPool::release);
+    return array;
+    }
+#endif
+
+  array->SetNumberOfTuples(tuples);
+  return array;
+}
+
+//------------------------------------------------------------------------------
+size_t volArrayPool::capacity() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_capacity;
+}
+
+//------------------------------------------------------------------------------
+void volArrayPool::setCapacity(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_capacity = bytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volArrayPool::trim()
+{
+  std::vector<std::vector<void*> > blocks;
+  size_t bytes = 0;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  blocks.swap(m_free);
+  bytes = m_pooledBytes;
+  m_pooledBytes = 0;
+  }
+
+  for (size_t i = 0; i < blocks.size(); ++i)
+    {
+    for (size_t j = 0; j < blocks[i].size(); ++j)
+      {
+      std::free(blocks[i][j]);
+      }
+    }
+  return bytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volArrayPool::pooledBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pooledBytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volArrayPool::usedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_usedBytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volArrayPool::hits() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_hits;
+}
+
+//------------------------------------------------------------------------------
+size_t volArrayPool::misses() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_misses;
+}
+
+//------------------------------------------------------------------------------
+void *volArrayPool::allocate(size_t bytes)
+{
+  const size_t sizeClass = sizeClassOf(bytes);
+  const size_t size = classSize(sizeClass);
+  void *block = nullptr;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_usedBytes += size;
+  if (sizeClass < m_free.size() && !m_free[sizeClass].empty())
+    {
+    block = m_free[sizeClass].back();
+    m_free[sizeClass].pop_back();
+    m_pooledBytes -= size;
+    ++m_hits;
+    }
+  else
+    {
+    ++m_misses;
+    }
+  }
+
+  if (!block)
+    {
+    block = std::malloc(sizeof(BlockHeader) + size);
+    if (!block)
+      {
+      throw std::bad_alloc();
+      }
+    static_cast<BlockHeader*>(block)->sizeClass = sizeClass;
+    }
+  return static_cast<BlockHeader*>(block) + 1;
+}
+
+//------------------------------------------------------------------------------
+void volArrayPool::recycle(void *block)
+{
+  const size_t sizeClass = static_cast<BlockHeader*>(block)->sizeClass;
+  const size_t size = classSize(sizeClass);
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_usedBytes -= size;
+  if (m_pooledBytes + size <= m_capacity)
+    {
+    if (m_free.size() <= sizeClass)
+      {
+      m_free.resize(sizeClass + 1);
+      }
+    m_free[sizeClass].push_back(block);
+    m_pooledBytes += size;
+    return;
+    }
+  }
+  std::free(block);
+}
+
+//------------------------------------------------------------------------------
+void volArrayPool::release(void *memory)
+{
+  if (memory)
+    {
+    volArrayPool::instance().recycle(static_cast<BlockHeader*>(memory) - 1);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef VOLARRAYPOOL_H
+#define VOLARRAYPOOL_H
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+class vtkDataArray;
+
+/**
+ * @brief The volArrayPool class recycles the memory of the large arrays that
+ * pipelines produce over and over, e.g. a free slice resampled on every drag.
+ *
+ * newArray() returns a VTK array whose memory comes from free lists of size
+ * classes (four per power of two, so at most a quarter is wasted). When the
+ * last reference to the array goes away -- typically when the LODData
+ * holding a result is replaced by the next one -- the memory goes back to
+ * its free list instead of to the heap, ready for the next result of about
+ * the same size. Free lists hold at most capacity() bytes; trim() empties
+ * them.
+ *
+ * Only arrays the viewer fills itself come from the pool: the resampled free
+ * slice, paged bricks and decoded .vti arrays. VTK filters (the isosurface,
+ * contour and slice cutters) create the arrays of their outputs with New()
+ * inside RequestData(), out of the pool's reach; their results share those
+ * arrays rather than copying them.
+ *
+ * There is a single, process-wide pool, since arrays may outlive any object
+ * that made them. All methods are thread safe. With VTK older than 8.1,
+ * which cannot hand an array's memory back to us, newArray() returns plain
+ * arrays.
+ */
+class volArrayPool
+{
+public:
+  /** Bytes kept in the free lists by default. */
+  static const size_t DefaultCapacity = size_t(256) << 20;
+
+  static volArrayPool& instance();
+
+  /**
+   * An array of the given VTK type (VTK_FLOAT, ...) holding tuples x
+   * components values, uninitialized, whose memory comes from the pool.
+   */
+  vtkSmartPointer<vtkDataArray> newArray(int dataType, vtkIdType tuples,
+                                         int components = 1);
+
+  /** Upper bound on the bytes kept in the free lists. */
+  size_t capacity() const;
+  void setCapacity(size_t bytes);
+
+  /** Free all the memory kept in the free lists. Returns the bytes freed. */
+  size_t trim();
+
+  /** Bytes in the free lists. */
+  size_t pooledBytes() const;
+
+  /** Bytes handed out and not returned yet. */
+  size_t usedBytes() const;
+
+  /** Requests served from the free lists, and from the heap. */
+  size_t hits() const;
+  size_t misses() const;
+
+private:
+  volArrayPool();
+  ~volArrayPool();
+
+  // Not implemented:
+  volArrayPool(const volArrayPool&);
+  volArrayPool& operator=(const volArrayPool&);
+
+  void* allocate(size_t bytes);
+  void recycle(void *block);
+  static void release(void *memory);
+
+  mutable std::mutex m_mutex;
+  size_t m_capacity;
+  std::vector<std::vector<void*> > m_free; // blocks of each size class
+  size_t m_pooledBytes;
+  size_t m_usedBytes;
+  size_t m_hits;
+  size_t m_misses;
+};
+
+#endif // VOLARRAYPOOL_H
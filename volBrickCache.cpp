@@ -0,0 +1,519 @@
+#include "volBrickCache.h"
+
+#include "volBrickFile.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Computes the lower corner index and interpolation weight of a continuous
+// index along one axis. Returns false if the sample lies outside the volume
+// (or is NaN).
+inline bool cellCoordinate(float f, int dim, int &i0, float &t)
+{
+  if (!(f >= 0.f) || f > static_cast<float>(dim - 1))
+    {
+    return false;
+    }
+  i0 = std::min(static_cast<int>(f), std::max(dim - 2, 0));
+  t = f - static_cast<float>(i0);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// What resampled pixels that are not kept read instead of a brick: enough
+// zeros for the corners of the first cell.
+const float NoSamples[volBrickCache::BrickSamples *
+                      (volBrickCache::BrickSamples + 1) + 2] = {};
+
+//------------------------------------------------------------------------------
+// Copies the bricks [begin, end) out of the source scalars. Samples past the
+// end of the image replicate the last sample along that axis.
+template <typename ScalarT>
+struct BuildBricksFunctor
+{
+  const ScalarT *scalars;
+  vtkIdType incs[3];
+  std::array<int, 3> dims;
+  std::array<int, 3> brickDims;
+  float *samples;
+  float *brickMin;
+  float *brickMax;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const int bi = static_cast<int>(b % this->brickDims[0]);
+      const int bj = static_cast<int>((b / this->brickDims[0]) %
+                                      this->brickDims[1]);
+      const int bk = static_cast<int>(b / (this->brickDims[0] *
+                                           this->brickDims[1]));
+
+      float *out = this->samples + b * S * S * S;
+      float lo = std::numeric_limits<float>::max();
+      float hi = -std::numeric_limits<float>::max();
+
+      for (int k = 0; k < S; ++k)
+        {
+        const int z = bk * B + k;
+        const bool zIn = z < this->dims[2];
+        const vtkIdType zOff = std::min(z, this->dims[2] - 1) * this->incs[2];
+        for (int j = 0; j < S; ++j)
+          {
+          const int y = bj * B + j;
+          const bool yIn = y < this->dims[1];
+          const ScalarT *row = this->scalars + zOff +
+              std::min(y, this->dims[1] - 1) * this->incs[1];
+          for (int i = 0; i < S; ++i)
+            {
+            const int x = bi * B + i;
+            const float v = static_cast<float>(
+                  row[std::min(x, this->dims[0] - 1) * this->incs[0]]);
+            *out++ = v;
+            if (zIn && yIn && x < this->dims[0])
+              {
+              lo = std::min(lo, v);
+              hi = std::max(hi, v);
+              }
+            }
+          }
+        }
+
+      this->brickMin[b] = lo;
+      this->brickMax[b] = hi;
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+template <typename ScalarT>
+void buildBricks(const ScalarT *scalars, int numComps,
+                 const std::array<int, 3> &dims,
+                 const std::array<int, 3> &brickDims,
+                 float *samples, float *brickMin, float *brickMax)
+{
+  BuildBricksFunctor<ScalarT> functor;
+  functor.scalars = scalars;
+  functor.incs[0] = numComps;
+  functor.incs[1] = functor.incs[0] * dims[0];
+  functor.incs[2] = functor.incs[1] * dims[1];
+  functor.dims = dims;
+  functor.brickDims = brickDims;
+  functor.samples = samples;
+  functor.brickMin = brickMin;
+  functor.brickMax = brickMax;
+
+  const vtkIdType numBricks = static_cast<vtkIdType>(brickDims[0]) *
+      brickDims[1] * brickDims[2];
+  vtkSMPTools::For(0, numBricks, 1, functor);
+}
+
+//------------------------------------------------------------------------------
+// Resamples the rows [rowBegin, rowEnd), a span of Span pixels at a time.
+// Each span goes through passes over all of its pixels, as structures of
+// arrays: continuous indices, cells and weights, the half space tests, the
+// corners of the cells gathered from the bricks, and the trilinear blend.
+// All passes but the gather are branchless loops of a fixed length, which
+// the compiler vectorizes.
+struct ResampleFunctor
+{
+  enum { Span = 64 };
+
+  const volBrickCache *cache;
+  const float *origin;
+  const float *stepU;
+  const float *stepV;
+  const std::vector<std::array<double, 4> > *keep;
+  int width;
+  float *output;
+
+  void operator()(vtkIdType rowBegin, vtkIdType rowEnd) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int dj = volBrickCache::BrickSamples;
+    const int dk = volBrickCache::BrickSamples * volBrickCache::BrickSamples;
+    const int corner[8] = { 0, 1, dj, dj + 1, dk, dk + 1, dj + dk,
+                            dj + dk + 1 };
+    const std::array<int, 3> &dims = this->cache->dimensions();
+    const std::array<int, 3> &brickDims = this->cache->brickDimensions();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    float f[3][Span];
+    int cell[3][Span];
+    float t[3][Span];
+    int kept[Span];
+    int brick[Span];
+    int offset[Span];
+    float p[8][Span];
+    float value[Span];
+
+    for (vtkIdType row = rowBegin; row < rowEnd; ++row)
+      {
+      const float r = static_cast<float>(row);
+      float *out = this->output + row * this->width;
+      for (int begin = 0; begin < this->width; begin += Span)
+        {
+        const int count = std::min(static_cast<int>(Span),
+                                   this->width - begin);
+        for (int a = 0; a < 3; ++a)
+          {
+          const float start = this->origin[a] + r * this->stepV[a];
+          const float step = this->stepU[a];
+          for (int i = 0; i < Span; ++i)
+            {
+            f[a][i] = start + static_cast<float>(begin + i) * step;
+            }
+          }
+
+        // Cells and weights, as cellCoordinate() computes them. Pixels
+        // outside the volume (or NaN), or past the row, are not kept:
+        for (int i = 0; i < Span; ++i)
+          {
+          kept[i] = i < count;
+          }
+        for (int a = 0; a < 3; ++a)
+          {
+          const float last = static_cast<float>(dims[a] - 1);
+          const float lastCell = static_cast<float>(std::max(dims[a] - 2, 0));
+          int inside[Span];
+          float clamped[Span];
+          for (int i = 0; i < Span; ++i)
+            {
+            inside[i] = (f[a][i] >= 0.f) & (f[a][i] <= last);
+            clamped[i] = inside[i] ? f[a][i] : 0.f;
+            }
+          for (int i = 0; i < Span; ++i)
+            {
+            cell[a][i] = static_cast<int>(std::min(clamped[i], lastCell));
+            t[a][i] = clamped[i] - static_cast<float>(cell[a][i]);
+            kept[i] &= inside[i];
+            }
+          }
+
+        // Spans without any pixel in the volume are done:
+        int anyKept = 0;
+        for (int i = 0; i < Span; ++i)
+          {
+          anyKept |= kept[i];
+          }
+        if (!anyKept)
+          {
+          std::fill(out + begin, out + begin + count, nan);
+          continue;
+          }
+
+        for (size_t h = 0; h < this->keep->size(); ++h)
+          {
+          // The sign of a * i + b * j + c * k - d, in double, is kept as a
+          // float so that the test vectorizes with the int masks:
+          const std::array<double, 4> &plane = (*this->keep)[h];
+          float side[Span];
+          for (int i = 0; i < Span; ++i)
+            {
+            side[i] = static_cast<float>(plane[0] * f[0][i] +
+                                         plane[1] * f[1][i] +
+                                         plane[2] * f[2][i] - plane[3]);
+            }
+          for (int i = 0; i < Span; ++i)
+            {
+            kept[i] &= side[i] >= 0.f;
+            }
+          }
+
+        // The bricks of the cells, as brickIndex(), and the cells in them:
+        for (int i = 0; i < Span; ++i)
+          {
+          const int bi = cell[0][i] / B;
+          const int bj = cell[1][i] / B;
+          const int bk = cell[2][i] / B;
+          brick[i] = bi + brickDims[0] * (bj + brickDims[1] * bk);
+          offset[i] = (cell[0][i] - bi * B) + (cell[1][i] - bj * B) * dj +
+              (cell[2][i] - bk * B) * dk;
+          }
+
+        // The gather. Pixels in missing bricks are not kept either:
+        for (int i = 0; i < Span; ++i)
+          {
+          const float *data = kept[i]
+              ? this->cache->brick(static_cast<size_t>(brick[i])) : nullptr;
+          kept[i] = data != nullptr;
+          const float *q = data ? data + offset[i] : NoSamples;
+          for (int c = 0; c < 8; ++c)
+            {
+            p[c][i] = q[corner[c]];
+            }
+          }
+
+        for (int i = 0; i < Span; ++i)
+          {
+          const float c00 = p[0][i] + t[0][i] * (p[1][i] - p[0][i]);
+          const float c10 = p[2][i] + t[0][i] * (p[3][i] - p[2][i]);
+          const float c01 = p[4][i] + t[0][i] * (p[5][i] - p[4][i]);
+          const float c11 = p[6][i] + t[0][i] * (p[7][i] - p[6][i]);
+          const float c0 = c00 + t[1][i] * (c10 - c00);
+          const float c1 = c01 + t[1][i] * (c11 - c01);
+          value[i] = c0 + t[2][i] * (c1 - c0);
+          }
+        for (int i = 0; i < Span; ++i)
+          {
+          value[i] = kept[i] ? value[i] : nan;
+          }
+        std::copy(value, value + count, out + begin);
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+// Hashes the samples of the bricks [begin, end): 64-bit FNV-1a, taking a
+// sample rather than a byte at a time. Missing bricks hash to 0.
+struct HashFunctor
+{
+  const volBrickCache *cache;
+  uint64_t *hashes;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int S = volBrickCache::BrickSamples;
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const float *brick = this->cache->brick(static_cast<size_t>(b));
+      if (!brick)
+        {
+        this->hashes[b] = 0;
+        continue;
+        }
+      uint64_t hash = 14695981039346656037ULL;
+      for (int i = 0; i < S * S * S; ++i)
+        {
+        uint32_t word;
+        std::memcpy(&word, brick + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+        }
+      this->hashes[b] = hash;
+      }
+  }
+};
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volBrickCache::volBrickCache(vtkImageData *image)
+{
+  m_dims.fill(0);
+  m_brickDims.fill(0);
+  m_origin.fill(0.);
+  m_spacing.fill(1.);
+  m_scalarRange.fill(0.);
+
+  vtkDataArray *scalars = image ? image->GetPointData()->GetScalars()
+                                : nullptr;
+  if (!scalars || scalars->GetNumberOfTuples() == 0)
+    {
+    return;
+    }
+
+  int extent[6];
+  image->GetExtent(extent);
+  image->GetDimensions(m_dims.data());
+  image->GetSpacing(m_spacing.data());
+  image->GetOrigin(m_origin.data());
+  for (int i = 0; i < 3; ++i)
+    {
+    // Fold the extent offset into the origin so that index 0 is the first
+    // stored sample:
+    m_origin[i] += extent[2 * i] * m_spacing[i];
+    m_brickDims[i] = std::max(1, (m_dims[i] - 2) / BrickSize + 1);
+    }
+
+  const size_t numBricks = static_cast<size_t>(m_brickDims[0]) *
+      m_brickDims[1] * m_brickDims[2];
+  m_samples.resize(numBricks * BrickSamples * BrickSamples * BrickSamples);
+  m_brickMin.resize(numBricks);
+  m_brickMax.resize(numBricks);
+
+  void *inPtr = scalars->GetVoidPointer(0);
+  const int numComps = scalars->GetNumberOfComponents();
+  switch (scalars->GetDataType())
+    {
+    vtkTemplateMacro(buildBricks(static_cast<const VTK_TT*>(inPtr), numComps,
+                                 m_dims, m_brickDims, m_samples.data(),
+                                 m_brickMin.data(), m_brickMax.data()));
+
+    default:
+      std::cerr << "Unsupported scalar type for brick cache: "
+                << scalars->GetDataTypeAsString() << "\n";
+      m_dims.fill(0);
+      m_brickDims.fill(0);
+      m_samples.clear();
+      m_brickMin.clear();
+      m_brickMax.clear();
+      return;
+    }
+
+  m_bricks.resize(numBricks);
+  for (size_t i = 0; i < numBricks; ++i)
+    {
+    m_bricks[i] = &m_samples[i * BrickSamples * BrickSamples * BrickSamples];
+    }
+
+  m_scalarRange[0] = *std::min_element(m_brickMin.begin(), m_brickMin.end());
+  m_scalarRange[1] = *std::max_element(m_brickMax.begin(), m_brickMax.end());
+}
+
+//------------------------------------------------------------------------------
+volBrickCache::volBrickCache(
+    const volBrickFile &file,
+    const std::vector<std::shared_ptr<const std::vector<float> > > &bricks)
+  : m_dims(file.dimensions()),
+    m_brickDims(file.brickDimensions()),
+    m_origin(file.origin()),
+    m_spacing(file.spacing()),
+    m_scalarRange(file.scalarRange()),
+    m_pinned(bricks),
+    m_bricks(bricks.size(), nullptr)
+{
+  const size_t numBricks = file.numberOfBricks();
+  m_brickMin.resize(numBricks);
+  m_brickMax.resize(numBricks);
+  for (size_t i = 0; i < numBricks; ++i)
+    {
+    m_brickMin[i] = file.brickMinimum(i);
+    m_brickMax[i] = file.brickMaximum(i);
+    if (i < m_pinned.size() && m_pinned[i])
+      {
+      m_bricks[i] = m_pinned[i]->data();
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+volBrickCache::~volBrickCache()
+{
+}
+
+//------------------------------------------------------------------------------
+std::array<double, 6> volBrickCache::bounds() const
+{
+  std::array<double, 6> result;
+  for (int i = 0; i < 3; ++i)
+    {
+    const double a = m_origin[i];
+    const double b = m_origin[i] + (m_dims[i] - 1) * m_spacing[i];
+    result[2 * i] = std::min(a, b);
+    result[2 * i + 1] = std::max(a, b);
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+size_t volBrickCache::memorySize() const
+{
+  size_t samples = m_samples.size();
+  for (size_t i = 0; i < m_pinned.size(); ++i)
+    {
+    samples += m_pinned[i] ? m_pinned[i]->size() : 0;
+    }
+  return sizeof(float) * (samples + m_brickMin.size() + m_brickMax.size());
+}
+
+//------------------------------------------------------------------------------
+std::vector<uint64_t> volBrickCache::brickHashes() const
+{
+  std::vector<uint64_t> hashes(this->numberOfBricks(), 0);
+  HashFunctor functor;
+  functor.cache = this;
+  functor.hashes = hashes.data();
+  vtkSMPTools::For(0, static_cast<vtkIdType>(hashes.size()), 1, functor);
+  return hashes;
+}
+
+//------------------------------------------------------------------------------
+bool volBrickCache::sample(float x, float y, float z, float &value) const
+{
+  int cx, cy, cz;
+  float tx, ty, tz;
+  if (!cellCoordinate(x, m_dims[0], cx, tx) ||
+      !cellCoordinate(y, m_dims[1], cy, ty) ||
+      !cellCoordinate(z, m_dims[2], cz, tz))
+    {
+    return false;
+    }
+
+  const int bi = cx / BrickSize;
+  const int bj = cy / BrickSize;
+  const int bk = cz / BrickSize;
+  const int lx = cx - bi * BrickSize;
+  const int ly = cy - bj * BrickSize;
+  const int lz = cz - bk * BrickSize;
+
+  const int dj = BrickSamples;
+  const int dk = BrickSamples * BrickSamples;
+  const float *data = this->brick(this->brickIndex(bi, bj, bk));
+  if (!data)
+    {
+    return false;
+    }
+  const float *p = data + lx + ly * dj + lz * dk;
+
+  const float c00 = p[0] + tx * (p[1] - p[0]);
+  const float c10 = p[dj] + tx * (p[dj + 1] - p[dj]);
+  const float c01 = p[dk] + tx * (p[dk + 1] - p[dk]);
+  const float c11 = p[dj + dk] + tx * (p[dj + dk + 1] - p[dj + dk]);
+  const float c0 = c00 + ty * (c10 - c00);
+  const float c1 = c01 + ty * (c11 - c01);
+  value = c0 + tz * (c1 - c0);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void volBrickCache::resample(const float origin[3], const float stepU[3],
+                             const float stepV[3], int width, int height,
+                             float *output,
+                             const std::vector<std::array<double, 4> > &keep)
+    const
+{
+  ResampleFunctor functor;
+  functor.cache = this;
+  functor.origin = origin;
+  functor.stepU = stepU;
+  functor.stepV = stepV;
+  functor.keep = &keep;
+  functor.width = width;
+  functor.output = output;
+
+  vtkSMPTools::For(0, height, functor);
+}
+
+//------------------------------------------------------------------------------
+void volBrickCache::worldToIndex(const double world[3], double index[3]) const
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    index[i] = m_spacing[i] != 0. ? (world[i] - m_origin[i]) / m_spacing[i]
+                                  : 0.;
+    }
+}
+
+//------------------------------------------------------------------------------
+void volBrickCache::indexToWorld(const double index[3], double world[3]) const
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    world[i] = m_origin[i] + index[i] * m_spacing[i];
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef VOLBRICKCACHE_H
+#define VOLBRICKCACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class volBrickFile;
+class vtkImageData;
+
+/**
+ * @brief The volBrickCache class holds a read-only, bricked float copy of the
+ * first scalar component of an image.
+ *
+ * The volume is split into bricks of BrickSize^3 cells. Each brick stores
+ * (BrickSize + 1)^3 samples, duplicating the shared faces of its neighbors, so
+ * that any trilinear interpolation can be served from a single brick. The
+ * minimum and maximum scalar of each brick are recorded as well.
+ *
+ * A cache is built once per reader output and then shared (through
+ * std::shared_ptr<const volBrickCache>) by any number of pipelines, which may
+ * sample it concurrently from their worker threads.
+ *
+ * A cache may also be a partial view of an out-of-core volume (see
+ * volBrickPager::view()), holding only some of the bricks. Samples that fall
+ * in a missing brick are treated as outside the volume.
+ */
+class volBrickCache
+{
+public:
+  /** Number of cells along each edge of a brick. */
+  static const int BrickSize = 32;
+  /** Number of samples along each edge of a brick. */
+  static const int BrickSamples = BrickSize + 1;
+
+  /** Build the cache from image's point scalars, in parallel. */
+  explicit volBrickCache(vtkImageData *image);
+
+  /**
+   * Build a view of the bricks of file. bricks holds one entry per brick of
+   * the file; the non-null ones are kept alive by the view.
+   */
+  volBrickCache(const volBrickFile &file,
+                const std::vector<std::shared_ptr<const std::vector<float> > >
+                &bricks);
+
+  ~volBrickCache();
+
+  /** Point dimensions of the source image. */
+  const std::array<int, 3>& dimensions() const { return m_dims; }
+  /** Number of bricks along each axis. */
+  const std::array<int, 3>& brickDimensions() const { return m_brickDims; }
+  size_t numberOfBricks() const { return m_brickMin.size(); }
+
+  /** World position of the sample with index (0, 0, 0). */
+  const std::array<double, 3>& origin() const { return m_origin; }
+  const std::array<double, 3>& spacing() const { return m_spacing; }
+  /** xmin, xmax, ymin, ymax, zmin, zmax, in world coordinates. */
+  std::array<double, 6> bounds() const;
+
+  /** Scalar range of all samples. */
+  const std::array<double, 2>& scalarRange() const { return m_scalarRange; }
+
+  size_t brickIndex(int bi, int bj, int bk) const
+  {
+    return bi + m_brickDims[0] * (bj + m_brickDims[1] * bk);
+  }
+
+  /**
+   * Samples of a brick, x fastest, BrickSamples^3 values. nullptr if the
+   * brick is not held by this cache.
+   */
+  const float* brick(size_t index) const { return m_bricks[index]; }
+
+  float brickMinimum(size_t index) const { return m_brickMin[index]; }
+  float brickMaximum(size_t index) const { return m_brickMax[index]; }
+
+  /**
+   * A hash of the samples of each brick, computed in parallel: bricks whose
+   * hashes differ between two versions of a volume have changed.
+   */
+  std::vector<uint64_t> brickHashes() const;
+
+  /** Bytes held by the cache. */
+  size_t memorySize() const;
+
+  /**
+   * Trilinearly interpolate at continuous index (x, y, z). Returns false if
+   * the position lies outside the volume.
+   */
+  bool sample(float x, float y, float z, float &value) const;
+
+  /**
+   * Resample onto a width x height grid in continuous index space: sample
+   * (i, j) is taken at origin + i * stepU + j * stepV and written to
+   * output[j * width + i]. Samples outside the volume, or outside any of the
+   * half spaces a, b, c, d of keep (where a * i + b * j + c * k >= d, in
+   * continuous indices), are set to NaN. Rows are processed in parallel.
+   */
+  void resample(const float origin[3], const float stepU[3],
+                const float stepV[3], int width, int height, float *output,
+                const std::vector<std::array<double, 4> > &keep =
+                    std::vector<std::array<double, 4> >()) const;
+
+  /** Convert between world coordinates and continuous indices. */
+  void worldToIndex(const double world[3], double index[3]) const;
+  void indexToWorld(const double index[3], double world[3]) const;
+
+private:
+  // Not implemented:
+  volBrickCache(const volBrickCache&);
+  volBrickCache& operator=(const volBrickCache&);
+
+  std::array<int, 3> m_dims;
+  std::array<int, 3> m_brickDims;
+  std::array<double, 3> m_origin;
+  std::array<double, 3> m_spacing;
+  std::array<double, 2> m_scalarRange;
+
+  std::vector<float> m_samples;
+  std::vector<std::shared_ptr<const std::vector<float> > > m_pinned;
+  std::vector<const float*> m_bricks;
+  std::vector<float> m_brickMin;
+  std::vector<float> m_brickMax;
+};
+
+#endif // VOLBRICKCACHE_H
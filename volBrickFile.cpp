@@ -0,0 +1,842 @@
+#include "volBrickFile.h"
+
+#include "volBrickCache.h"
+
+#include <vtkDataCompressor.h>
+#include <vtkDataObject.h>
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkVersion.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkZLibDataCompressor.h>
+
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+#include <vtkLZ4DataCompressor.h>
+#define VOL_HAVE_LZ4
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char Magic[8] = {'V', 'O', 'L', 'B', 'R', 'I', 'C', 'K'};
+const int32_t Version = 2;
+
+// Levels past this would subsample by more than any volume has samples:
+const int MaxLevels = 24;
+
+// Written as-is at the start of the file. Brick files are a local cache, so
+// they use the host's byte order.
+struct FileHeader
+{
+  char magic[8];
+  int32_t version;
+  int32_t brickSize;
+  int32_t numberOfLevels;
+  int32_t compression;
+  int32_t dims[3];
+  int32_t reserved;
+  double origin[3];
+  double spacing[3];
+  double scalarRange[2];
+  uint64_t tableOffset;
+  float histogram[volBrickFile::HistogramBins];
+};
+
+// The table at tableOffset holds one entry per brick, level after level. A
+// brick whose size is brickBytes() is stored uncompressed.
+struct BrickEntry
+{
+  uint64_t offset;
+  uint64_t size;
+  float minimum;
+  float maximum;
+};
+
+//------------------------------------------------------------------------------
+// pread() the whole range, retrying on short reads.
+bool readFully(int fd, void *buffer, size_t size, off_t offset)
+{
+  char *out = static_cast<char*>(buffer);
+  while (size > 0)
+    {
+    const ssize_t n = pread(fd, out, size, offset);
+    if (n <= 0)
+      {
+      return false;
+      }
+    out += n;
+    size -= static_cast<size_t>(n);
+    offset += n;
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool writeFully(int fd, const void *buffer, size_t size, off_t offset)
+{
+  const char *in = static_cast<const char*>(buffer);
+  while (size > 0)
+    {
+    const ssize_t n = pwrite(fd, in, size, offset);
+    if (n <= 0)
+      {
+      return false;
+      }
+    in += n;
+    size -= static_cast<size_t>(n);
+    offset += n;
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool isCompatible(const FileHeader &header)
+{
+  return std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 &&
+      header.version == Version &&
+      header.brickSize == volBrickCache::BrickSize &&
+      header.numberOfLevels >= 1 && header.numberOfLevels <= MaxLevels;
+}
+
+//------------------------------------------------------------------------------
+vtkDataCompressor* newCompressor(volBrickFile::Compression compression)
+{
+  switch (compression)
+    {
+    case volBrickFile::ZLibCompression:
+      return vtkZLibDataCompressor::New();
+#ifdef VOL_HAVE_LZ4
+    case volBrickFile::LZ4Compression:
+      return vtkLZ4DataCompressor::New();
+#endif
+    default:
+      return nullptr;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Reads a brick stored at offset, uncompressing it if needed.
+bool readStoredBrick(int fd, volBrickFile::Compression compression,
+                     const BrickEntry &entry, float *samples)
+{
+  const size_t bytes = volBrickFile::brickBytes();
+  if (entry.size == bytes)
+    {
+    return readFully(fd, samples, bytes, static_cast<off_t>(entry.offset));
+    }
+
+  vtkSmartPointer<vtkDataCompressor> decompressor;
+  decompressor.TakeReference(newCompressor(compression));
+  if (!decompressor || entry.size > bytes)
+    {
+    return false;
+    }
+  std::vector<unsigned char> buffer(static_cast<size_t>(entry.size));
+  return readFully(fd, buffer.data(), buffer.size(),
+                   static_cast<off_t>(entry.offset)) &&
+      decompressor->Uncompress(buffer.data(), buffer.size(),
+                               reinterpret_cast<unsigned char*>(samples),
+                               bytes) == bytes;
+}
+
+//------------------------------------------------------------------------------
+// Number of samples of the next coarser level along an axis with dim samples:
+// every second one, plus the last.
+int coarserDimension(int dim)
+{
+  return dim / 2 + 1;
+}
+
+//------------------------------------------------------------------------------
+// Index along an axis of the finer level's sample that sample i of the
+// coarser level (with dim samples) was taken from.
+int finerIndex(int i, int dim, int finerDim)
+{
+  return i < dim - 1 ? 2 * i : finerDim - 1;
+}
+
+//------------------------------------------------------------------------------
+int brickDimension(int dim)
+{
+  return std::max(1, (dim - 2) / volBrickCache::BrickSize + 1);
+}
+
+//------------------------------------------------------------------------------
+// Layout of a level while it is written.
+struct LevelLayout
+{
+  std::array<int, 3> dims;
+  std::array<int, 3> brickDims;
+  size_t firstBrick;
+};
+
+//------------------------------------------------------------------------------
+// Compresses the bricks of a layer and, for the full resolution level, bins
+// the samples each brick owns (those not shared with the next brick) into a
+// histogram of its own.
+struct LayerFunctor
+{
+  const volBrickCache *layer;
+  volBrickFile::Compression compression;
+  int ownedSlices;
+  std::vector<std::vector<unsigned char> > *compressed;
+  std::vector<uint32_t> *counts; // HistogramBins per brick, or null
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const int N = volBrickFile::HistogramBins;
+    const size_t bytes = volBrickFile::brickBytes();
+    const std::array<int, 3> &dims = this->layer->dimensions();
+    const std::array<int, 3> &brickDims = this->layer->brickDimensions();
+
+    vtkSmartPointer<vtkDataCompressor> compressor;
+    compressor.TakeReference(newCompressor(this->compression));
+
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const float *samples = this->layer->brick(static_cast<size_t>(b));
+
+      if (this->counts)
+        {
+        const int bi = static_cast<int>(b % brickDims[0]);
+        const int bj = static_cast<int>(b / brickDims[0]);
+        const int ni = bi == brickDims[0] - 1 ? dims[0] - bi * B : B;
+        const int nj = bj == brickDims[1] - 1 ? dims[1] - bj * B : B;
+        uint32_t *bins = this->counts->data() + b * N;
+        for (int k = 0; k < this->ownedSlices; ++k)
+          {
+          for (int j = 0; j < nj; ++j)
+            {
+            const float *row = samples + S * (j + S * k);
+            for (int i = 0; i < ni; ++i)
+              {
+              const float v = row[i];
+              ++bins[v >= N - 1 ? N - 1 : (v > 0.f ? static_cast<int>(v) : 0)];
+              }
+            }
+          }
+        }
+
+      // Keep the brick as is where compression does not pay:
+      std::vector<unsigned char> &out = (*this->compressed)[b];
+      out.clear();
+      if (compressor)
+        {
+        out.resize(compressor->GetMaximumCompressionSpace(bytes));
+        const size_t size = compressor->Compress(
+              reinterpret_cast<const unsigned char*>(samples), bytes,
+              out.data(), out.size());
+        out.resize(size > 0 && size < bytes ? size : 0);
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+// Appends bricks to the file being converted, and reads back those of the
+// finer level while building a coarser one.
+struct BrickWriter
+{
+  int fd;
+  volBrickFile::Compression compression;
+  uint64_t offset;
+  std::vector<BrickEntry> entries;
+
+  // Layer is the next brick layer of the current level. ownedSlices is the
+  // number of its slices that the next layer does not repeat.
+  bool writeLayer(const volBrickCache &layer, int ownedSlices,
+                  std::vector<double> *histogram)
+  {
+    const int N = volBrickFile::HistogramBins;
+    const size_t numBricks = layer.numberOfBricks();
+    std::vector<std::vector<unsigned char> > compressed(numBricks);
+    std::vector<uint32_t> counts(histogram ? numBricks * N : 0, 0);
+
+    LayerFunctor functor;
+    functor.layer = &layer;
+    functor.compression = this->compression;
+    functor.ownedSlices = ownedSlices;
+    functor.compressed = &compressed;
+    functor.counts = histogram ? &counts : nullptr;
+    vtkSMPTools::For(0, static_cast<vtkIdType>(numBricks), 1, functor);
+
+    for (size_t b = 0; b < numBricks; ++b)
+      {
+      BrickEntry entry;
+      entry.offset = this->offset;
+      entry.minimum = layer.brickMinimum(b);
+      entry.maximum = layer.brickMaximum(b);
+      bool written;
+      if (compressed[b].empty())
+        {
+        entry.size = volBrickFile::brickBytes();
+        written = writeFully(this->fd, layer.brick(b), entry.size,
+                             static_cast<off_t>(entry.offset));
+        }
+      else
+        {
+        entry.size = compressed[b].size();
+        written = writeFully(this->fd, compressed[b].data(), entry.size,
+                             static_cast<off_t>(entry.offset));
+        }
+      if (!written)
+        {
+        return false;
+        }
+      this->offset += entry.size;
+      this->entries.push_back(entry);
+
+      for (int i = 0; histogram && i < N; ++i)
+        {
+        (*histogram)[i] += counts[b * N + i];
+        }
+      }
+    return true;
+  }
+
+  bool readBrick(size_t entry, float *samples) const
+  {
+    return readStoredBrick(this->fd, this->compression, this->entries[entry],
+                           samples);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Reads bricks of the file being converted, in parallel.
+struct ReadBricksFunctor
+{
+  const BrickWriter *writer;
+  size_t firstEntry;
+  std::vector<std::vector<float> > *bricks;
+  std::atomic<bool> *failed;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const size_t S = volBrickCache::BrickSamples;
+    for (vtkIdType b = begin; b < end && !*this->failed; ++b)
+      {
+      std::vector<float> &brick = (*this->bricks)[b];
+      brick.resize(S * S * S);
+      if (!this->writer->readBrick(this->firstEntry + b, brick.data()))
+        {
+        *this->failed = true;
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+// Fills slices of a slab of the coarser level with the samples they are taken
+// from in the bricks of the finer one.
+struct SubsampleFunctor
+{
+  const std::vector<std::vector<float> > *bricks; // finer brick layers
+  std::array<std::vector<int>, 3> brick; // finer brick along each axis
+  std::array<std::vector<int>, 3> local; // index within that brick
+  std::array<int, 2> brickDims; // of the finer level
+  int firstLayer;
+  float *output;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int S = volBrickCache::BrickSamples;
+    const size_t nx = this->brick[0].size();
+    const size_t ny = this->brick[1].size();
+    for (vtkIdType z = begin; z < end; ++z)
+      {
+      const int bk = this->brick[2][z] - this->firstLayer;
+      const int lz = this->local[2][z];
+      float *out = this->output + z * nx * ny;
+      for (size_t y = 0; y < ny; ++y)
+        {
+        const int bj = this->brick[1][y];
+        const int ly = this->local[1][y];
+        for (size_t x = 0; x < nx; ++x)
+          {
+          const int bi = this->brick[0][x];
+          const std::vector<float> &samples = (*this->bricks)[
+              bi + this->brickDims[0] * (bj + this->brickDims[1] * bk)];
+          *out++ = samples[this->local[0][x] + S * (ly + S * lz)];
+          }
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+// The samples of the coarser level that brick layer bk covers, taken from
+// the finer level already in the file. Null if reading failed.
+vtkSmartPointer<vtkImageData> coarserSlab(const BrickWriter &writer,
+                                          const LevelLayout &finer,
+                                          const std::array<int, 3> &dims,
+                                          int bk)
+{
+  const int B = volBrickCache::BrickSize;
+  const int z0 = bk * B;
+  const int z1 = std::min(z0 + B, dims[2] - 1);
+
+  SubsampleFunctor subsample;
+  for (int i = 0; i < 3; ++i)
+    {
+    const int first = i == 2 ? z0 : 0;
+    const int last = i == 2 ? z1 : dims[i] - 1;
+    for (int c = first; c <= last; ++c)
+      {
+      const int f = finerIndex(c, dims[i], finer.dims[i]);
+      const int b = std::min(f / B, finer.brickDims[i] - 1);
+      subsample.brick[i].push_back(b);
+      subsample.local[i].push_back(f - b * B);
+      }
+    }
+  subsample.brickDims[0] = finer.brickDims[0];
+  subsample.brickDims[1] = finer.brickDims[1];
+  subsample.firstLayer = subsample.brick[2].front();
+
+  // The brick layers of the finer level holding those samples:
+  const size_t layerBricks =
+      static_cast<size_t>(finer.brickDims[0]) * finer.brickDims[1];
+  const size_t numLayers =
+      static_cast<size_t>(subsample.brick[2].back() - subsample.firstLayer + 1);
+  std::vector<std::vector<float> > bricks(numLayers * layerBricks);
+  std::atomic<bool> failed(false);
+  ReadBricksFunctor read;
+  read.writer = &writer;
+  read.firstEntry = finer.firstBrick + subsample.firstLayer * layerBricks;
+  read.bricks = &bricks;
+  read.failed = &failed;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(bricks.size()), 1, read);
+  if (failed)
+    {
+    return nullptr;
+    }
+
+  const int slabDims[3] = { dims[0], dims[1], z1 - z0 + 1 };
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  scalars->SetNumberOfTuples(static_cast<vtkIdType>(slabDims[0]) *
+                             slabDims[1] * slabDims[2]);
+  subsample.bricks = &bricks;
+  subsample.output = scalars->GetPointer(0);
+  vtkSMPTools::For(0, slabDims[2], subsample);
+
+  vtkSmartPointer<vtkImageData> slab = vtkSmartPointer<vtkImageData>::New();
+  slab->SetDimensions(slabDims);
+  slab->GetPointData()->SetScalars(scalars.Get());
+  return slab;
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volBrickFile::volBrickFile()
+  : m_fd(-1),
+    m_compression(NoCompression)
+{
+  this->close();
+}
+
+//------------------------------------------------------------------------------
+volBrickFile::~volBrickFile()
+{
+  this->close();
+}
+
+//------------------------------------------------------------------------------
+std::string volBrickFile::defaultFileName(const std::string &source)
+{
+  return source + ".bricks";
+}
+
+//------------------------------------------------------------------------------
+bool volBrickFile::isUpToDate(const std::string &source,
+                              const std::string &target)
+{
+  struct stat sourceStat;
+  struct stat targetStat;
+  if (stat(target.c_str(), &targetStat) != 0)
+    {
+    return false;
+    }
+
+  // Files written by an earlier version are rewritten:
+  const int fd = ::open(target.c_str(), O_RDONLY);
+  FileHeader header;
+  const bool compatible = fd >= 0 &&
+      readFully(fd, &header, sizeof(header), 0) && isCompatible(header);
+  if (fd >= 0)
+    {
+    ::close(fd);
+    }
+  if (!compatible)
+    {
+    return false;
+    }
+
+  if (stat(source.c_str(), &sourceStat) != 0)
+    {
+    // No source to compare against; use what we have.
+    return true;
+    }
+  return targetStat.st_mtime >= sourceStat.st_mtime;
+}
+
+//------------------------------------------------------------------------------
+bool volBrickFile::hasCompression(Compression compression)
+{
+  switch (compression)
+    {
+    case NoCompression:
+    case ZLibCompression:
+      return true;
+    case LZ4Compression:
+#ifdef VOL_HAVE_LZ4
+      return true;
+#else
+      return false;
+#endif
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+volBrickFile::Compression volBrickFile::defaultCompression()
+{
+  // zlib halves the file at best, but decompresses slower than most disks
+  // read; only LZ4 is worth it by default.
+  return hasCompression(LZ4Compression) ? LZ4Compression : NoCompression;
+}
+
+//------------------------------------------------------------------------------
+bool volBrickFile::convert(const std::string &source, const std::string &target,
+                           Compression compression, int numberOfLevels)
+{
+  const int B = volBrickCache::BrickSize;
+  const int N = HistogramBins;
+
+  if (!hasCompression(compression))
+    {
+    std::cerr << "This build of VTK does not provide the requested "
+                 "compressor.\n";
+    return false;
+    }
+
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(source.c_str());
+  reader->UpdateInformation();
+
+  vtkInformation *outInfo = reader->GetOutputInformation(0);
+  if (!outInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+    {
+    std::cerr << "Cannot read " << source << ".\n";
+    return false;
+    }
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.brickSize = B;
+  header.compression = compression;
+
+  int whole[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), whole);
+  std::fill(header.spacing, header.spacing + 3, 1.);
+  if (outInfo->Has(vtkDataObject::ORIGIN()))
+    {
+    outInfo->Get(vtkDataObject::ORIGIN(), header.origin);
+    }
+  if (outInfo->Has(vtkDataObject::SPACING()))
+    {
+    outInfo->Get(vtkDataObject::SPACING(), header.spacing);
+    }
+
+  // Levels are added until one fits in a brick, or as many as requested
+  // while subsampling still reduces the data:
+  std::vector<LevelLayout> levels(1);
+  for (int i = 0; i < 3; ++i)
+    {
+    header.dims[i] = whole[2 * i + 1] - whole[2 * i] + 1;
+    header.origin[i] += whole[2 * i] * header.spacing[i];
+    levels[0].dims[i] = header.dims[i];
+    levels[0].brickDims[i] = brickDimension(header.dims[i]);
+    }
+  while (static_cast<int>(levels.size()) < MaxLevels)
+    {
+    const LevelLayout &finer = levels.back();
+    if (numberOfLevels > 0 ? static_cast<int>(levels.size()) >= numberOfLevels
+                           : finer.brickDims == std::array<int, 3>{{1, 1, 1}})
+      {
+      break;
+      }
+    LevelLayout coarser;
+    for (int i = 0; i < 3; ++i)
+      {
+      coarser.dims[i] = coarserDimension(finer.dims[i]);
+      coarser.brickDims[i] = brickDimension(coarser.dims[i]);
+      }
+    if (coarser.dims == finer.dims)
+      {
+      break;
+      }
+    levels.push_back(coarser);
+    }
+  header.numberOfLevels = static_cast<int32_t>(levels.size());
+  header.scalarRange[0] = std::numeric_limits<double>::max();
+  header.scalarRange[1] = -std::numeric_limits<double>::max();
+
+  // Write to a temporary file first so that an interrupted conversion never
+  // leaves a truncated brick file behind. Bricks follow the header; the
+  // header is rewritten at the end, when the range and table are known:
+  const std::string tmpName = target + ".tmp";
+  BrickWriter writer;
+  writer.fd = ::open(tmpName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  writer.compression = compression;
+  writer.offset = sizeof(FileHeader);
+  if (writer.fd < 0)
+    {
+    std::cerr << "Cannot write " << tmpName << ".\n";
+    return false;
+    }
+  auto fail = [&](const std::string &message) -> bool
+    {
+    std::cerr << message << "\n";
+    ::close(writer.fd);
+    std::remove(tmpName.c_str());
+    return false;
+    };
+
+  std::vector<double> histogram(N, 0.);
+  for (size_t l = 0; l < levels.size(); ++l)
+    {
+    LevelLayout &level = levels[l];
+    level.firstBrick = writer.entries.size();
+    const size_t layerBricks =
+        static_cast<size_t>(level.brickDims[0]) * level.brickDims[1];
+
+    for (int bk = 0; bk < level.brickDims[2]; ++bk)
+      {
+      // One layer of bricks needs BrickSamples slices, the last one of which
+      // belongs to the next layer:
+      const bool lastLayer = bk == level.brickDims[2] - 1;
+      const int ownedSlices =
+          lastLayer ? level.dims[2] - bk * B : B;
+
+      std::unique_ptr<volBrickCache> layer;
+      if (l == 0)
+        {
+        int slab[6] = { whole[0], whole[1], whole[2], whole[3],
+                        whole[4] + bk * B, 0 };
+        slab[5] = std::min(slab[4] + B, whole[5]);
+        reader->UpdateExtent(slab);
+        layer.reset(new volBrickCache(reader->GetOutput()));
+        }
+      else
+        {
+        vtkSmartPointer<vtkImageData> slab =
+            coarserSlab(writer, levels[l - 1], level.dims, bk);
+        if (slab)
+          {
+          layer.reset(new volBrickCache(slab));
+          }
+        }
+      if (!layer || layer->numberOfBricks() != layerBricks)
+        {
+        return fail("Failed to read slab " + std::to_string(bk) +
+                    " of level " + std::to_string(l) + " of " + source + ".");
+        }
+
+      if (!writer.writeLayer(*layer, ownedSlices, l == 0 ? &histogram
+                                                         : nullptr))
+        {
+        return fail("Failed to write " + tmpName + ".");
+        }
+      if (l == 0)
+        {
+        header.scalarRange[0] = std::min(header.scalarRange[0],
+                                         layer->scalarRange()[0]);
+        header.scalarRange[1] = std::max(header.scalarRange[1],
+                                         layer->scalarRange()[1]);
+        }
+      }
+    }
+
+  header.tableOffset = writer.offset;
+  for (int i = 0; i < N; ++i)
+    {
+    header.histogram[i] = static_cast<float>(histogram[i]);
+    }
+  if (!writeFully(writer.fd, writer.entries.data(),
+                  writer.entries.size() * sizeof(BrickEntry),
+                  static_cast<off_t>(header.tableOffset)) ||
+      !writeFully(writer.fd, &header, sizeof(header), 0))
+    {
+    return fail("Failed to write " + tmpName + ".");
+    }
+
+  if (::close(writer.fd) != 0 ||
+      std::rename(tmpName.c_str(), target.c_str()) != 0)
+    {
+    std::cerr << "Failed to write " << target << ".\n";
+    std::remove(tmpName.c_str());
+    return false;
+    }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool volBrickFile::open(const std::string &fileName)
+{
+  this->close();
+
+  m_fd = ::open(fileName.c_str(), O_RDONLY);
+  if (m_fd < 0)
+    {
+    return false;
+    }
+
+  FileHeader header;
+  if (!readFully(m_fd, &header, sizeof(header), 0) || !isCompatible(header))
+    {
+    std::cerr << fileName << " is not a compatible brick file.\n";
+    this->close();
+    return false;
+    }
+  m_compression = static_cast<Compression>(header.compression);
+  if (!hasCompression(m_compression))
+    {
+    std::cerr << fileName << " needs a compressor that this build of VTK does "
+                 "not provide.\n";
+    this->close();
+    return false;
+    }
+
+  m_levels.resize(static_cast<size_t>(header.numberOfLevels));
+  size_t numBricks = 0;
+  for (size_t l = 0; l < m_levels.size(); ++l)
+    {
+    Level &level = m_levels[l];
+    const int rate = levelSampleRate(static_cast<int>(l));
+    for (int i = 0; i < 3; ++i)
+      {
+      level.dims[i] = l == 0 ? header.dims[i]
+                             : coarserDimension(m_levels[l - 1].dims[i]);
+      level.brickDims[i] = brickDimension(level.dims[i]);
+      level.spacing[i] = header.spacing[i] * rate;
+      }
+    level.firstBrick = numBricks;
+    level.numberOfBricks = static_cast<size_t>(level.brickDims[0]) *
+        level.brickDims[1] * level.brickDims[2];
+    numBricks += level.numberOfBricks;
+    }
+  for (int i = 0; i < 3; ++i)
+    {
+    m_origin[i] = header.origin[i];
+    }
+  m_scalarRange[0] = header.scalarRange[0];
+  m_scalarRange[1] = header.scalarRange[1];
+  m_histogram.assign(header.histogram, header.histogram + HistogramBins);
+
+  std::vector<BrickEntry> entries(numBricks);
+  if (!readFully(m_fd, entries.data(), numBricks * sizeof(BrickEntry),
+                 static_cast<off_t>(header.tableOffset)))
+    {
+    std::cerr << fileName << " is truncated.\n";
+    this->close();
+    return false;
+    }
+  m_brickOffset.resize(numBricks);
+  m_brickSize.resize(numBricks);
+  m_brickMin.resize(numBricks);
+  m_brickMax.resize(numBricks);
+  for (size_t b = 0; b < numBricks; ++b)
+    {
+    m_brickOffset[b] = entries[b].offset;
+    m_brickSize[b] = entries[b].size;
+    m_brickMin[b] = entries[b].minimum;
+    m_brickMax[b] = entries[b].maximum;
+    }
+
+  m_fileName = fileName;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void volBrickFile::close()
+{
+  if (m_fd >= 0)
+    {
+    ::close(m_fd);
+    m_fd = -1;
+    }
+  m_fileName.clear();
+
+  // A closed file has a single, empty level:
+  Level empty;
+  empty.dims.fill(0);
+  empty.brickDims.fill(0);
+  empty.spacing.fill(1.);
+  empty.firstBrick = 0;
+  empty.numberOfBricks = 0;
+  m_levels.assign(1, empty);
+  m_origin.fill(0.);
+  m_scalarRange.fill(0.);
+  m_histogram.clear();
+  m_brickOffset.clear();
+  m_brickSize.clear();
+  m_brickMin.clear();
+  m_brickMax.clear();
+}
+
+//------------------------------------------------------------------------------
+int volBrickFile::levelForSampleRate(int sampleRate) const
+{
+  int level = 0;
+  while (level + 1 < this->numberOfLevels() &&
+         sampleRate % levelSampleRate(level + 1) == 0)
+    {
+    ++level;
+    }
+  return level;
+}
+
+//------------------------------------------------------------------------------
+size_t volBrickFile::brickBytes()
+{
+  const size_t S = volBrickCache::BrickSamples;
+  return S * S * S * sizeof(float);
+}
+
+//------------------------------------------------------------------------------
+bool volBrickFile::readBrick(int level, size_t index, float *samples) const
+{
+  if (m_fd < 0 || level < 0 || level >= this->numberOfLevels() ||
+      index >= this->numberOfBricks(level))
+    {
+    return false;
+    }
+  const size_t b = m_levels[level].firstBrick + index;
+  BrickEntry entry;
+  entry.offset = m_brickOffset[b];
+  entry.size = m_brickSize[b];
+  return readStoredBrick(m_fd, m_compression, entry, samples);
+}
@@ -0,0 +1,189 @@
+#ifndef VOLBRICKFILE_H
+#define VOLBRICKFILE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The volBrickFile class is an on-disk, multiresolution copy of a
+ * volume, split into the same padded bricks as volBrickCache.
+ *
+ * The file holds a small header (geometry, scalar range and a histogram of the
+ * full resolution samples), the bricks of each level of detail and a table
+ * giving the location and range of every brick. Level 0 is the volume itself;
+ * level l keeps every 2^l-th sample along each axis plus the last one, as
+ * vtkExtractVOI with IncludeBoundaryOn() does at that sample rate. Bricks may
+ * be compressed, each on its own, so any brick of any level can be read
+ * without touching the others.
+ *
+ * The header and table are read when the file is opened; bricks are read on
+ * demand with readBrick(), which may be called concurrently.
+ *
+ * Brick files are written by convert(), which streams the source .vti through
+ * the reader in slabs one brick thick and builds each level from the one
+ * before it, so converting never needs more memory than a few such slabs.
+ * Bricks are built, compressed and binned into the histogram in parallel.
+ */
+class volBrickFile
+{
+public:
+  /** How the bricks are stored. */
+  enum Compression
+    {
+    NoCompression = 0,
+    ZLibCompression = 1,
+    LZ4Compression = 2
+    };
+
+  /** Number of bins of histogram(). */
+  static const int HistogramBins = 256;
+
+  volBrickFile();
+  ~volBrickFile();
+
+  /** The brick file used for the .vti file source. */
+  static std::string defaultFileName(const std::string &source);
+
+  /**
+   * True if target is a brick file of the current format that is not older
+   * than source.
+   */
+  static bool isUpToDate(const std::string &source, const std::string &target);
+
+  /** Whether this build of VTK provides the compressor. */
+  static bool hasCompression(Compression compression);
+
+  /** The fastest compression to read back that this build provides. */
+  static Compression defaultCompression();
+
+  /**
+   * Convert the first scalar component of the .vti file source to a brick
+   * file target. With numberOfLevels 0, levels are added until one fits in a
+   * single brick. Returns false on failure.
+   */
+  static bool convert(const std::string &source, const std::string &target,
+                      Compression compression = defaultCompression(),
+                      int numberOfLevels = 0);
+
+  bool open(const std::string &fileName);
+  void close();
+  bool isOpen() const { return m_fd >= 0; }
+  const std::string& fileName() const { return m_fileName; }
+
+  Compression compression() const { return m_compression; }
+  int numberOfLevels() const { return static_cast<int>(m_levels.size()); }
+
+  /** Factor by which level is subsampled. */
+  static int levelSampleRate(int level) { return 1 << level; }
+
+  /**
+   * The coarsest level from which the data reduced at sampleRate can be
+   * taken, i.e. whose sample rate divides sampleRate.
+   */
+  int levelForSampleRate(int sampleRate) const;
+
+  /** Geometry of the full resolution volume, as in volBrickCache. */
+  const std::array<int, 3>& dimensions() const { return m_levels[0].dims; }
+  const std::array<int, 3>& brickDimensions() const
+  {
+    return m_levels[0].brickDims;
+  }
+  size_t numberOfBricks() const { return this->numberOfBricks(0); }
+  const std::array<double, 3>& origin() const { return m_origin; }
+  const std::array<double, 3>& spacing() const { return m_levels[0].spacing; }
+  const std::array<double, 2>& scalarRange() const { return m_scalarRange; }
+
+  /** Geometry of a level. All levels share the origin. */
+  const std::array<int, 3>& dimensions(int level) const
+  {
+    return m_levels[level].dims;
+  }
+  const std::array<int, 3>& brickDimensions(int level) const
+  {
+    return m_levels[level].brickDims;
+  }
+  size_t numberOfBricks(int level) const
+  {
+    return m_levels[level].numberOfBricks;
+  }
+  const std::array<double, 3>& spacing(int level) const
+  {
+    return m_levels[level].spacing;
+  }
+
+  /**
+   * Histogram of the full resolution samples: bin i counts the values v with
+   * int(v) == i, values outside [0, HistogramBins) count in the end bins.
+   */
+  const std::vector<float>& histogram() const { return m_histogram; }
+
+  size_t brickIndex(int bi, int bj, int bk) const
+  {
+    return this->brickIndex(0, bi, bj, bk);
+  }
+  size_t brickIndex(int level, int bi, int bj, int bk) const
+  {
+    const std::array<int, 3> &brickDims = m_levels[level].brickDims;
+    return bi + brickDims[0] * (bj + brickDims[1] * bk);
+  }
+
+  float brickMinimum(size_t index) const { return m_brickMin[index]; }
+  float brickMaximum(size_t index) const { return m_brickMax[index]; }
+  float brickMinimum(int level, size_t index) const
+  {
+    return m_brickMin[m_levels[level].firstBrick + index];
+  }
+  float brickMaximum(int level, size_t index) const
+  {
+    return m_brickMax[m_levels[level].firstBrick + index];
+  }
+
+  /** Bytes used by one brick in memory. */
+  static size_t brickBytes();
+
+  /**
+   * Read the samples of a full resolution brick into samples, which must
+   * hold volBrickCache::BrickSamples^3 values. Thread safe.
+   */
+  bool readBrick(size_t index, float *samples) const
+  {
+    return this->readBrick(0, index, samples);
+  }
+
+  /** Read the samples of a brick of level. Thread safe. */
+  bool readBrick(int level, size_t index, float *samples) const;
+
+private:
+  // Not implemented:
+  volBrickFile(const volBrickFile&);
+  volBrickFile& operator=(const volBrickFile&);
+
+  struct Level
+  {
+    std::array<int, 3> dims;
+    std::array<int, 3> brickDims;
+    std::array<double, 3> spacing;
+    size_t firstBrick;
+    size_t numberOfBricks;
+  };
+
+  std::string m_fileName;
+  int m_fd;
+  Compression m_compression;
+
+  std::array<double, 3> m_origin;
+  std::array<double, 2> m_scalarRange;
+  std::vector<Level> m_levels;
+  std::vector<float> m_histogram;
+
+  // Per brick, all levels one after the other:
+  std::vector<uint64_t> m_brickOffset;
+  std::vector<uint64_t> m_brickSize;
+  std::vector<float> m_brickMin;
+  std::vector<float> m_brickMax;
+};
+
+#endif // VOLBRICKFILE_H
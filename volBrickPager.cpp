@@ -0,0 +1,451 @@
+#include "volBrickPager.h"
+
+#include "volArrayPool.h"
+#include "volBrickCache.h"
+#include "volBrickFile.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkTrivialProducer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Copies the samples each brick owns into an image. Every sample is owned by
+// exactly one brick (the faces a brick shares with its upper neighbors belong
+// to the neighbors), so the bricks can be copied in parallel.
+struct ExtractFunctor
+{
+  volBrickPager *pager;
+  const std::vector<size_t> *bricks;
+  std::array<int, 6> extent;
+  float *output;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const volBrickFile &file = this->pager->file();
+    const std::array<int, 3> &dims = file.dimensions();
+    const std::array<int, 3> &brickDims = file.brickDimensions();
+    const vtkIdType rowLength = this->extent[1] - this->extent[0] + 1;
+    const vtkIdType sliceLength =
+        rowLength * (this->extent[3] - this->extent[2] + 1);
+
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const size_t index = (*this->bricks)[b];
+      const int bijk[3] = {
+        static_cast<int>(index % brickDims[0]),
+        static_cast<int>((index / brickDims[0]) % brickDims[1]),
+        static_cast<int>(index / (static_cast<size_t>(brickDims[0]) *
+                                  brickDims[1])) };
+
+      // Samples owned by this brick, clamped to the extent:
+      int lo[3];
+      int hi[3];
+      for (int i = 0; i < 3; ++i)
+        {
+        const int first = bijk[i] * B;
+        const int last = bijk[i] == brickDims[i] - 1 ? dims[i] - 1
+                                                     : first + B - 1;
+        lo[i] = std::max(first, this->extent[2 * i]);
+        hi[i] = std::min(last, this->extent[2 * i + 1]);
+        }
+      if (lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2])
+        {
+        continue;
+        }
+
+      volBrickPager::Brick brick = this->pager->brick(index);
+      if (!brick)
+        {
+        continue;
+        }
+
+      for (int z = lo[2]; z <= hi[2]; ++z)
+        {
+        for (int y = lo[1]; y <= hi[1]; ++y)
+          {
+          const float *in = brick->data() + (lo[0] - bijk[0] * B) +
+              S * ((y - bijk[1] * B) + S * (z - bijk[2] * B));
+          float *out = this->output + (lo[0] - this->extent[0]) +
+              rowLength * (y - this->extent[2]) +
+              sliceLength * (z - this->extent[4]);
+          std::copy(in, in + (hi[0] - lo[0] + 1), out);
+          }
+        }
+      }
+  }
+};
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volBrickPager::volBrickPager(std::unique_ptr<volBrickFile> file, size_t budget)
+  : m_file(std::move(file)),
+    m_budget(budget),
+    m_prefetching(false)
+{
+}
+
+//------------------------------------------------------------------------------
+volBrickPager::~volBrickPager()
+{
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_prefetchQueue.clear();
+  }
+  if (m_prefetchTask.valid())
+    {
+    m_prefetchTask.wait();
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t volBrickPager::budget() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_budget;
+}
+
+//------------------------------------------------------------------------------
+void volBrickPager::setBudget(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_budget = bytes;
+  this->evict();
+}
+
+//------------------------------------------------------------------------------
+size_t volBrickPager::residentBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_resident.size() * volBrickFile::brickBytes();
+}
+
+//------------------------------------------------------------------------------
+volBrickPager::Brick volBrickPager::brick(size_t index)
+{
+  Brick result = this->lookup(index);
+  if (result)
+    {
+    return result;
+    }
+
+  // Read without holding the lock, so that other threads can keep sampling
+  // resident bricks meanwhile:
+  result = this->load(index);
+  if (!result)
+    {
+    return result;
+    }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_resident.find(index);
+  if (it != m_resident.end())
+    { // Another thread was faster.
+    return it->second.first;
+    }
+  m_lru.push_front(index);
+  m_resident[index] = std::make_pair(result, m_lru.begin());
+  this->evict();
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void volBrickPager::prefetch(const std::vector<size_t> &indices)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Don't read ahead more than fits; the first bricks would be evicted by the
+  // last ones.
+  const size_t maxBricks = m_budget / volBrickFile::brickBytes();
+  m_prefetchQueue.assign(indices.begin(),
+                         indices.begin() + std::min(indices.size(),
+                                                    maxBricks));
+
+  if (!m_prefetching && !m_prefetchQueue.empty())
+    {
+    m_prefetching = true;
+    m_prefetchTask = std::async(std::launch::async,
+                                &volBrickPager::runPrefetch, this);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::vector<size_t>
+volBrickPager::bricksInExtent(const std::array<int, 6> &extent) const
+{
+  const int B = volBrickCache::BrickSize;
+  const std::array<int, 3> &brickDims = m_file->brickDimensions();
+
+  int lo[3];
+  int hi[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    lo[i] = std::min(std::max(extent[2 * i], 0) / B, brickDims[i] - 1);
+    hi[i] = std::min(std::max(extent[2 * i + 1], 0) / B, brickDims[i] - 1);
+    }
+
+  std::vector<size_t> result;
+  for (int k = lo[2]; k <= hi[2]; ++k)
+    {
+    for (int j = lo[1]; j <= hi[1]; ++j)
+      {
+      for (int i = lo[0]; i <= hi[0]; ++i)
+        {
+        result.push_back(m_file->brickIndex(i, j, k));
+        }
+      }
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+std::vector<size_t> volBrickPager::bricksOnPlane(const double origin[3],
+                                                 const double normal[3]) const
+{
+  const int B = volBrickCache::BrickSize;
+  const std::array<int, 3> &dims = m_file->dimensions();
+  const std::array<int, 3> &brickDims = m_file->brickDimensions();
+  const std::array<double, 3> &volOrigin = m_file->origin();
+  const std::array<double, 3> &spacing = m_file->spacing();
+
+  std::vector<size_t> result;
+  for (int k = 0; k < brickDims[2]; ++k)
+    {
+    for (int j = 0; j < brickDims[1]; ++j)
+      {
+      for (int i = 0; i < brickDims[0]; ++i)
+        {
+        // The brick's box intersects the plane iff the distance of its
+        // center is within the box's projected half size:
+        const int ijk[3] = {i, j, k};
+        double distance = 0.;
+        double radius = 0.;
+        for (int c = 0; c < 3; ++c)
+          {
+          const int first = ijk[c] * B;
+          const int last = std::min(first + B, std::max(dims[c] - 1, 0));
+          const double center =
+              volOrigin[c] + 0.5 * (first + last) * spacing[c];
+          const double half = 0.5 * (last - first) * std::fabs(spacing[c]);
+          distance += normal[c] * (center - origin[c]);
+          radius += std::fabs(normal[c]) * half;
+          }
+        if (std::fabs(distance) <= radius)
+          {
+          result.push_back(m_file->brickIndex(i, j, k));
+          }
+        }
+      }
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+std::array<int, 6> volBrickPager::wholeExtent() const
+{
+  const std::array<int, 3> &dims = m_file->dimensions();
+  std::array<int, 6> result{{0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1}};
+  return result;
+}
+
+//------------------------------------------------------------------------------
+size_t volBrickPager::extractBytes(const std::array<int, 6> &extent)
+{
+  size_t result = sizeof(float);
+  for (int i = 0; i < 3; ++i)
+    {
+    result *= static_cast<size_t>(
+          std::max(extent[2 * i + 1] - extent[2 * i] + 1, 0));
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData>
+volBrickPager::extract(const std::array<int, 6> &extent)
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetExtent(const_cast<int*>(extent.data()));
+  image->SetOrigin(const_cast<double*>(m_file->origin().data()));
+  image->SetSpacing(const_cast<double*>(m_file->spacing().data()));
+
+  // Extents change on every drag of the region of interest:
+  vtkSmartPointer<vtkDataArray> scalars =
+      volArrayPool::instance().newArray(VTK_FLOAT, image->GetNumberOfPoints());
+  scalars->SetName("Scalars");
+  float *output = static_cast<float*>(scalars->GetVoidPointer(0));
+  std::fill(output, output + image->GetNumberOfPoints(), 0.f);
+  image->GetPointData()->SetScalars(scalars);
+
+  std::vector<size_t> bricks = this->bricksInExtent(extent);
+  ExtractFunctor functor;
+  functor.pager = this;
+  functor.bricks = &bricks;
+  functor.extent = extent;
+  functor.output = output;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(bricks.size()), 1, functor);
+
+  return image;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const volBrickCache>
+volBrickPager::view(const std::vector<size_t> &indices)
+{
+  std::vector<Brick> bricks(m_file->numberOfBricks());
+  for (size_t i = 0; i < indices.size(); ++i)
+    {
+    bricks[indices[i]] = this->brick(indices[i]);
+    }
+  return std::make_shared<volBrickCache>(*m_file, bricks);
+}
+
+//------------------------------------------------------------------------------
+volBrickPager::Brick volBrickPager::lookup(size_t index)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_resident.find(index);
+  if (it == m_resident.end())
+    {
+    return Brick();
+    }
+  // Mark as most recently used:
+  m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+  return it->second.first;
+}
+
+//------------------------------------------------------------------------------
+volBrickPager::Brick volBrickPager::load(size_t index)
+{
+  const size_t S = volBrickCache::BrickSamples;
+  std::shared_ptr<std::vector<float> > samples =
+      std::make_shared<std::vector<float> >(S * S * S);
+  if (!m_file->readBrick(index, samples->data()))
+    {
+    std::cerr << "Failed to read brick " << index << " from "
+              << m_file->fileName() << ".\n";
+    return Brick();
+    }
+  return samples;
+}
+
+//------------------------------------------------------------------------------
+void volBrickPager::evict()
+{
+  const size_t maxBricks = m_budget / volBrickFile::brickBytes();
+  while (m_resident.size() > maxBricks && !m_lru.empty())
+    {
+    m_resident.erase(m_lru.back());
+    m_lru.pop_back();
+    }
+}
+
+//------------------------------------------------------------------------------
+void volBrickPager::runPrefetch()
+{
+  for (;;)
+    {
+    size_t index;
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_prefetchQueue.empty())
+      {
+      m_prefetching = false;
+      return;
+      }
+    index = m_prefetchQueue.front();
+    m_prefetchQueue.pop_front();
+    if (m_resident.count(index) != 0)
+      {
+      continue;
+      }
+    }
+    this->brick(index);
+    }
+}
+
+//------------------------------------------------------------------------------
+volPagedSource::volPagedSource()
+{
+  m_extent.fill(0);
+  vtkNew<vtkImageData> empty;
+  m_producer->SetOutput(empty.Get());
+}
+
+//------------------------------------------------------------------------------
+volPagedSource::~volPagedSource()
+{
+}
+
+//------------------------------------------------------------------------------
+void volPagedSource::setPager(const std::shared_ptr<volBrickPager> &pager)
+{
+  if (pager != m_pager)
+    {
+    m_pager = pager;
+    m_modified.Modified();
+    if (m_pager && this->fits())
+      {
+      m_pager->prefetch(m_pager->bricksInExtent(m_extent));
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void volPagedSource::setExtent(const std::array<int, 6> &extent)
+{
+  if (extent != m_extent)
+    {
+    m_extent = extent;
+    m_modified.Modified();
+    if (m_pager && this->fits())
+      {
+      m_pager->prefetch(m_pager->bricksInExtent(m_extent));
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool volPagedSource::fits() const
+{
+  return m_pager &&
+      volBrickPager::extractBytes(m_extent) <= m_pager->budget();
+}
+
+//------------------------------------------------------------------------------
+vtkAlgorithm *volPagedSource::producer() const
+{
+  return m_producer.Get();
+}
+
+//------------------------------------------------------------------------------
+void volPagedSource::update()
+{
+  if (!m_pager || !this->fits() ||
+      m_updated.GetMTime() > m_modified.GetMTime())
+    {
+    return;
+    }
+
+  vtkSmartPointer<vtkImageData> image = m_pager->extract(m_extent);
+  m_producer->SetOutput(image.Get());
+  m_updated.Modified();
+}
+
+//------------------------------------------------------------------------------
+void volPagedSource::releaseData()
+{
+  vtkNew<vtkImageData> empty;
+  m_producer->SetOutput(empty.Get());
+  m_modified.Modified();
+}
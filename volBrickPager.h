@@ -0,0 +1,157 @@
+#ifndef VOLBRICKPAGER_H
+#define VOLBRICKPAGER_H
+
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class volBrickCache;
+class volBrickFile;
+class vtkAlgorithm;
+class vtkImageData;
+class vtkTrivialProducer;
+
+/**
+ * @brief The volBrickPager class keeps a bounded, least recently used set of
+ * bricks of a volBrickFile in memory.
+ *
+ * Pipelines ask for the bricks they touch, either as a sampling view
+ * (view()) or as an image covering an extent (extract()). Bricks that are not
+ * resident are read synchronously on the caller's (worker) thread; bricks
+ * that will likely be needed soon can be read ahead in the background with
+ * prefetch().
+ *
+ * Evicting a brick only drops the pager's reference: views and images that
+ * still use it are unaffected.
+ */
+class volBrickPager
+{
+public:
+  using Brick = std::shared_ptr<const std::vector<float> >;
+
+  /** Bytes of bricks kept in memory by default. */
+  static const size_t DefaultBudget = size_t(1) << 30;
+
+  /** file must be open. */
+  explicit volBrickPager(std::unique_ptr<volBrickFile> file,
+                         size_t budget = DefaultBudget);
+  ~volBrickPager();
+
+  const volBrickFile& file() const { return *m_file; }
+
+  /** Upper bound on the bytes of bricks held by the pager. */
+  size_t budget() const;
+  void setBudget(size_t bytes);
+
+  /** Bytes of bricks currently held by the pager. */
+  size_t residentBytes() const;
+
+  /** Return the brick, reading it if needed. Thread safe. */
+  Brick brick(size_t index);
+
+  /**
+   * Read the bricks in the background. Replaces any pending prefetch request.
+   * Thread safe.
+   */
+  void prefetch(const std::vector<size_t> &indices);
+
+  /** Bricks holding the samples in the point extent. */
+  std::vector<size_t> bricksInExtent(const std::array<int, 6> &extent) const;
+
+  /** Bricks intersected by the plane through origin with the given normal. */
+  std::vector<size_t> bricksOnPlane(const double origin[3],
+                                    const double normal[3]) const;
+
+  /** Whole extent of the volume, in point indices. */
+  std::array<int, 6> wholeExtent() const;
+
+  /** Bytes needed by extract(extent). */
+  static size_t extractBytes(const std::array<int, 6> &extent);
+
+  /** A float image holding the samples in the point extent. */
+  vtkSmartPointer<vtkImageData> extract(const std::array<int, 6> &extent);
+
+  /** A sampling view holding (only) the given bricks. */
+  std::shared_ptr<const volBrickCache> view(const std::vector<size_t> &indices);
+
+private:
+  // Not implemented:
+  volBrickPager(const volBrickPager&);
+  volBrickPager& operator=(const volBrickPager&);
+
+  Brick lookup(size_t index);
+  Brick load(size_t index);
+  void evict();
+  void runPrefetch();
+
+  std::unique_ptr<volBrickFile> m_file;
+
+  // LRU list of resident bricks, most recently used first:
+  mutable std::mutex m_mutex;
+  size_t m_budget;
+  std::list<size_t> m_lru;
+  std::unordered_map<size_t, std::pair<Brick, std::list<size_t>::iterator> >
+  m_resident;
+
+  std::deque<size_t> m_prefetchQueue;
+  std::future<void> m_prefetchTask;
+  bool m_prefetching;
+};
+
+/**
+ * @brief The volPagedSource class feeds an extent of a paged volume into a
+ * VTK pipeline.
+ *
+ * setExtent() is cheap and starts prefetching the bricks of the extent;
+ * update() assembles the image on the calling (worker) thread.
+ */
+class volPagedSource
+{
+public:
+  volPagedSource();
+  ~volPagedSource();
+
+  void setPager(const std::shared_ptr<volBrickPager> &pager);
+  const std::shared_ptr<volBrickPager>& pager() const { return m_pager; }
+
+  void setExtent(const std::array<int, 6> &extent);
+  const std::array<int, 6>& extent() const { return m_extent; }
+
+  /** False if the extent does not fit in the pager's budget. */
+  bool fits() const;
+
+  /** Producer whose output is the assembled image. */
+  vtkAlgorithm* producer() const;
+
+  /** Assemble the image if the extent or pager changed. */
+  void update();
+
+  /** Drop the assembled image. The next update() assembles it again. */
+  void releaseData();
+
+  /** Last time the pager or extent changed. */
+  unsigned long GetMTime() const { return m_modified.GetMTime(); }
+
+private:
+  // Not implemented:
+  volPagedSource(const volPagedSource&);
+  volPagedSource& operator=(const volPagedSource&);
+
+  std::shared_ptr<volBrickPager> m_pager;
+  std::array<int, 6> m_extent;
+  vtkTimeStamp m_modified;
+  vtkTimeStamp m_updated;
+  vtkNew<vtkTrivialProducer> m_producer;
+};
+
+#endif // VOLBRICKPAGER_H
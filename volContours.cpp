@@ -5,9 +5,11 @@
 #include "volReader.h"
 
 #include <vtkActor.h>
+#include <vtkClipPolyData.h>
 #include <vtkDataObject.h>
 #include <vtkFlyingEdges3D.h>
 #include <vtkExternalOpenGLRenderer.h>
+#include <vtkImageData.h>
 #include <vtkPolyDataMapper.h>
 
 //------------------------------------------------------------------------------
@@ -55,6 +57,19 @@ vtkDataObject *volContours::contourData(LevelOfDetail lod) const
               : nullptr;
 }
 
+//------------------------------------------------------------------------------
+size_t volContours::memoryUsage() const
+{
+  size_t bytes = 0;
+  const LevelOfDetail lods[2] = { LevelOfDetail::LoRes, LevelOfDetail::HiRes };
+  for (int i = 0; i < 2; ++i)
+    {
+    vtkDataObject *data = this->contourData(lods[i]);
+    bytes += data ? static_cast<size_t>(data->GetActualMemorySize()) << 10 : 0;
+    }
+  return bytes;
+}
+
 //------------------------------------------------------------------------------
 std::string volContours::progressLabel() const
 {
@@ -134,6 +149,7 @@ void volContours::ContourDataPipeline::configure(
       static_cast<const volApplicationState&>(appStateIn);
 
   vtkDataObject *input = nullptr;
+  bool fullResolution = false;
   switch (this->lod)
     {
     case LevelOfDetail::LoRes:
@@ -152,6 +168,7 @@ void volContours::ContourDataPipeline::configure(
       else
         {
         input = appState.reader().dataObject();
+        fullResolution = true;
         }
       break;
 
@@ -160,7 +177,11 @@ void volContours::ContourDataPipeline::configure(
       return;
     }
 
-  this->contour->SetInputDataObject(input);
+  this->clipper.configure(vtkImageData::SafeDownCast(input), appState,
+                          fullResolution);
+  this->clipper.connectInput(this->contour.Get());
+  this->output = this->clipper.connectOutput(this->contour.Get(),
+                                             this->clip.Get());
   this->contour->SetNumberOfContours(state.contourValues.size());
   for (size_t i = 0; i < state.contourValues.size(); ++i)
     {
@@ -177,15 +198,18 @@ bool volContours::ContourDataPipeline::needsUpdate(const ObjectState &,
   // Note that we don't check visibility -- this is intentional, as the contours
   // need to be up-to-date for volSlice, since slice uses the contoured data.
   return
-      this->contour->GetInputDataObject(0, 0) &&
+      this->contour->GetInputDataObject(0, 0) != nullptr &&
+      this->clipper.available() &&
       (!data.contours ||
-       data.contours->GetMTime() < this->contour->GetMTime());
+       data.contours->GetMTime() < this->contour->GetMTime() ||
+       data.contours->GetMTime() < this->clipper.GetMTime());
 }
 
 //------------------------------------------------------------------------------
 void volContours::ContourDataPipeline::execute()
 {
-  this->contour->Update();
+  this->clipper.update();
+  this->output->Update();
 }
 
 //------------------------------------------------------------------------------
@@ -193,10 +217,10 @@ void volContours::ContourDataPipeline::exportResult(LODData &result) const
 {
   ContourLODData &data = static_cast<ContourLODData&>(result);
 
-  vtkDataObject *output = this->contour->GetOutputDataObject(0);
-  assert(output);
-  data.contours.TakeReference(output->NewInstance());
-  data.contours->ShallowCopy(output);
+  vtkDataObject *outputData = this->output->GetOutputDataObject(0);
+  assert(outputData);
+  data.contours.TakeReference(outputData->NewInstance());
+  data.contours->ShallowCopy(outputData);
 }
 
 //------------------------------------------------------------------------------
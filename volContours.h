@@ -3,12 +3,17 @@
 
 #include <vvLODAsyncGLObject.h>
 
+#include "volDataClipper.h"
+
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 
+#include <cstddef>
 #include <vector>
 
 class vtkActor;
+class vtkAlgorithm;
+class vtkClipPolyData;
 class vtkDataObject;
 class vtkFlyingEdges3D;
 class vtkPolyDataMapper;
@@ -33,6 +38,9 @@ public:
    */
   vtkDataObject* contourData(LevelOfDetail lod) const;
 
+  /** Bytes held by the results. */
+  size_t memoryUsage() const;
+
   struct ContourState : public Superclass::ObjectState
   {
     void update(const vvApplicationState &state) override;
@@ -58,7 +66,10 @@ public:
     void exportResult(Superclass::LODData &result) const override;
 
     LevelOfDetail lod;
+    volDataClipper clipper;
     vtkNew<vtkFlyingEdges3D> contour;
+    vtkNew<vtkClipPolyData> clip;
+    vtkAlgorithm *output{nullptr};
   };
 
   struct ContourRenderPipeline : public Superclass::RenderPipeline
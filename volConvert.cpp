@@ -0,0 +1,185 @@
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <sys/stat.h>
+
+// VTK includes
+#include <vtkAbstractArray.h>
+#include <vtkDataObject.h>
+#include <vtkDataSetAttributes.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkXMLImageDataReader.h>
+
+// VolumeViewer includes
+#include "volBrickFile.h"
+
+/*
+ * scalarBytes - Bytes of the point scalars of a .vti file, from its header
+ *               alone, or 0 if they are unknown.
+ *
+ * parameter fileName - const std::string&
+ *
+ */
+double scalarBytes(const std::string &fileName)
+{
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(fileName.c_str());
+  reader->UpdateInformation();
+  vtkInformation *outInfo = reader->GetOutputInformation(0);
+  vtkInformation *scalars = vtkDataObject::GetActiveFieldInformation(
+    outInfo, vtkDataObject::FIELD_ASSOCIATION_POINTS,
+    vtkDataSetAttributes::SCALARS);
+  if(!scalars ||
+     !outInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+    {
+    return 0.0;
+    }
+  int whole[6];
+  outInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), whole);
+  double bytes = vtkAbstractArray::GetDataTypeSize(
+    scalars->Get(vtkDataObject::FIELD_ARRAY_TYPE()));
+  bytes *= scalars->Has(vtkDataObject::FIELD_NUMBER_OF_COMPONENTS()) ?
+    scalars->Get(vtkDataObject::FIELD_NUMBER_OF_COMPONENTS()) : 1;
+  for(int i = 0; i < 3; ++i)
+    {
+    bytes *= whole[2 * i + 1] - whole[2 * i] + 1;
+    }
+  return bytes;
+}
+
+void printUsage(void)
+{
+  std::cout << "\nvolConvert - Convert a VTK image to a brick file for out-of-core viewing" << std::endl;
+  std::cout << "\nUSAGE:\n\t./volConvert [options] <file.vti>" << std::endl;
+  std::cout << "\nOnly VTK XML image files (.vti) can be converted: they are read" << std::endl;
+  std::cout << "in slabs with vtkXMLImageDataReader." << std::endl;
+  std::cout << "\nWhere:" << std::endl;
+  std::cout << "\t-o <string>, -output <string>" << std::endl;
+  std::cout << "\tBrick file to write. Defaults to <file.vti>.bricks, which" << std::endl;
+  std::cout << "\tExampleVTKReader -outOfCore picks up.\n" << std::endl;
+  std::cout << "\t-c <none|zlib|lz4>, -compression <none|zlib|lz4>" << std::endl;
+  std::cout << "\tHow to compress the bricks. Defaults to lz4 where VTK provides it," << std::endl;
+  std::cout << "\tnone otherwise.\n" << std::endl;
+  std::cout << "\t-l <digit>, -levels <digit>" << std::endl;
+  std::cout << "\tLevels of detail to write, including the full resolution. By" << std::endl;
+  std::cout << "\tdefault, levels are added until one fits in a single brick.\n" << std::endl;
+  std::cout << "\t-h, -help" << std::endl;
+  std::cout << "\tDisplay this usage information and exit.\n" << std::endl;
+}
+
+/*
+ * main - Convert the file named on the command line.
+ *
+ * parameter argc - int
+ * parameter argv - char**
+ *
+ */
+int main(int argc, char* argv[])
+{
+  std::string source;
+  std::string target;
+  volBrickFile::Compression compression = volBrickFile::defaultCompression();
+  int levels = 0;
+
+  /* Parse the command-line arguments */
+  for(int i = 1; i < argc; ++i)
+    {
+    if((strcmp(argv[i], "-o")==0 || strcmp(argv[i], "-output")==0) &&
+       i + 1 < argc)
+      {
+      target.assign(argv[++i]);
+      }
+    else if((strcmp(argv[i], "-c")==0 || strcmp(argv[i], "-compression")==0) &&
+            i + 1 < argc)
+      {
+      const std::string name(argv[++i]);
+      if(name == "none")
+        {
+        compression = volBrickFile::NoCompression;
+        }
+      else if(name == "zlib")
+        {
+        compression = volBrickFile::ZLibCompression;
+        }
+      else if(name == "lz4")
+        {
+        compression = volBrickFile::LZ4Compression;
+        }
+      else
+        {
+        std::cerr << "Unknown compression " << name << "." << std::endl;
+        return 1;
+        }
+      }
+    else if((strcmp(argv[i], "-l")==0 || strcmp(argv[i], "-levels")==0) &&
+            i + 1 < argc)
+      {
+      levels = atoi(argv[++i]);
+      }
+    else if(strcmp(argv[i], "-h")==0 || strcmp(argv[i], "-help")==0)
+      {
+      printUsage();
+      return 0;
+      }
+    else
+      {
+      source.assign(argv[i]);
+      }
+    }
+
+  if(source.empty())
+    {
+    printUsage();
+    return 1;
+    }
+  if(source.size() < 4 || source.compare(source.size() - 4, 4, ".vti") != 0)
+    {
+    std::cerr << "Only .vti files can be converted." << std::endl;
+    return 1;
+    }
+  if(target.empty())
+    {
+    target = volBrickFile::defaultFileName(source);
+    }
+  if(!volBrickFile::hasCompression(compression))
+    {
+    std::cerr << "This build of VTK does not provide that compression."
+              << std::endl;
+    return 1;
+    }
+
+  std::cout << "Converting " << source << " to " << target << "..."
+            << std::endl;
+  volBrickFile file;
+  if(!volBrickFile::convert(source, target, compression, levels) ||
+     !file.open(target))
+    {
+    return 1;
+    }
+
+  /* Report what was written: */
+  for(int l = 0; l < file.numberOfLevels(); ++l)
+    {
+    const std::array<int, 3> &dims = file.dimensions(l);
+    std::cout << "Level " << l << ": " << dims[0] << " x " << dims[1] << " x "
+              << dims[2] << " samples in " << file.numberOfBricks(l)
+              << " bricks" << std::endl;
+    }
+  /* Against the scalars of the source, so that a ratio below 1 means the
+   * brick file is larger than the data it holds: */
+  const double sourceBytes = scalarBytes(source);
+  struct stat targetStat;
+  if(sourceBytes > 0.0 && stat(target.c_str(), &targetStat) == 0 &&
+     targetStat.st_size > 0)
+    {
+    std::cout << "Compression ratio: "
+              << sourceBytes / static_cast<double>(targetStat.st_size)
+              << std::endl;
+    }
+  return 0;
+}
@@ -0,0 +1,320 @@
+#include "volDataClipper.h"
+
+#include "volApplicationState.h"
+#include "volBrickCache.h"
+#include "volBrickPager.h"
+#include "volReader.h"
+
+#include <vtkAlgorithm.h>
+#include <vtkClipPolyData.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageClip.h>
+#include <vtkImageData.h>
+#include <vtkPlane.h>
+#include <vtkPlaneCollection.h>
+#include <vtkPlanes.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+volDataClipper::volDataClipper()
+  : m_restrictToROI(false),
+    m_crop(false)
+{
+  m_roi.fill(0.);
+  m_extent.fill(0);
+  m_extract->ClipDataOff();
+}
+
+//------------------------------------------------------------------------------
+volDataClipper::~volDataClipper()
+{
+}
+
+//------------------------------------------------------------------------------
+void volDataClipper::configure(vtkImageData *input,
+                               const volApplicationState &appState,
+                               bool fullResolution)
+{
+  const std::vector<Plane> &planes = appState.clippingPlanes();
+  const bool inputChanged = input != m_input.Get() ||
+      (input && input->GetMTime() > m_modified.GetMTime());
+  const bool restrictToROI = fullResolution && appState.hasRegionOfInterest();
+  std::shared_ptr<volBrickPager> pager;
+  if (fullResolution && input)
+    {
+    pager = appState.reader().brickPager();
+    }
+
+  if (!inputChanged && planes == m_planeList && pager == m_paged.pager() &&
+      restrictToROI == m_restrictToROI &&
+      (!restrictToROI || appState.regionOfInterest() == m_roi))
+    {
+    return;
+    }
+
+  m_input = input;
+  m_planeList = planes;
+  m_restrictToROI = restrictToROI;
+  if (restrictToROI)
+    {
+    m_roi = appState.regionOfInterest();
+    }
+
+  // vtkPlanes wants outward normals through a point on each plane:
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkDoubleArray> normals;
+  normals->SetNumberOfComponents(3);
+  for (size_t i = 0; i < planes.size(); ++i)
+    {
+    const Plane &p = planes[i];
+    const double len2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+    const double s = len2 > 0. ? p[3] / len2 : 0.;
+    points->InsertNextPoint(p[0] * s, p[1] * s, p[2] * s);
+    normals->InsertNextTuple3(-p[0], -p[1], -p[2]);
+    }
+  m_planes->SetPoints(points.Get());
+  m_planes->SetNormals(normals.Get());
+
+  m_crop = false;
+  if (input)
+    {
+    int whole[6];
+    input->GetExtent(whole);
+    m_extent = unclippedExtent(input, planes);
+    if (restrictToROI)
+      {
+      const std::array<int, 6> roi = regionExtent(input, m_roi);
+      for (int i = 0; i < 3; ++i)
+        {
+        m_extent[2 * i] = std::max(m_extent[2 * i], roi[2 * i]);
+        m_extent[2 * i + 1] = std::min(m_extent[2 * i + 1], roi[2 * i + 1]);
+        m_extent[2 * i + 1] = std::max(m_extent[2 * i + 1], m_extent[2 * i]);
+        }
+      }
+    m_crop = !std::equal(m_extent.begin(), m_extent.end(), whole);
+    m_extract->SetInputDataObject(input);
+    m_extract->SetOutputWholeExtent(m_extent.data());
+    }
+
+  // Out of core, only the bricks covering the extent are paged in:
+  m_paged.setPager(pager);
+  if (pager)
+    {
+    m_paged.setExtent(m_extent);
+    }
+
+  m_modified.Modified();
+}
+
+//------------------------------------------------------------------------------
+void volDataClipper::connectInput(vtkAlgorithm *filter)
+{
+  if (m_paged.pager())
+    {
+    filter->SetInputConnection(m_paged.producer()->GetOutputPort());
+    }
+  else if (m_crop)
+    {
+    filter->SetInputConnection(m_extract->GetOutputPort());
+    }
+  else
+    {
+    filter->SetInputDataObject(m_input);
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkAlgorithm *volDataClipper::connectOutput(vtkAlgorithm *source,
+                                            vtkClipPolyData *clip) const
+{
+  if (!this->clipping())
+    {
+    return source;
+    }
+
+  clip->SetInputConnection(source->GetOutputPort());
+  clip->SetClipFunction(m_planes.Get());
+  // vtkPlanes is negative inside the kept region:
+  clip->InsideOutOn();
+  return clip;
+}
+
+//------------------------------------------------------------------------------
+bool volDataClipper::available() const
+{
+  return !m_paged.pager() || m_paged.fits();
+}
+
+//------------------------------------------------------------------------------
+void volDataClipper::update()
+{
+  m_paged.update();
+}
+
+//------------------------------------------------------------------------------
+void volDataClipper::releaseData()
+{
+  m_paged.releaseData();
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<volBrickPager> volDataClipper::pager() const
+{
+  return m_paged.pager();
+}
+
+//------------------------------------------------------------------------------
+vtkMTimeType volDataClipper::GetMTime() const
+{
+  return std::max<vtkMTimeType>(m_modified.GetMTime(), m_paged.GetMTime());
+}
+
+//------------------------------------------------------------------------------
+std::array<int, 6>
+volDataClipper::unclippedExtent(vtkImageData *image,
+                                const std::vector<Plane> &planes)
+{
+  std::array<int, 6> whole;
+  image->GetExtent(whole.data());
+  if (planes.empty())
+    {
+    return whole;
+    }
+
+  double origin[3];
+  double spacing[3];
+  image->GetOrigin(origin);
+  image->GetSpacing(spacing);
+
+  const int B = volBrickCache::BrickSize;
+  std::array<int, 6> result{{whole[1], whole[0], whole[3], whole[2],
+                             whole[5], whole[4]}};
+  bool any = false;
+
+  for (int k = whole[4]; k < std::max(whole[5], whole[4] + 1); k += B)
+    {
+    const int k1 = std::min(k + B, whole[5]);
+    for (int j = whole[2]; j < std::max(whole[3], whole[2] + 1); j += B)
+      {
+      const int j1 = std::min(j + B, whole[3]);
+      for (int i = whole[0]; i < std::max(whole[1], whole[0] + 1); i += B)
+        {
+        const int i1 = std::min(i + B, whole[1]);
+
+        const double lo[3] = {origin[0] + i * spacing[0],
+                              origin[1] + j * spacing[1],
+                              origin[2] + k * spacing[2]};
+        const double hi[3] = {origin[0] + i1 * spacing[0],
+                              origin[1] + j1 * spacing[1],
+                              origin[2] + k1 * spacing[2]};
+
+        // The brick is dropped if one plane clips all of its corners. That is
+        // the case iff the corner that maximizes n.x is clipped.
+        bool clipped = false;
+        for (size_t p = 0; p < planes.size() && !clipped; ++p)
+          {
+          const Plane &plane = planes[p];
+          double d = 0.;
+          for (int c = 0; c < 3; ++c)
+            {
+            d += plane[c] * (plane[c] >= 0. ? std::max(lo[c], hi[c])
+                                            : std::min(lo[c], hi[c]));
+            }
+          clipped = d < plane[3];
+          }
+
+        if (!clipped)
+          {
+          any = true;
+          result[0] = std::min(result[0], i);
+          result[1] = std::max(result[1], i1);
+          result[2] = std::min(result[2], j);
+          result[3] = std::max(result[3], j1);
+          result[4] = std::min(result[4], k);
+          result[5] = std::max(result[5], k1);
+          }
+        }
+      }
+    }
+
+  if (!any)
+    {
+    result = {{whole[0], std::min(whole[0] + B, whole[1]),
+               whole[2], std::min(whole[2] + B, whole[3]),
+               whole[4], std::min(whole[4] + B, whole[5])}};
+    }
+
+  return result;
+}
+
+//------------------------------------------------------------------------------
+std::array<int, 6>
+volDataClipper::regionExtent(vtkImageData *image,
+                             const std::array<double, 6> &bounds)
+{
+  std::array<int, 6> whole;
+  image->GetExtent(whole.data());
+
+  double origin[3];
+  double spacing[3];
+  image->GetOrigin(origin);
+  image->GetSpacing(spacing);
+
+  std::array<int, 6> result = whole;
+  for (int i = 0; i < 3; ++i)
+    {
+    if (spacing[i] == 0.)
+      {
+      continue;
+      }
+    double lo = (bounds[2 * i] - origin[i]) / spacing[i];
+    double hi = (bounds[2 * i + 1] - origin[i]) / spacing[i];
+    if (lo > hi)
+      {
+      std::swap(lo, hi);
+      }
+    const int a = static_cast<int>(std::floor(lo));
+    const int b = static_cast<int>(std::ceil(hi));
+    result[2 * i] = std::min(std::max(a, whole[2 * i]), whole[2 * i + 1]);
+    result[2 * i + 1] = std::max(std::min(b, whole[2 * i + 1]),
+                                 result[2 * i]);
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void volDataClipper::fillPlaneCollection(const std::vector<Plane> &planes,
+                                         vtkPlaneCollection *collection)
+{
+  collection->RemoveAllItems();
+  for (size_t i = 0; i < planes.size(); ++i)
+    {
+    const Plane &p = planes[i];
+    const double len2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+    const double s = len2 > 0. ? p[3] / len2 : 0.;
+
+    // vtkPlane keeps the side its normal points to when used for clipping
+    // by mappers:
+    vtkNew<vtkPlane> plane;
+    plane->SetOrigin(p[0] * s, p[1] * s, p[2] * s);
+    plane->SetNormal(p[0], p[1], p[2]);
+    collection->AddItem(plane.Get());
+    }
+}
+
+//------------------------------------------------------------------------------
+bool volDataClipper::keeps(const std::vector<Plane> &planes, const double x[3])
+{
+  for (size_t i = 0; i < planes.size(); ++i)
+    {
+    const Plane &p = planes[i];
+    if (p[0] * x[0] + p[1] * x[1] + p[2] * x[2] < p[3])
+      {
+      return false;
+      }
+    }
+  return true;
+}
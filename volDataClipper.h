@@ -0,0 +1,147 @@
+#ifndef VOLDATACLIPPER_H
+#define VOLDATACLIPPER_H
+
+#include "volBrickPager.h"
+
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+class vtkAlgorithm;
+class vtkClipPolyData;
+class vtkImageClip;
+class vtkImageData;
+class vtkPlaneCollection;
+class vtkPlanes;
+class volApplicationState;
+
+/**
+ * @brief The volDataClipper class pushes the application's clipping planes
+ * and region of interest into a data pipeline.
+ *
+ * The input image is cropped to the bounding box of the bricks that are not
+ * entirely clipped away (and, if requested, to the region of interest) before
+ * it reaches the extraction filter, and the extracted polydata is then trimmed
+ * exactly against the planes. When nothing is cropped or clipped, the input
+ * and output are passed through untouched.
+ *
+ * Cropping does not copy the scalars: vtkImageClip only narrows the whole
+ * extent seen downstream, and the flying edges filters restrict themselves to
+ * their update extent.
+ *
+ * When the reader is out of core, the full resolution input only describes
+ * the volume's geometry; the cropped extent is then paged in from the brick
+ * file by update(), on the pipeline's worker thread.
+ *
+ * Typical use in a DataPipeline:
+ * - configure(): clipper.configure(input, appState, fullResolution);
+ *                clipper.connectInput(filter);
+ *                last = clipper.connectOutput(filter, clip);
+ * - needsUpdate(): also require clipper.available() and compare the result
+ *                  against clipper.GetMTime().
+ * - execute(): clipper.update(); last->Update();
+ * - exportResult(): use `last`.
+ */
+class volDataClipper
+{
+public:
+  /** nx, ny, nz, offset. Points x with n.x >= offset are kept. */
+  using Plane = std::array<double, 4>;
+
+  volDataClipper();
+  ~volDataClipper();
+
+  /**
+   * Set the data to clip and pick up the current clipping planes. If
+   * fullResolution is true, input is the reader's full resolution data: it is
+   * then also cropped to the application's region of interest, if any, and
+   * paged in from disk if the reader is out of core.
+   */
+  void configure(vtkImageData *input, const volApplicationState &appState,
+                 bool fullResolution = false);
+
+  /** True if any clipping plane is active. */
+  bool clipping() const { return !m_planeList.empty(); }
+
+  /** Connect filter's first input to the (possibly cropped) input image. */
+  void connectInput(vtkAlgorithm *filter);
+
+  /**
+   * Connect clip to source's polydata output. Returns the algorithm that
+   * produces the final result: clip if clipping, source otherwise.
+   */
+  vtkAlgorithm* connectOutput(vtkAlgorithm *source,
+                              vtkClipPolyData *clip) const;
+
+  /**
+   * False if the input is paged and the cropped extent does not fit in the
+   * pager's budget. The pipeline should not run then.
+   */
+  bool available() const;
+
+  /** Page in the cropped extent, if paging. Call from execute(). */
+  void update();
+
+  /** Drop the paged in extent, if paging. update() pages it in again. */
+  void releaseData();
+
+  /** The pager used for the input, if any. */
+  std::shared_ptr<volBrickPager> pager() const;
+
+  /** The point extent passed downstream. */
+  const std::array<int, 6>& extent() const { return m_extent; }
+
+  /** Last time the crop region, the planes or the paged input changed. */
+  vtkMTimeType GetMTime() const;
+
+  /** The implicit function matching the planes, usable by mappers. */
+  vtkPlanes* planes() const { return m_planes.Get(); }
+
+  /**
+   * The point extent of image that survives clipping, rounded out to whole
+   * bricks (volBrickCache::BrickSize cells). Bricks whose eight corners are
+   * all on the clipped side of a single plane are dropped. If every brick is
+   * clipped, the first brick is returned so downstream filters still get a
+   * valid (if soon to be fully trimmed) input.
+   */
+  static std::array<int, 6> unclippedExtent(vtkImageData *image,
+                                            const std::vector<Plane> &planes);
+
+  /**
+   * The point extent of image covering the world space box bounds (xmin,
+   * xmax, ...), clamped to the image's extent. If the box misses the image,
+   * the extent is flattened so that it contains no cells.
+   */
+  static std::array<int, 6> regionExtent(vtkImageData *image,
+                                         const std::array<double, 6> &bounds);
+
+  /** Fill a vtkPlaneCollection (for mappers) from planes. */
+  static void fillPlaneCollection(const std::vector<Plane> &planes,
+                                  vtkPlaneCollection *collection);
+
+  /** Returns true if the world position x is kept by all planes. */
+  static bool keeps(const std::vector<Plane> &planes, const double x[3]);
+
+private:
+  // Not implemented:
+  volDataClipper(const volDataClipper&);
+  volDataClipper& operator=(const volDataClipper&);
+
+  vtkSmartPointer<vtkImageData> m_input;
+  std::vector<Plane> m_planeList;
+  bool m_restrictToROI;
+  std::array<double, 6> m_roi;
+  std::array<int, 6> m_extent;
+  bool m_crop;
+  vtkTimeStamp m_modified;
+
+  vtkNew<vtkImageClip> m_extract;
+  volPagedSource m_paged;
+  vtkNew<vtkPlanes> m_planes;
+};
+
+#endif // VOLDATACLIPPER_H
@@ -0,0 +1,97 @@
+#include "volFileWatcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------
+volFileWatcher::volFileWatcher()
+  : m_fd(-1),
+    m_watch(-1)
+{
+#ifdef __linux__
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+//------------------------------------------------------------------------------
+volFileWatcher::~volFileWatcher()
+{
+#ifdef __linux__
+  if (m_fd >= 0)
+    {
+    ::close(m_fd);
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+void volFileWatcher::setFileName(const std::string &fileName)
+{
+  if (fileName == m_fileName)
+    {
+    return;
+    }
+  m_fileName = fileName;
+
+#ifdef __linux__
+  if (m_fd < 0)
+    {
+    return;
+    }
+  if (m_watch >= 0)
+    {
+    inotify_rm_watch(m_fd, m_watch);
+    m_watch = -1;
+    }
+  // Drop the events of the previous file:
+  this->changed();
+  if (fileName.empty())
+    {
+    return;
+    }
+
+  const size_t slash = fileName.rfind('/');
+  const std::string directory =
+      slash == std::string::npos ? std::string(".")
+                                 : fileName.substr(0, slash == 0 ? 1 : slash);
+  m_baseName = slash == std::string::npos ? fileName
+                                          : fileName.substr(slash + 1);
+  m_watch = inotify_add_watch(m_fd, directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO);
+#endif
+}
+
+//------------------------------------------------------------------------------
+bool volFileWatcher::changed()
+{
+  bool result = false;
+#ifdef __linux__
+  if (m_fd < 0)
+    {
+    return false;
+    }
+  alignas(struct inotify_event) char buffer[4096];
+  for (;;)
+    {
+    const ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+    if (length <= 0)
+      {
+      break;
+      }
+    for (ssize_t offset = 0; offset < length; )
+      {
+      const struct inotify_event *event =
+          reinterpret_cast<const struct inotify_event*>(buffer + offset);
+      if (event->wd == m_watch && event->len > 0 &&
+          m_baseName == event->name)
+        {
+        result = true;
+        }
+      offset += sizeof(struct inotify_event) + event->len;
+      }
+    }
+#endif
+  return result;
+}
@@ -0,0 +1,42 @@
+#ifndef VOLFILEWATCHER_H
+#define VOLFILEWATCHER_H
+
+#include <string>
+
+/**
+ * @brief The volFileWatcher class tells when a file was rewritten by another
+ * program.
+ *
+ * The directory of the file is watched with inotify, so that both files
+ * written in place and files replaced by renaming a new one over them are
+ * noticed. Only completed writes count: a change is reported once the writer
+ * closes the file, not while it is still being written. Polled from a single
+ * thread; never blocks. Reports no changes where inotify is unavailable.
+ */
+class volFileWatcher
+{
+public:
+  volFileWatcher();
+  ~volFileWatcher();
+
+  /** The watched file, or empty. */
+  const std::string& fileName() const { return m_fileName; }
+
+  /** Watch fileName instead of the current file. Empty stops watching. */
+  void setFileName(const std::string &fileName);
+
+  /** True if the file was written or replaced since the last call. */
+  bool changed();
+
+private:
+  // Not implemented:
+  volFileWatcher(const volFileWatcher&);
+  volFileWatcher& operator=(const volFileWatcher&);
+
+  std::string m_fileName;
+  std::string m_baseName;
+  int m_fd;
+  int m_watch;
+};
+
+#endif // VOLFILEWATCHER_H
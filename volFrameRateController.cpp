@@ -0,0 +1,124 @@
+#include "volFrameRateController.h"
+
+#include "volApplicationState.h"
+#include "volVolume.h"
+
+#include <algorithm>
+
+namespace {
+
+// From full quality down; each level costs roughly half the one before.
+const volFrameRateController::Quality Levels[] = {
+  { 1., 1., false },
+  { 2., 1., false },
+  { 2., 1.5, false },
+  { 2., 2., false },
+  { 2., 2., true },
+  { 4., 2., true },
+  { 4., 3., true },
+  { 4., 4., true }
+};
+const size_t NumberOfLevels = sizeof(Levels) / sizeof(Levels[0]);
+
+// Weight of the latest frame in the average frame time.
+const double Smoothing = 0.3;
+
+// Frames are slow above this fraction of the target frame time, and fast
+// below that one. The gap keeps a level that is just fast enough.
+const double SlowFraction = 1.1;
+const double FastFraction = 0.6;
+
+// Frames at a level before stepping down, or up, from it.
+const size_t SlowFrames = 2;
+const double FastSeconds = 1.;
+
+} // end anon namespace
+
+const double volFrameRateController::DefaultTargetFrameRate = 60.;
+
+//------------------------------------------------------------------------------
+volFrameRateController::volFrameRateController()
+  : m_targetFrameRate(DefaultTargetFrameRate),
+    m_averageFrameTime(0.),
+    m_interacting(false),
+    m_level(0),
+    m_interactiveLevel(0),
+    m_framesAtLevel(0)
+{
+}
+
+//------------------------------------------------------------------------------
+volFrameRateController::~volFrameRateController()
+{
+}
+
+//------------------------------------------------------------------------------
+void volFrameRateController::setTargetFrameRate(double framesPerSecond)
+{
+  m_targetFrameRate = std::max(framesPerSecond, 0.);
+  m_interactiveLevel = 0;
+}
+
+//------------------------------------------------------------------------------
+size_t volFrameRateController::numberOfLevels()
+{
+  return NumberOfLevels;
+}
+
+//------------------------------------------------------------------------------
+const volFrameRateController::Quality&
+volFrameRateController::levelQuality(size_t level)
+{
+  return Levels[std::min(level, NumberOfLevels - 1)];
+}
+
+//------------------------------------------------------------------------------
+void volFrameRateController::update(volApplicationState &state,
+                                    double frameTime, bool interacting)
+{
+  const double budget = m_targetFrameRate > 0. ? 1. / m_targetFrameRate : 0.;
+  if (!interacting || budget <= 0.)
+    {
+    m_level = 0;
+    }
+  else if (!m_interacting)
+    {
+    // The previous frame includes the time the view stood still: resume at
+    // the level the last interaction settled on, and start measuring anew.
+    m_level = m_interactiveLevel;
+    m_averageFrameTime = budget;
+    m_framesAtLevel = 0;
+    }
+  else
+    {
+    m_averageFrameTime += Smoothing * (frameTime - m_averageFrameTime);
+    ++m_framesAtLevel;
+    const size_t fastFrames =
+        static_cast<size_t>(FastSeconds * m_targetFrameRate);
+    size_t level = m_level;
+    if (m_averageFrameTime > SlowFraction * budget &&
+        m_framesAtLevel >= SlowFrames && level + 1 < NumberOfLevels)
+      {
+      ++level;
+      }
+    else if (m_averageFrameTime < FastFraction * budget &&
+             m_framesAtLevel >= fastFrames && level > 0)
+      {
+      --level;
+      }
+    if (level != m_level)
+      {
+      m_level = level;
+      m_averageFrameTime = budget;
+      m_framesAtLevel = 0;
+      }
+    m_interactiveLevel = m_level;
+    }
+  m_interacting = interacting && budget > 0.;
+
+  const Quality &quality = Levels[m_level];
+  volVolume &volume = state.volume();
+  volume.setSampleDistance(quality.sampleDistance);
+  volume.setImageSampleDistance(quality.imageSampleDistance);
+  volume.setLowResolution(quality.lowResolution);
+}
@@ -0,0 +1,71 @@
+#ifndef VOLFRAMERATECONTROLLER_H
+#define VOLFRAMERATECONTROLLER_H
+
+#include <cstddef>
+
+class volApplicationState;
+
+/**
+ * @brief The volFrameRateController class trades volume rendering quality
+ * for frame rate while the view is navigated.
+ *
+ * Each frame, update() is given the duration of the previous one. While
+ * interacting, the volume steps down a ladder of quality levels -- a longer
+ * sample distance, then fewer rays per pixel, then the reduced data --
+ * whenever the frames are slower than the target, and back up once they are
+ * well within it. The level reached is remembered for the next interaction.
+ * When the view is still, the volume is rendered at full quality. The
+ * controller owns the volume's sample distances and lowResolution().
+ *
+ * Levels go down after two slow frames, so that dropped frames are short
+ * lived, but only go up after a second of fast ones, so that the quality
+ * does not oscillate between two levels. All methods are called on the main
+ * thread.
+ */
+class volFrameRateController
+{
+public:
+  struct Quality
+  {
+    double sampleDistance;      // see volVolume::setSampleDistance()
+    double imageSampleDistance; // see volVolume::setImageSampleDistance()
+    bool lowResolution;         // see volVolume::setLowResolution()
+  };
+
+  /** Frame rate kept while interacting by default. */
+  static const double DefaultTargetFrameRate;
+
+  volFrameRateController();
+  ~volFrameRateController();
+
+  /** Frames per second to keep while interacting; 0 to always render at
+   *  full quality. */
+  double targetFrameRate() const { return m_targetFrameRate; }
+  void setTargetFrameRate(double framesPerSecond);
+
+  static size_t numberOfLevels();
+  static const Quality& levelQuality(size_t level);
+
+  /** Level of the last update(); 0 is full quality. */
+  size_t level() const { return m_level; }
+
+  /**
+   * Account for the previous frame, which took frameTime seconds, and set the
+   * quality of state's volume for the next one.
+   */
+  void update(volApplicationState &state, double frameTime, bool interacting);
+
+private:
+  // Not implemented:
+  volFrameRateController(const volFrameRateController&);
+  volFrameRateController& operator=(const volFrameRateController&);
+
+  double m_targetFrameRate;
+  double m_averageFrameTime;
+  bool m_interacting;
+  size_t m_level;
+  size_t m_interactiveLevel; // level to resume interacting at
+  size_t m_framesAtLevel;
+};
+
+#endif // VOLFRAMERATECONTROLLER_H
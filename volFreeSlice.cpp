@@ -1,16 +1,27 @@
 #include "volFreeSlice.h"
 
 #include "volApplicationState.h"
+#include "volArrayPool.h"
+#include "volBrickCache.h"
+#include "volBrickPager.h"
 #include "volContextState.h"
+#include "volDataClipper.h"
 #include "volReader.h"
+#include "volTransferFunction.h"
 
 #include <vtkActor.h>
-#include <vtkDataObject.h>
+#include <vtkDataArray.h>
 #include <vtkExternalOpenGLRenderer.h>
-#include <vtkFlyingEdgesPlaneCutter.h>
+#include <vtkImageData.h>
 #include <vtkLookupTable.h>
-#include <vtkPlane.h>
+#include <vtkMath.h>
+#include <vtkPlaneSource.h>
+#include <vtkPointData.h>
 #include <vtkPolyDataMapper.h>
+#include <vtkTexture.h>
+
+#include <algorithm>
+#include <cmath>
 
 //------------------------------------------------------------------------------
 volFreeSlice::volFreeSlice()
@@ -22,6 +33,18 @@ volFreeSlice::~volFreeSlice()
 {
 }
 
+//------------------------------------------------------------------------------
+bool volFreeSlice::allocated() const
+{
+  return m_allocated;
+}
+
+//------------------------------------------------------------------------------
+void volFreeSlice::setAllocated(bool alloc)
+{
+  m_allocated = alloc;
+}
+
 //------------------------------------------------------------------------------
 bool volFreeSlice::visible() const
 {
@@ -115,10 +138,24 @@ const std::array<double, 3> &volFreeSlice::origin() const
   return this->objectState<FreeSliceState>().origin;
 }
 
+//------------------------------------------------------------------------------
+int volFreeSlice::resolution() const
+{
+  return this->objectState<FreeSliceState>().resolution;
+}
+
+//------------------------------------------------------------------------------
+void volFreeSlice::setResolution(int res)
+{
+  this->objectState<FreeSliceState>().resolution = std::max(res, 2);
+}
+
 //------------------------------------------------------------------------------
 volFreeSlice::FreeSliceState::FreeSliceState()
 {
   this->color->SetNumberOfColors(256);
+  // Samples outside of the volume are NaN; don't draw them:
+  this->color->SetNanColor(0., 0., 0., 0.);
   this->color->Build();
 }
 
@@ -129,26 +166,19 @@ void volFreeSlice::FreeSliceState::update(const vvApplicationState &appState)
       static_cast<const volApplicationState&>(appState);
 
   if (this->color->GetNumberOfTableValues() == 0 ||
-      this->color->GetMTime() < state.sliceColorMapTimeStamp())
+      this->color->GetMTime() < state.sliceTransferFunction().timeStamp())
     {
-    for (vtkIdType i = 0; i < 256; ++i)
-      {
-      this->color->SetTableValue(i,
-                                 state.sliceColorMap()[4*i + 0],
-                                 state.sliceColorMap()[4*i + 1],
-                                 state.sliceColorMap()[4*i + 2],
-                                 1.);
-      }
+    state.sliceTransferFunction().exportLookupTable(this->color.Get());
     }
+
+  std::array<double, 2> scalarRange = state.reader().scalarRange();
+  this->color->SetRange(scalarRange.data());
 }
 
 //------------------------------------------------------------------------------
 volFreeSlice::FreeSliceDataPipeline::FreeSliceDataPipeline(LevelOfDetail l)
   : lod(l)
 {
-  this->cutter->SetPlane(this->plane.Get());
-  this->cutter->ComputeNormalsOff();
-  this->cutter->InterpolateAttributesOn();
 }
 
 //------------------------------------------------------------------------------
@@ -159,36 +189,68 @@ void volFreeSlice::FreeSliceDataPipeline::configure(
   const volApplicationState &appState =
       static_cast<const volApplicationState&>(appStateIn);
 
-  vtkDataObject *input = nullptr;
+  std::shared_ptr<const volBrickCache> newInput;
+  std::shared_ptr<volBrickPager> newPager;
+  int newResolution = state.resolution;
+  bool newRestrictToROI = false;
   switch (this->lod)
     {
     case LevelOfDetail::LoRes:
       // Disable this LOD when forcing low res:
       if (!appState.forceLowResolution())
         {
-        input = appState.reader().reducedDataObject();
+        newInput = appState.reader().reducedBrickCache();
         }
+      newResolution = std::max(state.resolution / 2, 2);
       break;
 
     case LevelOfDetail::HiRes:
       if (appState.forceLowResolution())
         {
-        input = appState.reader().reducedDataObject();
+        newInput = appState.reader().reducedBrickCache();
         }
       else
         {
-        input = appState.reader().dataObject();
+        // Out of core, there is no brick cache, only the pager:
+        newInput = appState.reader().brickCache();
+        newPager = appState.reader().brickPager();
+        newRestrictToROI = appState.hasRegionOfInterest();
         }
       break;
 
     default:
-      std::cerr << "Invalid level of detail for IsosurfaceDataPipeline.\n";
+      std::cerr << "Invalid level of detail for FreeSliceDataPipeline.\n";
     }
 
-  // const casts bc VTK is not const-correct
-  this->plane->SetOrigin(const_cast<double*>(state.origin.data()));
-  this->plane->SetNormal(const_cast<double*>(state.normal.data()));
-  this->cutter->SetInputDataObject(input);
+  if (newInput != this->input ||
+      newPager != this->pager ||
+      newResolution != this->resolution ||
+      state.origin != this->origin ||
+      state.normal != this->normal ||
+      appState.clippingPlanes() != this->clippingPlanes ||
+      newRestrictToROI != this->restrictToROI ||
+      (newRestrictToROI && appState.regionOfInterest() != this->roi))
+    {
+    this->clippingPlanes = appState.clippingPlanes();
+    this->restrictToROI = newRestrictToROI;
+    if (newRestrictToROI)
+      {
+      this->roi = appState.regionOfInterest();
+      }
+    this->input = newInput;
+    this->pager = newInput ? nullptr : newPager;
+    this->resolution = newResolution;
+    this->origin = state.origin;
+    this->normal = state.normal;
+    this->configureTime.Modified();
+
+    // Start reading the bricks on the plane while the worker is busy:
+    if (this->pager)
+      {
+      this->pager->prefetch(this->pager->bricksOnPlane(this->origin.data(),
+                                                       this->normal.data()));
+      }
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -200,16 +262,137 @@ bool volFreeSlice::FreeSliceDataPipeline::needsUpdate(
 
   return
       state.visible &&
-      this->cutter->GetInputDataObject(0, 0) != nullptr &&
+      (this->input != nullptr || this->pager != nullptr) &&
       (!data.slice ||
-       this->cutter->GetMTime() > data.slice->GetMTime());
-
+       this->configureTime.GetMTime() > data.slice->GetMTime());
 }
 
 //------------------------------------------------------------------------------
 void volFreeSlice::FreeSliceDataPipeline::execute()
 {
-  this->cutter->Update();
+  std::array<double, 3> n = this->normal;
+  if (vtkMath::Normalize(n.data()) == 0.)
+    {
+    n = {{1., 0., 0.}};
+    }
+
+  // Out of core, only the bricks the plane passes through are paged in:
+  std::shared_ptr<const volBrickCache> paged;
+  if (this->pager)
+    {
+    paged = this->pager->view(this->pager->bricksOnPlane(this->origin.data(),
+                                                         n.data()));
+    }
+  const volBrickCache &cache = paged ? *paged : *this->input;
+  if (cache.numberOfBricks() == 0)
+    {
+    this->output = nullptr;
+    return;
+    }
+
+  // Build an orthonormal basis (u, v) for the plane, using the axis least
+  // aligned with the normal as a reference:
+  std::array<double, 3> ref{{0., 0., 0.}};
+  ref[std::fabs(n[0]) < 0.9 ? 0 : 1] = 1.;
+  std::array<double, 3> u;
+  std::array<double, 3> v;
+  vtkMath::Cross(n.data(), ref.data(), u.data());
+  vtkMath::Normalize(u.data());
+  vtkMath::Cross(n.data(), u.data(), v.data());
+
+  // Cover the whole volume (or just the region of interest, so that all of
+  // the resolution goes there): center the slice on the projection of the
+  // region's center onto the plane, and make it as wide as its diagonal.
+  std::array<double, 6> bounds = cache.bounds();
+  if (this->restrictToROI)
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      bounds[2 * i] = std::max(bounds[2 * i], this->roi[2 * i]);
+      bounds[2 * i + 1] = std::min(bounds[2 * i + 1], this->roi[2 * i + 1]);
+      if (bounds[2 * i] > bounds[2 * i + 1])
+        {
+        this->output = nullptr;
+        return;
+        }
+      }
+    }
+  std::array<double, 3> center{{(bounds[0] + bounds[1]) * 0.5,
+                                (bounds[2] + bounds[3]) * 0.5,
+                                (bounds[4] + bounds[5]) * 0.5}};
+  std::array<double, 3> toCenter;
+  vtkMath::Subtract(center.data(), this->origin.data(), toCenter.data());
+  const double dist = vtkMath::Dot(toCenter.data(), n.data());
+  const double halfSize = 0.5 * std::sqrt(
+        (bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
+        (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
+        (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+
+  for (int i = 0; i < 3; ++i)
+    {
+    const double c = center[i] - dist * n[i];
+    this->corner[i] = c - halfSize * (u[i] + v[i]);
+    this->point1[i] = this->corner[i] + 2. * halfSize * u[i];
+    this->point2[i] = this->corner[i] + 2. * halfSize * v[i];
+    }
+
+  // Express the sampling grid in continuous index space:
+  const int res = this->resolution;
+  const double step = 2. * halfSize / static_cast<double>(res - 1);
+  const std::array<double, 3> &spacing = cache.spacing();
+  double cornerIndex[3];
+  cache.worldToIndex(this->corner.data(), cornerIndex);
+
+  float indexOrigin[3];
+  float stepU[3];
+  float stepV[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    const double s = spacing[i] != 0. ? spacing[i] : 1.;
+    indexOrigin[i] = static_cast<float>(cornerIndex[i]);
+    stepU[i] = static_cast<float>(step * u[i] / s);
+    stepV[i] = static_cast<float>(step * v[i] / s);
+    }
+
+  // Always write into a fresh array -- the previous one may still be in use
+  // by the render pipeline. Its memory is recycled once it no longer is.
+  vtkSmartPointer<vtkDataArray> sliceScalars =
+      volArrayPool::instance().newArray(VTK_FLOAT,
+                                        static_cast<vtkIdType>(res) * res);
+  sliceScalars->SetName("volFreeSlice Scalars");
+  float *out = static_cast<float*>(sliceScalars->GetVoidPointer(0));
+
+  // Hide the clipped parts of the slice and anything outside the region of
+  // interest, as the samples are taken: the planes and the faces of the
+  // region become half spaces in continuous indices.
+  std::vector<std::array<double, 4> > keep;
+  const std::array<double, 3> &dataOrigin = cache.origin();
+  for (size_t p = 0; p < this->clippingPlanes.size(); ++p)
+    {
+    const volDataClipper::Plane &plane = this->clippingPlanes[p];
+    std::array<double, 4> h{{0., 0., 0., plane[3]}};
+    for (int c = 0; c < 3; ++c)
+      {
+      h[c] = plane[c] * spacing[c];
+      h[3] -= plane[c] * dataOrigin[c];
+      }
+    keep.push_back(h);
+    }
+  for (int c = 0; this->restrictToROI && c < 3; ++c)
+    {
+    std::array<double, 4> lo{{0., 0., 0., bounds[2 * c] - dataOrigin[c]}};
+    std::array<double, 4> hi{{0., 0., 0.,
+                              dataOrigin[c] - bounds[2 * c + 1]}};
+    lo[c] = spacing[c];
+    hi[c] = -spacing[c];
+    keep.push_back(lo);
+    keep.push_back(hi);
+    }
+  cache.resample(indexOrigin, stepU, stepV, res, res, out, keep);
+
+  this->output = vtkSmartPointer<vtkImageData>::New();
+  this->output->SetDimensions(res, res, 1);
+  this->output->GetPointData()->SetScalars(sliceScalars);
 }
 
 //------------------------------------------------------------------------------
@@ -217,9 +400,17 @@ void volFreeSlice::FreeSliceDataPipeline::exportResult(LODData &result) const
 {
   FreeSliceLODData &data = static_cast<FreeSliceLODData&>(result);
 
-  vtkDataObject *dataObject = this->cutter->GetOutputDataObject(0);
-  data.slice.TakeReference(dataObject->NewInstance());
-  data.slice->ShallowCopy(dataObject);
+  if (!this->output)
+    {
+    data.slice = nullptr;
+    return;
+    }
+
+  data.slice.TakeReference(this->output->NewInstance());
+  data.slice->ShallowCopy(this->output);
+  data.corner = this->corner;
+  data.point1 = this->point1;
+  data.point2 = this->point2;
 }
 
 //------------------------------------------------------------------------------
@@ -227,26 +418,37 @@ void volFreeSlice::FreeSliceRenderPipeline::init(const ObjectState &objState,
                                                  vvContextState &contextState)
 {
   const FreeSliceState &state = static_cast<const FreeSliceState&>(objState);
-  this->mapper->SetLookupTable(state.color.Get());
-  this->mapper->SetColorModeToMapScalars();
+  this->texture->SetLookupTable(state.color.Get());
+  this->texture->MapColorScalarsThroughLookupTableOn();
+  this->texture->InterpolateOn();
+  this->texture->RepeatOff();
+  this->texture->EdgeClampOn();
+  this->mapper->SetInputConnection(this->quad->GetOutputPort());
+  this->mapper->ScalarVisibilityOff();
   this->actor->SetMapper(this->mapper.Get());
+  this->actor->SetTexture(this->texture.Get());
   contextState.renderer().AddActor(this->actor.Get());
 }
 
 //------------------------------------------------------------------------------
 void volFreeSlice::FreeSliceRenderPipeline::update(
-    const ObjectState &objState, const vvApplicationState &appStateIn,
+    const ObjectState &objState, const vvApplicationState &,
     const vvContextState &, const LODData &result)
 {
   const FreeSliceState &state = static_cast<const FreeSliceState&>(objState);
   const FreeSliceLODData &data = static_cast<const FreeSliceLODData&>(result);
-  const volApplicationState &appState =
-      static_cast<const volApplicationState&>(appStateIn);
 
-  std::array<double, 2> scalarRange = appState.reader().scalarRange();
+  if (!data.slice)
+    {
+    this->actor->SetVisibility(0);
+    return;
+    }
 
-  this->mapper->SetScalarRange(scalarRange.data());
-  this->mapper->SetInputDataObject(data.slice);
+  // const casts bc VTK is not const-correct
+  this->quad->SetOrigin(const_cast<double*>(data.corner.data()));
+  this->quad->SetPoint1(const_cast<double*>(data.point1.data()));
+  this->quad->SetPoint2(const_cast<double*>(data.point2.data()));
+  this->texture->SetInputData(data.slice);
   this->actor->SetVisibility(state.visible ? 1 : 0);
 }
 
@@ -5,13 +5,33 @@
 
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
 
+#include <array>
+#include <memory>
+#include <vector>
+
+class volBrickCache;
+class volBrickPager;
 class vtkActor;
-class vtkDataObject;
-class vtkFlyingEdgesPlaneCutter;
+class vtkImageData;
 class vtkLookupTable;
-class vtkPlane;
+class vtkPlaneSource;
 class vtkPolyDataMapper;
+class vtkTexture;
+
+/**
+ * @brief The volFreeSlice class renders an arbitrarily oriented slice through
+ * the volume.
+ *
+ * Rather than cutting the volume into a triangle mesh, the data pipeline
+ * resamples the reader's volBrickCache onto a fixed-resolution image lying in
+ * the slice plane (trilinear interpolation, parallelized over image rows with
+ * vtkSMPTools). The brick cache is shared read-only by all free slices.
+ * The image is colormapped by a texture and drawn as a single quad, so the
+ * cost of a pose update depends on the slice resolution rather than on the
+ * size of the volume.
+ */
 
 class volFreeSlice : public vvLODAsyncGLObject
 {
@@ -21,6 +41,10 @@ public:
   volFreeSlice();
   ~volFreeSlice();
 
+  /** True if a FreeSliceLocator has claimed this slice. */
+  bool allocated() const;
+  void setAllocated(bool alloc);
+
   bool visible() const;
   void setVisible(bool vis);
 
@@ -30,6 +54,11 @@ public:
   const std::array<double, 3>& normal() const;
   void setNormal(const std::array<double, 3> &o);
 
+  /** Number of samples along each edge of the HiRes slice image. The LoRes
+   *  image uses half this resolution. */
+  int resolution() const;
+  void setResolution(int res);
+
   struct FreeSliceState : public ObjectState
   {
     FreeSliceState();
@@ -40,11 +69,18 @@ public:
     bool visible{false};
     std::array<double, 3> origin{{0., 0., 0.}};
     std::array<double, 3> normal{{1., 0., 0.}};
+    int resolution{256};
   };
 
   struct FreeSliceLODData : public LODData
   {
-    vtkSmartPointer<vtkDataObject> slice;
+    // Resampled scalars; NaN where the slice leaves the volume.
+    vtkSmartPointer<vtkImageData> slice;
+
+    // Quad spanned by the slice image, in world coordinates:
+    std::array<double, 3> corner{{0., 0., 0.}};
+    std::array<double, 3> point1{{0., 0., 0.}};
+    std::array<double, 3> point2{{0., 0., 0.}};
   };
 
   struct FreeSliceDataPipeline : public DataPipeline
@@ -59,8 +95,21 @@ public:
     void exportResult(LODData &result) const override;
 
     LevelOfDetail lod;
-    vtkNew<vtkPlane> plane;
-    vtkNew<vtkFlyingEdgesPlaneCutter> cutter;
+    std::shared_ptr<const volBrickCache> input;
+    std::shared_ptr<volBrickPager> pager;
+    std::array<double, 3> origin{{0., 0., 0.}};
+    std::array<double, 3> normal{{1., 0., 0.}};
+    int resolution{0};
+    std::vector<std::array<double, 4> > clippingPlanes;
+    bool restrictToROI{false};
+    std::array<double, 6> roi{{0., 0., 0., 0., 0., 0.}};
+    vtkTimeStamp configureTime;
+
+    // Set by execute():
+    vtkSmartPointer<vtkImageData> output;
+    std::array<double, 3> corner{{0., 0., 0.}};
+    std::array<double, 3> point1{{0., 0., 0.}};
+    std::array<double, 3> point2{{0., 0., 0.}};
   };
 
   struct FreeSliceRenderPipeline : public RenderPipeline
@@ -73,11 +122,15 @@ public:
                 const LODData &result) override;
     void disable() override;
 
+    vtkNew<vtkPlaneSource> quad;
     vtkNew<vtkPolyDataMapper> mapper;
+    vtkNew<vtkTexture> texture;
     vtkNew<vtkActor> actor;
   };
 
 private:
+  bool m_allocated{false};
+
   std::string progressLabel() const override;
 
   ObjectState* createObjectState() const override;
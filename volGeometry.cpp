@@ -2,13 +2,16 @@
 
 #include "volApplicationState.h"
 #include "volContextState.h"
+#include "volDataClipper.h"
 #include "volReader.h"
+#include "volTransferFunction.h"
 
 #include <vtkActor.h>
 #include <vtkDataSetMapper.h>
 #include <vtkExternalOpenGLRenderer.h>
 #include <vtkImageData.h>
 #include <vtkLookupTable.h>
+#include <vtkPlaneCollection.h>
 #include <vtkProperty.h>
 
 #include <GL/GLContextData.h>
@@ -46,6 +49,7 @@ void volGeometry::initVvContext(vvContextState &vvContext,
 
   dataItem->mapper->SetLookupTable(m_color.Get());
   dataItem->mapper->SetColorModeToMapScalars();
+  dataItem->mapper->SetClippingPlanes(m_clippingPlanes.Get());
   dataItem->actor->SetMapper(dataItem->mapper.Get());
   vvContext.renderer().AddActor(dataItem->actor.Get());
 }
@@ -58,17 +62,17 @@ void volGeometry::syncApplicationState(const vvApplicationState &appState)
   const volApplicationState &state =
       static_cast<const volApplicationState&>(appState);
   if (m_color->GetNumberOfTableValues() == 0 ||
-      state.colorMapTimeStamp() > m_color->GetMTime())
+      state.transferFunction().timeStamp() > m_color->GetMTime())
     {
-    const double *data = state.colorMap().data();
-    for (vtkIdType i = 0; i < 256; ++i)
-      {
-      // Don't set opacity in the table -- we set it on the actor's property
-      m_color->SetTableValue(i,
-                             data[(4*i) + 0],
-                             data[(4*i) + 1],
-                             data[(4*i) + 2], 1.);
-      }
+    // Opacity is set on the actor's property instead:
+    state.transferFunction().exportLookupTable(m_color.Get());
+    }
+
+  if (state.clippingPlanesTimeStamp() > m_clippingTime.GetMTime())
+    {
+    volDataClipper::fillPlaneCollection(state.clippingPlanes(),
+                                        m_clippingPlanes.Get());
+    m_clippingTime.Modified();
     }
 }
 
@@ -87,7 +91,10 @@ void volGeometry::syncContextState(const vvApplicationState &appState,
     {
     const volApplicationState &state =
         static_cast<const volApplicationState&>(appState);
-    if (state.forceLowResolution())
+    // Out of core, the full resolution data holds no scalars. While the file
+    // is read, only the preview is there:
+    if (state.forceLowResolution() || state.reader().brickPager() ||
+        !state.reader().dataObject())
       {
       dataItem->mapper->SetInputData(state.reader().typedReducedDataObject());
       }
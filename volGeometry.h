@@ -4,10 +4,12 @@
 #include <vvGLObject.h>
 
 #include <vtkNew.h>
+#include <vtkTimeStamp.h>
 
 class vtkActor;
 class vtkDataSetMapper;
 class vtkLookupTable;
+class vtkPlaneCollection;
 
 class volGeometry : public vvGLObject
 {
@@ -52,6 +54,8 @@ private:
   double m_opacity;
   Representation m_representation;
   vtkNew<vtkLookupTable> m_color;
+  vtkNew<vtkPlaneCollection> m_clippingPlanes;
+  vtkTimeStamp m_clippingTime;
 };
 
 #endif // VOLGEOMETRY_H
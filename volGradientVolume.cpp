@@ -0,0 +1,270 @@
+#include "volGradientVolume.h"
+
+#include "volBrickCache.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//------------------------------------------------------------------------------
+inline float signOf(float value)
+{
+  return value < 0.f ? -1.f : 1.f;
+}
+
+//------------------------------------------------------------------------------
+// Computes the gradients of the bricks [begin, end).
+struct GradientFunctor
+{
+  const volBrickCache *volume;
+  double inverseSpacing[3];
+  volGradientVolume::Gradient *gradients;
+  float *brickMaximum;
+
+  // The sample at index (i, j, k) of the volume, or fallback if its brick is
+  // missing.
+  float at(const int index[3], float fallback) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const std::array<int, 3> &brickDims = this->volume->brickDimensions();
+    int brick[3];
+    int local[3];
+    for (int a = 0; a < 3; ++a)
+      {
+      brick[a] = std::min(index[a] / B, brickDims[a] - 1);
+      local[a] = index[a] - brick[a] * B;
+      }
+    const float *data = this->volume->brick(
+          this->volume->brickIndex(brick[0], brick[1], brick[2]));
+    return data ? data[local[0] + S * (local[1] + S * local[2])] : fallback;
+  }
+
+  // The gradient at sample of the brick data starting at base, whose index
+  // in the volume is index, reading the neighboring bricks if needed.
+  void borderGradient(const float *data, const int base[3], int sample,
+                      const int index[3], float g[3]) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const int stride[3] = { 1, S, S * S };
+    const std::array<int, 3> &dims = this->volume->dimensions();
+    const float center = data[sample];
+    for (int a = 0; a < 3; ++a)
+      {
+      const int lo = std::max(index[a] - 1, 0);
+      const int hi = std::min(index[a] + 1, dims[a] - 1);
+      if (hi <= lo)
+        {
+        g[a] = 0.f;
+        continue;
+        }
+      float values[2];
+      const int ends[2] = { lo, hi };
+      for (int e = 0; e < 2; ++e)
+        {
+        const int offset = ends[e] - index[a];
+        const int neighbor = index[a] - base[a] + offset;
+        if (neighbor >= 0 && neighbor <= B)
+          {
+          values[e] = data[sample + offset * stride[a]];
+          }
+        else
+          {
+          int other[3] = { index[0], index[1], index[2] };
+          other[a] = ends[e];
+          values[e] = this->at(other, center);
+          }
+        }
+      g[a] = static_cast<float>((values[1] - values[0]) / (hi - lo) *
+                                this->inverseSpacing[a]);
+      }
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const std::array<int, 3> &dims = this->volume->dimensions();
+    const std::array<int, 3> &brickDims = this->volume->brickDimensions();
+    const float half[3] = { static_cast<float>(0.5 * this->inverseSpacing[0]),
+                            static_cast<float>(0.5 * this->inverseSpacing[1]),
+                            static_cast<float>(0.5 * this->inverseSpacing[2]) };
+    std::vector<float> components(3 * S * S * S);
+
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const size_t brick = static_cast<size_t>(b);
+      const float *data = this->volume->brick(brick);
+      volGradientVolume::Gradient *out = this->gradients + brick * S * S * S;
+      if (!data)
+        {
+        this->brickMaximum[brick] = 0.f;
+        continue;
+        }
+      const int bi = static_cast<int>(b % brickDims[0]);
+      const int bj = static_cast<int>(b / brickDims[0] % brickDims[1]);
+      const int bk = static_cast<int>(b / brickDims[0] / brickDims[1]);
+      const int base[3] = { bi * B, bj * B, bk * B };
+
+      // Samples whose neighbors are all in this brick (and in the volume):
+      int interior[3];
+      for (int a = 0; a < 3; ++a)
+        {
+        interior[a] = std::min(B - 1, dims[a] - 2 - base[a]);
+        }
+
+      // Central differences, reading the neighboring bricks only at the
+      // faces of this one. Samples past the end of the volume duplicate the
+      // last ones, and so do their gradients:
+      float maximum = 0.f;
+      float *g = components.data();
+      for (int k = 0; k < S; ++k)
+        {
+        for (int j = 0; j < S; ++j)
+          {
+          const bool row = k >= 1 && k <= interior[2] &&
+              j >= 1 && j <= interior[1];
+          for (int i = 0; i < S; ++i, g += 3)
+            {
+            if (row && i >= 1 && i <= interior[0])
+              {
+              const float *p = data + i + S * (j + S * k);
+              g[0] = (p[1] - p[-1]) * half[0];
+              g[1] = (p[S] - p[-S]) * half[1];
+              g[2] = (p[S * S] - p[-S * S]) * half[2];
+              }
+            else
+              {
+              const int index[3] = { std::min(base[0] + i, dims[0] - 1),
+                                     std::min(base[1] + j, dims[1] - 1),
+                                     std::min(base[2] + k, dims[2] - 1) };
+              const int sample = (index[0] - base[0]) +
+                  S * ((index[1] - base[1]) + S * (index[2] - base[2]));
+              this->borderGradient(data, base, sample, index, g);
+              }
+            maximum = std::max(maximum,
+                               g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+            }
+          }
+        }
+      maximum = std::sqrt(maximum);
+      this->brickMaximum[brick] = maximum;
+
+      // Quantized against the brick's largest magnitude:
+      const float scale = maximum > 0.f ? 65535.f / maximum : 0.f;
+      g = components.data();
+      for (int s = 0; s < S * S * S; ++s, g += 3)
+        {
+        const float magnitude = std::sqrt(g[0] * g[0] + g[1] * g[1] +
+                                          g[2] * g[2]);
+        out[s].magnitude = static_cast<uint16_t>(
+              std::min(magnitude * scale + 0.5f, 65535.f));
+        if (magnitude > 0.f)
+          {
+          const float n[3] = { g[0] / magnitude, g[1] / magnitude,
+                               g[2] / magnitude };
+          out[s].normal = volGradientVolume::encodeNormal(n);
+          }
+        else
+          {
+          const float up[3] = { 0.f, 0.f, 1.f };
+          out[s].normal = volGradientVolume::encodeNormal(up);
+          }
+        }
+      }
+  }
+};
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volGradientVolume::volGradientVolume(
+    const std::shared_ptr<const volBrickCache> &volume)
+  : m_volume(volume),
+    m_maximum(0.f)
+{
+  const size_t S = volBrickCache::BrickSamples;
+  const size_t numBricks = volume->numberOfBricks();
+  m_gradients.resize(numBricks * S * S * S);
+  m_brickMaximum.assign(numBricks, 0.f);
+
+  GradientFunctor functor;
+  functor.volume = volume.get();
+  for (int a = 0; a < 3; ++a)
+    {
+    const double spacing = volume->spacing()[a];
+    functor.inverseSpacing[a] = spacing != 0. ? 1. / spacing : 0.;
+    }
+  functor.gradients = m_gradients.data();
+  functor.brickMaximum = m_brickMaximum.data();
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numBricks), 1, functor);
+
+  m_bricks.resize(numBricks);
+  for (size_t b = 0; b < numBricks; ++b)
+    {
+    m_bricks[b] = volume->brick(b) ? &m_gradients[b * S * S * S] : nullptr;
+    m_maximum = std::max(m_maximum, m_brickMaximum[b]);
+    }
+}
+
+//------------------------------------------------------------------------------
+volGradientVolume::~volGradientVolume()
+{
+}
+
+//------------------------------------------------------------------------------
+bool volGradientVolume::isGradientOf(
+    const std::shared_ptr<const volBrickCache> &volume) const
+{
+  return volume && m_volume.lock() == volume;
+}
+
+//------------------------------------------------------------------------------
+size_t volGradientVolume::memorySize() const
+{
+  return sizeof(Gradient) * m_gradients.size() +
+      sizeof(float) * m_brickMaximum.size();
+}
+
+//------------------------------------------------------------------------------
+uint16_t volGradientVolume::encodeNormal(const float n[3])
+{
+  // Project onto the octahedron |x| + |y| + |z| = 1, and fold its lower half
+  // over the upper one:
+  const float norm = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+  float x = norm > 0.f ? n[0] / norm : 0.f;
+  float y = norm > 0.f ? n[1] / norm : 0.f;
+  if (n[2] < 0.f)
+    {
+    const float folded = (1.f - std::fabs(y)) * signOf(x);
+    y = (1.f - std::fabs(x)) * signOf(y);
+    x = folded;
+    }
+  const unsigned int u = static_cast<unsigned int>((x * 0.5f + 0.5f) * 255.f +
+                                                   0.5f);
+  const unsigned int v = static_cast<unsigned int>((y * 0.5f + 0.5f) * 255.f +
+                                                   0.5f);
+  return static_cast<uint16_t>(u | (v << 8));
+}
+
+//------------------------------------------------------------------------------
+void volGradientVolume::decodeNormal(uint16_t code, float n[3])
+{
+  float x = (code & 0xff) / 255.f * 2.f - 1.f;
+  float y = (code >> 8) / 255.f * 2.f - 1.f;
+  const float z = 1.f - std::fabs(x) - std::fabs(y);
+  if (z < 0.f)
+    {
+    const float unfolded = (1.f - std::fabs(y)) * signOf(x);
+    y = (1.f - std::fabs(x)) * signOf(y);
+    x = unfolded;
+    }
+  const float length = std::sqrt(x * x + y * y + z * z);
+  n[0] = x / length;
+  n[1] = y / length;
+  n[2] = z / length;
+}
@@ -0,0 +1,81 @@
+#ifndef VOLGRADIENTVOLUME_H
+#define VOLGRADIENTVOLUME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class volBrickCache;
+
+/**
+ * @brief The volGradientVolume class holds the scalar gradient at every
+ * sample of a volBrickCache, computed ahead of time.
+ *
+ * Gradients are taken by central differences (one-sided at the borders of
+ * the volume), in world coordinates, brick by brick in parallel so that each
+ * task reads one brick and the faces of its neighbors. They are stored in the
+ * layout of the bricks, four bytes per sample: the direction as a 16-bit
+ * octahedral normal, and the magnitude as a 16-bit fraction of the largest
+ * magnitude in the brick. That is as many bytes as the float samples
+ * themselves, where three float components would take three times as many.
+ *
+ * Renderers use the normals for shading and the magnitudes for transfer
+ * functions over value and gradient magnitude. Like the brick cache, a
+ * gradient volume is read-only once built and may be used from any thread.
+ */
+class volGradientVolume
+{
+public:
+  struct Gradient
+  {
+    uint16_t normal;    // see encodeNormal()
+    uint16_t magnitude; // brickMaximumMagnitude() * magnitude / 65535
+  };
+
+  /** Compute the gradients of volume, in parallel. */
+  explicit volGradientVolume(const std::shared_ptr<const volBrickCache> &volume);
+  ~volGradientVolume();
+
+  /** True if this holds the gradients of volume. */
+  bool isGradientOf(const std::shared_ptr<const volBrickCache> &volume) const;
+
+  size_t numberOfBricks() const { return m_brickMaximum.size(); }
+
+  /**
+   * Gradients of a brick, laid out like volBrickCache::brick(). nullptr if the
+   * volume did not hold the brick.
+   */
+  const Gradient* brick(size_t index) const { return m_bricks[index]; }
+
+  /** Largest gradient magnitude in a brick, and in the whole volume. */
+  float brickMaximumMagnitude(size_t index) const
+  {
+    return m_brickMaximum[index];
+  }
+  float maximumMagnitude() const { return m_maximum; }
+
+  /** Bytes held by the gradients. */
+  size_t memorySize() const;
+
+  /**
+   * Octahedral encoding of the unit vector n, 8 bits per coordinate of the
+   * octahedron unfolded onto a square. Directions are within about a degree
+   * of the original.
+   */
+  static uint16_t encodeNormal(const float n[3]);
+  static void decodeNormal(uint16_t code, float n[3]);
+
+private:
+  // Not implemented:
+  volGradientVolume(const volGradientVolume&);
+  volGradientVolume& operator=(const volGradientVolume&);
+
+  std::weak_ptr<const volBrickCache> m_volume;
+  std::vector<Gradient> m_gradients;
+  std::vector<const Gradient*> m_bricks;
+  std::vector<float> m_brickMaximum;
+  float m_maximum;
+};
+
+#endif // VOLGRADIENTVOLUME_H
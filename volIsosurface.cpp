@@ -3,12 +3,17 @@
 #include "volApplicationState.h"
 #include "volContextState.h"
 #include "volReader.h"
+#include "volSidecarCache.h"
+#include "volTransferFunction.h"
 
 #include <vtkActor.h>
+#include <vtkClipPolyData.h>
 #include <vtkDataObject.h>
 #include <vtkExternalOpenGLRenderer.h>
 #include <vtkFlyingEdges3D.h>
+#include <vtkImageData.h>
 #include <vtkLookupTable.h>
+#include <vtkPolyData.h>
 #include <vtkPolyDataMapper.h>
 
 //------------------------------------------------------------------------------
@@ -30,7 +35,12 @@ bool volIsosurface::visible() const
 //------------------------------------------------------------------------------
 void volIsosurface::setVisible(bool vis)
 {
-  this->objectState<IsosurfaceState>().visible = vis;
+  IsosurfaceState &state = this->objectState<IsosurfaceState>();
+  state.visible = vis;
+  if (vis)
+    {
+    state.hiResReleased = false;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -45,6 +55,39 @@ void volIsosurface::setContourValue(double val)
   this->objectState<IsosurfaceState>().contourValue = val;
 }
 
+//------------------------------------------------------------------------------
+size_t volIsosurface::memoryUsage() const
+{
+  size_t bytes = 0;
+  const LevelOfDetail lods[2] = { LevelOfDetail::LoRes, LevelOfDetail::HiRes };
+  for (int i = 0; i < 2; ++i)
+    {
+    const IsosurfaceLODData *data =
+        static_cast<const IsosurfaceLODData*>(this->lodData(lods[i]));
+    if (data && data->contour &&
+        !(lods[i] == LevelOfDetail::HiRes &&
+          this->objectState<IsosurfaceState>().hiResReleased))
+      {
+      bytes += static_cast<size_t>(data->contour->GetActualMemorySize()) << 10;
+      }
+    }
+  return bytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volIsosurface::releaseHiddenData()
+{
+  IsosurfaceState &state = this->objectState<IsosurfaceState>();
+  const IsosurfaceLODData *data = static_cast<const IsosurfaceLODData*>(
+        this->lodData(LevelOfDetail::HiRes));
+  if (state.visible || state.hiResReleased || !data || !data->contour)
+    {
+    return 0;
+    }
+  state.hiResReleased = true;
+  return static_cast<size_t>(data->contour->GetActualMemorySize()) << 10;
+}
+
 //------------------------------------------------------------------------------
 std::string volIsosurface::progressLabel() const
 {
@@ -116,16 +159,9 @@ void volIsosurface::IsosurfaceState::update(const vvApplicationState &appState)
       static_cast<const volApplicationState&>(appState);
 
   if (this->color->GetNumberOfTableValues() == 0 ||
-      this->color->GetMTime() < state.isosurfaceColorMapTimeStamp())
+      this->color->GetMTime() < state.isosurfaceTransferFunction().timeStamp())
     {
-    for (vtkIdType i = 0; i < 256; ++i)
-      {
-      this->color->SetTableValue(i,
-                                 state.isosurfaceColorMap()[4*i + 0],
-                                 state.isosurfaceColorMap()[4*i + 1],
-                                 state.isosurfaceColorMap()[4*i + 2],
-                                 1.);
-      }
+    state.isosurfaceTransferFunction().exportLookupTable(this->color.Get());
     }
 }
 
@@ -146,6 +182,7 @@ void volIsosurface::IsosurfaceDataPipeline::configure(
       static_cast<const volApplicationState&>(appStateIn);
 
   vtkDataObject *input = nullptr;
+  bool fullResolution = false;
   switch (this->lod)
     {
     case LevelOfDetail::LoRes:
@@ -163,7 +200,10 @@ void volIsosurface::IsosurfaceDataPipeline::configure(
         }
       else
         {
+        // Full resolution data is only processed inside the region of
+        // interest, and may have to be paged in:
         input = appState.reader().dataObject();
+        fullResolution = true;
         }
       break;
 
@@ -171,8 +211,31 @@ void volIsosurface::IsosurfaceDataPipeline::configure(
       std::cerr << "Invalid level of detail for IsosurfaceDataPipeline.\n";
     }
 
-  this->contour->SetInputDataObject(input);
+  this->clipper.configure(vtkImageData::SafeDownCast(input), appState,
+                          fullResolution);
+  this->clipper.connectInput(this->contour.Get());
+  this->output = this->clipper.connectOutput(this->contour.Get(),
+                                             this->clip.Get());
   this->contour->SetValue(0, state.contourValue);
+  this->release = this->lod == LevelOfDetail::HiRes && !state.visible &&
+      state.hiResReleased;
+
+  // During time series playback, use the isosurface computed along with the
+  // step if there is one, or one computed in an earlier run:
+  vtkPolyData *speculative = nullptr;
+  this->sidecarCache.reset();
+  if (this->lod == LevelOfDetail::LoRes && input &&
+      appState.clippingPlanes().empty())
+    {
+    speculative = appState.reader().speculativeContour(state.contourValue);
+    this->sidecarCache = appState.reader().sidecarCache();
+    this->sampleRate = appState.reader().reducedSampleRate();
+    }
+  if (speculative != this->speculative.Get())
+    {
+    this->speculative = speculative;
+    this->speculativeTime.Modified();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -182,25 +245,59 @@ bool volIsosurface::IsosurfaceDataPipeline::needsUpdate(
   const IsosurfaceState &state = static_cast<const IsosurfaceState&>(objState);
   const IsosurfaceLODData &data = static_cast<const IsosurfaceLODData&>(result);
 
+  if (this->release)
+    {
+    return data.contour != nullptr;
+    }
+
   return
       state.visible &&
       this->contour->GetInputDataObject(0, 0) != nullptr &&
+      this->clipper.available() &&
       (!data.contour ||
-       this->contour->GetMTime() > data.contour->GetMTime());
+       this->contour->GetMTime() > data.contour->GetMTime() ||
+       this->clipper.GetMTime() > data.contour->GetMTime() ||
+       this->speculativeTime.GetMTime() > data.contour->GetMTime());
 }
 
 //------------------------------------------------------------------------------
 void volIsosurface::IsosurfaceDataPipeline::execute()
 {
-  this->contour->Update();
+  if (this->release)
+    {
+    // Released data is regenerated by the next Update():
+    this->clipper.releaseData();
+    this->contour->GetOutputDataObject(0)->ReleaseData();
+    this->clip->GetOutputDataObject(0)->ReleaseData();
+    return;
+    }
+  if (this->speculative)
+    {
+    return;
+    }
+  this->clipper.update();
+  this->output->Update();
+
+  if (this->sidecarCache)
+    {
+    this->sidecarCache->storeIsosurface(
+          this->sampleRate, this->contour->GetValue(0),
+          vtkPolyData::SafeDownCast(this->output->GetOutputDataObject(0)));
+    }
 }
 
 //------------------------------------------------------------------------------
 void volIsosurface::IsosurfaceDataPipeline::exportResult(LODData &result) const
 {
   IsosurfaceLODData &data = static_cast<IsosurfaceLODData&>(result);
+  if (this->release)
+    {
+    data.contour = nullptr;
+    return;
+    }
 
-  vtkDataObject *dataObject = this->contour->GetOutputDataObject(0);
+  vtkDataObject *dataObject = this->speculative
+      ? this->speculative.Get() : this->output->GetOutputDataObject(0);
   data.contour.TakeReference(dataObject->NewInstance());
   data.contour->ShallowCopy(dataObject);
 }
@@ -3,13 +3,23 @@
 
 #include <vvLODAsyncGLObject.h>
 
+#include "volDataClipper.h"
+
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+
+#include <cstddef>
+#include <memory>
 
+class volSidecarCache;
 class vtkActor;
+class vtkAlgorithm;
+class vtkClipPolyData;
 class vtkDataObject;
 class vtkFlyingEdges3D;
 class vtkLookupTable;
+class vtkPolyData;
 class vtkPolyDataMapper;
 
 class volIsosurface : public vvLODAsyncGLObject
@@ -26,6 +36,15 @@ public:
   double contourValue() const;
   void setContourValue(double val);
 
+  /** Bytes held by the results, not counting released ones. */
+  size_t memoryUsage() const;
+
+  /**
+   * If the isosurface is hidden, drop its HiRes result (see volMemoryManager);
+   * it is recomputed when shown again. Returns the bytes released.
+   */
+  size_t releaseHiddenData();
+
   struct IsosurfaceState : public ObjectState
   {
     IsosurfaceState();
@@ -35,6 +54,7 @@ public:
     vtkNew<vtkLookupTable> color;
     bool visible{false};
     double contourValue{0.};
+    bool hiResReleased{false};
   };
 
   struct IsosurfaceLODData : public LODData
@@ -54,7 +74,22 @@ public:
     void exportResult(LODData &result) const override;
 
     LevelOfDetail lod;
+    volDataClipper clipper;
     vtkNew<vtkFlyingEdges3D> contour;
+    vtkNew<vtkClipPolyData> clip;
+    vtkAlgorithm *output{nullptr};
+
+    // Set while the result of a hidden HiRes pipeline is to be dropped:
+    bool release{false};
+
+    // LoRes isosurface computed ahead of time for a time series step, or
+    // loaded from the sidecar cache:
+    vtkSmartPointer<vtkPolyData> speculative;
+    vtkTimeStamp speculativeTime;
+
+    // Where computed LoRes isosurfaces are kept for the next run, if at all:
+    std::shared_ptr<volSidecarCache> sidecarCache;
+    int sampleRate{0};
   };
 
   struct IsosurfaceRenderPipeline : public RenderPipeline
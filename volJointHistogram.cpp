@@ -0,0 +1,146 @@
+#include "volJointHistogram.h"
+
+#include "volBrickCache.h"
+#include "volGradientVolume.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Partial histograms, each binned by one task. More than the threads there
+// are, so that the tasks balance, few enough that the partials stay small.
+const size_t Partitions = 32;
+
+const size_t NumberOfBins = static_cast<size_t>(volJointHistogram::ValueBins) *
+    volJointHistogram::MagnitudeBins;
+
+//------------------------------------------------------------------------------
+// Bins the bricks of the partitions [begin, end) into their partials.
+struct BinFunctor
+{
+  const volBrickCache *volume;
+  const volGradientVolume *gradients;
+  size_t partitions;
+  float valueOffset;
+  float valueScale;     // value bins per scalar unit
+  float magnitudeScale; // magnitude bins per unit of the largest magnitude
+  uint32_t *partials;   // NumberOfBins per partition
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const int V = volJointHistogram::ValueBins;
+    const int M = volJointHistogram::MagnitudeBins;
+    const std::array<int, 3> &dims = this->volume->dimensions();
+    const std::array<int, 3> &brickDims = this->volume->brickDimensions();
+    const size_t numBricks = this->volume->numberOfBricks();
+
+    for (vtkIdType p = begin; p < end; ++p)
+      {
+      uint32_t *bins = this->partials + static_cast<size_t>(p) * NumberOfBins;
+      const size_t first = numBricks * static_cast<size_t>(p) /
+          this->partitions;
+      const size_t last = numBricks * static_cast<size_t>(p + 1) /
+          this->partitions;
+      for (size_t b = first; b < last; ++b)
+        {
+        const float *samples = this->volume->brick(b);
+        const volGradientVolume::Gradient *gradients =
+            this->gradients->brick(b);
+        if (!samples || !gradients)
+          {
+          continue;
+          }
+        const int bi = static_cast<int>(b % brickDims[0]);
+        const int bj = static_cast<int>(b / brickDims[0] % brickDims[1]);
+        const int bk = static_cast<int>(b / brickDims[0] / brickDims[1]);
+        const int ni = bi == brickDims[0] - 1 ? dims[0] - bi * B : B;
+        const int nj = bj == brickDims[1] - 1 ? dims[1] - bj * B : B;
+        const int nk = bk == brickDims[2] - 1 ? dims[2] - bk * B : B;
+        const float magnitudeScale = this->magnitudeScale *
+            this->gradients->brickMaximumMagnitude(b) / 65535.f;
+        for (int k = 0; k < nk; ++k)
+          {
+          for (int j = 0; j < nj; ++j)
+            {
+            const int row = S * (j + S * k);
+            for (int i = 0; i < ni; ++i)
+              {
+              const float v = (samples[row + i] - this->valueOffset) *
+                  this->valueScale;
+              const float m = gradients[row + i].magnitude * magnitudeScale;
+              const int vb = v >= V - 1 ? V - 1
+                                        : (v > 0.f ? static_cast<int>(v) : 0);
+              const int mb = m >= M - 1 ? M - 1 : static_cast<int>(m);
+              ++bins[vb + V * mb];
+              }
+            }
+          }
+        }
+      }
+  }
+};
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volJointHistogram::volJointHistogram(const volBrickCache &volume,
+                                     const volGradientVolume &gradients,
+                                     const std::array<double, 2> &scalarRange)
+  : m_scalarRange(scalarRange),
+    m_maximumMagnitude(gradients.maximumMagnitude()),
+    m_counts(NumberOfBins, 0)
+{
+  const size_t partitions = std::max<size_t>(
+        std::min(Partitions, volume.numberOfBricks()), 1);
+  std::vector<uint32_t> partials(partitions * NumberOfBins, 0);
+
+  const double width = scalarRange[1] - scalarRange[0];
+  BinFunctor functor;
+  functor.volume = &volume;
+  functor.gradients = &gradients;
+  functor.partitions = partitions;
+  functor.valueOffset = static_cast<float>(scalarRange[0]);
+  functor.valueScale = width > 0. ? static_cast<float>(ValueBins / width)
+                                  : 0.f;
+  functor.magnitudeScale = m_maximumMagnitude > 0.f
+      ? MagnitudeBins / m_maximumMagnitude : 0.f;
+  functor.partials = partials.data();
+  vtkSMPTools::For(0, static_cast<vtkIdType>(partitions), 1, functor);
+
+  for (size_t p = 0; p < partitions; ++p)
+    {
+    const uint32_t *bins = &partials[p * NumberOfBins];
+    for (size_t i = 0; i < NumberOfBins; ++i)
+      {
+      m_counts[i] += bins[i];
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+volJointHistogram::~volJointHistogram()
+{
+}
+
+//------------------------------------------------------------------------------
+std::vector<float> volJointHistogram::logScaled() const
+{
+  const uint32_t largest = *std::max_element(m_counts.begin(), m_counts.end());
+  std::vector<float> scaled(m_counts.size(), 0.f);
+  if (largest == 0)
+    {
+    return scaled;
+    }
+  const double scale = 1. / std::log1p(static_cast<double>(largest));
+  for (size_t i = 0; i < m_counts.size(); ++i)
+    {
+    scaled[i] = static_cast<float>(std::log1p(
+                                     static_cast<double>(m_counts[i])) * scale);
+    }
+  return scaled;
+}
@@ -0,0 +1,64 @@
+#ifndef VOLJOINTHISTOGRAM_H
+#define VOLJOINTHISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class volBrickCache;
+class volGradientVolume;
+
+/**
+ * @brief The volJointHistogram class counts the samples of a volume over
+ * their scalar value and gradient magnitude, the two axes of a
+ * volTransferFunction2D.
+ *
+ * Samples are binned brick by brick in parallel. The bricks are split into a
+ * fixed number of partitions, each binned by one task into a partial
+ * histogram of its own so that no counts are shared between threads, and the
+ * partials are summed at the end. Only the samples a brick owns are counted,
+ * not those it repeats from the next brick.
+ *
+ * Homogeneous materials pile up at low magnitudes while the boundaries
+ * between them draw faint arcs above, so the counts span orders of magnitude
+ * and are shown through logScaled().
+ */
+class volJointHistogram
+{
+public:
+  /** Bins along the value and the gradient magnitude axes. */
+  static const int ValueBins = 256;
+  static const int MagnitudeBins = 128;
+
+  /**
+   * Bin the samples of volume, with values over scalarRange and magnitudes
+   * over [0, gradients.maximumMagnitude()]. gradients must be those of
+   * volume.
+   */
+  volJointHistogram(const volBrickCache &volume,
+                    const volGradientVolume &gradients,
+                    const std::array<double, 2> &scalarRange);
+  ~volJointHistogram();
+
+  const std::array<double, 2>& scalarRange() const { return m_scalarRange; }
+  float maximumMagnitude() const { return m_maximumMagnitude; }
+
+  /** Samples in value bin v and magnitude bin m, at
+   *  counts()[v + ValueBins * m]. */
+  const std::vector<uint32_t>& counts() const { return m_counts; }
+
+  /** log(1 + count) / log(1 + largest count) of each bin, in [0, 1]. */
+  std::vector<float> logScaled() const;
+
+private:
+  // Not implemented:
+  volJointHistogram(const volJointHistogram&);
+  volJointHistogram& operator=(const volJointHistogram&);
+
+  std::array<double, 2> m_scalarRange;
+  float m_maximumMagnitude;
+  std::vector<uint32_t> m_counts;
+};
+
+#endif // VOLJOINTHISTOGRAM_H
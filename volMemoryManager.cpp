@@ -0,0 +1,330 @@
+#include "volMemoryManager.h"
+
+#include "volApplicationState.h"
+#include "volArrayPool.h"
+#include "volBrickPager.h"
+#include "volContours.h"
+#include "volGradientVolume.h"
+#include "volIsosurface.h"
+#include "volReader.h"
+#include "volTimeSeries.h"
+
+#include <vtkDataObject.h>
+
+#include <algorithm>
+
+#include <unistd.h>
+
+namespace {
+
+//------------------------------------------------------------------------------
+size_t dataBytes(const vtkDataObject *data)
+{
+  // const_cast because VTK is not const correct:
+  return data ? static_cast<size_t>(
+                  const_cast<vtkDataObject*>(data)->GetActualMemorySize())
+                << 10
+              : 0;
+}
+
+//------------------------------------------------------------------------------
+size_t gradientBytes(const std::shared_ptr<const volGradientVolume> &gradients)
+{
+  return gradients ? gradients->memorySize() : 0;
+}
+
+// Memory is only taken back while this fraction of the budget stays free, so
+// that restoring does not immediately cause another eviction:
+const size_t RestoreMarginDivisor = 8;
+
+} // end anon namespace
+
+const size_t volMemoryManager::NotLowered;
+
+//------------------------------------------------------------------------------
+volMemoryManager::volMemoryManager()
+  : m_budget(defaultBudget()),
+    m_capacity(NotLowered),
+    m_stepBytes(0),
+    m_storeBudget(NotLowered),
+    m_brickBudget(NotLowered)
+{
+  m_evictionOrder.push_back(ArrayPool);
+  m_evictionOrder.push_back(TimeSeriesSteps);
+  m_evictionOrder.push_back(TimeSeriesStore);
+  m_evictionOrder.push_back(BrickPager);
+  m_evictionOrder.push_back(Isosurfaces);
+  m_statistics.budget = m_budget;
+  m_statistics.bytes.fill(0);
+  m_pendingTarget.fill(NotLowered);
+  m_pendingUpdates.fill(0);
+}
+
+//------------------------------------------------------------------------------
+volMemoryManager::~volMemoryManager()
+{
+}
+
+//------------------------------------------------------------------------------
+const char *volMemoryManager::subsystemName(Subsystem subsystem)
+{
+  switch (subsystem)
+    {
+    case VolumeData:
+      return "Volume";
+    case ReducedData:
+      return "Reduced volume";
+    case BrickPager:
+      return "Paged bricks";
+    case TimeSeriesSteps:
+      return "Decoded time steps";
+    case TimeSeriesStore:
+      return "Compressed time steps";
+    case Isosurfaces:
+      return "Isosurfaces";
+    case Contours:
+      return "Contours";
+    case ArrayPool:
+      return "Pooled buffers";
+    default:
+      return "Unknown";
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t volMemoryManager::defaultBudget()
+{
+  const long pages = sysconf(_SC_PHYS_PAGES);
+  const long pageSize = sysconf(_SC_PAGESIZE);
+  if (pages <= 0 || pageSize <= 0)
+    {
+    return 0;
+    }
+  return static_cast<size_t>(pages) * static_cast<size_t>(pageSize) / 2;
+}
+
+//------------------------------------------------------------------------------
+void volMemoryManager::update(volApplicationState &state)
+{
+  const volReader &reader = state.reader();
+  std::array<size_t, NumberOfSubsystems> &bytes = m_statistics.bytes;
+  bytes.fill(0);
+
+  bytes[VolumeData] =
+      dataBytes(reader.dataObject()) + reader.brickCacheBytes() +
+      gradientBytes(reader.gradients());
+  bytes[ReducedData] = dataBytes(reader.reducedDataObject()) +
+      reader.reducedBrickCacheBytes() +
+      gradientBytes(reader.reducedGradients());
+  if (std::shared_ptr<volBrickPager> pager = reader.brickPager())
+    {
+    bytes[BrickPager] = pager->residentBytes();
+    }
+  if (const std::shared_ptr<volTimeSeries> &timeSeries = reader.timeSeries())
+    {
+    bytes[TimeSeriesSteps] = timeSeries->decodedBytes();
+    bytes[TimeSeriesStore] = timeSeries->store().storedBytes();
+    }
+  bytes[Isosurfaces] = state.isosurfaceA().memoryUsage() +
+      state.isosurfaceB().memoryUsage() + state.isosurfaceC().memoryUsage();
+  bytes[Contours] = state.contours().memoryUsage();
+  bytes[ArrayPool] = volArrayPool::instance().pooledBytes();
+
+  m_statistics.budget = m_budget;
+  m_statistics.totalBytes = 0;
+  m_statistics.pendingBytes = 0;
+  size_t total = 0; // counting pending releases as done
+  for (size_t i = 0; i < bytes.size(); ++i)
+    {
+    m_statistics.totalBytes += bytes[i];
+    size_t held = bytes[i];
+    if (m_pendingTarget[i] != NotLowered)
+      {
+      if (held <= m_pendingTarget[i] ||
+          ++m_pendingUpdates[i] > MaximumPendingUpdates)
+        {
+        m_pendingTarget[i] = NotLowered;
+        }
+      else
+        {
+        m_statistics.pendingBytes += held - m_pendingTarget[i];
+        held = m_pendingTarget[i];
+        }
+      }
+    total += held;
+    }
+  if (m_budget == 0)
+    {
+    return;
+    }
+  if (total <= m_budget)
+    {
+    if (m_statistics.pendingBytes == 0)
+      {
+      this->restore(state, m_budget - total);
+      }
+    return;
+    }
+
+  size_t excess = total - m_budget;
+  for (size_t i = 0; i < m_evictionOrder.size() && excess > 0; ++i)
+    {
+    const Subsystem subsystem = m_evictionOrder[i];
+    const size_t released = this->release(state, subsystem, excess);
+    if (released > 0)
+      {
+      ++m_statistics.evictions;
+      m_statistics.releasedBytes += released;
+      excess -= std::min(released, excess);
+      const size_t held = std::min(bytes[subsystem],
+                                   m_pendingTarget[subsystem]);
+      m_pendingTarget[subsystem] = held - std::min(released, held);
+      m_pendingUpdates[subsystem] = 0;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t volMemoryManager::release(volApplicationState &state,
+                                 Subsystem subsystem, size_t bytes)
+{
+  const size_t held = std::min(m_statistics.bytes[subsystem],
+                               m_pendingTarget[subsystem]);
+  const std::shared_ptr<volTimeSeries> &timeSeries =
+      state.reader().timeSeries();
+  switch (subsystem)
+    {
+    case ArrayPool:
+      return volArrayPool::instance().trim();
+
+    case TimeSeriesSteps:
+      {
+      // Decode as many fewer steps ahead as it takes, but at least one:
+      const size_t capacity = timeSeries ? timeSeries->capacity() : 0;
+      if (held == 0 || capacity <= 1)
+        {
+        return 0;
+        }
+      const size_t stepBytes = std::max<size_t>(held / capacity, 1);
+      const size_t steps = std::min((bytes + stepBytes - 1) / stepBytes,
+                                    capacity - 1);
+      if (m_capacity == NotLowered)
+        {
+        m_capacity = capacity;
+        }
+      m_stepBytes = stepBytes;
+      timeSeries->setCapacity(capacity - steps);
+      return std::min(steps * stepBytes, held);
+      }
+
+    case TimeSeriesStore:
+      if (held == 0)
+        {
+        return 0;
+        }
+      if (m_storeBudget == NotLowered)
+        {
+        m_storeBudget = timeSeries->store().budget();
+        }
+      timeSeries->store().setBudget(held - std::min(bytes, held));
+      return std::min(bytes, held);
+
+    case BrickPager:
+      {
+      std::shared_ptr<volBrickPager> pager = state.reader().brickPager();
+      if (!pager || held <= MinimumBrickBudget)
+        {
+        return 0;
+        }
+      const size_t budget = std::max(held - std::min(bytes, held),
+                                     MinimumBrickBudget);
+      if (m_brickBudget == NotLowered)
+        {
+        m_brickBudget = state.reader().brickBudget();
+        }
+      state.reader().setBrickBudget(budget);
+      return held - budget;
+      }
+
+    case Isosurfaces:
+      {
+      volIsosurface *isosurfaces[3] = { &state.isosurfaceA(),
+                                        &state.isosurfaceB(),
+                                        &state.isosurfaceC() };
+      size_t released = 0;
+      for (int i = 0; i < 3 && released < bytes; ++i)
+        {
+        released += isosurfaces[i]->releaseHiddenData();
+        }
+      return released;
+      }
+
+    default:
+      return 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+void volMemoryManager::restore(volApplicationState &state, size_t bytes)
+{
+  const size_t margin = m_budget / RestoreMarginDivisor;
+  if (bytes <= margin)
+    {
+    return;
+    }
+  size_t room = bytes - margin;
+
+  // The pager and the store first, as they are given up last:
+  if (m_brickBudget != NotLowered && room > 0)
+    {
+    const size_t current = state.reader().brickBudget();
+    const size_t budget = std::min(m_brickBudget, current + room);
+    if (budget > current)
+      {
+      state.reader().setBrickBudget(budget);
+      room -= budget - current;
+      }
+    if (budget >= m_brickBudget || !state.reader().brickPager())
+      {
+      m_brickBudget = NotLowered;
+      }
+    }
+
+  const std::shared_ptr<volTimeSeries> &timeSeries =
+      state.reader().timeSeries();
+  if (!timeSeries)
+    {
+    m_storeBudget = NotLowered;
+    m_capacity = NotLowered;
+    return;
+    }
+  if (m_storeBudget != NotLowered && room > 0)
+    {
+    volTimeSeriesStore &store = timeSeries->store();
+    const size_t current = store.budget();
+    const size_t budget = std::min(m_storeBudget, current + room);
+    if (budget > current)
+      {
+      store.setBudget(budget);
+      room -= budget - current;
+      }
+    if (budget >= m_storeBudget)
+      {
+      m_storeBudget = NotLowered;
+      }
+    }
+  if (m_capacity != NotLowered && room >= m_stepBytes)
+    {
+    const size_t current = timeSeries->capacity();
+    const size_t capacity = std::min(m_capacity,
+                                     current + room / m_stepBytes);
+    if (capacity > current)
+      {
+      timeSeries->setCapacity(capacity);
+      }
+    if (capacity >= m_capacity)
+      {
+      m_capacity = NotLowered;
+      }
+    }
+}
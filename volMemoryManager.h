@@ -0,0 +1,123 @@
+#ifndef VOLMEMORYMANAGER_H
+#define VOLMEMORYMANAGER_H
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+class volApplicationState;
+
+/**
+ * @brief The volMemoryManager class keeps the memory held by the viewer
+ * within a global budget.
+ *
+ * update() accounts for the bytes held by each subsystem. When their sum
+ * exceeds the budget, the subsystems in evictionOrder() are asked, one after
+ * the other, to give up the difference:
+ * - ArrayPool frees the buffers it keeps for reuse.
+ * - TimeSeriesSteps decodes fewer steps ahead of the current one.
+ * - TimeSeriesStore and BrickPager get a smaller budget.
+ * - Isosurfaces drop the full resolution results of hidden isosurfaces,
+ *   which are recomputed when shown again.
+ * The volume, the reduced data and the contours (which the slices depend on)
+ * are accounted for but never evicted. At least one step is always decoded
+ * ahead, or playback would stall.
+ *
+ * Results are released by the objects' worker threads, so their memory is
+ * freed some frames after it is requested. Until then, or for at most
+ * MaximumPendingUpdates, a subsystem counts as holding what it was asked to
+ * keep so that the same memory is not evicted again. Once the total is back
+ * under the budget with room to spare, the steps, store and pager budgets
+ * given up are taken back, as far as the room allows. All methods are called
+ * on the main thread.
+ */
+class volMemoryManager
+{
+public:
+  enum Subsystem
+    {
+    VolumeData = 0,  // full resolution data, its bricks and gradients
+    ReducedData,     // reduced data, its bricks and gradients
+    BrickPager,      // bricks paged in out of core
+    TimeSeriesSteps, // steps decoded ahead of the current one
+    TimeSeriesStore, // compressed steps
+    Isosurfaces,     // LoRes and HiRes isosurfaces
+    Contours,        // LoRes and HiRes contours
+    ArrayPool,       // recycled buffers kept for the next results
+    NumberOfSubsystems
+    };
+
+  struct Statistics
+  {
+    size_t budget{0};
+    size_t totalBytes{0};
+    std::array<size_t, NumberOfSubsystems> bytes;
+    size_t evictions{0};     // subsystems asked to give up memory so far
+    size_t releasedBytes{0}; // bytes they were asked to give up
+    size_t pendingBytes{0};  // of those, bytes not freed yet
+  };
+
+  /** Bytes below which the brick pager's budget is never lowered. */
+  static const size_t MinimumBrickBudget = size_t(64) << 20;
+
+  /** Updates after which a release that was not carried out is forgotten. */
+  static const int MaximumPendingUpdates = 60;
+
+  volMemoryManager();
+  ~volMemoryManager();
+
+  static const char* subsystemName(Subsystem subsystem);
+
+  /** Half of the physical memory, or 0 if that is unknown. */
+  static size_t defaultBudget();
+
+  /** Upper bound on the bytes held by all subsystems; 0 for no limit. */
+  size_t budget() const { return m_budget; }
+  void setBudget(size_t bytes) { m_budget = bytes; }
+
+  /** Subsystems evicted from when over budget, first to last. */
+  const std::vector<Subsystem>& evictionOrder() const
+  {
+    return m_evictionOrder;
+  }
+  void setEvictionOrder(const std::vector<Subsystem> &order)
+  {
+    m_evictionOrder = order;
+  }
+
+  /** Account for the memory held by state, and evict if over budget. */
+  void update(volApplicationState &state);
+
+  /** As of the last update(). */
+  const Statistics& statistics() const { return m_statistics; }
+
+private:
+  // Not implemented:
+  volMemoryManager(const volMemoryManager&);
+  volMemoryManager& operator=(const volMemoryManager&);
+
+  size_t release(volApplicationState &state, Subsystem subsystem,
+                 size_t bytes);
+  void restore(volApplicationState &state, size_t bytes);
+
+  static const size_t NotLowered = std::numeric_limits<size_t>::max();
+
+  size_t m_budget;
+  std::vector<Subsystem> m_evictionOrder;
+  Statistics m_statistics;
+
+  // Bytes each subsystem was asked to keep, and for how many updates it has
+  // not done so yet. NotLowered when nothing is pending.
+  std::array<size_t, NumberOfSubsystems> m_pendingTarget;
+  std::array<int, NumberOfSubsystems> m_pendingUpdates;
+
+  // Settings before they were first lowered, to restore them later.
+  // NotLowered when they were not.
+  size_t m_capacity;
+  size_t m_stepBytes; // decoded bytes per step when it was lowered
+  size_t m_storeBudget;
+  size_t m_brickBudget;
+};
+
+#endif // VOLMEMORYMANAGER_H
@@ -10,6 +10,7 @@
 #include <vtkDataObject.h>
 #include <vtkExternalOpenGLRenderer.h>
 #include <vtkOutlineFilter.h>
+#include <vtkOutlineSource.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
 
@@ -20,6 +21,8 @@ volOutline::DataItem::DataItem()
 {
   this->actor->SetMapper(this->mapper.Get());
   this->actor->GetProperty()->SetColor(1., 1., 1.);
+  this->roiActor->SetMapper(this->roiMapper.Get());
+  this->roiActor->GetProperty()->SetColor(1., 1., 0.);
 }
 
 //------------------------------------------------------------------------------
@@ -45,6 +48,7 @@ void volOutline::initVvContext(vvContextState &vvContext,
   contextData.addDataItem(this, dataItem);
 
   vvContext.renderer().AddActor(dataItem->actor.Get());
+  vvContext.renderer().AddActor(dataItem->roiActor.Get());
 }
 
 //------------------------------------------------------------------------------
@@ -52,15 +56,41 @@ void volOutline::syncApplicationState(const vvApplicationState &appState)
 {
   this->Superclass::syncApplicationState(appState);
 
-  if (m_visible)
+  const volApplicationState &state =
+      static_cast<const volApplicationState&>(appState);
+
+  if (m_visible && state.reader().dataObject())
     {
-    const volApplicationState &state =
-        static_cast<const volApplicationState&>(appState);
     m_filter->SetInputData(state.reader().dataObject());
     m_filter->Update();
     m_outline.TakeReference(m_filter->GetOutput()->NewInstance());
     m_outline->ShallowCopy(m_filter->GetOutput());
     }
+  else if (m_visible && state.reader().bounds().IsValid())
+    {
+    // The bounds are known before the file is read:
+    double bounds[6];
+    state.reader().bounds().GetBounds(bounds);
+    m_boundsSource->SetBounds(bounds);
+    m_boundsSource->Update();
+    m_outline.TakeReference(m_boundsSource->GetOutput()->NewInstance());
+    m_outline->ShallowCopy(m_boundsSource->GetOutput());
+    }
+
+  if (!state.hasRegionOfInterest())
+    {
+    m_roiOutline = nullptr;
+    }
+  else if (!m_roiOutline ||
+           state.regionOfInterestTimeStamp() > m_roiOutline->GetMTime())
+    {
+    const volApplicationState::RegionOfInterest &roi =
+        state.regionOfInterest();
+    m_roiSource->SetBounds(roi[0], roi[1], roi[2], roi[3], roi[4], roi[5]);
+    m_roiSource->Update();
+    m_roiOutline.TakeReference(m_roiSource->GetOutput()->NewInstance());
+    m_roiOutline->ShallowCopy(m_roiSource->GetOutput());
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -75,6 +105,9 @@ void volOutline::syncContextState(const vvApplicationState &appState,
 
   dataItem->mapper->SetInputDataObject(m_outline.Get());
   dataItem->actor->SetVisibility(m_visible ? 1 : 0);
+
+  dataItem->roiMapper->SetInputDataObject(m_roiOutline.Get());
+  dataItem->roiActor->SetVisibility(m_roiOutline ? 1 : 0);
 }
 
 //------------------------------------------------------------------------------
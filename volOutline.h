@@ -9,6 +9,7 @@
 class vtkActor;
 class vtkDataObject;
 class vtkOutlineFilter;
+class vtkOutlineSource;
 class vtkPolyDataMapper;
 
 class volOutline : public vvGLObject
@@ -22,6 +23,10 @@ public:
 
     vtkNew<vtkPolyDataMapper> mapper;
     vtkNew<vtkActor> actor;
+
+    // Region of interest box:
+    vtkNew<vtkPolyDataMapper> roiMapper;
+    vtkNew<vtkActor> roiActor;
   };
 
   volOutline();
@@ -42,6 +47,12 @@ private:
 
   vtkNew<vtkOutlineFilter> m_filter;
   vtkSmartPointer<vtkDataObject> m_outline;
+
+  // Outlines the bounds while the file is still being read:
+  vtkNew<vtkOutlineSource> m_boundsSource;
+
+  vtkNew<vtkOutlineSource> m_roiSource;
+  vtkSmartPointer<vtkDataObject> m_roiOutline;
 };
 
 #endif // VOLOUTLINE_H
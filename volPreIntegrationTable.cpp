@@ -0,0 +1,272 @@
+#include "volPreIntegrationTable.h"
+
+#include "volTransferFunction.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Opacities are clamped below 1 so that the extinction stays finite.
+const double MaximumOpacity = 0.9999;
+
+// Steps per entry of the integrals over the table.
+const int IntegrationSteps = 16;
+
+// Below this, a slab's extinction is treated as zero and its color is the
+// unweighted mean of the colors it spans.
+const double MinimumExtinction = 1e-12;
+
+//------------------------------------------------------------------------------
+// The extinction coefficient giving opacity over unitDistance.
+inline double extinction(double opacity, double unitDistance)
+{
+  const double alpha = std::min(std::max(opacity, 0.), MaximumOpacity);
+  return -std::log(1. - alpha) / unitDistance;
+}
+
+//------------------------------------------------------------------------------
+// Computes the rows [begin, end) of the table, skipping the entries outside
+// the slabs that span the changed entries [firstChanged, lastChanged].
+struct BuildFunctor
+{
+  size_t resolution;
+  size_t firstChanged;
+  size_t lastChanged;
+  double sampleDistance;
+  const float *source;
+  const double *extinction;
+  const double *extinctionIntegral;
+  const double *colorIntegral;
+  const double *weightedColorIntegral;
+  float *table;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    for (vtkIdType row = begin; row < end; ++row)
+      {
+      const size_t back = static_cast<size_t>(row);
+      float *out = this->table + 4 * back * this->resolution;
+      for (size_t front = 0; front < this->resolution; ++front, out += 4)
+        {
+        const size_t lo = std::min(front, back);
+        const size_t hi = std::max(front, back);
+        if (hi < this->firstChanged || lo > this->lastChanged)
+          {
+          continue;
+          }
+
+        double depth;
+        double color[3];
+        if (lo == hi)
+          {
+          depth = this->sampleDistance * this->extinction[lo];
+          for (int c = 0; c < 3; ++c)
+            {
+            color[c] = this->source[4 * lo + c];
+            }
+          }
+        else
+          {
+          // The scalar varies linearly over the slab, so the integrals along
+          // the slab are those over [lo, hi] scaled by the slab's length:
+          const double span = static_cast<double>(hi - lo);
+          const double extinction =
+              this->extinctionIntegral[hi] - this->extinctionIntegral[lo];
+          depth = this->sampleDistance * extinction / span;
+          for (int c = 0; c < 3; ++c)
+            {
+            color[c] = extinction > MinimumExtinction
+                ? (this->weightedColorIntegral[3 * hi + c] -
+                   this->weightedColorIntegral[3 * lo + c]) / extinction
+                : (this->colorIntegral[3 * hi + c] -
+                   this->colorIntegral[3 * lo + c]) / span;
+            }
+          }
+
+        const double alpha = 1. - std::exp(-depth);
+        for (int c = 0; c < 3; ++c)
+          {
+          out[c] = static_cast<float>(color[c] * alpha);
+          }
+        out[3] = static_cast<float>(alpha);
+        }
+      }
+  }
+};
+
+} // end anon namespace
+
+const size_t volPreIntegrationTable::MaximumResolution;
+
+//------------------------------------------------------------------------------
+volPreIntegrationTable::volPreIntegrationTable()
+  : m_resolution(0),
+    m_sampleDistance(0.),
+    m_opacityUnitDistance(0.),
+    m_transferFunctionTime(0),
+    m_updatedEntries(0)
+{
+}
+
+//------------------------------------------------------------------------------
+volPreIntegrationTable::~volPreIntegrationTable()
+{
+}
+
+//------------------------------------------------------------------------------
+bool volPreIntegrationTable::update(const volTransferFunction &tf,
+                                    double sampleDistance,
+                                    double opacityUnitDistance)
+{
+  const size_t resolution = std::min(tf.resolution(), MaximumResolution);
+  const bool rescaled = resolution != m_resolution ||
+      sampleDistance != m_sampleDistance ||
+      opacityUnitDistance != m_opacityUnitDistance;
+  if (!rescaled && tf.timeStamp() == m_transferFunctionTime)
+    {
+    return false;
+    }
+  m_transferFunctionTime = tf.timeStamp();
+
+  // Resample the transfer function, its first and last entries falling on
+  // ours:
+  const std::vector<float> &rgba = tf.table();
+  const size_t entries = rgba.size() / 4;
+  std::vector<float> source(4 * resolution);
+  const double scale = static_cast<double>(entries - 1) / (resolution - 1);
+  for (size_t i = 0; i < resolution; ++i)
+    {
+    const double x = i * scale;
+    const size_t j = std::min(static_cast<size_t>(x), entries - 1);
+    const size_t k = std::min(j + 1, entries - 1);
+    const float t = static_cast<float>(x - j);
+    for (int c = 0; c < 4; ++c)
+      {
+      source[4 * i + c] = (1.f - t) * rgba[4 * j + c] + t * rgba[4 * k + c];
+      }
+    }
+
+  // Only the slabs spanning the entries that changed need to be recomputed:
+  size_t firstChanged = 0;
+  size_t lastChanged = resolution - 1;
+  if (!rescaled)
+    {
+    while (firstChanged < resolution &&
+           std::equal(&source[4 * firstChanged],
+                      &source[4 * firstChanged] + 4,
+                      &m_source[4 * firstChanged]))
+      {
+      ++firstChanged;
+      }
+    if (firstChanged == resolution)
+      {
+      return false;
+      }
+    while (std::equal(&source[4 * lastChanged], &source[4 * lastChanged] + 4,
+                      &m_source[4 * lastChanged]))
+      {
+      --lastChanged;
+      }
+    }
+
+  m_resolution = resolution;
+  m_sampleDistance = sampleDistance;
+  m_opacityUnitDistance = opacityUnitDistance;
+  m_source.swap(source);
+  this->integrate();
+  this->build(firstChanged, lastChanged);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void volPreIntegrationTable::integrate()
+{
+  const size_t n = m_resolution;
+  m_extinction.resize(n);
+  m_extinctionIntegral.resize(n);
+  m_colorIntegral.resize(3 * n);
+  m_weightedColorIntegral.resize(3 * n);
+
+  m_opaqueEntries.resize(n + 1);
+  m_opaqueEntries[0] = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+    m_extinction[i] = extinction(m_source[4 * i + 3], m_opacityUnitDistance);
+    m_opaqueEntries[i + 1] =
+        m_opaqueEntries[i] + (m_extinction[i] > 0. ? 1 : 0);
+    }
+
+  // The opacity is linear between entries, but not the extinction: the
+  // integrals are taken with the midpoint rule over a few steps per entry.
+  m_extinctionIntegral[0] = 0.;
+  std::fill(m_colorIntegral.begin(), m_colorIntegral.begin() + 3, 0.);
+  std::fill(m_weightedColorIntegral.begin(),
+            m_weightedColorIntegral.begin() + 3, 0.);
+  for (size_t i = 1; i < n; ++i)
+    {
+    const float *lo = &m_source[4 * (i - 1)];
+    const float *hi = &m_source[4 * i];
+    double extinctionSum = 0.;
+    double colorSum[3] = { 0., 0., 0. };
+    double weightedColorSum[3] = { 0., 0., 0. };
+    for (int step = 0; step < IntegrationSteps; ++step)
+      {
+      const double t = (step + 0.5) / IntegrationSteps;
+      const double tau = extinction(lo[3] + t * (hi[3] - lo[3]),
+                                    m_opacityUnitDistance);
+      extinctionSum += tau;
+      for (int c = 0; c < 3; ++c)
+        {
+        const double color = lo[c] + t * (hi[c] - lo[c]);
+        colorSum[c] += color;
+        weightedColorSum[c] += color * tau;
+        }
+      }
+
+    m_extinctionIntegral[i] =
+        m_extinctionIntegral[i - 1] + extinctionSum / IntegrationSteps;
+    for (int c = 0; c < 3; ++c)
+      {
+      m_colorIntegral[3 * i + c] =
+          m_colorIntegral[3 * (i - 1) + c] + colorSum[c] / IntegrationSteps;
+      m_weightedColorIntegral[3 * i + c] =
+          m_weightedColorIntegral[3 * (i - 1) + c] +
+          weightedColorSum[c] / IntegrationSteps;
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void volPreIntegrationTable::build(size_t firstChanged, size_t lastChanged)
+{
+  const size_t n = m_resolution;
+  m_table.resize(4 * n * n);
+
+  BuildFunctor functor;
+  functor.resolution = n;
+  functor.firstChanged = firstChanged;
+  functor.lastChanged = lastChanged;
+  functor.sampleDistance = m_sampleDistance;
+  functor.source = m_source.data();
+  functor.extinction = m_extinction.data();
+  functor.extinctionIntegral = m_extinctionIntegral.data();
+  functor.colorIntegral = m_colorIntegral.data();
+  functor.weightedColorIntegral = m_weightedColorIntegral.data();
+  functor.table = m_table.data();
+  vtkSMPTools::For(0, static_cast<vtkIdType>(n), functor);
+
+  m_sampleTable.resize(4 * n);
+  for (size_t i = 0; i < n; ++i)
+    {
+    std::copy(&m_table[4 * (i * n + i)], &m_table[4 * (i * n + i)] + 4,
+              &m_sampleTable[4 * i]);
+    }
+
+  // The slabs entirely before or entirely after the changed entries are kept:
+  const size_t before = firstChanged;
+  const size_t after = n - 1 - lastChanged;
+  m_updatedEntries = n * n - before * before - after * after;
+}
@@ -0,0 +1,101 @@
+#ifndef VOLPREINTEGRATIONTABLE_H
+#define VOLPREINTEGRATIONTABLE_H
+
+#include <cstddef>
+#include <vector>
+
+class volTransferFunction;
+
+/**
+ * @brief The volPreIntegrationTable class holds the color and opacity of
+ * slabs of the volume, for every pair of scalar values at their front and
+ * back faces.
+ *
+ * Sampling the transfer function only at the samples misses the features a
+ * sharp opacity ramp puts between them, so the volume needs many samples per
+ * voxel to render without slab artifacts. Looking up slabs in this table
+ * instead integrates the transfer function over the scalar range each slab
+ * spans (assuming the scalar varies linearly through it), so the sample
+ * distance only needs to follow the data.
+ *
+ * Entries are computed in constant time from prefix integrals of the
+ * extinction and of the extinction-weighted color over the table, so a
+ * rebuild costs one pass over the resolution()^2 entries. When the transfer
+ * function changes over a range of entries only -- a control point being
+ * dragged -- only the slabs spanning that range are recomputed.
+ */
+class volPreIntegrationTable
+{
+public:
+  /** Entries along each axis of the table at most; larger transfer functions
+   *  are resampled. */
+  static const size_t MaximumResolution = 512;
+
+  volPreIntegrationTable();
+  ~volPreIntegrationTable();
+
+  /**
+   * Update the table for slabs of length sampleDistance through tf. Opacities
+   * are for a length of opacityUnitDistance (as in vtkVolumeProperty).
+   * Returns true if the table changed.
+   */
+  bool update(const volTransferFunction &tf, double sampleDistance,
+              double opacityUnitDistance);
+
+  /** Entries along each axis, 0 until the first update(). */
+  size_t resolution() const { return m_resolution; }
+
+  double sampleDistance() const { return m_sampleDistance; }
+
+  /**
+   * Premultiplied RGBA of the slab from front entry front to back entry back,
+   * at table()[4 * (back * resolution() + front)].
+   */
+  const std::vector<float>& table() const { return m_table; }
+
+  /**
+   * Premultiplied RGBA of a single sample at each entry, opacity corrected
+   * for sampleDistance(): the diagonal of table(), for post-classification.
+   */
+  const std::vector<float>& sampleTable() const { return m_sampleTable; }
+
+  /** RGBA of the transfer function at each entry, neither premultiplied nor
+   *  corrected for sampleDistance(). */
+  const std::vector<float>& colors() const { return m_source; }
+
+  /** True if the entries first to last (inclusive) are all fully
+   *  transparent, and so are the slabs between them. */
+  bool transparent(size_t first, size_t last) const
+  {
+    return m_opaqueEntries[last + 1] == m_opaqueEntries[first];
+  }
+
+  /** Entries recomputed by the last update() that changed the table. */
+  size_t updatedEntries() const { return m_updatedEntries; }
+
+private:
+  // Not implemented:
+  volPreIntegrationTable(const volPreIntegrationTable&);
+  volPreIntegrationTable& operator=(const volPreIntegrationTable&);
+
+  void integrate();
+  void build(size_t firstChanged, size_t lastChanged);
+
+  size_t m_resolution;
+  double m_sampleDistance;
+  double m_opacityUnitDistance;
+  unsigned long int m_transferFunctionTime;
+  std::vector<float> m_source; // RGBA of the transfer function, resampled
+  std::vector<double> m_extinction; // per entry, per unit of distance
+  std::vector<size_t> m_opaqueEntries; // before each entry, with extinction
+  // Prefix integrals over the entries, of the extinction, the color and the
+  // extinction-weighted color:
+  std::vector<double> m_extinctionIntegral;
+  std::vector<double> m_colorIntegral;
+  std::vector<double> m_weightedColorIntegral;
+  std::vector<float> m_table;
+  std::vector<float> m_sampleTable;
+  size_t m_updatedEntries;
+};
+
+#endif // VOLPREINTEGRATIONTABLE_H
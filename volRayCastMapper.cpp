@@ -0,0 +1,135 @@
+#include "volRayCastMapper.h"
+
+#include <vtkCamera.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkRayCastImageDisplayHelper.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkVolume.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//------------------------------------------------------------------------------
+int nextPowerOfTwo(int value)
+{
+  int result = 1;
+  while (result < value)
+    {
+    result *= 2;
+    }
+  return result;
+}
+
+} // end anon namespace
+
+vtkStandardNewMacro(volRayCastMapper);
+
+//------------------------------------------------------------------------------
+volRayCastMapper::volRayCastMapper()
+  : m_imageSampleDistance(1.)
+{
+  m_displayHelper->PreMultipliedColorsOn();
+}
+
+//------------------------------------------------------------------------------
+volRayCastMapper::~volRayCastMapper()
+{
+}
+
+//------------------------------------------------------------------------------
+void volRayCastMapper::setImageSampleDistance(double distance)
+{
+  distance = std::max(distance, 1.);
+  if (distance != m_imageSampleDistance)
+    {
+    m_imageSampleDistance = distance;
+    this->Modified();
+    }
+}
+
+//------------------------------------------------------------------------------
+void volRayCastMapper::Render(vtkRenderer *ren, vtkVolume *vol)
+{
+  int viewportWidth;
+  int viewportHeight;
+  int viewportX;
+  int viewportY;
+  ren->GetTiledSizeAndOrigin(&viewportWidth, &viewportHeight,
+                             &viewportX, &viewportY);
+  if (viewportWidth <= 0 || viewportHeight <= 0)
+    {
+    return;
+    }
+
+  // Normalized device coordinates to data coordinates:
+  vtkNew<vtkMatrix4x4> ndcToData;
+  vtkMatrix4x4::Multiply4x4(
+        ren->GetActiveCamera()->GetCompositeProjectionTransformMatrix(
+          static_cast<double>(viewportWidth) / viewportHeight, -1., 1.),
+        vol->GetMatrix(), ndcToData.Get());
+  ndcToData->Invert();
+  std::array<double, 16> matrix;
+  std::copy(&ndcToData->Element[0][0], &ndcToData->Element[0][0] + 16,
+            matrix.begin());
+
+  // The image is uploaded as a texture, whose dimensions are kept powers of
+  // two for older OpenGL implementations:
+  int imageSize[2] = {
+    static_cast<int>(std::ceil(viewportWidth / m_imageSampleDistance)),
+    static_cast<int>(std::ceil(viewportHeight / m_imageSampleDistance)) };
+  int memorySize[2] = { nextPowerOfTwo(imageSize[0]),
+                        nextPowerOfTwo(imageSize[1]) };
+  int imageOrigin[2] = { 0, 0 };
+  m_image.resize(4 * static_cast<size_t>(memorySize[0]) * memorySize[1]);
+
+  // The opaque geometry is drawn before the volumes. Each ray stops at the
+  // nearest depth under its pixels:
+  m_viewportDepth.resize(static_cast<size_t>(viewportWidth) * viewportHeight);
+  m_depth.assign(static_cast<size_t>(imageSize[0]) * imageSize[1], 1.f);
+  if (ren->GetRenderWindow()->GetZbufferData(
+        viewportX, viewportY, viewportX + viewportWidth - 1,
+        viewportY + viewportHeight - 1, m_viewportDepth.data()) != 0)
+    {
+    for (int y = 0; y < viewportHeight; ++y)
+      {
+      const int row = static_cast<int>(y / m_imageSampleDistance);
+      for (int x = 0; x < viewportWidth; ++x)
+        {
+        float &depth = m_depth[row * imageSize[0] +
+                               static_cast<int>(x / m_imageSampleDistance)];
+        depth = std::min(depth, m_viewportDepth[y * viewportWidth + x]);
+        }
+      }
+    }
+
+  m_rayCaster.render(matrix, imageSize[0], imageSize[1], memorySize[0],
+                     m_image.data(), m_depth.data());
+
+  // The image is drawn at the nearest depth of the volume, so that geometry
+  // in front of all of it still hides it, as vtkFixedPointVolumeRayCastMapper
+  // does when intermixing geometry:
+  double bounds[6];
+  vol->GetBounds(bounds);
+  vtkMatrix4x4 *worldToNdc =
+      ren->GetActiveCamera()->GetCompositeProjectionTransformMatrix(
+        static_cast<double>(viewportWidth) / viewportHeight, -1., 1.);
+  double nearest = 1.;
+  for (int corner = 0; corner < 8 && nearest > -1.; ++corner)
+    {
+    const double point[4] = { bounds[corner & 1],
+                              bounds[2 + ((corner >> 1) & 1)],
+                              bounds[4 + ((corner >> 2) & 1)], 1. };
+    double ndc[4];
+    worldToNdc->MultiplyPoint(point, ndc);
+    // A corner behind the eye puts the volume at the near plane:
+    nearest = ndc[3] > 0. ? std::min(nearest, ndc[2] / ndc[3]) : -1.;
+    }
+  const float depth = std::max(static_cast<float>(0.5 * (nearest + 1.)),
+                               0.001f);
+  m_displayHelper->RenderTexture(vol, ren, memorySize, imageSize, imageSize,
+                                 imageOrigin, depth, m_image.data());
+}
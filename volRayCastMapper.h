@@ -0,0 +1,55 @@
+#ifndef VOLRAYCASTMAPPER_H
+#define VOLRAYCASTMAPPER_H
+
+#include "volRayCaster.h"
+
+#include <vtkNew.h>
+#include <vtkVolumeMapper.h>
+
+#include <vector>
+
+class vtkRayCastImageDisplayHelper;
+
+/**
+ * @brief The volRayCastMapper class renders a vtkVolume with a volRayCaster.
+ *
+ * The rays are cast on the CPU for the renderer's active camera, and the image
+ * is drawn over the viewport by a vtkRayCastImageDisplayHelper. Rays stop at
+ * the depth buffer, so that the volume composites with the opaque geometry
+ * drawn before it. The input only
+ * provides the bounds of the volume; the samples come from the ray caster's
+ * volBrickCache.
+ */
+class volRayCastMapper : public vtkVolumeMapper
+{
+public:
+  static volRayCastMapper* New();
+  vtkTypeMacro(volRayCastMapper, vtkVolumeMapper);
+
+  volRayCaster& rayCaster() { return m_rayCaster; }
+  const volRayCaster& rayCaster() const { return m_rayCaster; }
+
+  /** Viewport pixels per ray along each axis; at least 1. */
+  double imageSampleDistance() const { return m_imageSampleDistance; }
+  void setImageSampleDistance(double distance);
+
+  void Render(vtkRenderer *ren, vtkVolume *vol) override;
+
+protected:
+  volRayCastMapper();
+  ~volRayCastMapper() override;
+
+private:
+  // Not implemented:
+  volRayCastMapper(const volRayCastMapper&);
+  void operator=(const volRayCastMapper&);
+
+  volRayCaster m_rayCaster;
+  double m_imageSampleDistance;
+  vtkNew<vtkRayCastImageDisplayHelper> m_displayHelper;
+  std::vector<unsigned char> m_image;
+  std::vector<float> m_viewportDepth;
+  std::vector<float> m_depth; // nearest depth under each ray
+};
+
+#endif // VOLRAYCASTMAPPER_H
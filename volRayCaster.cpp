@@ -0,0 +1,1094 @@
+#include "volRayCaster.h"
+
+#include "volBrickCache.h"
+#include "volGradientVolume.h"
+#include "volPreIntegrationTable.h"
+#include "volSampleTable2D.h"
+
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Rays stop once they are this opaque.
+const float OpaqueAlpha = 0.99f;
+
+// Entries of the table of specular highlights, over the cosine of the angle
+// between the normal and the light.
+const int SpecularEntries = 256;
+
+//------------------------------------------------------------------------------
+// Transforms the homogeneous point (x, y, z, 1) by the row-major matrix m.
+void transformPoint(const double *m, double x, double y, double z,
+                    double out[3])
+{
+  const double w = m[12] * x + m[13] * y + m[14] * z + m[15];
+  for (int i = 0; i < 3; ++i)
+    {
+    out[i] = (m[4 * i] * x + m[4 * i + 1] * y + m[4 * i + 2] * z +
+              m[4 * i + 3]) / w;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Clips the ray origin + t * direction, t in [tEnter, tExit], to the box
+// [lo, hi]. Returns false if nothing is left.
+bool clipToBox(const double origin[3], const double direction[3],
+               const double lo[3], const double hi[3],
+               double &tEnter, double &tExit)
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    if (std::fabs(direction[i]) < 1e-12)
+      {
+      if (origin[i] < lo[i] || origin[i] > hi[i])
+        {
+        return false;
+        }
+      continue;
+      }
+    double t0 = (lo[i] - origin[i]) / direction[i];
+    double t1 = (hi[i] - origin[i]) / direction[i];
+    if (t0 > t1)
+      {
+      std::swap(t0, t1);
+      }
+    tEnter = std::max(tEnter, t0);
+    tExit = std::min(tExit, t1);
+    }
+  return tEnter <= tExit;
+}
+
+//------------------------------------------------------------------------------
+// Clips the ray origin + t * direction, t in [tEnter, tExit], to the half
+// spaces n.x >= offset of the planes. Returns false if nothing is left.
+bool clipToPlanes(const double origin[3], const double direction[3],
+                  const std::vector<std::array<double, 4> > &planes,
+                  double &tEnter, double &tExit)
+{
+  for (size_t p = 0; p < planes.size(); ++p)
+    {
+    const std::array<double, 4> &plane = planes[p];
+    double atOrigin = -plane[3];
+    double slope = 0.;
+    for (int i = 0; i < 3; ++i)
+      {
+      atOrigin += plane[i] * origin[i];
+      slope += plane[i] * direction[i];
+      }
+    if (std::fabs(slope) < 1e-12)
+      {
+      if (atOrigin < 0.)
+        {
+        return false;
+        }
+      continue;
+      }
+    const double t = -atOrigin / slope;
+    if (slope > 0.)
+      {
+      tEnter = std::max(tEnter, t);
+      }
+    else
+      {
+      tExit = std::min(tExit, t);
+      }
+    }
+  return tEnter <= tExit;
+}
+
+//------------------------------------------------------------------------------
+inline unsigned char toByte(float value)
+{
+  return static_cast<unsigned char>(std::min(value, 1.f) * 255.f + 0.5f);
+}
+
+//------------------------------------------------------------------------------
+// A packet of neighbouring rays, stepped together so that their samples
+// fall in the same bricks. The rays are the lanes of the packet, laid out as
+// a structure of arrays: each step computes the positions, cells,
+// interpolation weights, table entries and compositing of all lanes in loops
+// over Size values, which the compiler turns into SIMD instructions. Only
+// fetching the bricks, samples and table entries of the lanes (gathers) goes
+// a lane at a time. Lanes that are done, or skip their brick this step, are
+// masked out of the rest of the step.
+struct Packet
+{
+  enum { Width = 4, Height = 2, Size = Width * Height };
+
+  // Sample s of a lane is at start + s * step, in continuous indices.
+  float startX[Size];
+  float startY[Size];
+  float startZ[Size];
+  float stepX[Size];
+  float stepY[Size];
+  float stepZ[Size];
+  int sample[Size];
+  int samples[Size];
+
+  // The table entry of the previous sample, if it was taken:
+  float front[Size];
+  int haveFront[Size];
+
+  // Direction to the eye (and the light), in world coordinates:
+  float eyeX[Size];
+  float eyeY[Size];
+  float eyeZ[Size];
+
+  // The accumulated premultiplied color:
+  float red[Size];
+  float green[Size];
+  float blue[Size];
+  float alpha[Size];
+
+  // Projections: the maximum, minimum or sum of the scalars so far, and the
+  // samples taken.
+  float value[Size];
+  int count[Size];
+
+  // The current step: positions, cells and bricks of the samples, whether
+  // each lane takes its sample (1) or not (0), the samples interpolated and
+  // their table entries, and their classified contribution.
+  float x[Size];
+  float y[Size];
+  float z[Size];
+  int cx[Size];
+  int cy[Size];
+  int cz[Size];
+  int brick[Size];
+  int offset[Size];
+  const float *data[Size];
+  int taken[Size];
+  float corners[8][Size];
+  float sampled[Size];
+  float entry[Size];
+  float rgba[4][Size];
+};
+
+// What lanes that take no sample read instead of a brick: enough zeros for
+// the corners of a cell at the first sample.
+const int NoSamplesSize = volBrickCache::BrickSamples *
+    (volBrickCache::BrickSamples + 1) + 2;
+const float NoSamples[NoSamplesSize] = {};
+
+//------------------------------------------------------------------------------
+// Linearly interpolates the 1D table of resolution n at the continuous
+// entries u of the lanes.
+inline void lookup(const float *table, int n, const float *u,
+                   float rgba[4][Packet::Size])
+{
+  int i[Packet::Size];
+  float t[Packet::Size];
+  for (int l = 0; l < Packet::Size; ++l)
+    {
+    i[l] = std::min(static_cast<int>(u[l]), n - 2);
+    t[l] = u[l] - static_cast<float>(i[l]);
+    }
+  float lo[4][Packet::Size];
+  float hi[4][Packet::Size];
+  for (int l = 0; l < Packet::Size; ++l)
+    {
+    const float *p = table + 4 * i[l];
+    for (int c = 0; c < 4; ++c)
+      {
+      lo[c][l] = p[c];
+      hi[c][l] = p[c + 4];
+      }
+    }
+  for (int c = 0; c < 4; ++c)
+    {
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      rgba[c][l] = lo[c][l] + t[l] * (hi[c][l] - lo[c][l]);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Bilinearly interpolates the 2D table of columns x rows entries, rows
+// stored one after the other, at the continuous entries (x, y) of the lanes.
+inline void lookup(const float *table, int columns, int rows, const float *x,
+                   const float *y, float rgba[4][Packet::Size])
+{
+  int index[Packet::Size];
+  float tx[Packet::Size];
+  float ty[Packet::Size];
+  for (int l = 0; l < Packet::Size; ++l)
+    {
+    const int i = std::min(static_cast<int>(x[l]), columns - 2);
+    const int j = std::min(static_cast<int>(y[l]), rows - 2);
+    tx[l] = x[l] - static_cast<float>(i);
+    ty[l] = y[l] - static_cast<float>(j);
+    index[l] = 4 * (j * columns + i);
+    }
+  float p0[4][Packet::Size];
+  float p1[4][Packet::Size];
+  float q0[4][Packet::Size];
+  float q1[4][Packet::Size];
+  for (int l = 0; l < Packet::Size; ++l)
+    {
+    const float *p = table + index[l];
+    const float *q = p + 4 * columns;
+    for (int c = 0; c < 4; ++c)
+      {
+      p0[c][l] = p[c];
+      p1[c][l] = p[c + 4];
+      q0[c][l] = q[c];
+      q1[c][l] = q[c + 4];
+      }
+    }
+  for (int c = 0; c < 4; ++c)
+    {
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const float lower = p0[c][l] + tx[l] * (p1[c][l] - p0[c][l]);
+      const float upper = q0[c][l] + tx[l] * (q1[c][l] - q0[c][l]);
+      rgba[c][l] = lower + ty[l] * (upper - lower);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Casts the rays of the image tiles [begin, end).
+struct RenderFunctor
+{
+  const volBrickCache *volume;
+  const volPreIntegrationTable *table;
+  bool preIntegrated;
+  volRayCaster::Projection projection;
+  const volGradientVolume *gradients;
+  bool shading;
+  const volSampleTable2D *table2D;
+  float valueScale2D;     // value entries of table2D per entry of table
+  float magnitudeScale2D; // magnitude entries of table2D per unit of the
+                          // quantized magnitude, times the brick maximum
+  float ambient;
+  float diffuse;
+  float specular;
+  const float *specularTable;
+  const unsigned char *visibleBricks;
+  const double *ndcToData;
+  const float *depth;
+  const std::vector<std::array<double, 4> > *clippingPlanes;
+  const std::array<double, 6> *cropBounds;
+  double scalarOffset;
+  double scalarScale;
+  double indexLo[3];
+  double indexHi[3];
+  int width;
+  int height;
+  int tilesX;
+  int rowStride;
+  unsigned char *rgba;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int tileSize = volRayCaster::TileSize;
+    for (vtkIdType tile = begin; tile < end; ++tile)
+      {
+      const int x0 = static_cast<int>(tile % this->tilesX) * tileSize;
+      const int y0 = static_cast<int>(tile / this->tilesX) * tileSize;
+      const int x1 = std::min(x0 + tileSize, this->width);
+      const int y1 = std::min(y0 + tileSize, this->height);
+      for (int y = y0; y < y1; y += Packet::Height)
+        {
+        for (int x = x0; x < x1; x += Packet::Width)
+          {
+          this->castPacket(x, y, x1, y1);
+          }
+        }
+      }
+  }
+
+  // Sets up the ray through pixel (column, row) in lane l. Returns false if
+  // it misses the (clipped) volume.
+  bool setupRay(int column, int row, Packet &packet, int l) const
+  {
+    // The ray from the near to the far plane, clipped in data coordinates,
+    // then in continuous indices:
+    const double x = 2. * (column + 0.5) / this->width - 1.;
+    const double y = 2. * (row + 0.5) / this->height - 1.;
+    double nearPoint[3];
+    double farPoint[3];
+    transformPoint(this->ndcToData, x, y, -1., nearPoint);
+    transformPoint(this->ndcToData, x, y, 1., farPoint);
+    double ray[3];
+    double length = 0.;
+    for (int i = 0; i < 3; ++i)
+      {
+      ray[i] = farPoint[i] - nearPoint[i];
+      length += ray[i] * ray[i];
+      }
+    length = std::sqrt(length);
+    double tEnter = 0.;
+    double tExit = 1.;
+    if (this->depth && length > 0.)
+      {
+      // Stop at the opaque geometry, on the same ray:
+      const double z = this->depth[row * this->width + column];
+      if (z < 1.)
+        {
+        double depthPoint[3];
+        transformPoint(this->ndcToData, x, y, 2. * z - 1., depthPoint);
+        double t = 0.;
+        for (int i = 0; i < 3; ++i)
+          {
+          t += (depthPoint[i] - nearPoint[i]) * ray[i];
+          }
+        tExit = std::min(tExit, t / (length * length));
+        }
+      }
+    if (length <= 0. ||
+        !clipToPlanes(nearPoint, ray, *this->clippingPlanes, tEnter, tExit))
+      {
+      return false;
+      }
+    if (this->cropBounds)
+      {
+      const double lo[3] = { (*this->cropBounds)[0], (*this->cropBounds)[2],
+                             (*this->cropBounds)[4] };
+      const double hi[3] = { (*this->cropBounds)[1], (*this->cropBounds)[3],
+                             (*this->cropBounds)[5] };
+      if (!clipToBox(nearPoint, ray, lo, hi, tEnter, tExit))
+        {
+        return false;
+        }
+      }
+
+    double origin[3];
+    double direction[3];
+    this->volume->worldToIndex(nearPoint, origin);
+    this->volume->worldToIndex(farPoint, direction);
+    for (int i = 0; i < 3; ++i)
+      {
+      direction[i] -= origin[i];
+      }
+    if (!clipToBox(origin, direction, this->indexLo, this->indexHi, tEnter,
+                   tExit))
+      {
+      return false;
+      }
+
+    packet.eyeX[l] = static_cast<float>(-ray[0] / length);
+    packet.eyeY[l] = static_cast<float>(-ray[1] / length);
+    packet.eyeZ[l] = static_cast<float>(-ray[2] / length);
+
+    const double dt = this->table->sampleDistance() / length;
+    packet.startX[l] = static_cast<float>(origin[0] + tEnter * direction[0]);
+    packet.startY[l] = static_cast<float>(origin[1] + tEnter * direction[1]);
+    packet.startZ[l] = static_cast<float>(origin[2] + tEnter * direction[2]);
+    packet.stepX[l] = static_cast<float>(dt * direction[0]);
+    packet.stepY[l] = static_cast<float>(dt * direction[1]);
+    packet.stepZ[l] = static_cast<float>(dt * direction[2]);
+    packet.samples[l] = static_cast<int>((tExit - tEnter) / dt) + 1;
+    return true;
+  }
+
+  // The samples of lane l, from its current one, that stay in its current
+  // brick.
+  int samplesInBrick(const Packet &packet, int l) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const std::array<int, 3> &dims = this->volume->dimensions();
+    const float position[3] = { packet.x[l], packet.y[l], packet.z[l] };
+    const float step[3] = { packet.stepX[l], packet.stepY[l],
+                            packet.stepZ[l] };
+    const int brick[3] = { packet.cx[l] / B, packet.cy[l] / B,
+                           packet.cz[l] / B };
+    float steps = static_cast<float>(packet.samples[l]);
+    for (int i = 0; i < 3; ++i)
+      {
+      const float lo = static_cast<float>(brick[i] * B);
+      const float hi = static_cast<float>(std::min((brick[i] + 1) * B,
+                                                   dims[i] - 1));
+      if (step[i] > 0.f)
+        {
+        steps = std::min(steps, (hi - position[i]) / step[i]);
+        }
+      else if (step[i] < 0.f)
+        {
+        steps = std::min(steps, (lo - position[i]) / step[i]);
+        }
+      }
+    return std::max(static_cast<int>(steps), 0);
+  }
+
+  // Positions, cells and bricks of the current samples of all lanes.
+  void locate(Packet &packet) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const std::array<int, 3> &dims = this->volume->dimensions();
+    const int lastX = std::max(dims[0] - 2, 0);
+    const int lastY = std::max(dims[1] - 2, 0);
+    const int lastZ = std::max(dims[2] - 2, 0);
+    const int bricksX = this->volume->brickDimensions()[0];
+    const int bricksY = this->volume->brickDimensions()[1];
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const float s = static_cast<float>(packet.sample[l]);
+      packet.x[l] = packet.startX[l] + s * packet.stepX[l];
+      packet.y[l] = packet.startY[l] + s * packet.stepY[l];
+      packet.z[l] = packet.startZ[l] + s * packet.stepZ[l];
+      }
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      packet.cx[l] = std::min(std::max(static_cast<int>(packet.x[l]), 0),
+                              lastX);
+      packet.cy[l] = std::min(std::max(static_cast<int>(packet.y[l]), 0),
+                              lastY);
+      packet.cz[l] = std::min(std::max(static_cast<int>(packet.z[l]), 0),
+                              lastZ);
+      }
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      packet.brick[l] = packet.cx[l] / B + bricksX *
+          (packet.cy[l] / B + bricksY * (packet.cz[l] / B));
+      packet.offset[l] = packet.cx[l] % B + S *
+          (packet.cy[l] % B + S * (packet.cz[l] % B));
+      }
+  }
+
+  // Gathers the corners of the cells of the lanes that take their sample,
+  // and trilinearly interpolates them.
+  void interpolate(Packet &packet) const
+  {
+    const int S = volBrickCache::BrickSamples;
+    const int dj = S;
+    const int dk = S * S;
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const float *p = packet.taken[l]
+          ? packet.data[l] + packet.offset[l] : NoSamples;
+      packet.corners[0][l] = p[0];
+      packet.corners[1][l] = p[1];
+      packet.corners[2][l] = p[dj];
+      packet.corners[3][l] = p[dj + 1];
+      packet.corners[4][l] = p[dk];
+      packet.corners[5][l] = p[dk + 1];
+      packet.corners[6][l] = p[dj + dk];
+      packet.corners[7][l] = p[dj + dk + 1];
+      }
+    const float (*c)[Packet::Size] = packet.corners;
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const float tx = packet.x[l] - static_cast<float>(packet.cx[l]);
+      const float ty = packet.y[l] - static_cast<float>(packet.cy[l]);
+      const float tz = packet.z[l] - static_cast<float>(packet.cz[l]);
+      const float c00 = c[0][l] + tx * (c[1][l] - c[0][l]);
+      const float c10 = c[2][l] + tx * (c[3][l] - c[2][l]);
+      const float c01 = c[4][l] + tx * (c[5][l] - c[4][l]);
+      const float c11 = c[6][l] + tx * (c[7][l] - c[6][l]);
+      const float c0 = c00 + ty * (c10 - c00);
+      const float c1 = c01 + ty * (c11 - c01);
+      packet.sampled[l] = c0 + tz * (c1 - c0);
+      }
+  }
+
+  // Fetches the bricks of the lanes that are not done. Bricks in which
+  // nothing can be seen, nor in the slabs between their samples, are
+  // skipped: their lanes go to the last sample in the brick, which starts
+  // the slab out of it, and take no sample this step.
+  void fetchVisible(Packet &packet) const
+  {
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      packet.taken[l] = 0;
+      if (packet.sample[l] >= packet.samples[l])
+        {
+        continue;
+        }
+      const size_t brick = static_cast<size_t>(packet.brick[l]);
+      const float *data = this->volume->brick(brick);
+      if (!this->visibleBricks[brick])
+        {
+        const int skip = this->samplesInBrick(packet, l);
+        if (skip > 0 || !data)
+          {
+          packet.sample[l] += std::max(skip, 1);
+          packet.haveFront[l] = 0;
+          continue;
+          }
+        }
+      packet.data[l] = data;
+      packet.taken[l] = 1;
+      }
+  }
+
+  // Fetches the bricks of the lanes that are not done. Bricks that cannot
+  // change the projection -- missing ones, and for maximum (minimum)
+  // intensity those whose maximum (minimum) is no more (less) than the
+  // ray's so far -- are skipped, up to the first sample past them.
+  void fetchProjected(Packet &packet) const
+  {
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      packet.taken[l] = 0;
+      if (packet.sample[l] >= packet.samples[l])
+        {
+        continue;
+        }
+      const size_t brick = static_cast<size_t>(packet.brick[l]);
+      const float *data = this->volume->brick(brick);
+      const bool seen = packet.count[l] > 0;
+      if (!data ||
+          (seen && this->projection == volRayCaster::MaximumIntensity &&
+           this->volume->brickMaximum(brick) <= packet.value[l]) ||
+          (seen && this->projection == volRayCaster::MinimumIntensity &&
+           this->volume->brickMinimum(brick) >= packet.value[l]))
+        {
+        packet.sample[l] += 1 + this->samplesInBrick(packet, l);
+        continue;
+        }
+      packet.data[l] = data;
+      packet.taken[l] = 1;
+      }
+  }
+
+  // The continuous table entries of the interpolated samples.
+  void entries(Packet &packet, float last) const
+  {
+    const float offset = static_cast<float>(this->scalarOffset);
+    const float scale = static_cast<float>(this->scalarScale);
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      packet.entry[l] = std::min(std::max(
+        (packet.sampled[l] - offset) * scale, 0.f), last);
+      }
+  }
+
+  // The gradient at the sample nearest to the current one of lane l; null
+  // if its brick has none.
+  const volGradientVolume::Gradient* gradientAt(const Packet &packet,
+                                                int l) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const volGradientVolume::Gradient *data =
+        this->gradients->brick(static_cast<size_t>(packet.brick[l]));
+    if (!data)
+      {
+      return nullptr;
+      }
+    const int cx = packet.cx[l];
+    const int cy = packet.cy[l];
+    const int cz = packet.cz[l];
+    const int lx = cx % B + (packet.x[l] - static_cast<float>(cx) >= 0.5f);
+    const int ly = cy % B + (packet.y[l] - static_cast<float>(cy) >= 0.5f);
+    const int lz = cz % B + (packet.z[l] - static_cast<float>(cz) >= 0.5f);
+    return data + lx + S * (ly + S * lz);
+  }
+
+  // Classifies the samples taken over their value and gradient magnitude
+  // with table2D.
+  void classify2D(Packet &packet) const
+  {
+    float values[Packet::Size];
+    float magnitudes[Packet::Size];
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const volGradientVolume::Gradient *gradient =
+          packet.taken[l] ? this->gradientAt(packet, l) : nullptr;
+      magnitudes[l] = gradient
+          ? gradient->magnitude * this->magnitudeScale2D *
+            this->gradients->brickMaximumMagnitude(
+              static_cast<size_t>(packet.brick[l]))
+          : 0.f;
+      }
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      values[l] = packet.entry[l] * this->valueScale2D;
+      }
+    lookup(this->table2D->table().data(),
+           static_cast<int>(this->table2D->valueEntries()),
+           static_cast<int>(this->table2D->magnitudeEntries()), values,
+           magnitudes, packet.rgba);
+  }
+
+  // Shades the premultiplied colors of the visible samples with their
+  // gradients. Two sided, as the light is at the eye.
+  void shade(Packet &packet) const
+  {
+    float nx[Packet::Size];
+    float ny[Packet::Size];
+    float nz[Packet::Size];
+    int lit[Packet::Size];
+    int anyLit = 0;
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const volGradientVolume::Gradient *gradient =
+          packet.taken[l] && packet.rgba[3][l] > 0.f
+          ? this->gradientAt(packet, l) : nullptr;
+      lit[l] = gradient && gradient->magnitude != 0;
+      float n[3] = { 0.f, 0.f, 0.f };
+      if (lit[l])
+        {
+        volGradientVolume::decodeNormal(gradient->normal, n);
+        }
+      nx[l] = n[0];
+      ny[l] = n[1];
+      nz[l] = n[2];
+      anyLit |= lit[l];
+      }
+    if (!anyLit)
+      {
+      return;
+      }
+    float cosine[Packet::Size];
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      cosine[l] = std::min(std::fabs(nx[l] * packet.eyeX[l] +
+                                     ny[l] * packet.eyeY[l] +
+                                     nz[l] * packet.eyeZ[l]), 1.f);
+      }
+    float highlight[Packet::Size];
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      highlight[l] = this->specularTable[
+          static_cast<int>(cosine[l] * SpecularEntries)];
+      }
+    float light[Packet::Size];
+    float added[Packet::Size];
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      light[l] = this->ambient + this->diffuse * cosine[l];
+      added[l] = this->specular * packet.rgba[3][l] * highlight[l];
+      }
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      light[l] = lit[l] ? light[l] : 1.f;
+      added[l] = lit[l] ? added[l] : 0.f;
+      }
+    for (int c = 0; c < 3; ++c)
+      {
+      for (int l = 0; l < Packet::Size; ++l)
+        {
+        packet.rgba[c][l] = packet.rgba[c][l] * light[l] + added[l];
+        }
+      }
+  }
+
+  // Starts the rays of the packet at (x0, y0), within the tile's (x1, y1).
+  // Returns false if none of them hits the volume.
+  bool startPacket(int x0, int y0, int x1, int y1, Packet &packet) const
+  {
+    bool active = false;
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const int column = x0 + l % Packet::Width;
+      const int row = y0 + l / Packet::Width;
+      packet.startX[l] = packet.startY[l] = packet.startZ[l] = 0.f;
+      packet.stepX[l] = packet.stepY[l] = packet.stepZ[l] = 0.f;
+      packet.eyeX[l] = packet.eyeY[l] = packet.eyeZ[l] = 0.f;
+      packet.sample[l] = 0;
+      packet.samples[l] = 0;
+      packet.haveFront[l] = 0;
+      packet.front[l] = 0.f;
+      packet.red[l] = packet.green[l] = packet.blue[l] = 0.f;
+      packet.alpha[l] = 0.f;
+      packet.value[l] = 0.f;
+      packet.count[l] = 0;
+      if (column < x1 && row < y1 && this->setupRay(column, row, packet, l))
+        {
+        active = true;
+        }
+      }
+    return active;
+  }
+
+  // Writes the pixels of the packet at (x0, y0), within the tile's (x1, y1).
+  void writePacket(int x0, int y0, int x1, int y1, const Packet &packet) const
+  {
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const int column = x0 + l % Packet::Width;
+      const int row = y0 + l / Packet::Width;
+      if (column < x1 && row < y1)
+        {
+        unsigned char *out = this->rgba + 4 * (row * this->rowStride + column);
+        out[0] = toByte(packet.red[l]);
+        out[1] = toByte(packet.green[l]);
+        out[2] = toByte(packet.blue[l]);
+        out[3] = toByte(packet.alpha[l]);
+        }
+      }
+  }
+
+  // Whether any lane of the packet has samples left.
+  static bool anyActive(const Packet &packet)
+  {
+    int active = 0;
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      active |= packet.sample[l] < packet.samples[l];
+      }
+    return active != 0;
+  }
+
+  void castPacket(int x0, int y0, int x1, int y1) const
+  {
+    if (this->projection != volRayCaster::Composite)
+      {
+      this->projectPacket(x0, y0, x1, y1);
+      return;
+      }
+
+    const int n = static_cast<int>(this->table->resolution());
+    const float *entries = this->preIntegrated
+        ? this->table->table().data() : this->table->sampleTable().data();
+    const float last = static_cast<float>(n - 1);
+
+    Packet packet;
+    bool active = this->startPacket(x0, y0, x1, y1, packet);
+    while (active)
+      {
+      this->locate(packet);
+      this->fetchVisible(packet);
+      this->interpolate(packet);
+      this->entries(packet, last);
+
+      // Classification, of the slabs from the previous samples if
+      // pre-integrated. Lanes that take no sample, or have no previous one
+      // for a slab, contribute nothing:
+      const int needsFront = this->preIntegrated && !this->table2D;
+      int contributes[Packet::Size];
+      if (this->table2D)
+        {
+        this->classify2D(packet);
+        }
+      else if (!this->preIntegrated)
+        {
+        lookup(entries, n, packet.entry, packet.rgba);
+        }
+      else
+        {
+        lookup(entries, n, n, packet.front, packet.entry, packet.rgba);
+        }
+      for (int l = 0; l < Packet::Size; ++l)
+        {
+        contributes[l] = packet.taken[l] & (packet.haveFront[l] | !needsFront);
+        }
+      for (int c = 0; c < 4; ++c)
+        {
+        for (int l = 0; l < Packet::Size; ++l)
+          {
+          packet.rgba[c][l] = contributes[l] ? packet.rgba[c][l] : 0.f;
+          }
+        }
+      if (this->shading)
+        {
+        this->shade(packet);
+        }
+
+      // The lanes that took a sample go on to the next one. Front to back
+      // compositing; rays that are (nearly) opaque stop:
+      for (int l = 0; l < Packet::Size; ++l)
+        {
+        packet.front[l] = packet.taken[l] ? packet.entry[l] : packet.front[l];
+        packet.haveFront[l] |= packet.taken[l];
+        packet.sample[l] += packet.taken[l];
+        }
+      for (int l = 0; l < Packet::Size; ++l)
+        {
+        const float transparency = 1.f - packet.alpha[l];
+        packet.red[l] += transparency * packet.rgba[0][l];
+        packet.green[l] += transparency * packet.rgba[1][l];
+        packet.blue[l] += transparency * packet.rgba[2][l];
+        packet.alpha[l] += transparency * packet.rgba[3][l];
+        packet.sample[l] = packet.alpha[l] >= OpaqueAlpha
+            ? packet.samples[l] : packet.sample[l];
+        }
+      active = anyActive(packet);
+      }
+
+    this->writePacket(x0, y0, x1, y1, packet);
+  }
+
+  void projectPacket(int x0, int y0, int x1, int y1) const
+  {
+    const int n = static_cast<int>(this->table->resolution());
+    const float *colors = this->table->colors().data();
+    const float last = static_cast<float>(n - 1);
+    const float highest = static_cast<float>(
+          this->scalarOffset + last / this->scalarScale);
+    const float lowest = static_cast<float>(this->scalarOffset);
+    const int maximum = this->projection == volRayCaster::MaximumIntensity;
+    const int minimum = this->projection == volRayCaster::MinimumIntensity;
+    const int average = this->projection == volRayCaster::AverageIntensity;
+
+    Packet packet;
+    bool active = this->startPacket(x0, y0, x1, y1, packet);
+    while (active)
+      {
+      this->locate(packet);
+      this->fetchProjected(packet);
+      this->interpolate(packet);
+
+      // The first sample of a lane starts its projection; the sum starts at
+      // zero anyway:
+      float projected[Packet::Size];
+      if (maximum)
+        {
+        for (int l = 0; l < Packet::Size; ++l)
+          {
+          const float so = packet.count[l] > 0
+              ? packet.value[l] : packet.sampled[l];
+          projected[l] = std::max(so, packet.sampled[l]);
+          }
+        }
+      else if (minimum)
+        {
+        for (int l = 0; l < Packet::Size; ++l)
+          {
+          const float so = packet.count[l] > 0
+              ? packet.value[l] : packet.sampled[l];
+          projected[l] = std::min(so, packet.sampled[l]);
+          }
+        }
+      else
+        {
+        for (int l = 0; l < Packet::Size; ++l)
+          {
+          projected[l] = packet.value[l] + packet.sampled[l];
+          }
+        }
+
+      // Rays stop once they reach the end of the scalar range:
+      for (int l = 0; l < Packet::Size; ++l)
+        {
+        packet.value[l] = packet.taken[l] ? projected[l] : packet.value[l];
+        packet.count[l] += packet.taken[l];
+        packet.sample[l] += packet.taken[l];
+        const int reached = (packet.count[l] > 0) &
+            (((packet.value[l] >= highest) & maximum) |
+             ((packet.value[l] <= lowest) & minimum));
+        packet.sample[l] = reached ? packet.samples[l] : packet.sample[l];
+        }
+      active = anyActive(packet);
+      }
+
+    // The projected scalar is classified once, without opacity correction.
+    // Other projections than the average divide by one:
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      packet.sampled[l] =
+          packet.value[l] / std::max(packet.count[l] * average, 1);
+      }
+    this->entries(packet, last);
+    lookup(colors, n, packet.entry, packet.rgba);
+    for (int l = 0; l < Packet::Size; ++l)
+      {
+      const float opacity = packet.count[l] > 0 ? packet.rgba[3][l] : 0.f;
+      packet.red[l] = packet.rgba[0][l] * opacity;
+      packet.green[l] = packet.rgba[1][l] * opacity;
+      packet.blue[l] = packet.rgba[2][l] * opacity;
+      packet.alpha[l] = opacity;
+      }
+    this->writePacket(x0, y0, x1, y1, packet);
+  }
+};
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volRayCaster::volRayCaster()
+  : m_shading(false),
+    m_ambient(0.1),
+    m_diffuse(0.7),
+    m_specular(0.2),
+    m_specularPower(10.),
+    m_classification(PreIntegrated),
+    m_projection(Composite),
+    m_cropping(false)
+{
+  m_scalarRange.fill(0.);
+  m_cropBounds.fill(0.);
+}
+
+//------------------------------------------------------------------------------
+volRayCaster::~volRayCaster()
+{
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setVolume(const std::shared_ptr<const volBrickCache> &volume)
+{
+  m_volume = volume;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setTable(
+    const std::shared_ptr<const volPreIntegrationTable> &table)
+{
+  m_table = table;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setGradients(
+    const std::shared_ptr<const volGradientVolume> &gradients)
+{
+  m_gradients = gradients;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setShading(bool shading)
+{
+  m_shading = shading;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setTable2D(
+    const std::shared_ptr<const volSampleTable2D> &table)
+{
+  m_table2D = table;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setLighting(double ambient, double diffuse,
+                               double specular, double specularPower)
+{
+  m_ambient = ambient;
+  m_diffuse = diffuse;
+  m_specular = specular;
+  m_specularPower = specularPower;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setScalarRange(const std::array<double, 2> &range)
+{
+  m_scalarRange = range;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setClassification(Classification classification)
+{
+  m_classification = classification;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setProjection(Projection projection)
+{
+  m_projection = projection;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setClippingPlanes(
+    const std::vector<std::array<double, 4> > &planes)
+{
+  m_clippingPlanes = planes;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::setCropping(bool cropping,
+                               const std::array<double, 6> &bounds)
+{
+  m_cropping = cropping;
+  m_cropBounds = bounds;
+}
+
+//------------------------------------------------------------------------------
+void volRayCaster::render(const std::array<double, 16> &ndcToData, int width,
+                          int height, int rowStride, unsigned char *rgba,
+                          const float *depth) const
+{
+  if (!m_volume || !m_table || m_table->resolution() < 2 ||
+      m_table->sampleDistance() <= 0.)
+    {
+    for (int row = 0; row < height; ++row)
+      {
+      std::memset(rgba + 4 * row * rowStride, 0, 4 * width);
+      }
+    return;
+    }
+
+  const volGradientVolume *gradients =
+      m_gradients && m_gradients->isGradientOf(m_volume)
+      ? m_gradients.get() : nullptr;
+  const volSampleTable2D *table2D =
+      gradients && m_table2D && m_table2D->valueEntries() >= 2 &&
+      m_table2D->magnitudeEntries() >= 2 ? m_table2D.get() : nullptr;
+
+  // Bricks that are missing, or whose whole scalar range is transparent (at
+  // any magnitude, for table2D), are skipped by the composited rays
+  // (projections check the ranges per ray):
+  const size_t n = m_table->resolution();
+  const double scalarScale = m_scalarRange[1] > m_scalarRange[0]
+      ? (n - 1) / (m_scalarRange[1] - m_scalarRange[0]) : 0.;
+  const size_t entries = table2D ? table2D->valueEntries() : n;
+  const double entryScale = scalarScale * (entries - 1) / (n - 1);
+  std::vector<unsigned char> visibleBricks(m_volume->numberOfBricks());
+  for (size_t b = 0; b < visibleBricks.size(); ++b)
+    {
+    const double lo = (m_volume->brickMinimum(b) - m_scalarRange[0]) *
+        entryScale;
+    const double hi = (m_volume->brickMaximum(b) - m_scalarRange[0]) *
+        entryScale;
+    const size_t first = static_cast<size_t>(
+          std::min(std::max(std::floor(lo), 0.), double(entries - 1)));
+    const size_t last = static_cast<size_t>(
+          std::min(std::max(std::ceil(hi), 0.), double(entries - 1)));
+    visibleBricks[b] = m_volume->brick(b) &&
+        !(table2D ? table2D->transparent(first, last)
+                  : m_table->transparent(first, last));
+    }
+
+  RenderFunctor functor;
+  functor.volume = m_volume.get();
+  functor.table = m_table.get();
+  functor.preIntegrated = m_classification == PreIntegrated;
+  functor.projection = m_projection;
+
+  // Highlights for the light at the eye, where the halfway vector is the
+  // light's direction:
+  std::vector<float> specularTable(SpecularEntries + 1);
+  for (int i = 0; i <= SpecularEntries; ++i)
+    {
+    specularTable[i] = static_cast<float>(
+          std::pow(static_cast<double>(i) / SpecularEntries,
+                   m_specularPower));
+    }
+  functor.gradients = gradients;
+  functor.shading = gradients && m_shading;
+  functor.table2D = table2D;
+  functor.valueScale2D = 0.f;
+  functor.magnitudeScale2D = 0.f;
+  if (table2D)
+    {
+    functor.valueScale2D = static_cast<float>(
+          (table2D->valueEntries() - 1.) / (m_table->resolution() - 1.));
+    functor.magnitudeScale2D = gradients->maximumMagnitude() > 0.f
+        ? static_cast<float>((table2D->magnitudeEntries() - 1.) /
+                             (65535. * gradients->maximumMagnitude()))
+        : 0.f;
+    }
+  functor.ambient = static_cast<float>(m_ambient);
+  functor.diffuse = static_cast<float>(m_diffuse);
+  functor.specular = static_cast<float>(m_specular);
+  functor.specularTable = specularTable.data();
+  functor.visibleBricks = visibleBricks.data();
+  functor.ndcToData = ndcToData.data();
+  functor.depth = depth;
+  functor.clippingPlanes = &m_clippingPlanes;
+  functor.cropBounds = m_cropping ? &m_cropBounds : nullptr;
+  functor.scalarOffset = m_scalarRange[0];
+  functor.scalarScale = scalarScale;
+  for (int i = 0; i < 3; ++i)
+    {
+    functor.indexLo[i] = 0.;
+    functor.indexHi[i] = m_volume->dimensions()[i] - 1;
+    }
+  functor.width = width;
+  functor.height = height;
+  functor.tilesX = (width + TileSize - 1) / TileSize;
+  functor.rowStride = rowStride;
+  functor.rgba = rgba;
+
+  // Each tile is a task, so that threads that get cheap tiles (empty or
+  // quickly opaque) take on more of them:
+  const int tilesY = (height + TileSize - 1) / TileSize;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(functor.tilesX) * tilesY, 1,
+                   functor);
+}
@@ -0,0 +1,171 @@
+#ifndef VOLRAYCASTER_H
+#define VOLRAYCASTER_H
+
+#include <array>
+#include <memory>
+#include <vector>
+
+class volBrickCache;
+class volGradientVolume;
+class volPreIntegrationTable;
+class volSampleTable2D;
+
+/**
+ * @brief The volRayCaster class renders a volBrickCache on the CPU.
+ *
+ * Samples are classified with a volPreIntegrationTable, either one at a time
+ * (post-classification, as the VTK mappers do) or as the slabs between
+ * consecutive samples (pre-integration, see volPreIntegrationTable).
+ *
+ * The image is split into tiles of TileSize^2 pixels, rendered in parallel
+ * with vtkSMPTools. Within a tile, rays are cast in packets of 4 x 2 pixels
+ * that step together as the SIMD lanes of the compiler's vectorized loops.
+ * Rays stop once they are nearly opaque or reach the opaque geometry already
+ * drawn, and skip the bricks of the volume whose scalar range is transparent
+ * (from the per-brick minima and maxima of the volBrickCache); such lanes are
+ * masked out until the whole packet is done.
+ *
+ * Given the gradients of the volume (see volGradientVolume), composited
+ * samples can be shaded by a light at the eye, as VTK's mappers do, and
+ * classified over their value and gradient magnitude with a
+ * volSampleTable2D instead.
+ *
+ * Instead of compositing, the rays can project the maximum, minimum or
+ * average scalar along them, classified once per pixel. Maximum (minimum)
+ * intensity rays skip the bricks whose maximum (minimum) cannot change the
+ * projection so far.
+ *
+ * Rendering needs no graphics context: render() writes an image of
+ * premultiplied RGBA bytes for any view, given as the transform from
+ * normalized device coordinates to the volume's data coordinates.
+ * volRayCastMapper displays the images in a VTK renderer, and volRender
+ * renders and times them offscreen.
+ */
+class volRayCaster
+{
+public:
+  /** Pixels along each edge of the tiles the image is split into. */
+  static const int TileSize = 16;
+
+  enum Classification
+    {
+    PostClassified = 0,
+    PreIntegrated
+    };
+
+  enum Projection
+    {
+    Composite = 0,
+    MaximumIntensity,
+    MinimumIntensity,
+    AverageIntensity
+    };
+
+  volRayCaster();
+  ~volRayCaster();
+
+  /** The volume to render. */
+  const std::shared_ptr<const volBrickCache>& volume() const
+  {
+    return m_volume;
+  }
+  void setVolume(const std::shared_ptr<const volBrickCache> &volume);
+
+  /** The table the samples are classified with; its sampleDistance() is
+   *  the distance between samples along the rays, in data coordinates. */
+  const std::shared_ptr<const volPreIntegrationTable>& table() const
+  {
+    return m_table;
+  }
+  void setTable(const std::shared_ptr<const volPreIntegrationTable> &table);
+
+  /** PreIntegrated by default. */
+  Classification classification() const { return m_classification; }
+  void setClassification(Classification classification);
+
+  /** Composite by default. Classification only applies to Composite. */
+  Projection projection() const { return m_projection; }
+  void setProjection(Projection projection);
+
+  /** Gradients of volume(), for shading() and table2D(); null by default.
+   *  Ignored if they are not those of volume(). */
+  const std::shared_ptr<const volGradientVolume>& gradients() const
+  {
+    return m_gradients;
+  }
+  void setGradients(const std::shared_ptr<const volGradientVolume> &gradients);
+
+  /** Shade the composited samples, given gradients(). Off by default. */
+  bool shading() const { return m_shading; }
+  void setShading(bool shading);
+
+  /**
+   * The table to classify the composited samples with instead of table(),
+   * given gradients(); null (the default) for table(). Samples are then
+   * post-classified, and table() still sets the sample distance.
+   */
+  const std::shared_ptr<const volSampleTable2D>& table2D() const
+  {
+    return m_table2D;
+  }
+  void setTable2D(const std::shared_ptr<const volSampleTable2D> &table);
+
+  /** Coefficients of the shading, as in vtkVolumeProperty. */
+  void setLighting(double ambient, double diffuse, double specular,
+                   double specularPower);
+
+  /** Scalars mapped onto the first and last entries of the table. */
+  const std::array<double, 2>& scalarRange() const { return m_scalarRange; }
+  void setScalarRange(const std::array<double, 2> &range);
+
+  /** Planes nx, ny, nz, offset in data coordinates; points x with
+   *  n.x >= offset are rendered. */
+  const std::vector<std::array<double, 4> >& clippingPlanes() const
+  {
+    return m_clippingPlanes;
+  }
+  void setClippingPlanes(const std::vector<std::array<double, 4> > &planes);
+
+  /** If cropping, only xmin, xmax, ymin, ymax, zmin, zmax (in data
+   *  coordinates) is rendered. */
+  bool cropping() const { return m_cropping; }
+  const std::array<double, 6>& cropBounds() const { return m_cropBounds; }
+  void setCropping(bool cropping, const std::array<double, 6> &bounds);
+
+  /**
+   * Render a width x height image, rows from bottom to top, rowStride pixels
+   * apart. ndcToData is the row-major 4x4 matrix taking normalized device
+   * coordinates to data coordinates (the inverse of the projection times the
+   * volume's matrix). Pixels the volume does not cover are zero.
+   *
+   * If depth is not null, it holds width x height window depths in [0, 1],
+   * rows from bottom to top, of the opaque geometry in front of which the
+   * volume is drawn; each ray stops at its depth.
+   */
+  void render(const std::array<double, 16> &ndcToData, int width, int height,
+              int rowStride, unsigned char *rgba,
+              const float *depth = nullptr) const;
+
+private:
+  // Not implemented:
+  volRayCaster(const volRayCaster&);
+  volRayCaster& operator=(const volRayCaster&);
+
+  std::shared_ptr<const volBrickCache> m_volume;
+  std::shared_ptr<const volPreIntegrationTable> m_table;
+  std::shared_ptr<const volGradientVolume> m_gradients;
+  std::shared_ptr<const volSampleTable2D> m_table2D;
+  bool m_shading;
+  double m_ambient;
+  double m_diffuse;
+  double m_specular;
+  double m_specularPower;
+  Classification m_classification;
+  Projection m_projection;
+  std::array<double, 2> m_scalarRange;
+  std::vector<std::array<double, 4> > m_clippingPlanes;
+  bool m_cropping;
+  std::array<double, 6> m_cropBounds;
+};
+
+#endif // VOLRAYCASTER_H
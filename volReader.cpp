@@ -1,16 +1,324 @@
 #include "volReader.h"
 
+#include "volBrickCache.h"
+#include "volBrickFile.h"
+#include "volBrickPager.h"
+#include "volFileWatcher.h"
+#include "volGradientVolume.h"
+#include "volSharedMemory.h"
+#include "volSidecarCache.h"
+#include "volVTIReader.h"
+
+#include <vtkDataArray.h>
 #include <vtkExtractVOI.h>
+#include <vtkFloatArray.h>
 #include <vtkImageData.h>
+#include <vtkInformation.h>
 #include <vtkPassThrough.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSMPTools.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTrivialProducer.h>
 #include <vtkXMLImageDataReader.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+// Samples along the longest axis of the preview read while a file is loading:
+const int PreviewSamples = 64;
+
+//------------------------------------------------------------------------------
+// Builds the reduced data straight from a brick file, matching what
+// vtkExtractVOI with IncludeBoundaryOn() produces: every rate-th sample along
+// each axis, plus the last one. Each brick of the level is read once, in
+// parallel.
+struct ReduceFunctor
+{
+  const volBrickFile *file;
+  int level;
+  std::array<std::vector<int>, 3> sources; // source index of each output index
+  float *output;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const int B = volBrickCache::BrickSize;
+    const int S = volBrickCache::BrickSamples;
+    const std::array<int, 3> &dims = this->file->dimensions(this->level);
+    const std::array<int, 3> &brickDims =
+        this->file->brickDimensions(this->level);
+    const vtkIdType rowLength = static_cast<vtkIdType>(this->sources[0].size());
+    const vtkIdType sliceLength =
+        rowLength * static_cast<vtkIdType>(this->sources[1].size());
+    std::vector<float> brick;
+
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const int bijk[3] = {
+        static_cast<int>(b % brickDims[0]),
+        static_cast<int>((b / brickDims[0]) % brickDims[1]),
+        static_cast<int>(b / (static_cast<vtkIdType>(brickDims[0]) *
+                              brickDims[1])) };
+
+      // Output indices whose source sample this brick owns:
+      std::array<std::vector<int>, 3> outputs;
+      for (int i = 0; i < 3; ++i)
+        {
+        const int first = bijk[i] * B;
+        const int last = bijk[i] == brickDims[i] - 1 ? dims[i] - 1
+                                                     : first + B - 1;
+        for (size_t o = 0; o < this->sources[i].size(); ++o)
+          {
+          if (this->sources[i][o] >= first && this->sources[i][o] <= last)
+            {
+            outputs[i].push_back(static_cast<int>(o));
+            }
+          }
+        }
+      if (outputs[0].empty() || outputs[1].empty() || outputs[2].empty())
+        {
+        continue;
+        }
+
+      brick.resize(static_cast<size_t>(S) * S * S);
+      if (!this->file->readBrick(this->level, static_cast<size_t>(b),
+                                 brick.data()))
+        {
+        continue;
+        }
+
+      for (size_t k = 0; k < outputs[2].size(); ++k)
+        {
+        const int oz = outputs[2][k];
+        const int lz = this->sources[2][oz] - bijk[2] * B;
+        for (size_t j = 0; j < outputs[1].size(); ++j)
+          {
+          const int oy = outputs[1][j];
+          const int ly = this->sources[1][oy] - bijk[1] * B;
+          const float *in = brick.data() + S * (ly + S * lz);
+          float *out = this->output + oy * rowLength + oz * sliceLength;
+          for (size_t i = 0; i < outputs[0].size(); ++i)
+            {
+            const int ox = outputs[0][i];
+            out[ox] = in[this->sources[0][ox] - bijk[0] * B];
+            }
+          }
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+void reduceBrickFile(const volBrickFile &file, int rate, vtkImageData *output)
+{
+  rate = std::max(rate, 1);
+
+  // Start from the coarsest level the file holds that has all the samples
+  // needed, so only its (fewer) bricks are read:
+  ReduceFunctor functor;
+  functor.file = &file;
+  functor.level = file.levelForSampleRate(rate);
+  const int levelRate = rate / volBrickFile::levelSampleRate(functor.level);
+  int outDims[3];
+  double spacing[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    const int last = file.dimensions(functor.level)[i] - 1;
+    for (int s = 0; s < last; s += levelRate)
+      {
+      functor.sources[i].push_back(s);
+      }
+    functor.sources[i].push_back(last);
+    outDims[i] = static_cast<int>(functor.sources[i].size());
+    spacing[i] = file.spacing(functor.level)[i] * levelRate;
+    }
+
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  scalars->SetNumberOfTuples(static_cast<vtkIdType>(outDims[0]) *
+                             outDims[1] * outDims[2]);
+  functor.output = scalars->GetPointer(0);
+
+  vtkSMPTools::For(0,
+                   static_cast<vtkIdType>(file.numberOfBricks(functor.level)),
+                   1, functor);
+
+  output->Initialize();
+  output->SetDimensions(outDims);
+  output->SetOrigin(const_cast<double*>(file.origin().data()));
+  output->SetSpacing(spacing);
+  output->GetPointData()->SetScalars(scalars.Get());
+}
+
+//------------------------------------------------------------------------------
+// Reads every rate-th sample of the whole extent (plus the last one, like
+// reduceBrickFile), one z slice at a time, so only the sampled slices are
+// read from the file. Returns null if the file could not be read.
+vtkSmartPointer<vtkImageData> readStrided(vtkXMLImageDataReader *reader,
+                                          const int whole[6],
+                                          const double origin[3],
+                                          const double spacing[3], int rate)
+{
+  std::array<std::vector<int>, 3> sources;
+  int outDims[3];
+  double outOrigin[3];
+  double outSpacing[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    const int last = whole[2 * i + 1] - whole[2 * i];
+    for (int s = 0; s < last; s += rate)
+      {
+      sources[i].push_back(s);
+      }
+    sources[i].push_back(last);
+    outDims[i] = static_cast<int>(sources[i].size());
+    outOrigin[i] = origin[i] + whole[2 * i] * spacing[i];
+    outSpacing[i] = spacing[i] * rate;
+    }
+
+  const vtkIdType rowLength = outDims[0];
+  const vtkIdType sliceLength = rowLength * outDims[1];
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  scalars->SetNumberOfTuples(sliceLength * outDims[2]);
+  float *out = scalars->GetPointer(0);
+
+  for (int oz = 0; oz < outDims[2]; ++oz)
+    {
+    const int z = whole[4] + sources[2][oz];
+    int slice[6] = { whole[0], whole[1], whole[2], whole[3], z, z };
+    reader->UpdateExtent(slice);
+
+    vtkImageData *input = reader->GetOutput();
+    vtkDataArray *in = input->GetPointData()->GetScalars();
+    int extent[6];
+    input->GetExtent(extent);
+    if (!in || extent[0] > whole[0] || extent[1] < whole[1] ||
+        extent[2] > whole[2] || extent[3] < whole[3] ||
+        extent[4] > z || extent[5] < z)
+      {
+      return nullptr;
+      }
+
+    // The reader may produce more than the requested slice:
+    const vtkIdType inRow = extent[1] - extent[0] + 1;
+    const vtkIdType inSlice = inRow * (extent[3] - extent[2] + 1);
+    const vtkIdType inOffset = (z - extent[4]) * inSlice +
+        (whole[2] - extent[2]) * inRow + (whole[0] - extent[0]);
+    for (int oy = 0; oy < outDims[1]; ++oy)
+      {
+      const vtkIdType inRowOffset = inOffset + sources[1][oy] * inRow;
+      float *outRow = out + oy * rowLength + oz * sliceLength;
+      for (int ox = 0; ox < outDims[0]; ++ox)
+        {
+        outRow[ox] = static_cast<float>(
+              in->GetComponent(inRowOffset + sources[0][ox], 0));
+        }
+      }
+    }
+
+  vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+  output->SetDimensions(outDims);
+  output->SetOrigin(outOrigin);
+  output->SetSpacing(outSpacing);
+  output->GetPointData()->SetScalars(scalars.Get());
+  return output;
+}
+
+//------------------------------------------------------------------------------
+// Installs the gradients computed by task, drops those of data that was
+// replaced, and starts computing the gradients of volume if enabled. Returns
+// true if gradients changed.
+bool updateGradientTask(
+    bool enabled, const std::shared_ptr<const volBrickCache> &volume,
+    std::shared_ptr<const volGradientVolume> &gradients,
+    std::future<std::shared_ptr<const volGradientVolume> > &task)
+{
+  bool changed = false;
+  if (task.valid() &&
+      task.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+    gradients = task.get();
+    changed = true;
+    }
+  if (gradients && (!enabled || !gradients->isGradientOf(volume)))
+    {
+    gradients.reset();
+    changed = true;
+    }
+  if (enabled && volume && !gradients && !task.valid())
+    {
+    task = std::async(std::launch::async,
+      [volume]() -> std::shared_ptr<const volGradientVolume>
+      {
+      return std::make_shared<volGradientVolume>(volume);
+      });
+    }
+  return changed;
+}
+
+//------------------------------------------------------------------------------
+// Installs the cache built by task if it is still of source, and starts
+// building the cache of source if asked for. taskSource keeps the image being
+// bricked alive until the task is done. Returns true if cache changed.
+bool updateBrickCacheTask(
+    bool requested, const vtkSmartPointer<vtkImageData> &source,
+    std::shared_ptr<const volBrickCache> &cache,
+    vtkSmartPointer<vtkImageData> &taskSource,
+    std::future<std::shared_ptr<const volBrickCache> > &task)
+{
+  bool changed = false;
+  if (task.valid() &&
+      task.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+    std::shared_ptr<const volBrickCache> built = task.get();
+    if (taskSource == source && !cache)
+      {
+      cache = built;
+      changed = true;
+      }
+    taskSource = nullptr;
+    }
+  if (requested && source && !cache && !task.valid())
+    {
+    taskSource = source;
+    vtkImageData *image = source.Get();
+    task = std::async(std::launch::async,
+      [image]() -> std::shared_ptr<const volBrickCache>
+      {
+      return std::make_shared<volBrickCache>(image);
+      });
+    }
+  return changed;
+}
+
+} // end anon namespace
 
 //------------------------------------------------------------------------------
 volReader::volReader()
-  : m_sampleRate(4)
+  : m_sampleRate(4),
+    m_reducedSampleRate(4),
+    m_pendingReducedSampleRate(4),
+    m_outOfCore(false),
+    m_brickBudget(volBrickPager::DefaultBudget),
+    m_dataGeneration(0),
+    m_pendingGeneration(0),
+    m_fileWatchingEnabled(true),
+    m_fileWatcher(new volFileWatcher),
+    m_pendingUnchanged(false),
+    m_sidecarCacheEnabled(true),
+    m_previewRequested(false),
+    m_previewing(false),
+    m_hasPreviewBounds(false),
+    m_previewSampleRate(0),
+    m_brickCacheRequested(false),
+    m_reducedBrickCacheRequested(false),
+    m_gradientsEnabled(false)
 {
+  m_previewBounds.fill(0.);
   m_reducer->IncludeBoundaryOn();
 }
 
@@ -31,6 +339,142 @@ vtkImageData *volReader::typedReducedDataObject() const
   return static_cast<vtkImageData*>(m_reducedData.Get());
 }
 
+//------------------------------------------------------------------------------
+std::shared_ptr<const volBrickCache> volReader::brickCache() const
+{
+  if (!m_brickCache)
+    {
+    m_brickCacheRequested = true;
+    }
+  return m_brickCache;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const volBrickCache> volReader::reducedBrickCache() const
+{
+  if (!m_reducedBrickCache)
+    {
+    m_reducedBrickCacheRequested = true;
+    }
+  return m_reducedBrickCache;
+}
+
+//------------------------------------------------------------------------------
+size_t volReader::brickCacheBytes() const
+{
+  return m_brickCache ? m_brickCache->memorySize() : 0;
+}
+
+//------------------------------------------------------------------------------
+size_t volReader::reducedBrickCacheBytes() const
+{
+  return m_reducedBrickCache ? m_reducedBrickCache->memorySize() : 0;
+}
+
+//------------------------------------------------------------------------------
+bool volReader::updateBrickCaches()
+{
+  // Only built while asked for, so that a cache nobody uses since the data
+  // changed is not built:
+  const bool full = updateBrickCacheTask(m_brickCacheRequested.exchange(false),
+                                         m_brickCacheSource, m_brickCache,
+                                         m_brickCacheTaskSource,
+                                         m_brickCacheTask);
+  const bool reduced = updateBrickCacheTask(
+        m_reducedBrickCacheRequested.exchange(false),
+        m_reducedBrickCacheSource, m_reducedBrickCache,
+        m_reducedBrickCacheTaskSource, m_reducedBrickCacheTask);
+  return full || reduced;
+}
+
+//------------------------------------------------------------------------------
+bool volReader::buildingBrickCaches() const
+{
+  return m_brickCacheTask.valid() || m_reducedBrickCacheTask.valid();
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const volGradientVolume> volReader::gradients() const
+{
+  return m_gradients;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<const volGradientVolume> volReader::reducedGradients() const
+{
+  return m_reducedGradients;
+}
+
+//------------------------------------------------------------------------------
+bool volReader::updateGradients()
+{
+  // Gradients are computed from the bricks:
+  if (m_gradientsEnabled)
+    {
+    this->brickCache();
+    this->reducedBrickCache();
+    }
+
+  // Out of core, the full resolution bricks are paged in as needed and
+  // brickCache() is null: only the reduced data has gradients then.
+  const bool full = updateGradientTask(m_gradientsEnabled, m_brickCache,
+                                       m_gradients, m_gradientTask);
+  const bool reduced = updateGradientTask(m_gradientsEnabled,
+                                          m_reducedBrickCache,
+                                          m_reducedGradients,
+                                          m_reducedGradientTask);
+  return full || reduced;
+}
+
+//------------------------------------------------------------------------------
+bool volReader::computingGradients() const
+{
+  return m_gradientTask.valid() || m_reducedGradientTask.valid();
+}
+
+//------------------------------------------------------------------------------
+void volReader::setBrickBudget(size_t bytes)
+{
+  m_brickBudget = bytes;
+  if (m_brickPager)
+    {
+    m_brickPager->setBudget(bytes);
+    }
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<volBrickPager> volReader::brickPager() const
+{
+  return m_brickPager;
+}
+
+//------------------------------------------------------------------------------
+void volReader::setTimeSeries(const std::shared_ptr<volTimeSeries> &timeSeries)
+{
+  m_timeSeries = timeSeries;
+}
+
+//------------------------------------------------------------------------------
+vtkPolyData *volReader::speculativeContour(double value) const
+{
+  if (m_reducedStep)
+    {
+    auto it = m_reducedStep->contours.find(value);
+    if (it != m_reducedStep->contours.end())
+      {
+      return it->second;
+      }
+    }
+  auto it = m_cachedContours.find(value);
+  return it != m_cachedContours.end() ? it->second.Get() : nullptr;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<volSidecarCache> volReader::sidecarCache() const
+{
+  return m_sidecarCache;
+}
+
 //------------------------------------------------------------------------------
 std::array<int, 3> volReader::dimensions() const
 {
@@ -46,10 +490,19 @@ std::array<int, 3> volReader::dimensions() const
 std::array<double, 2> volReader::scalarRange() const
 {
   std::array<double, 2> result{0., 0.};
-  if (m_dataObject)
+  if (m_brickPager)
+    {
+    result = m_brickPager->file().scalarRange();
+    }
+  else if (m_dataObject)
     {
     this->typedDataObject()->GetScalarRange(result.data());
     }
+  else if (m_reducedData)
+    {
+    // Only the preview has been read so far:
+    this->typedReducedDataObject()->GetScalarRange(result.data());
+    }
   return result;
 }
 
@@ -67,6 +520,40 @@ std::array<double, 3> volReader::spacing() const
 //------------------------------------------------------------------------------
 void volReader::syncReaderState()
 {
+  // Only worth it while nothing is shown yet. Time series steps are usually
+  // decoded ahead of time:
+  m_previewRequested = !m_dataObject && !m_fileName.empty() && !m_timeSeries;
+
+  // Attach to the simulation's segment once it exists, and again when a
+  // restarted simulation replaces it:
+  if (!m_sharedMemoryName.empty() &&
+      (!m_sharedMemory || m_sharedMemory->isReplaced()))
+    {
+    std::shared_ptr<volSharedMemory> memory =
+        volSharedMemory::attach(m_sharedMemoryName);
+    if (memory)
+      {
+      m_sharedMemory = memory;
+      m_dataGeneration = 0;
+      }
+    }
+
+  // Reread the file shown when it is rewritten, comparing the new data with
+  // the current one:
+  const bool watch = m_fileWatchingEnabled && !m_timeSeries &&
+      !m_sharedMemory && m_dataObject && m_dataFileName == m_fileName;
+  m_fileWatcher->setFileName(watch ? m_dataFileName : std::string());
+  m_reloadData = nullptr;
+  m_reloadBrickCache.reset();
+  m_reloadBrickHashes.clear();
+  if (watch && m_fileWatcher->changed())
+    {
+    m_reader->Modified();
+    m_reloadData = this->typedDataObject();
+    m_reloadBrickCache = m_brickCache;
+    m_reloadBrickHashes = m_brickHashes;
+    }
+
   if (m_fileName.empty())
     {
     // Render a simple cube. The call to AllocateScalars always modifies the
@@ -92,6 +579,13 @@ void volReader::syncReaderState()
 //------------------------------------------------------------------------------
 bool volReader::dataNeedsUpdate()
 {
+  if (m_sharedMemory)
+    {
+    // The simulation publishes a step by bumping the generation:
+    const uint64_t generation = m_sharedMemory->generation();
+    return generation > 0 && (!m_dataObject || generation != m_dataGeneration);
+    }
+
   if (m_dataObject)
     {
     if (m_dataObject->GetMTime() < m_selector->GetMTime())
@@ -105,8 +599,7 @@ bool volReader::dataNeedsUpdate()
       return true;
       }
 
-    if (!m_fileName.empty() &&
-        m_dataObject->GetMTime() < m_reader->GetMTime())
+    if (!m_fileName.empty() && m_readTime.GetMTime() < m_reader->GetMTime())
       { // File needs to be read
       return true;
       }
@@ -128,7 +621,123 @@ void volReader::executeReaderInformation()
 //------------------------------------------------------------------------------
 void volReader::executeReaderData()
 {
+  m_pendingFileName = m_fileName;
+  m_pendingUnchanged = false;
+  m_pendingBrickHashes.clear();
+  m_pendingBrickCache.reset();
+  m_pendingBrickPager.reset();
+  m_pendingStep.reset();
+  m_pendingSidecarCache.reset();
+  m_pendingDecoded = nullptr;
+  m_pendingGeneration = 0;
+
+  // Steps in shared memory are used in place, and only bricked if asked for:
+  if (m_sharedMemory)
+    {
+    m_pendingDecoded = m_sharedMemory->acquire(m_pendingGeneration);
+    if (m_pendingDecoded)
+      {
+      return;
+      }
+    }
+
+  // Time series steps are usually decoded ahead of time, and like steps in
+  // shared memory only bricked if asked for:
+  if (m_timeSeries && !m_fileName.empty())
+    {
+    m_pendingStep = m_timeSeries->load(m_fileName);
+    if (m_pendingStep)
+      {
+      return;
+      }
+    }
+
+  if (m_sidecarCacheEnabled && !m_timeSeries && !m_fileName.empty())
+    {
+    m_pendingSidecarCache = std::make_shared<volSidecarCache>(m_fileName);
+    if (!m_pendingSidecarCache->isValid())
+      {
+      m_pendingSidecarCache.reset();
+      }
+    }
+
+  if (m_previewRequested)
+    {
+    this->readPreview();
+    }
+
+  if (m_outOfCore && !m_timeSeries && !m_fileName.empty())
+    {
+    const std::string brickFileName = volBrickFile::defaultFileName(m_fileName);
+    if (!volBrickFile::isUpToDate(m_fileName, brickFileName))
+      {
+      std::cout << "Converting " << m_fileName << " to " << brickFileName
+                << "..." << std::endl;
+      volBrickFile::convert(m_fileName, brickFileName);
+      }
+
+    std::unique_ptr<volBrickFile> file(new volBrickFile);
+    if (file->open(brickFileName))
+      {
+      m_pendingImage->Initialize();
+      m_pendingImage->SetDimensions(
+            const_cast<int*>(file->dimensions().data()));
+      m_pendingImage->SetOrigin(const_cast<double*>(file->origin().data()));
+      m_pendingImage->SetSpacing(const_cast<double*>(file->spacing().data()));
+      m_pendingBrickPager = std::make_shared<volBrickPager>(std::move(file),
+                                                            m_brickBudget);
+      m_pendingBrickCache.reset();
+      return;
+      }
+
+    std::cerr << "Out-of-core mode unavailable, reading " << m_fileName
+              << " into memory." << std::endl;
+    }
+
+  // Decode the file on all cores if its layout allows, let VTK read it
+  // otherwise:
+  if (!m_fileName.empty())
+    {
+    m_pendingDecoded = volVTIReader::read(m_fileName);
+    if (m_pendingDecoded)
+      {
+      this->compareReload(m_pendingDecoded);
+      return;
+      }
+    }
+
   m_selector->Update();
+  this->compareReload(
+        vtkImageData::SafeDownCast(m_selector->GetOutputDataObject(0)));
+}
+
+//------------------------------------------------------------------------------
+void volReader::compareReload(vtkImageData *image)
+{
+  // The data is only bricked here when the file was rewritten, to compare it
+  // with the current data; the bricks are kept then:
+  m_pendingUnchanged = false;
+  m_pendingBrickHashes.clear();
+  if (!m_reloadData || !image || !image->GetPointData()->GetScalars())
+    {
+    return;
+    }
+
+  m_pendingBrickCache = std::make_shared<volBrickCache>(image);
+  m_pendingBrickHashes = m_pendingBrickCache->brickHashes();
+  if (m_reloadBrickHashes.empty())
+    {
+    if (!m_reloadBrickCache)
+      {
+      m_reloadBrickCache = std::make_shared<volBrickCache>(m_reloadData);
+      }
+    m_reloadBrickHashes = m_reloadBrickCache->brickHashes();
+    }
+  m_pendingUnchanged =
+      m_pendingBrickCache->dimensions() == m_reloadBrickCache->dimensions() &&
+      m_pendingBrickCache->origin() == m_reloadBrickCache->origin() &&
+      m_pendingBrickCache->spacing() == m_reloadBrickCache->spacing() &&
+      m_pendingBrickHashes == m_reloadBrickHashes;
 }
 
 //------------------------------------------------------------------------------
@@ -140,12 +749,155 @@ void volReader::updateInformationCache()
 //------------------------------------------------------------------------------
 void volReader::updateDataCache()
 {
-  m_dataObject.TakeReference(m_selector->GetOutput()->NewInstance());
-  m_dataObject->ShallowCopy(m_selector->GetOutput());
+  m_readTime.Modified();
+  m_brickHashes = m_pendingBrickHashes;
+  m_pendingBrickHashes.clear();
+  if (m_pendingUnchanged)
+    {
+    // The file was rewritten with the same content: keep the data, so that
+    // nothing derived from it is recomputed.
+    m_pendingUnchanged = false;
+    m_pendingBrickCache.reset();
+    m_pendingDecoded = nullptr;
+    m_pendingSidecarCache.reset();
+    return;
+    }
+
+  vtkDataObject *output = m_selector->GetOutput();
+  if (m_pendingStep)
+    {
+    output = m_pendingStep->data;
+    }
+  else if (m_pendingBrickPager)
+    {
+    output = m_pendingImage.Get();
+    }
+  else if (m_pendingDecoded)
+    {
+    output = m_pendingDecoded;
+    }
+  m_dataObject.TakeReference(output->NewInstance());
+  m_dataObject->ShallowCopy(output);
+  m_brickCache = m_pendingBrickCache;
+  m_pendingBrickCache.reset();
+  m_brickPager = m_pendingBrickPager;
+  m_pendingBrickPager.reset();
+  m_brickCacheSource = m_brickCache || m_brickPager ? nullptr
+                                                    : this->typedDataObject();
+  m_step = m_pendingStep;
+  m_pendingStep.reset();
+  m_decoded = m_pendingDecoded;
+  m_pendingDecoded = nullptr;
+  m_sidecarCache = m_pendingSidecarCache;
+  m_pendingSidecarCache.reset();
+  m_dataFileName = m_pendingFileName;
+  m_dataGeneration = m_pendingGeneration;
 
   std::array<double, 6> bounds;
   this->typedDataObject()->GetBounds(bounds.data());
   m_bounds.SetBounds(bounds.data());
+
+  // A preview not picked up by now is of no use:
+  std::lock_guard<std::mutex> lock(m_previewMutex);
+  m_hasPreviewBounds = false;
+  m_preview = nullptr;
+  m_previewBrickCache.reset();
+}
+
+//------------------------------------------------------------------------------
+void volReader::readPreview()
+{
+  // The reduced data stored by an earlier run is the best preview there is:
+  vtkSmartPointer<vtkImageData> preview;
+  int rate = m_sampleRate;
+  if (m_pendingSidecarCache)
+    {
+    preview = m_pendingSidecarCache->reducedData(rate);
+    }
+
+  if (!preview)
+    {
+    vtkNew<vtkXMLImageDataReader> reader;
+    reader->SetFileName(m_fileName.c_str());
+    reader->UpdateInformation();
+
+    vtkInformation *outInfo = reader->GetOutputInformation(0);
+    if (!outInfo->Has(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()))
+      {
+      return;
+      }
+    int whole[6];
+    double origin[3] = { 0., 0., 0. };
+    double spacing[3] = { 1., 1., 1. };
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), whole);
+    if (outInfo->Has(vtkDataObject::ORIGIN()))
+      {
+      outInfo->Get(vtkDataObject::ORIGIN(), origin);
+      }
+    if (outInfo->Has(vtkDataObject::SPACING()))
+      {
+      outInfo->Get(vtkDataObject::SPACING(), spacing);
+      }
+
+    // The outline can be shown and the view centered right away:
+    int maxDim = 1;
+    {
+    std::lock_guard<std::mutex> lock(m_previewMutex);
+    for (int i = 0; i < 3; ++i)
+      {
+      m_previewBounds[2 * i] = origin[i] + whole[2 * i] * spacing[i];
+      m_previewBounds[2 * i + 1] = origin[i] + whole[2 * i + 1] * spacing[i];
+      maxDim = std::max(maxDim, whole[2 * i + 1] - whole[2 * i] + 1);
+      }
+    m_hasPreviewBounds = true;
+    }
+
+    // Read no more than PreviewSamples slices. Sampling at a multiple of the
+    // sample rate keeps the preview's samples on those of the reduced data.
+    const int minRate = (maxDim + PreviewSamples - 1) / PreviewSamples;
+    rate = std::max(rate, 1);
+    rate *= (minRate + rate - 1) / rate;
+    preview = readStrided(reader.Get(), whole, origin, spacing, rate);
+    if (!preview)
+      {
+      return;
+      }
+    }
+
+  std::shared_ptr<const volBrickCache> brickCache =
+      std::make_shared<volBrickCache>(preview);
+
+  std::lock_guard<std::mutex> lock(m_previewMutex);
+  preview->GetBounds(m_previewBounds.data());
+  m_hasPreviewBounds = true;
+  m_preview = preview;
+  m_previewBrickCache = brickCache;
+  m_previewSampleRate = rate;
+}
+
+//------------------------------------------------------------------------------
+bool volReader::updatePreview()
+{
+  std::lock_guard<std::mutex> lock(m_previewMutex);
+  bool changed = false;
+  if (m_hasPreviewBounds && !m_dataObject)
+    {
+    m_bounds.SetBounds(m_previewBounds.data());
+    changed = true;
+    }
+  m_hasPreviewBounds = false;
+
+  if (m_preview && !m_dataObject && !m_reducedData)
+    {
+    m_reducedData = m_preview.Get();
+    m_reducedBrickCache = m_previewBrickCache;
+    m_reducedSampleRate = m_previewSampleRate;
+    m_previewing = true;
+    changed = true;
+    }
+  m_preview = nullptr;
+  m_previewBrickCache.reset();
+  return changed;
 }
 
 //------------------------------------------------------------------------------
@@ -153,7 +905,21 @@ void volReader::syncReducerState()
 {
   std::array<int, 3> dims(this->dimensions());
 
-  m_reducer->SetInputConnection(m_selector->GetOutputPort());
+  // A decoded time step or file was not read through the selector:
+  m_reducerStep = m_step;
+  m_reducerSidecarCache = m_sidecarCache;
+  if (m_step)
+    {
+    m_reducer->SetInputData(m_step->data);
+    }
+  else if (m_decoded)
+    {
+    m_reducer->SetInputData(m_decoded);
+    }
+  else
+    {
+    m_reducer->SetInputConnection(m_selector->GetOutputPort());
+    }
   m_reducer->SetSampleRate(m_sampleRate, m_sampleRate, m_sampleRate);
   m_reducer->SetVOI(0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1);
 }
@@ -166,7 +932,7 @@ bool volReader::reducerNeedsUpdate()
     return false;
     }
 
-  if (!m_reducedData)
+  if (!m_reducedData || m_previewing)
     {
     return true;
     }
@@ -179,14 +945,76 @@ bool volReader::reducerNeedsUpdate()
 //------------------------------------------------------------------------------
 void volReader::executeReducer()
 {
-  m_reducer->Update();
+  m_pendingReducedStep.reset();
+  m_pendingReducedBrickCache.reset();
+  m_pendingCachedReduced = nullptr;
+  m_pendingCachedContours.clear();
+  m_pendingReducedSampleRate = m_sampleRate;
+  if (m_reducerStep && m_reducerStep->sampleRate == m_sampleRate &&
+      m_reducerStep->reducedData)
+    {
+    m_pendingReducedStep = m_reducerStep;
+    return;
+    }
+
+  // Reuse what an earlier run derived from the same file:
+  if (m_reducerSidecarCache)
+    {
+    m_pendingCachedContours = m_reducerSidecarCache->isosurfaces(m_sampleRate);
+    m_pendingCachedReduced = m_reducerSidecarCache->reducedData(m_sampleRate);
+    if (m_pendingCachedReduced)
+      {
+      return;
+      }
+    }
+
+  vtkImageData *output = nullptr;
+  if (m_brickPager)
+    {
+    reduceBrickFile(m_brickPager->file(), m_sampleRate, m_pendingReduced.Get());
+    output = m_pendingReduced.Get();
+    }
+  else
+    {
+    m_reducer->Update();
+    output = m_reducer->GetOutput();
+    }
+
+  if (m_reducerSidecarCache)
+    {
+    m_reducerSidecarCache->storeReducedData(m_sampleRate, output);
+    }
 }
 
 //------------------------------------------------------------------------------
 void volReader::updateReducedData()
 {
-  m_reducedData = m_reducer->GetOutput()->NewInstance();
-  m_reducedData->ShallowCopy(m_reducer->GetOutput());
+  vtkImageData *output = m_reducer->GetOutput();
+  if (m_pendingReducedStep)
+    {
+    output = m_pendingReducedStep->reducedData;
+    }
+  else if (m_pendingCachedReduced)
+    {
+    output = m_pendingCachedReduced;
+    }
+  else if (m_brickPager)
+    {
+    output = m_pendingReduced.Get();
+    }
+  m_reducedData = output->NewInstance();
+  m_reducedData->ShallowCopy(output);
+  m_reducedBrickCache = m_pendingReducedBrickCache;
+  m_pendingReducedBrickCache.reset();
+  m_reducedBrickCacheSource =
+      m_reducedBrickCache ? nullptr : this->typedReducedDataObject();
+  m_reducedStep = m_pendingReducedStep;
+  m_pendingReducedStep.reset();
+  m_pendingCachedReduced = nullptr;
+  m_cachedContours.swap(m_pendingCachedContours);
+  m_pendingCachedContours.clear();
+  m_reducedSampleRate = m_pendingReducedSampleRate;
+  m_previewing = false;
 }
 
 //------------------------------------------------------------------------------
@@ -4,12 +4,32 @@
 #include <vvReader.h>
 
 #include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+
+#include "volTimeSeries.h"
 
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
+class volBrickCache;
+class volBrickPager;
+class volFileWatcher;
+class volGradientVolume;
+class volSharedMemory;
+class volSidecarCache;
 class vtkExtractVOI;
 class vtkImageData;
 class vtkPassThrough;
+class vtkPolyData;
 class vtkTrivialProducer;
 class vtkXMLImageDataReader;
 
@@ -22,6 +42,136 @@ public:
   vtkImageData* typedDataObject() const;
   vtkImageData* typedReducedDataObject() const;
 
+  /**
+   * Read-only bricked copies of dataObject() and reducedDataObject(), shared
+   * by the pipelines that resample the volume. Unless the data came with its
+   * bricks, they are only built once something asks for them: these return
+   * nullptr until then, and asking starts building them in the background
+   * (see updateBrickCaches()). Data that is only contoured, sliced or
+   * rendered by VTK is thus never copied.
+   */
+  std::shared_ptr<const volBrickCache> brickCache() const;
+  std::shared_ptr<const volBrickCache> reducedBrickCache() const;
+
+  /** Bytes of the brick caches built so far, without asking for them. */
+  size_t brickCacheBytes() const;
+  size_t reducedBrickCacheBytes() const;
+
+  /**
+   * Start building the brick caches asked for since the last call, and
+   * install those built. Call on the main thread, after update(). Returns
+   * true if anything changed.
+   */
+  bool updateBrickCaches();
+
+  /** True while brick caches are built in the background. */
+  bool buildingBrickCaches() const;
+
+  /**
+   * Gradients of brickCache() and reducedBrickCache() (see volGradientVolume),
+   * for shading and for transfer functions over gradient magnitude. Once
+   * enabled, they are computed in the background whenever the data changes,
+   * and are null until then. Off by default, as they take as much memory as
+   * the bricks.
+   */
+  bool gradientsEnabled() const { return m_gradientsEnabled; }
+  void setGradientsEnabled(bool enabled) { m_gradientsEnabled = enabled; }
+  std::shared_ptr<const volGradientVolume> gradients() const;
+  std::shared_ptr<const volGradientVolume> reducedGradients() const;
+
+  /**
+   * Start computing the gradients of new data, and install those computed.
+   * Call on the main thread, after update(). Returns true if anything
+   * changed.
+   */
+  bool updateGradients();
+
+  /** True while gradients are computed in the background. */
+  bool computingGradients() const;
+
+  /**
+   * Out-of-core mode. The file is converted once to a brick file next to it
+   * (see volBrickFile) and the full resolution data is paged in through
+   * brickPager() as pipelines need it. dataObject() then only describes the
+   * geometry of the volume and holds no scalars, and brickCache() is null.
+   * The reduced data is built from the coarsest level of the brick file that
+   * holds its samples and stays in memory. Files can be converted ahead of
+   * time with volConvert. Must be set before the file is read. Ignored for
+   * time series.
+   */
+  bool outOfCore() const { return m_outOfCore; }
+  void setOutOfCore(bool outOfCore) { m_outOfCore = outOfCore; }
+
+  /** Bytes of full resolution bricks kept in memory in out-of-core mode. */
+  size_t brickBudget() const { return m_brickBudget; }
+  void setBrickBudget(size_t bytes);
+
+  /** The full resolution data in out-of-core mode, null otherwise. */
+  std::shared_ptr<volBrickPager> brickPager() const;
+
+  /**
+   * Time series whose decoded steps are used instead of reading the file,
+   * when the file name is one of its steps. See volTimeSeries.
+   */
+  const std::shared_ptr<volTimeSeries>& timeSeries() const
+  {
+    return m_timeSeries;
+  }
+  void setTimeSeries(const std::shared_ptr<volTimeSeries> &timeSeries);
+
+  /**
+   * Shared-memory segment in which a running simulation publishes its steps
+   * (see volSharedMemory), read instead of the file when set. The segment is
+   * attached to once the simulation creates it, and the data is updated,
+   * without copying the step, whenever the simulation publishes a new one.
+   * A step's buffer stays held for as long as anything uses its scalars.
+   */
+  const std::string& sharedMemoryName() const { return m_sharedMemoryName; }
+  void setSharedMemoryName(const std::string &name)
+  {
+    m_sharedMemoryName = name;
+  }
+
+  /** Generation of the shared-memory step the data came from, or 0. */
+  uint64_t dataGeneration() const { return m_dataGeneration; }
+
+  /**
+   * Read the file again when another program rewrites it. The file is reread
+   * in the background while the current data stays in use, and the data
+   * object is only replaced (and so pipelines only re-execute) if some brick
+   * of the volume actually changed. On by default; not used for time series
+   * and shared memory.
+   */
+  bool fileWatchingEnabled() const { return m_fileWatchingEnabled; }
+  void setFileWatchingEnabled(bool enabled)
+  {
+    m_fileWatchingEnabled = enabled;
+  }
+
+  /** The file the current data object was read from. */
+  const std::string& dataFileName() const { return m_dataFileName; }
+
+  /**
+   * The isosurface of reducedDataObject() for value, if it was computed ahead
+   * of time by the time series or in an earlier run (see sidecarCache()).
+   * May return nullptr.
+   */
+  vtkPolyData* speculativeContour(double value) const;
+
+  /**
+   * Keep data derived from the file (reduced data, histogram, isosurfaces) in
+   * a directory next to it, so that reopening the file is fast. See
+   * volSidecarCache. On by default; not used for time series.
+   */
+  bool sidecarCacheEnabled() const { return m_sidecarCacheEnabled; }
+  void setSidecarCacheEnabled(bool enabled)
+  {
+    m_sidecarCacheEnabled = enabled;
+  }
+
+  /** The cache of the file the data was read from. May return nullptr. */
+  std::shared_ptr<volSidecarCache> sidecarCache() const;
+
   std::array<int, 3> dimensions() const;
   std::array<double, 3> spacing() const;
   std::array<double, 2> scalarRange() const;
@@ -29,6 +179,22 @@ public:
   int sampleRate() const;
   void setSampleRate(int sampleRate);
 
+  /** The sample rate reducedDataObject() was made with. */
+  int reducedSampleRate() const { return m_reducedSampleRate; }
+
+  /**
+   * While a file is first read, a coarse preview is made from its reduced
+   * data stored by an earlier run (see sidecarCache()) or from a strided read
+   * of a few slices. This installs it as reducedDataObject(), and sets
+   * bounds() as soon as the header has been read, so that something can be
+   * shown before the full read and the reducer complete. Call on the main
+   * thread, before update(). Returns true if anything changed.
+   */
+  bool updatePreview();
+
+  /** True while reducedDataObject() is the preview. */
+  bool previewing() const { return m_previewing; }
+
 private:
   void syncReaderState() override;
   bool dataNeedsUpdate() override;
@@ -42,6 +208,9 @@ private:
   void executeReducer() override;
   void updateReducedData() override;
 
+  void readPreview();
+  void compareReload(vtkImageData *image);
+
 private:
   // The actual file reader:
   vtkNew<vtkXMLImageDataReader> m_reader;
@@ -56,8 +225,105 @@ private:
   // The low-res data producer:
   vtkNew<vtkExtractVOI> m_reducer;
 
-  // Downsample rate for data reducer.
+  // Downsample rate for data reducer, requested and current.
   int m_sampleRate;
+  int m_reducedSampleRate;
+  int m_pendingReducedSampleRate;
+
+  // Out-of-core state. m_pendingImage is the geometry-only data object and
+  // m_pendingReduced the strided data, produced on the worker threads.
+  bool m_outOfCore;
+  size_t m_brickBudget;
+  std::shared_ptr<volBrickPager> m_brickPager;
+  std::shared_ptr<volBrickPager> m_pendingBrickPager;
+  vtkNew<vtkImageData> m_pendingImage;
+  vtkNew<vtkImageData> m_pendingReduced;
+
+  // Time series state. The step the data (and reduced data) came from, if it
+  // was decoded ahead of time:
+  std::shared_ptr<volTimeSeries> m_timeSeries;
+  volTimeSeries::StepPointer m_step;
+  volTimeSeries::StepPointer m_pendingStep;
+  volTimeSeries::StepPointer m_reducerStep;
+  volTimeSeries::StepPointer m_reducedStep;
+  volTimeSeries::StepPointer m_pendingReducedStep;
+  std::string m_dataFileName;
+  std::string m_pendingFileName;
+
+  // The data when not read through the selector: the file decoded by
+  // volVTIReader, or a step in shared memory:
+  vtkSmartPointer<vtkImageData> m_decoded;
+  vtkSmartPointer<vtkImageData> m_pendingDecoded;
+
+  // Shared-memory state, attached on the main thread. Segments replaced when
+  // the simulation restarts stay mapped while pipelines still use steps in
+  // them, as the steps' scalars keep them:
+  std::string m_sharedMemoryName;
+  std::shared_ptr<volSharedMemory> m_sharedMemory;
+  uint64_t m_dataGeneration;
+  uint64_t m_pendingGeneration;
+
+  // File watching state. When the file is rewritten, the data and its cache,
+  // if built, are handed to the reader thread, which compares them with the
+  // reread data using per-brick hashes. m_brickHashes are those of the data,
+  // computed on the first reload. m_readTime is when the data was last read,
+  // whether it was replaced or not:
+  bool m_fileWatchingEnabled;
+  std::unique_ptr<volFileWatcher> m_fileWatcher;
+  std::vector<uint64_t> m_brickHashes;
+  vtkSmartPointer<vtkImageData> m_reloadData;
+  std::shared_ptr<const volBrickCache> m_reloadBrickCache;
+  std::vector<uint64_t> m_reloadBrickHashes;
+  std::vector<uint64_t> m_pendingBrickHashes;
+  bool m_pendingUnchanged;
+  vtkTimeStamp m_readTime;
+
+  // Derived data cache of the file. The reduced data and isosurfaces loaded
+  // from it are produced on the reducer thread:
+  bool m_sidecarCacheEnabled;
+  std::shared_ptr<volSidecarCache> m_sidecarCache;
+  std::shared_ptr<volSidecarCache> m_pendingSidecarCache;
+  std::shared_ptr<volSidecarCache> m_reducerSidecarCache;
+  vtkSmartPointer<vtkImageData> m_pendingCachedReduced;
+  std::map<double, vtkSmartPointer<vtkPolyData> > m_cachedContours;
+  std::map<double, vtkSmartPointer<vtkPolyData> > m_pendingCachedContours;
+
+  // Preview of the file while it is first read, made on the reader thread.
+  // m_previewRequested is set when the read starts:
+  bool m_previewRequested;
+  bool m_previewing;
+  std::mutex m_previewMutex;
+  bool m_hasPreviewBounds;
+  std::array<double, 6> m_previewBounds;
+  vtkSmartPointer<vtkImageData> m_preview;
+  std::shared_ptr<const volBrickCache> m_previewBrickCache;
+  int m_previewSampleRate;
+
+  // Bricked copies of the data. The pending caches come with the data from
+  // the worker threads and are swapped in along with the data objects. When
+  // there are none, the caches are built from the sources by tasks started on
+  // the main thread, if asked for since the last updateBrickCaches(). The
+  // task sources keep the images being bricked alive:
+  std::shared_ptr<const volBrickCache> m_brickCache;
+  std::shared_ptr<const volBrickCache> m_reducedBrickCache;
+  std::shared_ptr<const volBrickCache> m_pendingBrickCache;
+  std::shared_ptr<const volBrickCache> m_pendingReducedBrickCache;
+  vtkSmartPointer<vtkImageData> m_brickCacheSource;
+  vtkSmartPointer<vtkImageData> m_reducedBrickCacheSource;
+  mutable std::atomic<bool> m_brickCacheRequested;
+  mutable std::atomic<bool> m_reducedBrickCacheRequested;
+  vtkSmartPointer<vtkImageData> m_brickCacheTaskSource;
+  vtkSmartPointer<vtkImageData> m_reducedBrickCacheTaskSource;
+  std::future<std::shared_ptr<const volBrickCache> > m_brickCacheTask;
+  std::future<std::shared_ptr<const volBrickCache> > m_reducedBrickCacheTask;
+
+  // Gradients of the bricked data, computed by tasks started on the main
+  // thread:
+  bool m_gradientsEnabled;
+  std::shared_ptr<const volGradientVolume> m_gradients;
+  std::shared_ptr<const volGradientVolume> m_reducedGradients;
+  std::future<std::shared_ptr<const volGradientVolume> > m_gradientTask;
+  std::future<std::shared_ptr<const volGradientVolume> > m_reducedGradientTask;
 };
 
 #endif // VOLREADER_H
@@ -0,0 +1,500 @@
+// STD includes
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// VTK includes
+#include <vtkCamera.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPNGWriter.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkXMLImageDataReader.h>
+
+// VolumeViewer includes
+#include "volBrickCache.h"
+#include "volGradientVolume.h"
+#include "volPreIntegrationTable.h"
+#include "volRayCaster.h"
+#include "volTransferFunction.h"
+
+/* Largest difference, per 8-bit channel, accepted by -compare. Composited
+ * rays stop at 0.99 opacity, which changes a channel by up to 3. */
+const int Tolerance = 4;
+
+void printUsage(void)
+{
+  std::cout << "\nvolRender - Time and check the CPU ray caster offscreen" << std::endl;
+  std::cout << "\nUSAGE:\n\t./volRender [options] <file.vti>" << std::endl;
+  std::cout << "\nWhere:" << std::endl;
+  std::cout << "\t-s <digit>, -size <digit>" << std::endl;
+  std::cout << "\tWidth and height of the images. Defaults to 512.\n" << std::endl;
+  std::cout << "\t-n <digit>, -frames <digit>" << std::endl;
+  std::cout << "\tFrames to render, orbiting the volume. Defaults to 36.\n" << std::endl;
+  std::cout << "\t-d <float>, -sampleDistance <float>" << std::endl;
+  std::cout << "\tDistance between samples in voxels. Defaults to 1.\n" << std::endl;
+  std::cout << "\t-post" << std::endl;
+  std::cout << "\tClassify single samples instead of pre-integrated slabs.\n" << std::endl;
+  std::cout << "\t-shade" << std::endl;
+  std::cout << "\tShade the samples by their gradients.\n" << std::endl;
+  std::cout << "\t-p <max|min|average>, -projection <max|min|average>" << std::endl;
+  std::cout << "\tProject the scalars along the rays instead of compositing.\n" << std::endl;
+  std::cout << "\t-o <string>, -output <string>" << std::endl;
+  std::cout << "\tWrite the first frame to this PNG file.\n" << std::endl;
+  std::cout << "\t-c, -compare" << std::endl;
+  std::cout << "\tAlso render every frame with a plain ray caster, one sample at" << std::endl;
+  std::cout << "\ta time without skipping or stopping, and fail if the images" << std::endl;
+  std::cout << "\tdiffer by more than " << Tolerance << " in any channel. Not with -shade.\n" << std::endl;
+  std::cout << "\t-h, -help" << std::endl;
+  std::cout << "\tDisplay this usage information and exit.\n" << std::endl;
+}
+
+/*
+ * lookup - Linearly interpolate entry u of a table of n RGBA entries, or
+ *          bilinearly interpolate entries (u, v) of an n x n one, as
+ *          volRayCaster does.
+ *
+ * parameter table - const float*
+ * parameter n - int
+ * parameter u - float
+ * parameter v - float
+ * parameter rgba - float*
+ *
+ */
+void lookup(const float *table, int n, float u, float rgba[4])
+{
+  const int i = std::min(static_cast<int>(u), n - 2);
+  const float t = u - static_cast<float>(i);
+  for(int c = 0; c < 4; ++c)
+    {
+    rgba[c] = table[4 * i + c] + t * (table[4 * i + 4 + c] - table[4 * i + c]);
+    }
+}
+
+void lookup(const float *table, int n, float u, float v, float rgba[4])
+{
+  const int j = std::min(static_cast<int>(v), n - 2);
+  const float t = v - static_cast<float>(j);
+  float lower[4];
+  float upper[4];
+  lookup(table + 4 * j * n, n, u, lower);
+  lookup(table + 4 * (j + 1) * n, n, u, upper);
+  for(int c = 0; c < 4; ++c)
+    {
+    rgba[c] = lower[c] + t * (upper[c] - lower[c]);
+    }
+}
+
+/*
+ * renderReference - Render image as volRayCaster::render() does for
+ *                   rayCaster's settings, but the obvious way: every sample
+ *                   of every ray is taken from the image itself, with no
+ *                   tiles, bricks, skipping or early ray termination.
+ *
+ * parameter image - vtkImageData*
+ * parameter rayCaster - const volRayCaster&
+ * parameter ndcToData - const std::array<double, 16>&
+ * parameter size - int
+ * parameter rgba - unsigned char*
+ *
+ */
+void renderReference(vtkImageData *image, const volRayCaster &rayCaster,
+                     const std::array<double, 16> &ndcToData, int size,
+                     unsigned char *rgba)
+{
+  int dims[3];
+  int extent[6];
+  double origin[3];
+  double spacing[3];
+  image->GetDimensions(dims);
+  image->GetExtent(extent);
+  image->GetOrigin(origin);
+  image->GetSpacing(spacing);
+  vtkDataArray *scalars = image->GetPointData()->GetScalars();
+  std::vector<double> values(static_cast<size_t>(scalars->GetNumberOfTuples()));
+  for(size_t i = 0; i < values.size(); ++i)
+    {
+    values[i] = scalars->GetComponent(static_cast<vtkIdType>(i), 0);
+    }
+
+  const volPreIntegrationTable &table = *rayCaster.table();
+  const int n = static_cast<int>(table.resolution());
+  const float last = static_cast<float>(n - 1);
+  const std::array<double, 2> &range = rayCaster.scalarRange();
+  const double scale = range[1] > range[0] ? last / (range[1] - range[0]) : 0.0;
+  const bool preIntegrated =
+    rayCaster.classification() == volRayCaster::PreIntegrated;
+  const volRayCaster::Projection projection = rayCaster.projection();
+  const double *m = ndcToData.data();
+
+  for(int row = 0; row < size; ++row)
+    {
+    for(int column = 0; column < size; ++column)
+      {
+      /* The ray from the near to the far plane, in data coordinates: */
+      const double x = 2.0 * (column + 0.5) / size - 1.0;
+      const double y = 2.0 * (row + 0.5) / size - 1.0;
+      double ends[2][3];
+      for(int e = 0; e < 2; ++e)
+        {
+        const double z = e == 0 ? -1.0 : 1.0;
+        const double w = m[12] * x + m[13] * y + m[14] * z + m[15];
+        for(int i = 0; i < 3; ++i)
+          {
+          ends[e][i] = (m[4 * i] * x + m[4 * i + 1] * y + m[4 * i + 2] * z +
+                        m[4 * i + 3]) / w;
+          }
+        }
+      double length = 0.0;
+      double start[3];
+      double direction[3];
+      for(int i = 0; i < 3; ++i)
+        {
+        length += (ends[1][i] - ends[0][i]) * (ends[1][i] - ends[0][i]);
+        start[i] = (ends[0][i] - origin[i]) / spacing[i] - extent[2 * i];
+        direction[i] = (ends[1][i] - ends[0][i]) / spacing[i];
+        }
+      length = std::sqrt(length);
+
+      /* Clipped to the samples of the image: */
+      double tEnter = 0.0;
+      double tExit = 1.0;
+      for(int i = 0; i < 3; ++i)
+        {
+        if(std::fabs(direction[i]) < 1e-12)
+          {
+          if(start[i] < 0.0 || start[i] > dims[i] - 1)
+            {
+            tExit = -1.0;
+            }
+          continue;
+          }
+        double t0 = -start[i] / direction[i];
+        double t1 = (dims[i] - 1 - start[i]) / direction[i];
+        tEnter = std::max(tEnter, std::min(t0, t1));
+        tExit = std::min(tExit, std::max(t0, t1));
+        }
+
+      float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      double projected = 0.0;
+      int count = 0;
+      float front = 0.0f;
+      const double dt = table.sampleDistance() / length;
+      const int samples = length > 0.0 && tEnter <= tExit ?
+        static_cast<int>((tExit - tEnter) / dt) + 1 : 0;
+      for(int s = 0; s < samples; ++s)
+        {
+        /* Trilinear interpolation in the cell holding the sample: */
+        const double t = tEnter + s * dt;
+        int cell[3];
+        double f[3];
+        for(int i = 0; i < 3; ++i)
+          {
+          const double p = start[i] + t * direction[i];
+          cell[i] = std::min(std::max(static_cast<int>(p), 0),
+                             std::max(dims[i] - 2, 0));
+          f[i] = p - cell[i];
+          }
+        double value = 0.0;
+        for(int corner = 0; corner < 8; ++corner)
+          {
+          const int di = corner & 1;
+          const int dj = (corner >> 1) & 1;
+          const int dk = (corner >> 2) & 1;
+          value += (di ? f[0] : 1.0 - f[0]) * (dj ? f[1] : 1.0 - f[1]) *
+            (dk ? f[2] : 1.0 - f[2]) *
+            values[(cell[2] + dk) * dims[0] * dims[1] +
+                   (cell[1] + dj) * dims[0] + cell[0] + di];
+          }
+
+        if(projection == volRayCaster::Composite)
+          {
+          const float u = std::min(std::max(
+            static_cast<float>((value - range[0]) * scale), 0.0f), last);
+          float slab[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+          if(!preIntegrated)
+            {
+            lookup(table.sampleTable().data(), n, u, slab);
+            }
+          else if(s > 0)
+            {
+            lookup(table.table().data(), n, front, u, slab);
+            }
+          front = u;
+          const float transparency = 1.0f - color[3];
+          for(int c = 0; c < 4; ++c)
+            {
+            color[c] += transparency * slab[c];
+            }
+          }
+        else if(projection == volRayCaster::MaximumIntensity)
+          {
+          projected = count > 0 ? std::max(projected, value) : value;
+          }
+        else if(projection == volRayCaster::MinimumIntensity)
+          {
+          projected = count > 0 ? std::min(projected, value) : value;
+          }
+        else
+          {
+          projected += value;
+          }
+        ++count;
+        }
+
+      if(projection != volRayCaster::Composite && count > 0)
+        {
+        if(projection == volRayCaster::AverageIntensity)
+          {
+          projected /= count;
+          }
+        const float u = std::min(std::max(
+          static_cast<float>((projected - range[0]) * scale), 0.0f), last);
+        lookup(table.colors().data(), n, u, color);
+        for(int c = 0; c < 3; ++c)
+          {
+          color[c] *= color[3];
+          }
+        }
+      unsigned char *out = rgba + 4 * (row * size + column);
+      for(int c = 0; c < 4; ++c)
+        {
+        out[c] = static_cast<unsigned char>(
+          std::min(color[c], 1.0f) * 255.0f + 0.5f);
+        }
+      }
+    }
+}
+
+/*
+ * main - Render the file named on the command line.
+ *
+ * parameter argc - int
+ * parameter argv - char**
+ *
+ */
+int main(int argc, char* argv[])
+{
+  std::string source;
+  std::string output;
+  int size = 512;
+  int frames = 36;
+  double sampleDistance = 1.0;
+  volRayCaster::Classification classification = volRayCaster::PreIntegrated;
+  volRayCaster::Projection projection = volRayCaster::Composite;
+  bool shade = false;
+  bool compare = false;
+
+  /* Parse the command-line arguments */
+  for(int i = 1; i < argc; ++i)
+    {
+    if((strcmp(argv[i], "-s")==0 || strcmp(argv[i], "-size")==0) &&
+       i + 1 < argc)
+      {
+      size = std::max(atoi(argv[++i]), 1);
+      }
+    else if((strcmp(argv[i], "-n")==0 || strcmp(argv[i], "-frames")==0) &&
+            i + 1 < argc)
+      {
+      frames = std::max(atoi(argv[++i]), 1);
+      }
+    else if((strcmp(argv[i], "-d")==0 ||
+             strcmp(argv[i], "-sampleDistance")==0) && i + 1 < argc)
+      {
+      sampleDistance = atof(argv[++i]);
+      }
+    else if(strcmp(argv[i], "-post")==0)
+      {
+      classification = volRayCaster::PostClassified;
+      }
+    else if(strcmp(argv[i], "-shade")==0)
+      {
+      shade = true;
+      }
+    else if((strcmp(argv[i], "-p")==0 || strcmp(argv[i], "-projection")==0) &&
+            i + 1 < argc)
+      {
+      const std::string name(argv[++i]);
+      if(name == "max")
+        {
+        projection = volRayCaster::MaximumIntensity;
+        }
+      else if(name == "min")
+        {
+        projection = volRayCaster::MinimumIntensity;
+        }
+      else if(name == "average")
+        {
+        projection = volRayCaster::AverageIntensity;
+        }
+      else
+        {
+        std::cerr << "Unknown projection " << name << "." << std::endl;
+        return 1;
+        }
+      }
+    else if((strcmp(argv[i], "-o")==0 || strcmp(argv[i], "-output")==0) &&
+            i + 1 < argc)
+      {
+      output.assign(argv[++i]);
+      }
+    else if(strcmp(argv[i], "-c")==0 || strcmp(argv[i], "-compare")==0)
+      {
+      compare = true;
+      }
+    else if(strcmp(argv[i], "-h")==0 || strcmp(argv[i], "-help")==0)
+      {
+      printUsage();
+      return 0;
+      }
+    else
+      {
+      source.assign(argv[i]);
+      }
+    }
+
+  if(source.empty() || sampleDistance <= 0.0 || (compare && shade))
+    {
+    printUsage();
+    return 1;
+    }
+
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(source.c_str());
+  reader->Update();
+  vtkImageData *image = reader->GetOutput();
+  if(!image || !image->GetPointData()->GetScalars())
+    {
+    std::cerr << "Could not read scalars from " << source << "." << std::endl;
+    return 1;
+    }
+
+  std::shared_ptr<volBrickCache> volume =
+    std::make_shared<volBrickCache>(image);
+  const std::array<double, 3> &spacing = volume->spacing();
+  const double voxel = std::min(std::fabs(spacing[0]),
+                                std::min(std::fabs(spacing[1]),
+                                         std::fabs(spacing[2])));
+
+  /* Grayscale, with opacity ramping up over the upper half of the range: */
+  const size_t entries = volTransferFunction::DefaultResolution;
+  std::vector<double> rgba(4 * entries);
+  for(size_t i = 0; i < entries; ++i)
+    {
+    const double x = static_cast<double>(i) / (entries - 1);
+    rgba[4 * i] = rgba[4 * i + 1] = rgba[4 * i + 2] = x;
+    rgba[4 * i + 3] = std::max(0.0, 2.0 * x - 1.0);
+    }
+  volTransferFunction tf;
+  tf.setTable(rgba.data(), entries);
+  std::shared_ptr<volPreIntegrationTable> table =
+    std::make_shared<volPreIntegrationTable>();
+  table->update(tf, sampleDistance * voxel, voxel);
+
+  volRayCaster rayCaster;
+  rayCaster.setVolume(volume);
+  rayCaster.setTable(table);
+  rayCaster.setClassification(classification);
+  rayCaster.setProjection(projection);
+  rayCaster.setScalarRange(volume->scalarRange());
+  if(shade)
+    {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    rayCaster.setGradients(std::make_shared<volGradientVolume>(volume));
+    rayCaster.setShading(true);
+    std::cout << "Gradients: " << std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+    }
+
+  /* Orbit the volume's center at three times its size: */
+  const std::array<double, 6> bounds = volume->bounds();
+  double center[3];
+  double radius = 0.0;
+  for(int j = 0; j < 3; ++j)
+    {
+    center[j] = 0.5 * (bounds[2 * j] + bounds[2 * j + 1]);
+    radius = std::max(radius, bounds[2 * j + 1] - bounds[2 * j]);
+    }
+  vtkNew<vtkCamera> camera;
+  camera->SetFocalPoint(center);
+  camera->SetViewUp(0.0, 0.0, 1.0);
+  camera->SetClippingRange(0.5 * radius, 5.5 * radius);
+
+  std::vector<unsigned char> pixels(4 * static_cast<size_t>(size) * size);
+  std::vector<unsigned char> reference(compare ? pixels.size() : 0);
+  int difference = 0;
+  double total = 0.0;
+  for(int frame = 0; frame < frames; ++frame)
+    {
+    const double angle = 2.0 * vtkMath::Pi() * frame / frames;
+    camera->SetPosition(center[0] + 3.0 * radius * std::cos(angle),
+                        center[1] + 3.0 * radius * std::sin(angle),
+                        center[2] + radius);
+
+    vtkNew<vtkMatrix4x4> ndcToData;
+    ndcToData->DeepCopy(
+      camera->GetCompositeProjectionTransformMatrix(1.0, -1.0, 1.0));
+    ndcToData->Invert();
+    std::array<double, 16> matrix;
+    std::copy(&ndcToData->Element[0][0], &ndcToData->Element[0][0] + 16,
+              matrix.begin());
+
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    rayCaster.render(matrix, size, size, size, pixels.data());
+    total += std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+
+    if(compare)
+      {
+      renderReference(image, rayCaster, matrix, size, reference.data());
+      for(size_t i = 0; i < pixels.size(); ++i)
+        {
+        difference = std::max(difference, std::abs(int(pixels[i]) -
+                                                   int(reference[i])));
+        }
+      }
+
+    if(frame == 0 && !output.empty())
+      {
+      vtkNew<vtkImageData> result;
+      result->SetDimensions(size, size, 1);
+      vtkNew<vtkUnsignedCharArray> colors;
+      colors->SetNumberOfComponents(4);
+      colors->SetNumberOfTuples(static_cast<vtkIdType>(size) * size);
+      std::copy(pixels.begin(), pixels.end(), colors->GetPointer(0));
+      result->GetPointData()->SetScalars(colors.Get());
+      vtkNew<vtkPNGWriter> writer;
+      writer->SetFileName(output.c_str());
+      writer->SetInputData(result.Get());
+      writer->Write();
+      }
+    }
+
+  const std::array<int, 3> &dims = volume->dimensions();
+  std::cout << dims[0] << " x " << dims[1] << " x " << dims[2] << " samples, "
+            << size << " x " << size << " pixels: " << total / frames
+            << " ms per frame" << std::endl;
+  if(compare)
+    {
+    std::cout << "Largest difference from the plain ray caster: "
+              << difference << std::endl;
+    if(difference > Tolerance)
+      {
+      return 1;
+      }
+    }
+  return 0;
+}
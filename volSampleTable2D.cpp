@@ -0,0 +1,75 @@
+#include "volSampleTable2D.h"
+
+#include "volTransferFunction2D.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Opacities are clamped below 1 so that the correction stays finite.
+const double MaximumOpacity = 0.9999;
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volSampleTable2D::volSampleTable2D()
+  : m_valueEntries(0),
+    m_magnitudeEntries(0),
+    m_sampleDistance(0.),
+    m_opacityUnitDistance(0.),
+    m_transferFunctionTime(0)
+{
+}
+
+//------------------------------------------------------------------------------
+volSampleTable2D::~volSampleTable2D()
+{
+}
+
+//------------------------------------------------------------------------------
+bool volSampleTable2D::update(const volTransferFunction2D &tf,
+                              double sampleDistance,
+                              double opacityUnitDistance)
+{
+  if (tf.timeStamp() == m_transferFunctionTime &&
+      sampleDistance == m_sampleDistance &&
+      opacityUnitDistance == m_opacityUnitDistance)
+    {
+    return false;
+    }
+  m_transferFunctionTime = tf.timeStamp();
+  m_sampleDistance = sampleDistance;
+  m_opacityUnitDistance = opacityUnitDistance;
+  m_valueEntries = volTransferFunction2D::ValueEntries;
+  m_magnitudeEntries = volTransferFunction2D::MagnitudeEntries;
+
+  const std::vector<float> &rgba = tf.table();
+  const double exponent = opacityUnitDistance > 0.
+      ? sampleDistance / opacityUnitDistance : 1.;
+  m_table.resize(rgba.size());
+  std::vector<bool> opaque(m_valueEntries, false);
+  for (size_t entry = 0; entry < rgba.size() / 4; ++entry)
+    {
+    const double opacity = std::min(static_cast<double>(rgba[4 * entry + 3]),
+                                    MaximumOpacity);
+    const double alpha = 1. - std::pow(1. - opacity, exponent);
+    for (int c = 0; c < 3; ++c)
+      {
+      m_table[4 * entry + c] = static_cast<float>(rgba[4 * entry + c] * alpha);
+      }
+    m_table[4 * entry + 3] = static_cast<float>(alpha);
+    if (alpha > 0.)
+      {
+      opaque[entry % m_valueEntries] = true;
+      }
+    }
+
+  m_opaqueEntries.resize(m_valueEntries + 1);
+  m_opaqueEntries[0] = 0;
+  for (size_t v = 0; v < m_valueEntries; ++v)
+    {
+    m_opaqueEntries[v + 1] = m_opaqueEntries[v] + (opaque[v] ? 1 : 0);
+    }
+  return true;
+}
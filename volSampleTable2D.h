@@ -0,0 +1,67 @@
+#ifndef VOLSAMPLETABLE2D_H
+#define VOLSAMPLETABLE2D_H
+
+#include <cstddef>
+#include <vector>
+
+class volTransferFunction2D;
+
+/**
+ * @brief The volSampleTable2D class holds the color and opacity of single
+ * samples of the volume over their scalar value and gradient magnitude, as
+ * volRayCaster composites them.
+ *
+ * The 2D counterpart of volPreIntegrationTable::sampleTable(): entries are
+ * premultiplied, and opacities corrected for the sample distance. The
+ * magnitude does not vary linearly between samples the way the value does,
+ * so there is no pre-integrated counterpart, and samples are classified one
+ * at a time.
+ */
+class volSampleTable2D
+{
+public:
+  volSampleTable2D();
+  ~volSampleTable2D();
+
+  /**
+   * Update the table for samples sampleDistance apart through tf. Opacities
+   * are for a length of opacityUnitDistance (as in vtkVolumeProperty).
+   * Returns true if the table changed.
+   */
+  bool update(const volTransferFunction2D &tf, double sampleDistance,
+              double opacityUnitDistance);
+
+  /** Entries along the value and the magnitude axes, 0 until the first
+   *  update(). */
+  size_t valueEntries() const { return m_valueEntries; }
+  size_t magnitudeEntries() const { return m_magnitudeEntries; }
+
+  double sampleDistance() const { return m_sampleDistance; }
+
+  /** Premultiplied RGBA of value entry v and magnitude entry m at
+   *  table()[4 * (v + valueEntries() * m)]. */
+  const std::vector<float>& table() const { return m_table; }
+
+  /** True if the value entries first to last (inclusive) are fully
+   *  transparent at every magnitude. */
+  bool transparent(size_t first, size_t last) const
+  {
+    return m_opaqueEntries[last + 1] == m_opaqueEntries[first];
+  }
+
+private:
+  // Not implemented:
+  volSampleTable2D(const volSampleTable2D&);
+  volSampleTable2D& operator=(const volSampleTable2D&);
+
+  size_t m_valueEntries;
+  size_t m_magnitudeEntries;
+  double m_sampleDistance;
+  double m_opacityUnitDistance;
+  unsigned long int m_transferFunctionTime;
+  std::vector<float> m_table;
+  std::vector<size_t> m_opaqueEntries; // value entries before each one, with
+                                       // opacity at some magnitude
+};
+
+#endif // VOLSAMPLETABLE2D_H
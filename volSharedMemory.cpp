@@ -0,0 +1,322 @@
+#include "volSharedMemory.h"
+
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkType.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Shared-memory volumes need lock-free atomics.");
+
+namespace {
+
+const char Magic[8] = {'V', 'O', 'L', 'S', 'H', 'M', 'E', 'M'};
+const uint32_t Version = 2;
+
+//------------------------------------------------------------------------------
+// Buffers start at multiples of this, which suits any scalar type and SIMD
+// loads.
+const uint64_t BufferAlignment = 64;
+
+uint64_t alignUp(uint64_t value)
+{
+  return (value + BufferAlignment - 1) / BufferAlignment * BufferAlignment;
+}
+
+//------------------------------------------------------------------------------
+// Bytes of a step, or 0 if the header does not describe a valid volume.
+uint64_t stepBytes(const volSharedMemory::Header &header)
+{
+  vtkSmartPointer<vtkDataArray> probe;
+  probe.TakeReference(vtkDataArray::CreateDataArray(header.scalarType));
+  if (!probe || header.numberOfComponents < 1 || header.dims[0] < 1 ||
+      header.dims[1] < 1 || header.dims[2] < 1)
+    {
+    return 0;
+    }
+  return static_cast<uint64_t>(header.dims[0]) * header.dims[1] *
+      header.dims[2] * header.numberOfComponents * probe->GetDataTypeSize();
+}
+
+//------------------------------------------------------------------------------
+// What releases the hold of an array on its buffer, when the array is deleted.
+struct Hold
+{
+  std::shared_ptr<volSharedMemory> memory;
+  uint32_t buffer;
+};
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volSharedMemory::volSharedMemory(const std::string &name, void *mapping,
+                                 size_t size, uint64_t inode)
+  : m_name(name),
+    m_mapping(mapping),
+    m_size(size),
+    m_inode(inode),
+    m_header(static_cast<Header*>(mapping)),
+    m_writing(NoBuffer)
+{
+}
+
+//------------------------------------------------------------------------------
+volSharedMemory::~volSharedMemory()
+{
+  munmap(m_mapping, m_size);
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<volSharedMemory>
+volSharedMemory::attach(const std::string &name)
+{
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0)
+    {
+    return nullptr;
+    }
+  struct stat info;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 &&
+      static_cast<size_t>(info.st_size) >= sizeof(Header))
+    {
+    mapping = mmap(nullptr, static_cast<size_t>(info.st_size),
+                   PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    {
+    return nullptr;
+    }
+
+  std::shared_ptr<volSharedMemory> memory(
+        new volSharedMemory(name, mapping, static_cast<size_t>(info.st_size),
+                            static_cast<uint64_t>(info.st_ino)));
+
+  // The segment may be attached to while the producer still sets it up; it
+  // is only valid once the magic is written, which happens last:
+  const Header &header = *memory->m_header;
+  const uint64_t bytes = stepBytes(header);
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+      header.version != Version ||
+      header.numberOfBuffers < MinimumBuffers ||
+      header.numberOfBuffers > MaximumBuffers ||
+      bytes == 0 || header.bufferBytes < bytes ||
+      header.bufferOffset < sizeof(Header) ||
+      header.bufferOffset + header.numberOfBuffers * header.bufferBytes >
+        memory->m_size)
+    {
+    return nullptr;
+    }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  // Holds left by a viewer that went away would keep their buffers forever:
+  for (uint32_t i = 0; i < MaximumBuffers; ++i)
+    {
+    memory->m_header->holds[i] = 0;
+    }
+  return memory;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<volSharedMemory>
+volSharedMemory::create(const std::string &name, int scalarType,
+                        int numberOfComponents, const int dims[3],
+                        const double origin[3], const double spacing[3])
+{
+  Header layout;
+  layout.scalarType = scalarType;
+  layout.numberOfComponents = numberOfComponents;
+  std::copy(dims, dims + 3, layout.dims);
+  const uint64_t bytes = stepBytes(layout);
+  if (bytes == 0)
+    {
+    std::cerr << "Invalid volume for shared memory segment " << name << ".\n";
+    return nullptr;
+    }
+  const uint64_t bufferOffset = alignUp(sizeof(Header));
+  const uint64_t bufferBytes = alignUp(bytes);
+  const size_t size =
+      static_cast<size_t>(bufferOffset + MinimumBuffers * bufferBytes);
+
+  // Viewers attached to an earlier segment of that name keep it until they
+  // notice it was replaced:
+  shm_unlink(name.c_str());
+  const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    {
+    std::cerr << "Cannot create shared memory segment " << name << ".\n";
+    return nullptr;
+    }
+  struct stat info;
+  void *mapping = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0 && fstat(fd, &info) == 0)
+    {
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    {
+    std::cerr << "Cannot map shared memory segment " << name << ".\n";
+    shm_unlink(name.c_str());
+    return nullptr;
+    }
+
+  Header *header = new (mapping) Header;
+  header->version = Version;
+  header->numberOfBuffers = MinimumBuffers;
+  header->scalarType = scalarType;
+  header->numberOfComponents = numberOfComponents;
+  std::copy(dims, dims + 3, header->dims);
+  header->reserved = 0;
+  std::copy(origin, origin + 3, header->origin);
+  std::copy(spacing, spacing + 3, header->spacing);
+  header->bufferOffset = bufferOffset;
+  header->bufferBytes = bufferBytes;
+  header->generation = 0;
+  header->current = NoBuffer;
+  for (uint32_t i = 0; i < MaximumBuffers; ++i)
+    {
+    header->holds[i] = 0;
+    }
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, Magic, sizeof(Magic));
+
+  return std::shared_ptr<volSharedMemory>(
+        new volSharedMemory(name, mapping, size,
+                            static_cast<uint64_t>(info.st_ino)));
+}
+
+//------------------------------------------------------------------------------
+uint64_t volSharedMemory::generation() const
+{
+  return m_header->generation.load();
+}
+
+//------------------------------------------------------------------------------
+bool volSharedMemory::isReplaced() const
+{
+  const int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    {
+    // Gone, but not replaced (yet):
+    return false;
+    }
+  struct stat info;
+  const bool replaced =
+      fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_ino) != m_inode;
+  ::close(fd);
+  return replaced;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> volSharedMemory::acquire(uint64_t &generation)
+{
+  // Hold the latest step before using it. Once held, the producer won't pick
+  // the buffer; if current still names it after that, the producer can't
+  // have started writing to it in between.
+  uint32_t current;
+  for (;;)
+    {
+    generation = m_header->generation.load();
+    current = m_header->current.load();
+    if (current >= m_header->numberOfBuffers)
+      {
+      return nullptr;
+      }
+    ++m_header->holds[current];
+    if (m_header->current.load() == current)
+      {
+      break;
+      }
+    --m_header->holds[current];
+    }
+
+  const Header &header = *m_header;
+  vtkSmartPointer<vtkDataArray> scalars;
+  scalars.TakeReference(vtkDataArray::CreateDataArray(header.scalarType));
+  scalars->SetNumberOfComponents(header.numberOfComponents);
+  scalars->SetVoidArray(this->buffer(current),
+                        static_cast<vtkIdType>(header.dims[0]) *
+                        header.dims[1] * header.dims[2] *
+                        header.numberOfComponents, 1);
+  scalars->SetName("Scalars");
+
+  // The hold, and the mapping, last as long as the array:
+  Hold *hold = new Hold;
+  hold->memory = this->shared_from_this();
+  hold->buffer = current;
+  vtkNew<vtkCallbackCommand> release;
+  release->SetCallback(&volSharedMemory::releaseHold);
+  release->SetClientData(hold);
+  scalars->AddObserver(vtkCommand::DeleteEvent, release.Get());
+
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(const_cast<int*>(header.dims));
+  image->SetOrigin(const_cast<double*>(header.origin));
+  image->SetSpacing(const_cast<double*>(header.spacing));
+  image->GetPointData()->SetScalars(scalars);
+  return image;
+}
+
+//------------------------------------------------------------------------------
+void* volSharedMemory::beginWrite()
+{
+  const uint32_t current = m_header->current.load();
+  for (m_writing = 0; m_writing < m_header->numberOfBuffers; ++m_writing)
+    {
+    if (m_writing != current && m_header->holds[m_writing].load() == 0)
+      {
+      return this->buffer(m_writing);
+      }
+    }
+  m_writing = NoBuffer;
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+void volSharedMemory::endWrite()
+{
+  if (m_writing == NoBuffer)
+    {
+    return;
+    }
+  m_header->current = m_writing;
+  ++m_header->generation;
+  m_writing = NoBuffer;
+}
+
+//------------------------------------------------------------------------------
+void volSharedMemory::unlink()
+{
+  shm_unlink(m_name.c_str());
+}
+
+//------------------------------------------------------------------------------
+char* volSharedMemory::buffer(uint32_t index) const
+{
+  return static_cast<char*>(m_mapping) + m_header->bufferOffset +
+      index * m_header->bufferBytes;
+}
+
+//------------------------------------------------------------------------------
+void volSharedMemory::releaseHold(vtkObject*, unsigned long, void *clientData,
+                                  void*)
+{
+  Hold *hold = static_cast<Hold*>(clientData);
+  --hold->memory->m_header->holds[hold->buffer];
+  delete hold;
+}
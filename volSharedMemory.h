@@ -0,0 +1,142 @@
+#ifndef VOLSHAREDMEMORY_H
+#define VOLSHAREDMEMORY_H
+
+#include <vtkSmartPointer.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class vtkImageData;
+class vtkObject;
+
+/**
+ * @brief The volSharedMemory class is a volume that a running simulation
+ * publishes in a POSIX shared-memory segment, step after step.
+ *
+ * The segment starts with a Header describing the volume, followed by
+ * numberOfBuffers buffers, each large enough for one step. The producer
+ * writes a step into a buffer nobody uses (beginWrite()), then publishes it
+ * (endWrite()): current is set to that buffer and generation is incremented.
+ * The viewer counts in holds the arrays it made of each buffer, and the
+ * producer never writes to a buffer with a hold. A hold lasts as long as the
+ * array wrapping the buffer, so any pipeline still working on an older step,
+ * however late, is not disturbed by the next ones. A segment is therefore
+ * watched by a single viewer at a time; attaching to it drops the holds of a
+ * viewer that went away without releasing them.
+ *
+ * acquire() wraps the latest step's buffer as the scalars of an image,
+ * without copying. Those scalars keep the segment mapped until they are
+ * deleted.
+ *
+ * The header is read and written through std::atomic members, which are
+ * lock free and therefore work across processes. Both sides must be built
+ * for the same machine.
+ */
+class volSharedMemory : public std::enable_shared_from_this<volSharedMemory>
+{
+public:
+  /** Marks an unused held slot or an unset current buffer. */
+  static const uint32_t NoBuffer = 0xffffffff;
+
+  /**
+   * Buffers in a segment: one being written, the latest and two more for
+   * steps still held.
+   */
+  static const uint32_t MinimumBuffers = 4;
+
+  /** Most buffers a segment may have. */
+  static const uint32_t MaximumBuffers = 8;
+
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t numberOfBuffers;
+    int32_t scalarType; // VTK_FLOAT, VTK_UNSIGNED_CHAR, ...
+    int32_t numberOfComponents;
+    int32_t dims[3];
+    int32_t reserved;
+    double origin[3];
+    double spacing[3];
+    uint64_t bufferOffset; // of buffer 0, from the start of the segment
+    uint64_t bufferBytes; // distance between buffers
+    std::atomic<uint64_t> generation; // steps published so far
+    std::atomic<uint32_t> current; // buffer of the latest step
+    std::atomic<uint32_t> holds[MaximumBuffers]; // arrays the viewer made
+  };
+
+  ~volSharedMemory();
+
+  /**
+   * Attach to the segment called name (as passed to shm_open(), e.g.
+   * "/simulation"). Returns null if it does not exist or is not a volume.
+   */
+  static std::shared_ptr<volSharedMemory> attach(const std::string &name);
+
+  /**
+   * Create the segment name for a volume of the given geometry and VTK scalar
+   * type, replacing any segment of that name. Used by producers.
+   */
+  static std::shared_ptr<volSharedMemory> create(const std::string &name,
+                                                 int scalarType,
+                                                 int numberOfComponents,
+                                                 const int dims[3],
+                                                 const double origin[3],
+                                                 const double spacing[3]);
+
+  const std::string& name() const { return m_name; }
+  const Header& header() const { return *m_header; }
+
+  /** Number of steps published; 0 until the first one. */
+  uint64_t generation() const;
+
+  /** True if the name now refers to another segment: the producer restarted. */
+  bool isReplaced() const;
+
+  /**
+   * Hold the latest step and return it as an image whose scalars live in the
+   * segment. generation is set to the step's generation. Returns null if no
+   * step was published yet.
+   */
+  vtkSmartPointer<vtkImageData> acquire(uint64_t &generation);
+
+  /**
+   * Start writing a step: the buffer to write it to, of header().bufferBytes,
+   * or null while the viewer holds all the others. Not to be called
+   * concurrently.
+   */
+  void* beginWrite();
+
+  /** Publish the step written to the buffer of beginWrite(). */
+  void endWrite();
+
+  /** Remove the name of the segment. Attached viewers keep their mapping. */
+  void unlink();
+
+private:
+  // Not implemented:
+  volSharedMemory(const volSharedMemory&);
+  volSharedMemory& operator=(const volSharedMemory&);
+
+  volSharedMemory(const std::string &name, void *mapping, size_t size,
+                  uint64_t inode);
+
+  char* buffer(uint32_t index) const;
+
+  static void releaseHold(vtkObject *caller, unsigned long eventId,
+                          void *clientData, void *callData);
+
+  std::string m_name;
+  void *m_mapping;
+  size_t m_size;
+  uint64_t m_inode;
+  Header *m_header;
+
+  // Producer state: the buffer being written.
+  uint32_t m_writing;
+};
+
+#endif // VOLSHAREDMEMORY_H
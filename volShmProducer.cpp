@@ -0,0 +1,160 @@
+// STD includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+// VTK includes
+#include <vtkType.h>
+
+// VolumeViewer includes
+#include "volSharedMemory.h"
+
+namespace {
+
+std::atomic<bool> Interrupted(false);
+
+void interrupt(int)
+{
+  Interrupted = true;
+}
+
+} // end anon namespace
+
+void printUsage(void)
+{
+  std::cout << "\nvolShmProducer - Publish a synthetic, evolving volume in shared memory" << std::endl;
+  std::cout << "\nStands in for a running simulation, e.g. to try" << std::endl;
+  std::cout << "ExampleVTKReader -sharedMemory without one." << std::endl;
+  std::cout << "\nUSAGE:\n\t./volShmProducer [options]" << std::endl;
+  std::cout << "\nWhere:" << std::endl;
+  std::cout << "\t-n <string>, -name <string>" << std::endl;
+  std::cout << "\tName of the shared memory segment. Defaults to /volumeviewer.\n" << std::endl;
+  std::cout << "\t-d <digit>, -dimensions <digit>" << std::endl;
+  std::cout << "\tSamples along each axis of the volume. Defaults to 128.\n" << std::endl;
+  std::cout << "\t-r <number>, -rate <number>" << std::endl;
+  std::cout << "\tSteps published per second. Defaults to 10.\n" << std::endl;
+  std::cout << "\t-s <digit>, -steps <digit>" << std::endl;
+  std::cout << "\tNumber of steps to publish; 0, the default, runs until interrupted.\n" << std::endl;
+  std::cout << "\t-h, -help" << std::endl;
+  std::cout << "\tDisplay this usage information and exit.\n" << std::endl;
+}
+
+/*
+ * main - Publish steps until done or interrupted.
+ *
+ * parameter argc - int
+ * parameter argv - char**
+ *
+ */
+int main(int argc, char* argv[])
+{
+  std::string name("/volumeviewer");
+  int size = 128;
+  double rate = 10.0;
+  long steps = 0;
+
+  /* Parse the command-line arguments */
+  for(int i = 1; i < argc; ++i)
+    {
+    if((strcmp(argv[i], "-n")==0 || strcmp(argv[i], "-name")==0) &&
+       i + 1 < argc)
+      {
+      name.assign(argv[++i]);
+      }
+    else if((strcmp(argv[i], "-d")==0 || strcmp(argv[i], "-dimensions")==0) &&
+            i + 1 < argc)
+      {
+      size = atoi(argv[++i]);
+      }
+    else if((strcmp(argv[i], "-r")==0 || strcmp(argv[i], "-rate")==0) &&
+            i + 1 < argc)
+      {
+      rate = atof(argv[++i]);
+      }
+    else if((strcmp(argv[i], "-s")==0 || strcmp(argv[i], "-steps")==0) &&
+            i + 1 < argc)
+      {
+      steps = atol(argv[++i]);
+      }
+    else
+      {
+      printUsage();
+      return strcmp(argv[i], "-h")==0 || strcmp(argv[i], "-help")==0 ? 0 : 1;
+      }
+    }
+  if(size < 2 || rate <= 0.0)
+    {
+    printUsage();
+    return 1;
+    }
+
+  const int dims[3] = { size, size, size };
+  const double origin[3] = { 0.0, 0.0, 0.0 };
+  const double spacing[3] = { 1.0, 1.0, 1.0 };
+  std::shared_ptr<volSharedMemory> memory =
+    volSharedMemory::create(name, VTK_FLOAT, 1, dims, origin, spacing);
+  if(!memory)
+    {
+    return 1;
+    }
+  std::signal(SIGINT, interrupt);
+  std::signal(SIGTERM, interrupt);
+  std::cout << "Publishing " << size << "^3 floats in " << name
+            << ", Ctrl-C to stop." << std::endl;
+
+  /* Two blobs circling the center, in [0, 255] like the bundled data: */
+  const auto interval = std::chrono::duration<double>(1.0 / rate);
+  auto next = std::chrono::steady_clock::now();
+  const double center = 0.5 * (size - 1);
+  const double radius = 0.25 * size;
+  const double sigma2 = 2.0 * (0.1 * size) * (0.1 * size);
+  for(long step = 0; !Interrupted && (steps == 0 || step < steps); ++step)
+    {
+    const double angle = 0.1 * step;
+    const double blobs[2][3] = {
+      { center + radius * std::cos(angle), center + radius * std::sin(angle),
+        center },
+      { center - radius * std::cos(angle), center,
+        center + radius * std::sin(angle) } };
+
+    /* Skip the step while the viewer still holds every other buffer: */
+    float *out = static_cast<float*>(memory->beginWrite());
+    for(int k = 0; out && k < size; ++k)
+      {
+      for(int j = 0; j < size; ++j)
+        {
+        for(int i = 0; i < size; ++i)
+          {
+          double value = 0.0;
+          for(int b = 0; b < 2; ++b)
+            {
+            const double dx = i - blobs[b][0];
+            const double dy = j - blobs[b][1];
+            const double dz = k - blobs[b][2];
+            value += std::exp(-(dx * dx + dy * dy + dz * dz) / sigma2);
+            }
+          *out++ = static_cast<float>(255.0 * std::min(value, 1.0));
+          }
+        }
+      }
+    if(out)
+      {
+      memory->endWrite();
+      }
+
+    next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      interval);
+    std::this_thread::sleep_until(next);
+    }
+
+  memory->unlink();
+  return 0;
+}
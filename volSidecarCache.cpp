@@ -0,0 +1,757 @@
+#include "volSidecarCache.h"
+
+#include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkVersion.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char Magic[8] = {'V', 'O', 'L', 'C', 'A', 'C', 'H', 'E'};
+const int32_t Version = 2;
+
+enum ItemKind
+{
+  ReducedDataItem = 1,
+  HistogramItem,
+  IsosurfaceItem
+};
+
+const char *const Suffixes[] = {"", ".reduced", ".histogram", ".iso"};
+
+// Written as-is at the start of each item. Like brick files, items are a
+// local cache and use the host's byte order.
+struct ItemHeader
+{
+  char magic[8];
+  int32_t version;
+  int32_t kind;
+  uint64_t contentKey;
+  uint64_t key;
+  uint64_t payloadSize;
+};
+
+// Arrays in a payload start at multiples of this in the file, so that they can
+// be used where they are mapped:
+const size_t ArrayAlignment = 8;
+
+// Sampled blocks of the source that go into its content key:
+const size_t KeyBlockSize = 64 << 10;
+const int KeyBlocks = 16;
+
+//------------------------------------------------------------------------------
+// 64-bit FNV-1a.
+const uint64_t FnvOffset = 14695981039346656037ULL;
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = FnvOffset)
+{
+  const unsigned char *bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i)
+    {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+uint64_t fnv1a(const T &value, uint64_t hash)
+{
+  return fnv1a(&value, sizeof(T), hash);
+}
+
+//------------------------------------------------------------------------------
+bool endsWith(const std::string &name, const char *suffix)
+{
+  const size_t n = std::strlen(suffix);
+  return name.size() >= n && name.compare(name.size() - n, n, suffix) == 0;
+}
+
+//------------------------------------------------------------------------------
+// Names of the items of the given kind in directory.
+std::vector<std::string> listItems(const std::string &directory, int kind)
+{
+  std::vector<std::string> result;
+  DIR *dir = opendir(directory.c_str());
+  if (!dir)
+    {
+    return result;
+    }
+  while (dirent *entry = readdir(dir))
+    {
+    const std::string name = entry->d_name;
+    for (int k = ReducedDataItem; k <= IsosurfaceItem; ++k)
+      {
+      if ((kind == 0 || kind == k) && endsWith(name, Suffixes[k]))
+        {
+        result.push_back(directory + "/" + name);
+        }
+      }
+    }
+  closedir(dir);
+  return result;
+}
+
+//------------------------------------------------------------------------------
+bool readHeader(const std::string &fileName, ItemHeader &header)
+{
+  const int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+    return false;
+    }
+  const bool ok = pread(fd, &header, sizeof(header), 0) ==
+      static_cast<ssize_t>(sizeof(header)) &&
+      std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 &&
+      header.version == Version;
+  ::close(fd);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+// A mapped item file. Pages are copied on write, so arrays wrapping them may be
+// modified without touching the file.
+struct Mapping
+{
+  Mapping(void *address, size_t length)
+    : data(static_cast<char*>(address)),
+      size(length)
+  {
+  }
+
+  ~Mapping()
+  {
+    munmap(data, size);
+  }
+
+  char *data;
+  size_t size;
+};
+
+//------------------------------------------------------------------------------
+// Drops the reference of a deleted array on the mapping it wraps.
+void releaseMapping(vtkObject*, unsigned long, void *clientData, void*)
+{
+  delete static_cast<std::shared_ptr<Mapping>*>(clientData);
+}
+
+//------------------------------------------------------------------------------
+// A cached item mapped into memory. Invalid if missing, truncated or not of
+// the expected kind and content. The mapping lasts as long as the item or any
+// array wrapping it.
+class MappedItem
+{
+public:
+  MappedItem(const std::string &fileName, int kind, uint64_t contentKey,
+             uint64_t key = 0)
+    : m_offset(sizeof(ItemHeader))
+  {
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+      {
+      return;
+      }
+    struct stat info;
+    if (fstat(fd, &info) == 0 &&
+        static_cast<size_t>(info.st_size) >= sizeof(ItemHeader))
+      {
+      void *data = mmap(nullptr, static_cast<size_t>(info.st_size),
+                        PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+        {
+        m_mapping = std::make_shared<Mapping>(
+              data, static_cast<size_t>(info.st_size));
+        }
+      }
+    ::close(fd);
+
+    if (m_mapping)
+      {
+      ItemHeader header;
+      std::memcpy(&header, m_mapping->data, sizeof(header));
+      if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+          header.version != Version || header.kind != kind ||
+          header.contentKey != contentKey || (key != 0 && header.key != key) ||
+          header.payloadSize != m_mapping->size - sizeof(ItemHeader))
+        {
+        m_mapping.reset();
+        }
+      }
+  }
+
+  bool isValid() const { return m_mapping != nullptr; }
+
+  /** Copy the next size bytes of the payload. False past the end. */
+  bool read(void *out, size_t size)
+  {
+    if (!this->available(size))
+      {
+      return false;
+      }
+    if (size == 0)
+      {
+      return true;
+      }
+    std::memcpy(out, m_mapping->data + m_offset, size);
+    m_offset += size;
+    return true;
+  }
+
+  template <typename T>
+  bool read(T &value)
+  {
+    return this->read(&value, sizeof(T));
+  }
+
+  /**
+   * Point array, whose number of components is set, at the next tuples of the
+   * payload, aligned as written by pad(). The array uses the mapped memory as
+   * it is and keeps the mapping until it is deleted. False past the end.
+   */
+  bool wrap(vtkDataArray *array, vtkIdType tuples)
+  {
+    m_offset += (ArrayAlignment - m_offset % ArrayAlignment) % ArrayAlignment;
+    const vtkIdType values = tuples * array->GetNumberOfComponents();
+    const size_t size = static_cast<size_t>(values) *
+        static_cast<size_t>(array->GetDataTypeSize());
+    if (!this->available(size))
+      {
+      return false;
+      }
+    array->SetVoidArray(m_mapping->data + m_offset, values, 1);
+    m_offset += size;
+
+    vtkNew<vtkCallbackCommand> release;
+    release->SetCallback(&releaseMapping);
+    release->SetClientData(new std::shared_ptr<Mapping>(m_mapping));
+    array->AddObserver(vtkCommand::DeleteEvent, release.Get());
+    return true;
+  }
+
+private:
+  // Not implemented:
+  MappedItem(const MappedItem&);
+  MappedItem& operator=(const MappedItem&);
+
+  bool available(size_t size) const
+  {
+    return m_mapping && m_offset <= m_mapping->size &&
+        size <= m_mapping->size - m_offset;
+  }
+
+  std::shared_ptr<Mapping> m_mapping;
+  size_t m_offset;
+};
+
+//------------------------------------------------------------------------------
+void append(std::vector<char> &payload, const void *data, size_t size)
+{
+  const char *bytes = static_cast<const char*>(data);
+  payload.insert(payload.end(), bytes, bytes + size);
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+void append(std::vector<char> &payload, const T &value)
+{
+  append(payload, &value, sizeof(T));
+}
+
+//------------------------------------------------------------------------------
+// Pad payload so that the array appended next is where MappedItem::wrap()
+// expects it.
+void pad(std::vector<char> &payload)
+{
+  while ((sizeof(ItemHeader) + payload.size()) % ArrayAlignment != 0)
+    {
+    payload.push_back('\0');
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> readIsosurface(MappedItem &item, int sampleRate,
+                                            double &value)
+{
+  int32_t rate = 0;
+  int32_t hasNormals = 0;
+  uint64_t numPoints = 0;
+  uint64_t numTriangles = 0;
+  if (!item.read(value) || !item.read(rate) || !item.read(hasNormals) ||
+      !item.read(numPoints) || !item.read(numTriangles) || rate != sampleRate)
+    {
+    return nullptr;
+    }
+
+  const vtkIdType points = static_cast<vtkIdType>(numPoints);
+  const vtkIdType cells = static_cast<vtkIdType>(numTriangles);
+  vtkNew<vtkFloatArray> coords;
+  coords->SetNumberOfComponents(3);
+  vtkNew<vtkFloatArray> normals;
+  normals->SetName("Normals");
+  normals->SetNumberOfComponents(3);
+  vtkNew<vtkFloatArray> scalars;
+  scalars->SetName("Scalars");
+  vtkNew<vtkTypeInt32Array> connectivity;
+  if (!item.wrap(coords.Get(), points) ||
+      (hasNormals && !item.wrap(normals.Get(), points)) ||
+      !item.wrap(scalars.Get(), points) ||
+      !item.wrap(connectivity.Get(), 3 * cells))
+    {
+    return nullptr;
+    }
+
+  vtkNew<vtkPoints> polyPoints;
+  polyPoints->SetData(coords.Get());
+  vtkNew<vtkCellArray> polys;
+#if VTK_MAJOR_VERSION >= 9
+  // The cell array uses the stored connectivity as it is:
+  polys->SetData(3, connectivity.Get());
+#else
+  // The legacy layout puts the number of ids before those of each cell:
+  vtkNew<vtkIdTypeArray> legacy;
+  legacy->SetNumberOfValues(4 * cells);
+  vtkIdType *cell = legacy->GetPointer(0);
+  const int32_t *ids = connectivity->GetPointer(0);
+  for (vtkIdType t = 0; t < cells; ++t, cell += 4, ids += 3)
+    {
+    cell[0] = 3;
+    cell[1] = ids[0];
+    cell[2] = ids[1];
+    cell[3] = ids[2];
+    }
+  polys->SetCells(cells, legacy.Get());
+#endif
+
+  vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+  surface->SetPoints(polyPoints.Get());
+  surface->SetPolys(polys.Get());
+  surface->GetPointData()->SetScalars(scalars.Get());
+  if (hasNormals)
+    {
+    surface->GetPointData()->SetNormals(normals.Get());
+    }
+  return surface;
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volSidecarCache::volSidecarCache(const std::string &source)
+  : m_directory(defaultDirectory(source)),
+    m_contentKey(0),
+    m_valid(false),
+    m_writeFailed(false)
+{
+  m_valid = contentKey(source, m_contentKey);
+  if (m_valid)
+    {
+    this->removeStaleItems();
+    }
+}
+
+//------------------------------------------------------------------------------
+volSidecarCache::~volSidecarCache()
+{
+}
+
+//------------------------------------------------------------------------------
+std::string volSidecarCache::defaultDirectory(const std::string &source)
+{
+  return source + ".cache";
+}
+
+//------------------------------------------------------------------------------
+bool volSidecarCache::contentKey(const std::string &source, uint64_t &key)
+{
+  const int fd = ::open(source.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+    return false;
+    }
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+    {
+    ::close(fd);
+    return false;
+    }
+
+  const uint64_t size = static_cast<uint64_t>(info.st_size);
+  const int64_t mtime = static_cast<int64_t>(info.st_mtime);
+  key = fnv1a(Version, FnvOffset);
+  key = fnv1a(size, key);
+  key = fnv1a(mtime, key);
+
+  std::vector<char> block(KeyBlockSize);
+  const uint64_t last = size > KeyBlockSize ? size - KeyBlockSize : 0;
+  for (int i = 0; i < KeyBlocks; ++i)
+    {
+    const off_t offset = static_cast<off_t>(last * i / (KeyBlocks - 1));
+    const ssize_t n = pread(fd, block.data(), block.size(), offset);
+    if (n > 0)
+      {
+      key = fnv1a(block.data(), static_cast<size_t>(n), key);
+      }
+    if (last == 0)
+      {
+      break;
+      }
+    }
+
+  ::close(fd);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> volSidecarCache::reducedData(int sampleRate) const
+{
+  const uint64_t key = this->itemKey(ReducedDataItem, sampleRate);
+  MappedItem item(this->itemFileName(key, Suffixes[ReducedDataItem]),
+                  ReducedDataItem, m_contentKey, key);
+  int32_t extent[6];
+  double origin[3];
+  double spacing[3];
+  int32_t scalarType = 0;
+  int32_t numComps = 0;
+  uint64_t numTuples = 0;
+  uint32_t nameLength = 0;
+  if (!item.isValid() || !item.read(extent) || !item.read(origin) ||
+      !item.read(spacing) || !item.read(scalarType) || !item.read(numComps) ||
+      !item.read(numTuples) || !item.read(nameLength))
+    {
+    return nullptr;
+    }
+  std::string name(nameLength, '\0');
+  if (!item.read(&name[0], nameLength))
+    {
+    return nullptr;
+    }
+
+  vtkSmartPointer<vtkDataArray> scalars;
+  scalars.TakeReference(vtkDataArray::CreateDataArray(scalarType));
+  if (!scalars || numComps < 1)
+    {
+    return nullptr;
+    }
+  scalars->SetName(name.c_str());
+  scalars->SetNumberOfComponents(numComps);
+  if (!item.wrap(scalars, static_cast<vtkIdType>(numTuples)))
+    {
+    return nullptr;
+    }
+
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  int ext[6];
+  std::copy(extent, extent + 6, ext);
+  image->SetExtent(ext);
+  image->SetOrigin(origin);
+  image->SetSpacing(spacing);
+  if (image->GetNumberOfPoints() != static_cast<vtkIdType>(numTuples))
+    {
+    return nullptr;
+    }
+  image->GetPointData()->SetScalars(scalars);
+  return image;
+}
+
+//------------------------------------------------------------------------------
+void volSidecarCache::storeReducedData(int sampleRate, vtkImageData *image)
+{
+  vtkDataArray *scalars = image ? image->GetPointData()->GetScalars()
+                                : nullptr;
+  if (!m_valid || !scalars)
+    {
+    return;
+    }
+
+  int extent[6];
+  double origin[3];
+  double spacing[3];
+  image->GetExtent(extent);
+  image->GetOrigin(origin);
+  image->GetSpacing(spacing);
+  const char *name = scalars->GetName() ? scalars->GetName() : "";
+
+  std::vector<char> payload;
+  for (int i = 0; i < 6; ++i)
+    {
+    append(payload, static_cast<int32_t>(extent[i]));
+    }
+  append(payload, origin);
+  append(payload, spacing);
+  append(payload, static_cast<int32_t>(scalars->GetDataType()));
+  append(payload, static_cast<int32_t>(scalars->GetNumberOfComponents()));
+  append(payload, static_cast<uint64_t>(scalars->GetNumberOfTuples()));
+  append(payload, static_cast<uint32_t>(std::strlen(name)));
+  append(payload, name, std::strlen(name));
+  pad(payload);
+  append(payload, scalars->GetVoidPointer(0),
+         static_cast<size_t>(scalars->GetNumberOfTuples()) *
+         scalars->GetNumberOfComponents() * scalars->GetDataTypeSize());
+
+  const uint64_t key = this->itemKey(ReducedDataItem, sampleRate);
+  this->writeItem(this->itemFileName(key, Suffixes[ReducedDataItem]),
+                  ReducedDataItem, key, payload);
+}
+
+//------------------------------------------------------------------------------
+bool volSidecarCache::histogram(int sampleRate, std::vector<float> &bins) const
+{
+  const uint64_t key = this->itemKey(HistogramItem, sampleRate);
+  MappedItem item(this->itemFileName(key, Suffixes[HistogramItem]),
+                  HistogramItem, m_contentKey, key);
+  uint32_t numBins = 0;
+  if (!item.isValid() || !item.read(numBins))
+    {
+    return false;
+    }
+  bins.resize(numBins);
+  return item.read(bins.data(), numBins * sizeof(float));
+}
+
+//------------------------------------------------------------------------------
+void volSidecarCache::storeHistogram(int sampleRate,
+                                     const std::vector<float> &bins)
+{
+  if (!m_valid)
+    {
+    return;
+    }
+  std::vector<char> payload;
+  append(payload, static_cast<uint32_t>(bins.size()));
+  append(payload, bins.data(), bins.size() * sizeof(float));
+
+  const uint64_t key = this->itemKey(HistogramItem, sampleRate);
+  this->writeItem(this->itemFileName(key, Suffixes[HistogramItem]),
+                  HistogramItem, key, payload);
+}
+
+//------------------------------------------------------------------------------
+std::map<double, vtkSmartPointer<vtkPolyData> >
+volSidecarCache::isosurfaces(int sampleRate) const
+{
+  std::map<double, vtkSmartPointer<vtkPolyData> > result;
+  if (!m_valid)
+    {
+    return result;
+    }
+
+  const std::vector<std::string> items =
+      listItems(m_directory, IsosurfaceItem);
+  for (size_t i = 0; i < items.size(); ++i)
+    {
+    MappedItem item(items[i], IsosurfaceItem, m_contentKey);
+    double value = 0.;
+    vtkSmartPointer<vtkPolyData> surface;
+    if (item.isValid())
+      {
+      surface = readIsosurface(item, sampleRate, value);
+      }
+    if (surface)
+      {
+      result[value] = surface;
+      }
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void volSidecarCache::storeIsosurface(int sampleRate, double value,
+                                      vtkPolyData *surface)
+{
+  if (!m_valid || !surface || !surface->GetPoints())
+    {
+    return;
+    }
+
+  const vtkIdType numPoints = surface->GetNumberOfPoints();
+  vtkDataArray *normals = surface->GetPointData()->GetNormals();
+  vtkDataArray *scalars = surface->GetPointData()->GetScalars();
+  const int32_t hasNormals = normals != nullptr;
+
+  std::vector<int32_t> triangles;
+  vtkCellArray *polys = surface->GetPolys();
+  vtkNew<vtkIdList> ids;
+  polys->InitTraversal();
+  while (polys->GetNextCell(ids.Get()))
+    {
+    // Contour filters only make triangles:
+    if (ids->GetNumberOfIds() == 3)
+      {
+      for (int j = 0; j < 3; ++j)
+        {
+        triangles.push_back(static_cast<int32_t>(ids->GetId(j)));
+        }
+      }
+    }
+
+  std::vector<char> payload;
+  append(payload, value);
+  append(payload, static_cast<int32_t>(sampleRate));
+  append(payload, hasNormals);
+  append(payload, static_cast<uint64_t>(numPoints));
+  append(payload, static_cast<uint64_t>(triangles.size() / 3));
+  pad(payload);
+  double x[3];
+  for (vtkIdType i = 0; i < numPoints; ++i)
+    {
+    surface->GetPoint(i, x);
+    for (int c = 0; c < 3; ++c)
+      {
+      append(payload, static_cast<float>(x[c]));
+      }
+    }
+  pad(payload);
+  for (vtkIdType i = 0; hasNormals && i < numPoints; ++i)
+    {
+    normals->GetTuple(i, x);
+    for (int c = 0; c < 3; ++c)
+      {
+      append(payload, static_cast<float>(x[c]));
+      }
+    }
+  pad(payload);
+  for (vtkIdType i = 0; i < numPoints; ++i)
+    {
+    append(payload, static_cast<float>(scalars ? scalars->GetComponent(i, 0)
+                                               : value));
+    }
+  pad(payload);
+  append(payload, triangles.data(), triangles.size() * sizeof(int32_t));
+
+  const uint64_t key = this->itemKey(IsosurfaceItem, sampleRate, value);
+  if (this->writeItem(this->itemFileName(key, Suffixes[IsosurfaceItem]),
+                      IsosurfaceItem, key, payload))
+    {
+    this->pruneIsosurfaces();
+    }
+}
+
+//------------------------------------------------------------------------------
+uint64_t volSidecarCache::itemKey(int kind, int sampleRate, double value) const
+{
+  uint64_t key = fnv1a(m_contentKey, FnvOffset);
+  key = fnv1a(static_cast<int32_t>(kind), key);
+  key = fnv1a(static_cast<int32_t>(sampleRate), key);
+  key = fnv1a(value, key);
+  return key != 0 ? key : 1;
+}
+
+//------------------------------------------------------------------------------
+std::string volSidecarCache::itemFileName(uint64_t key,
+                                          const char *suffix) const
+{
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(key));
+  return m_directory + "/" + name + suffix;
+}
+
+//------------------------------------------------------------------------------
+bool volSidecarCache::writeItem(const std::string &fileName, int kind,
+                                uint64_t key, const std::vector<char> &payload)
+{
+  static std::atomic<unsigned> counter(0);
+
+  ItemHeader header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.kind = kind;
+  header.contentKey = m_contentKey;
+  header.key = key;
+  header.payloadSize = payload.size();
+
+  // Write to a temporary file unique to this call first, so readers never
+  // map a partial item:
+  mkdir(m_directory.c_str(), 0777);
+  std::ostringstream tmpName;
+  tmpName << fileName << ".tmp" << getpid() << "." << counter++;
+  std::ofstream out(tmpName.str().c_str(), std::ios::binary | std::ios::trunc);
+  if (out)
+    {
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    out.close();
+    }
+
+  if (!out || std::rename(tmpName.str().c_str(), fileName.c_str()) != 0)
+    {
+    std::remove(tmpName.str().c_str());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_writeFailed)
+      {
+      std::cerr << "Cannot write derived data to " << m_directory << ".\n";
+      m_writeFailed = true;
+      }
+    return false;
+    }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void volSidecarCache::removeStaleItems() const
+{
+  const std::vector<std::string> items = listItems(m_directory, 0);
+  for (size_t i = 0; i < items.size(); ++i)
+    {
+    ItemHeader header;
+    if (!readHeader(items[i], header) || header.contentKey != m_contentKey)
+      {
+      std::remove(items[i].c_str());
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+void volSidecarCache::pruneIsosurfaces() const
+{
+  std::vector<std::pair<double, std::string> > items;
+  const std::vector<std::string> names =
+      listItems(m_directory, IsosurfaceItem);
+  for (size_t i = 0; i < names.size(); ++i)
+    {
+    struct stat info;
+    if (stat(names[i].c_str(), &info) == 0)
+      {
+      items.push_back(std::make_pair(info.st_mtim.tv_sec +
+                                     1e-9 * info.st_mtim.tv_nsec, names[i]));
+      }
+    }
+  if (items.size() <= MaxIsosurfaces)
+    {
+    return;
+    }
+
+  // Newest first:
+  std::sort(items.begin(), items.end(),
+            [](const std::pair<double, std::string> &a,
+               const std::pair<double, std::string> &b)
+            { return a.first > b.first; });
+  for (size_t i = MaxIsosurfaces; i < items.size(); ++i)
+    {
+    std::remove(items[i].second.c_str());
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef VOLSIDECARCACHE_H
+#define VOLSIDECARCACHE_H
+
+#include <vtkSmartPointer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class vtkImageData;
+class vtkPolyData;
+
+/**
+ * @brief The volSidecarCache class keeps data derived from a volume file in a
+ * directory next to it, so that reopening the file does not recompute it.
+ *
+ * Each item (the reduced data at a sample rate, which form a pyramid as the
+ * sample rate changes, the histogram, recently used isosurfaces) is a file of
+ * its own, named by a hash of the source's content key and the item's
+ * parameters. Items are written through a temporary file, so concurrent
+ * readers and writers never see partial items. Loaded items are mapped into
+ * memory, and their arrays and triangles use the mapping as it is; it is
+ * released with the last of them.
+ *
+ * The content key hashes the size and modification time of the source and
+ * blocks sampled through it; hashing every byte would cost as much as reading
+ * the file. Items left over from an earlier version of the source are removed
+ * when the cache is opened.
+ *
+ * Methods may be called concurrently from worker threads.
+ */
+class volSidecarCache
+{
+public:
+  /** Isosurfaces kept per source; the least recently stored are dropped. */
+  static const size_t MaxIsosurfaces = 16;
+
+  /** Opens (but does not create) the cache of source. */
+  explicit volSidecarCache(const std::string &source);
+  ~volSidecarCache();
+
+  /** The cache directory used for source. */
+  static std::string defaultDirectory(const std::string &source);
+
+  /** Hash identifying the content of source. False if it can't be read. */
+  static bool contentKey(const std::string &source, uint64_t &key);
+
+  /** False if the source could not be read. Nothing is cached then. */
+  bool isValid() const { return m_valid; }
+  const std::string& directory() const { return m_directory; }
+  uint64_t contentKey() const { return m_contentKey; }
+
+  /** The reduced data at sampleRate (a level of the pyramid), or null. */
+  vtkSmartPointer<vtkImageData> reducedData(int sampleRate) const;
+  void storeReducedData(int sampleRate, vtkImageData *image);
+
+  /**
+   * Histogram of the data reduced at sampleRate (1 for the full resolution
+   * data). False if not cached.
+   */
+  bool histogram(int sampleRate, std::vector<float> &bins) const;
+  void storeHistogram(int sampleRate, const std::vector<float> &bins);
+
+  /** The isosurfaces of the data reduced at sampleRate, by contour value. */
+  std::map<double, vtkSmartPointer<vtkPolyData> >
+  isosurfaces(int sampleRate) const;
+  void storeIsosurface(int sampleRate, double value, vtkPolyData *surface);
+
+private:
+  // Not implemented:
+  volSidecarCache(const volSidecarCache&);
+  volSidecarCache& operator=(const volSidecarCache&);
+
+  uint64_t itemKey(int kind, int sampleRate, double value = 0.) const;
+  std::string itemFileName(uint64_t key, const char *suffix) const;
+  bool writeItem(const std::string &fileName, int kind, uint64_t key,
+                 const std::vector<char> &payload);
+  void removeStaleItems() const;
+  void pruneIsosurfaces() const;
+
+  std::string m_directory;
+  uint64_t m_contentKey;
+  bool m_valid;
+
+  // Whether a write failed; warn only once:
+  std::mutex m_mutex;
+  bool m_writeFailed;
+};
+
+#endif // VOLSIDECARCACHE_H
@@ -4,18 +4,24 @@
 #include "volContextState.h"
 #include "volContours.h"
 #include "volReader.h"
+#include "volTransferFunction.h"
 
 #include <vtkActor.h>
+#include <vtkClipPolyData.h>
 #include <vtkContourFilter.h>
 #include <vtkDataObject.h>
 #include <vtkExternalOpenGLRenderer.h>
 #include <vtkFlyingEdgesPlaneCutter.h>
+#include <vtkImageData.h>
 #include <vtkLookupTable.h>
 #include <vtkPlane.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
 #include <vtkSampleImplicitFunctionFilter.h>
 
+#include <algorithm>
+#include <cmath>
+
 //------------------------------------------------------------------------------
 volSlices::volSlices()
 {
@@ -180,13 +186,10 @@ void volSlices::ObjectState::update(const vvApplicationState &appState)
     this->contourPlanes[i]->SetOrigin(origin.data());
     }
 
-  for (vtkIdType i = 0; i < 256; ++i)
+  if (this->color->GetNumberOfTableValues() == 0 ||
+      this->color->GetMTime() < state.sliceTransferFunction().timeStamp())
     {
-    this->color->SetTableValue(i,
-                               state.sliceColorMap()[4*i + 0],
-                               state.sliceColorMap()[4*i + 1],
-                               state.sliceColorMap()[4*i + 2],
-                               1.);
+    state.sliceTransferFunction().exportLookupTable(this->color.Get());
     }
 }
 
@@ -196,6 +199,7 @@ volSlices::DataPipeline::DataPipeline(vvLODAsyncGLObject::LevelOfDetail l)
 {
   for (size_t i = 0; i < 3; ++i)
     {
+    this->sliceOutputs[i] = this->sliceCutters[i].Get();
     this->sliceCutters[i]->ComputeNormalsOff();
     this->sliceCutters[i]->InterpolateAttributesOn();
 
@@ -222,6 +226,7 @@ void volSlices::DataPipeline::configure(
       static_cast<const ObjectState&>(objStateIn);
 
   vtkDataObject *input = nullptr;
+  bool fullResolution = false;
   switch (this->lod)
     {
     case LevelOfDetail::LoRes:
@@ -240,6 +245,7 @@ void volSlices::DataPipeline::configure(
       else
         {
         input = state.reader().dataObject();
+        fullResolution = true;
         }
       break;
 
@@ -250,10 +256,39 @@ void volSlices::DataPipeline::configure(
 
   vtkDataObject *contours = state.contours().contourData(this->lod);
 
+  // Contours arrive already clipped from volContours; only the slices need
+  // to be clipped here.
+  vtkImageData *image = vtkImageData::SafeDownCast(input);
+  this->clipper.configure(image, state, fullResolution);
+  std::shared_ptr<volBrickPager> pager = this->clipper.pager();
+
   for (size_t i = 0; i < 3; ++i)
     {
     this->sliceCutters[i]->SetPlane(objState.slicePlanes[i].Get());
-    this->sliceCutters[i]->SetInputDataObject(input);
+
+    // Out of core, each cutter only pages in the cells around its plane:
+    this->slabs[i].setPager(pager);
+    if (pager && image->GetSpacing()[i] != 0.)
+      {
+      std::array<int, 6> slab = this->clipper.extent();
+      const double index =
+          (objState.slicePlanes[i]->GetOrigin()[i] - image->GetOrigin()[i]) /
+          image->GetSpacing()[i];
+      const int lo = std::max(slab[2 * i],
+                              std::min(static_cast<int>(std::floor(index)),
+                                       slab[2 * i + 1] - 1));
+      slab[2 * i + 1] = std::min(lo + 1, slab[2 * i + 1]);
+      slab[2 * i] = lo;
+      this->slabs[i].setExtent(slab);
+      this->sliceCutters[i]->SetInputConnection(
+            this->slabs[i].producer()->GetOutputPort());
+      }
+    else
+      {
+      this->clipper.connectInput(this->sliceCutters[i].Get());
+      }
+    this->sliceOutputs[i] = this->clipper.connectOutput(
+          this->sliceCutters[i].Get(), this->sliceClips[i].Get());
 
     this->contourAddPlane[i]->SetInputDataObject(contours);
     this->contourAddPlane[i]->SetImplicitFunction(
@@ -280,7 +315,9 @@ bool volSlices::DataPipeline::needsUpdate(
       {
       if (result.slices[i].Get() == nullptr ||
           result.slices[i]->GetMTime() < state.slicePlanes[i]->GetMTime() ||
-          result.slices[i]->GetMTime() < this->sliceCutters[i]->GetMTime())
+          result.slices[i]->GetMTime() < this->sliceCutters[i]->GetMTime() ||
+          result.slices[i]->GetMTime() < this->clipper.GetMTime() ||
+          result.slices[i]->GetMTime() < this->slabs[i].GetMTime())
         {
         return true;
         }
@@ -307,7 +344,8 @@ void volSlices::DataPipeline::execute()
     {
     if (this->sliceCutters[i]->GetInputDataObject(0, 0) != nullptr)
       {
-      this->sliceCutters[i]->Update();
+      this->slabs[i].update();
+      this->sliceOutputs[i]->Update();
       }
     if (this->contourAddPlane[i]->GetInputDataObject(0, 0) != nullptr)
       {
@@ -323,7 +361,7 @@ void volSlices::DataPipeline::exportResult(
   LODData &result = static_cast<LODData&>(resultIn);
   for (size_t i = 0; i < 3; ++i)
     {
-    vtkDataObject *data = this->sliceCutters[i]->GetOutputDataObject(0);
+    vtkDataObject *data = this->sliceOutputs[i]->GetOutputDataObject(0);
     if (data)
       {
       result.slices[i].TakeReference(data->NewInstance());
@@ -3,10 +3,14 @@
 
 #include <vvLODAsyncGLObject.h>
 
+#include "volDataClipper.h"
+
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 
 class vtkActor;
+class vtkAlgorithm;
+class vtkClipPolyData;
 class vtkContourFilter;
 class vtkFlyingEdgesPlaneCutter;
 class vtkDataObject;
@@ -72,7 +76,11 @@ public:
     void exportResult(Superclass::LODData &result) const override;
 
     LevelOfDetail lod;
+    volDataClipper clipper;
     std::array<vtkNew<vtkFlyingEdgesPlaneCutter>, 3> sliceCutters;
+    std::array<vtkNew<vtkClipPolyData>, 3> sliceClips;
+    std::array<vtkAlgorithm*, 3> sliceOutputs;
+    std::array<volPagedSource, 3> slabs;
     std::array<vtkNew<vtkSampleImplicitFunctionFilter>, 3> contourAddPlane;
     std::array<vtkNew<vtkContourFilter>, 3> contourCutters;
   };
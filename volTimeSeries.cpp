@@ -0,0 +1,479 @@
+#include "volTimeSeries.h"
+
+#include "volVTIReader.h"
+
+#include <vtkExtractVOI.h>
+#include <vtkFlyingEdges3D.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkXMLImageDataReader.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include <glob.h>
+#include <sys/stat.h>
+
+namespace {
+
+//------------------------------------------------------------------------------
+bool fileExists(const std::string &fileName)
+{
+  struct stat info;
+  return stat(fileName.c_str(), &info) == 0;
+}
+
+//------------------------------------------------------------------------------
+// Compute the isosurfaces of step's reduced data the way the LoRes
+// isosurface pipelines would.
+void addContours(volTimeSeries::Step &step, const std::vector<double> &values)
+{
+  if (!step.reducedData)
+    {
+    return;
+    }
+
+  vtkNew<vtkFlyingEdges3D> contour;
+  contour->ComputeNormalsOn();
+  contour->ComputeGradientsOff();
+  contour->SetInputData(step.reducedData);
+  for (size_t i = 0; i < values.size(); ++i)
+    {
+    if (step.contours.count(values[i]))
+      {
+      continue;
+      }
+    contour->SetValue(0, values[i]);
+    contour->Update();
+    vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->ShallowCopy(contour->GetOutput());
+    step.contours[values[i]] = surface;
+    }
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volTimeSeries::volTimeSeries()
+  : m_ring(DefaultCapacity + 1),
+    m_currentStep(0),
+    m_sampleRate(4),
+    m_stop(false),
+    m_readingAhead(false)
+{
+}
+
+//------------------------------------------------------------------------------
+volTimeSeries::~volTimeSeries()
+{
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stop = true;
+  }
+  if (m_readAheadTask.valid())
+    {
+    m_readAheadTask.wait();
+    }
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string>
+volTimeSeries::expandPattern(const std::string &pattern)
+{
+  std::vector<std::string> result;
+
+  if (pattern.find_first_of("*?[") != std::string::npos)
+    {
+    glob_t matches;
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+      {
+      result.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+      }
+    globfree(&matches);
+    }
+  else if (pattern.find('%') != std::string::npos)
+    {
+    char buffer[4096];
+    for (int first = 0; first < 2 && result.empty(); ++first)
+      {
+      for (int i = first; ; ++i)
+        {
+        std::snprintf(buffer, sizeof(buffer), pattern.c_str(), i);
+        if (!fileExists(buffer))
+          {
+          break;
+          }
+        result.push_back(buffer);
+        }
+      }
+    }
+  else
+    {
+    result.push_back(pattern);
+    }
+
+  if (result.empty())
+    {
+    std::cerr << "No files match " << pattern << ".\n";
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::setFileNames(const std::vector<std::string> &fileNames)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_fileNames = fileNames;
+  std::fill(m_ring.begin(), m_ring.end(), StepPointer());
+  m_currentStep = 0;
+  m_store.clear();
+  m_store.setNumberOfSteps(m_fileNames.size());
+  m_store.setCurrentStep(0);
+  this->readAhead();
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeries::capacity() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_ring.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::setCapacity(size_t steps)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Keep the current step and the steps that are still upcoming:
+  std::vector<StepPointer> ring;
+  for (size_t i = 0; i < m_ring.size(); ++i)
+    {
+    if (m_ring[i] && this->distance(m_ring[i]->index) <= steps)
+      {
+      ring.push_back(m_ring[i]);
+      }
+    }
+  ring.resize(steps + 1);
+  m_ring.swap(ring);
+  this->readAhead();
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeries::decodedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t bytes = 0;
+  for (size_t i = 0; i < m_ring.size(); ++i)
+    {
+    const StepPointer &step = m_ring[i];
+    if (!step || this->distance(step->index) == 0)
+      {
+      continue;
+      }
+    if (step->data)
+      {
+      bytes += static_cast<size_t>(step->data->GetActualMemorySize()) << 10;
+      }
+    if (step->reducedData)
+      {
+      bytes +=
+          static_cast<size_t>(step->reducedData->GetActualMemorySize()) << 10;
+      }
+    for (auto it = step->contours.begin(); it != step->contours.end(); ++it)
+      {
+      if (it->second)
+        {
+        bytes += static_cast<size_t>(it->second->GetActualMemorySize()) << 10;
+        }
+      }
+    }
+  return bytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeries::currentStep() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_currentStep;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::setCurrentStep(size_t step)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (step < m_fileNames.size())
+    {
+    m_currentStep = step;
+    m_store.setCurrentStep(step);
+    this->readAhead();
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeries::nextStep(size_t step) const
+{
+  return m_fileNames.empty() ? 0 : (step + 1) % m_fileNames.size();
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::setSampleRate(int rate)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (rate != m_sampleRate)
+    {
+    m_sampleRate = rate;
+    this->readAhead();
+    }
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::setSpeculativeContours(const std::vector<double> &values)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (values != m_contours)
+    {
+    m_contours = values;
+    this->readAhead();
+    }
+}
+
+//------------------------------------------------------------------------------
+volTimeSeries::StepPointer
+volTimeSeries::find(const std::string &fileName) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (size_t i = 0; i < m_ring.size(); ++i)
+    {
+    if (m_ring[i] && m_ring[i]->data && m_ring[i]->fileName == fileName)
+      {
+      return m_ring[i];
+      }
+    }
+  return StepPointer();
+}
+
+//------------------------------------------------------------------------------
+bool volTimeSeries::isReady(size_t step) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return this->entry(step) != nullptr;
+}
+
+//------------------------------------------------------------------------------
+volTimeSeries::StepPointer volTimeSeries::load(const std::string &fileName)
+{
+  StepPointer result = this->find(fileName);
+  if (result)
+    {
+    return result;
+    }
+
+  size_t step = 0;
+  int sampleRate = 0;
+  std::vector<double> contours;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = std::find(m_fileNames.begin(), m_fileNames.end(), fileName);
+  if (it == m_fileNames.end())
+    {
+    return result;
+    }
+  step = static_cast<size_t>(it - m_fileNames.begin());
+  sampleRate = m_sampleRate;
+  contours = m_contours;
+  }
+
+  if (!m_store.contains(step))
+    {
+    return result;
+    }
+  result = this->decode(step, sampleRate, contours);
+  return result->data ? result : StepPointer();
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeries::distance(size_t step) const
+{
+  const size_t n = m_fileNames.size();
+  return n > 0 ? (step + n - m_currentStep) % n : 0;
+}
+
+//------------------------------------------------------------------------------
+const volTimeSeries::StepPointer *volTimeSeries::entry(size_t step) const
+{
+  for (size_t i = 0; i < m_ring.size(); ++i)
+    {
+    if (m_ring[i] && m_ring[i]->index == step)
+      {
+      return &m_ring[i];
+      }
+    }
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::store(const StepPointer &step)
+{
+  // Replace the step's previous version, or else an empty entry or one that
+  // is no longer current or upcoming. There always is one: the ring holds as
+  // many entries as there are current and upcoming steps.
+  size_t slot = m_ring.size();
+  for (size_t i = 0; i < m_ring.size(); ++i)
+    {
+    if (m_ring[i] && m_ring[i]->index == step->index)
+      {
+      slot = i;
+      break;
+      }
+    if (slot == m_ring.size() &&
+        (!m_ring[i] || this->distance(m_ring[i]->index) >= m_ring.size()))
+      {
+      slot = i;
+      }
+    }
+  if (slot < m_ring.size())
+    {
+    m_ring[slot] = step;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool volTimeSeries::needsDecode(size_t step) const
+{
+  const StepPointer *decoded = this->entry(step);
+  if (!decoded || (*decoded)->sampleRate != m_sampleRate)
+    {
+    return true;
+    }
+  if (!(*decoded)->data)
+    { // Failed to read; don't retry.
+    return false;
+    }
+  for (size_t i = 0; i < m_contours.size(); ++i)
+    {
+    if (!(*decoded)->contours.count(m_contours[i]))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::readAhead()
+{
+  // Called with m_mutex held. The running task picks up any new request
+  // before it finishes, see runReadAhead().
+  if (!m_readingAhead && !m_stop && m_fileNames.size() > 1)
+    {
+    m_readingAhead = true;
+    m_readAheadTask = std::async(std::launch::async,
+                                 &volTimeSeries::runReadAhead, this);
+    }
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeries::runReadAhead()
+{
+  for (;;)
+    {
+    size_t step = 0;
+    int sampleRate = 0;
+    std::vector<double> contours;
+    StepPointer previous;
+    {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t n = m_fileNames.size();
+    bool found = false;
+    // Nearest upcoming steps first:
+    for (size_t i = 1; !m_stop && !found && i < std::min(m_ring.size(), n);
+         ++i)
+      {
+      step = (m_currentStep + i) % n;
+      found = this->needsDecode(step);
+      }
+    if (!found)
+      {
+      m_readingAhead = false;
+      return;
+      }
+    sampleRate = m_sampleRate;
+    contours = m_contours;
+    const StepPointer *decoded = this->entry(step);
+    previous = decoded ? *decoded : StepPointer();
+    }
+
+    StepPointer decoded;
+    if (previous && previous->sampleRate == sampleRate)
+      { // Only the isosurfaces are missing.
+      std::shared_ptr<Step> updated = std::make_shared<Step>(*previous);
+      addContours(*updated, contours);
+      decoded = updated;
+      }
+    else
+      {
+      decoded = this->decode(step, sampleRate, contours);
+      }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The current step may have moved on meanwhile; only keep upcoming steps.
+    const size_t ahead = this->distance(step);
+    if (ahead > 0 && ahead < m_ring.size())
+      {
+      this->store(decoded);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+volTimeSeries::StepPointer
+volTimeSeries::decode(size_t step, int sampleRate,
+                      const std::vector<double> &contours)
+{
+  std::shared_ptr<Step> result = std::make_shared<Step>();
+  result->index = step;
+  result->sampleRate = sampleRate;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  result->fileName = m_fileNames[step];
+  }
+
+  // Steps seen before are decompressed rather than read again:
+  result->data = m_store.decode(step);
+  if (!result->data)
+    {
+    result->data = volVTIReader::read(result->fileName);
+    if (!result->data)
+      {
+      vtkNew<vtkXMLImageDataReader> reader;
+      reader->SetFileName(result->fileName.c_str());
+      reader->Update();
+      vtkImageData *image = reader->GetOutput();
+      if (!image || image->GetNumberOfPoints() == 0)
+        {
+        std::cerr << "Failed to read timestep " << result->fileName << ".\n";
+        return result;
+        }
+      result->data = vtkSmartPointer<vtkImageData>::New();
+      result->data->ShallowCopy(image);
+      }
+    m_store.add(step, result->data);
+    }
+
+  // Same as volReader's reducer:
+  int dims[3];
+  result->data->GetDimensions(dims);
+  vtkNew<vtkExtractVOI> reducer;
+  reducer->IncludeBoundaryOn();
+  reducer->SetInputData(result->data);
+  reducer->SetSampleRate(sampleRate, sampleRate, sampleRate);
+  reducer->SetVOI(0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1);
+  reducer->Update();
+  result->reducedData = vtkSmartPointer<vtkImageData>::New();
+  result->reducedData->ShallowCopy(reducer->GetOutput());
+
+  addContours(*result, contours);
+  return result;
+}
@@ -0,0 +1,133 @@
+#ifndef VOLTIMESERIES_H
+#define VOLTIMESERIES_H
+
+#include "volTimeSeriesStore.h"
+
+#include <vtkSmartPointer.h>
+
+#include <cstddef>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class vtkImageData;
+class vtkPolyData;
+
+/**
+ * @brief The volTimeSeries class holds the files of a time-varying volume and
+ * decodes upcoming timesteps in the background.
+ *
+ * A ring buffer keeps the steps following currentStep() read and reduced, so
+ * that volReader can pick them up without touching the disk. Steps are not
+ * bricked here: volReader bricks the current step once something samples it.
+ * Isosurfaces of the reduced data are computed ahead of time for the contour
+ * values passed to setSpeculativeContours(), and used by the LoRes
+ * isosurface pipelines when the step becomes current.
+ *
+ * The scalars of every step read are also kept delta compressed in store(),
+ * in their own type, so that later passes over the series are decoded from
+ * memory instead of read from disk.
+ */
+class volTimeSeries
+{
+public:
+  /** A decoded timestep. Never modified once handed out. */
+  struct Step
+  {
+    size_t index{0};
+    std::string fileName;
+    int sampleRate{0};
+    vtkSmartPointer<vtkImageData> data;
+    vtkSmartPointer<vtkImageData> reducedData;
+    std::map<double, vtkSmartPointer<vtkPolyData> > contours;
+  };
+  using StepPointer = std::shared_ptr<const Step>;
+
+  /** Steps decoded ahead of the current one by default. */
+  static const size_t DefaultCapacity = 4;
+
+  volTimeSeries();
+  ~volTimeSeries();
+
+  /**
+   * Expand a file pattern: a shell wildcard ("run/*.vti"), a printf-style
+   * step number ("run/step_%04d.vti", counting from 0 or 1 until a file is
+   * missing), or a plain file name. Wildcard matches are sorted by name.
+   */
+  static std::vector<std::string> expandPattern(const std::string &pattern);
+
+  void setFileNames(const std::vector<std::string> &fileNames);
+  const std::vector<std::string>& fileNames() const { return m_fileNames; }
+  size_t numberOfSteps() const { return m_fileNames.size(); }
+
+  /** Number of upcoming steps kept decoded. */
+  size_t capacity() const;
+  void setCapacity(size_t steps);
+
+  /** Bytes held by the decoded steps ahead of the current one. */
+  size_t decodedBytes() const;
+
+  /** The step being shown. Setting it reads ahead of it. */
+  size_t currentStep() const;
+  void setCurrentStep(size_t step);
+
+  /** The step after step, wrapping around at the end. */
+  size_t nextStep(size_t step) const;
+
+  /** Sample rate of the reduced data, see volReader::sampleRate(). */
+  void setSampleRate(int rate);
+
+  /** Isosurface values to compute ahead of time on the reduced data. */
+  void setSpeculativeContours(const std::vector<double> &values);
+
+  /** The decoded step read from fileName, or null. Thread safe. */
+  StepPointer find(const std::string &fileName) const;
+
+  /** True if step has been decoded (or failed to read). Thread safe. */
+  bool isReady(size_t step) const;
+
+  /**
+   * Like find(), but decodes the step from store() if it is held there and
+   * not decoded yet. Called on worker threads.
+   */
+  StepPointer load(const std::string &fileName);
+
+  /** Compressed copies of the steps read so far. */
+  volTimeSeriesStore& store() { return m_store; }
+  const volTimeSeriesStore& store() const { return m_store; }
+
+private:
+  // Not implemented:
+  volTimeSeries(const volTimeSeries&);
+  volTimeSeries& operator=(const volTimeSeries&);
+
+  size_t distance(size_t step) const;
+  const StepPointer* entry(size_t step) const;
+  void store(const StepPointer &step);
+  bool needsDecode(size_t step) const;
+  void readAhead();
+  void runReadAhead();
+  StepPointer decode(size_t step, int sampleRate,
+                     const std::vector<double> &contours);
+
+  std::vector<std::string> m_fileNames;
+
+  // Ring buffer of decoded steps, holding the current step and up to
+  // capacity() upcoming ones, in no particular order:
+  mutable std::mutex m_mutex;
+  std::vector<StepPointer> m_ring;
+  size_t m_currentStep;
+  int m_sampleRate;
+  std::vector<double> m_contours;
+  bool m_stop;
+
+  std::future<void> m_readAheadTask;
+  bool m_readingAhead;
+
+  volTimeSeriesStore m_store;
+};
+
+#endif // VOLTIMESERIES_H
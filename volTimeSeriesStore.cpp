@@ -0,0 +1,555 @@
+#include "volTimeSeriesStore.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Values per block. Blocks are compressed independently, in parallel.
+const size_t BlockValues = 16384;
+
+//------------------------------------------------------------------------------
+// XOR the bytes of block with those of reference (zero if null), and
+// run-length encode the zero bytes of the result one byte plane at a time,
+// most significant byte first: a zero byte is followed by the length of its
+// run (1-255), other bytes are copied.
+std::vector<unsigned char> encodeBlock(const unsigned char *block,
+                                       const unsigned char *reference,
+                                       size_t values, size_t valueSize)
+{
+  std::vector<unsigned char> bytes(block, block + values * valueSize);
+  if (reference)
+    {
+    for (size_t i = 0; i < bytes.size(); ++i)
+      {
+      bytes[i] ^= reference[i];
+      }
+    }
+
+  std::vector<unsigned char> result;
+  unsigned char run = 0;
+  for (size_t plane = 0; plane < valueSize; ++plane)
+    {
+    const size_t offset = valueSize - 1 - plane;
+    for (size_t i = 0; i < values; ++i)
+      {
+      const unsigned char byte = bytes[i * valueSize + offset];
+      if (byte == 0 && run < 255)
+        {
+        ++run;
+        continue;
+        }
+      if (run > 0)
+        {
+        result.push_back(0);
+        result.push_back(run);
+        run = 0;
+        }
+      if (byte == 0)
+        {
+        run = 1;
+        }
+      else
+        {
+        result.push_back(byte);
+        }
+      }
+    }
+  if (run > 0)
+    {
+    result.push_back(0);
+    result.push_back(run);
+    }
+
+  result.shrink_to_fit();
+  return result;
+}
+
+//------------------------------------------------------------------------------
+// Apply a delta made by encodeBlock() to block in place.
+void decodeBlock(const std::vector<unsigned char> &delta, unsigned char *block,
+                 size_t values, size_t valueSize)
+{
+  size_t pos = 0;
+  const size_t end = values * valueSize;
+  for (size_t i = 0; i < delta.size() && pos < end; ++i)
+    {
+    if (delta[i] == 0)
+      {
+      pos += i + 1 < delta.size() ? delta[++i] : 0;
+      continue;
+      }
+    const size_t offset = valueSize - 1 - pos / values;
+    block[(pos % values) * valueSize + offset] ^= delta[i];
+    ++pos;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Values in block b of an array of numberOfValues values.
+size_t blockValues(size_t b, size_t numberOfValues)
+{
+  return std::min(BlockValues, numberOfValues - b * BlockValues);
+}
+
+//------------------------------------------------------------------------------
+struct EncodeFunctor
+{
+  const unsigned char *values;
+  const unsigned char *reference;
+  size_t numberOfValues;
+  size_t valueSize;
+  std::vector<std::shared_ptr<const std::vector<unsigned char> > > *blocks;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const size_t blockBytes = BlockValues * this->valueSize;
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const size_t n = blockValues(static_cast<size_t>(b),
+                                   this->numberOfValues);
+      const unsigned char *block = this->values + b * blockBytes;
+      const unsigned char *ref = this->reference ?
+            this->reference + b * blockBytes : nullptr;
+      if (ref && std::memcmp(block, ref, n * this->valueSize) == 0)
+        {
+        continue; // Unchanged.
+        }
+      (*this->blocks)[b] =
+          std::make_shared<std::vector<unsigned char> >(
+            encodeBlock(block, ref, n, this->valueSize));
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+struct ReplayFunctor
+{
+  const unsigned char *reference;
+  const std::vector<const std::vector<
+      std::shared_ptr<const std::vector<unsigned char> > >*> *chain;
+  size_t numberOfValues;
+  size_t valueSize;
+  unsigned char *values;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const size_t blockBytes = BlockValues * this->valueSize;
+    for (vtkIdType b = begin; b < end; ++b)
+      {
+      const size_t n = blockValues(static_cast<size_t>(b),
+                                   this->numberOfValues);
+      unsigned char *out = this->values + b * blockBytes;
+      if (this->reference)
+        {
+        const unsigned char *ref = this->reference + b * blockBytes;
+        std::copy(ref, ref + n * this->valueSize, out);
+        }
+      else
+        {
+        std::fill(out, out + n * this->valueSize, 0);
+        }
+      for (size_t i = 0; i < this->chain->size(); ++i)
+        {
+        const auto &delta = (*(*this->chain)[i])[b];
+        if (delta)
+          {
+          decodeBlock(*delta, out, n, this->valueSize);
+          }
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+const unsigned char* scalarBytes(vtkImageData *image)
+{
+  return static_cast<const unsigned char*>(
+        image->GetPointData()->GetScalars()->GetVoidPointer(0));
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+bool volTimeSeriesStore::Layout::operator==(const Layout &other) const
+{
+  return extent == other.extent && origin == other.origin &&
+      spacing == other.spacing && scalarType == other.scalarType &&
+      numberOfComponents == other.numberOfComponents &&
+      scalarName == other.scalarName;
+}
+
+//------------------------------------------------------------------------------
+volTimeSeriesStore::volTimeSeriesStore(size_t budget)
+  : m_budget(budget),
+    m_keyframeInterval(DefaultKeyframeInterval),
+    m_numberOfSteps(0),
+    m_currentStep(0),
+    m_storedBytes(0),
+    m_lastStep(0)
+{
+  m_layout.extent.fill(0);
+  m_layout.origin.fill(0.);
+  m_layout.spacing.fill(0.);
+}
+
+//------------------------------------------------------------------------------
+volTimeSeriesStore::~volTimeSeriesStore()
+{
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeriesStore::budget() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_budget;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::setBudget(size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_budget = bytes;
+  this->evict(m_currentStep);
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeriesStore::keyframeInterval() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_keyframeInterval;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::setKeyframeInterval(size_t steps)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // Only affects steps added from now on.
+  m_keyframeInterval = std::max<size_t>(steps, 1);
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::setNumberOfSteps(size_t steps)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (steps != m_numberOfSteps)
+    {
+    m_numberOfSteps = steps;
+    this->clearLocked();
+    }
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::setCurrentStep(size_t step)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_currentStep = step;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  this->clearLocked();
+}
+
+//------------------------------------------------------------------------------
+bool volTimeSeriesStore::layout(vtkImageData *image, Layout &result)
+{
+  vtkDataArray *scalars = image ? image->GetPointData()->GetScalars() : nullptr;
+  if (!scalars || scalars->GetDataTypeSize() == 0 ||
+      scalars->GetNumberOfTuples() == 0)
+    {
+    return false;
+    }
+  image->GetExtent(result.extent.data());
+  image->GetOrigin(result.origin.data());
+  image->GetSpacing(result.spacing.data());
+  result.scalarType = scalars->GetDataType();
+  result.numberOfComponents = scalars->GetNumberOfComponents();
+  result.scalarName = scalars->GetName() ? scalars->GetName() : "";
+  result.valueSize = static_cast<size_t>(scalars->GetDataTypeSize());
+  result.numberOfValues = static_cast<size_t>(scalars->GetNumberOfTuples()) *
+      static_cast<size_t>(scalars->GetNumberOfComponents());
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::add(size_t step, vtkImageData *image)
+{
+  Layout stepLayout;
+  if (!volTimeSeriesStore::layout(image, stepLayout))
+    {
+    return;
+    }
+  const size_t numBlocks =
+      (stepLayout.numberOfValues + BlockValues - 1) / BlockValues;
+
+  // Continue the group of the previous step if there is room in it:
+  size_t keyframe = step;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_frames.empty() && stepLayout != m_layout)
+    {
+    this->clearLocked();
+    }
+  if (m_frames.count(step))
+    {
+    return;
+    }
+  m_layout = stepLayout;
+
+  auto previous = step > 0 ? m_frames.find(step - 1) : m_frames.end();
+  if (previous != m_frames.end() &&
+      step - previous->second->keyframe < m_keyframeInterval)
+    {
+    keyframe = previous->second->keyframe;
+    }
+  }
+
+  vtkSmartPointer<vtkImageData> reference;
+  if (keyframe != step)
+    {
+    reference = this->decode(step - 1);
+    if (!reference)
+      { // Evicted meanwhile.
+      keyframe = step;
+      }
+    }
+
+  std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+  frame->keyframe = keyframe;
+  frame->blocks.resize(numBlocks);
+
+  EncodeFunctor functor;
+  functor.values = scalarBytes(image);
+  functor.reference = reference ? scalarBytes(reference) : nullptr;
+  functor.numberOfValues = stepLayout.numberOfValues;
+  functor.valueSize = stepLayout.valueSize;
+  functor.blocks = &frame->blocks;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numBlocks), 1, functor);
+
+  frame->bytes = sizeof(Frame) + numBlocks * sizeof(Delta);
+  for (size_t i = 0; i < numBlocks; ++i)
+    {
+    if (frame->blocks[i])
+      {
+      frame->bytes += frame->blocks[i]->size();
+      }
+    }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_frames.count(step) || stepLayout != m_layout)
+    {
+    return;
+    }
+  if (keyframe != step)
+    {
+    // The group may have been evicted (or replaced) while encoding:
+    auto previous = m_frames.find(step - 1);
+    if (previous == m_frames.end() || previous->second->keyframe != keyframe)
+      {
+      return;
+      }
+    }
+  m_frames[step] = frame;
+  m_storedBytes += frame->bytes;
+  m_lastStep = step;
+  m_last = image;
+  this->evict(step);
+}
+
+//------------------------------------------------------------------------------
+bool volTimeSeriesStore::contains(size_t step) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_frames.count(step) > 0;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> volTimeSeriesStore::decode(size_t step)
+{
+  std::vector<FramePointer> chain;
+  vtkSmartPointer<vtkImageData> reference;
+  Layout stepLayout;
+  {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  stepLayout = m_layout;
+  if (m_last && m_lastStep == step)
+    {
+    return m_last;
+    }
+
+  // Walk back to the keyframe, or to the last decoded step:
+  for (size_t s = step; ; --s)
+    {
+    auto frame = m_frames.find(s);
+    if (frame == m_frames.end())
+      {
+      return nullptr;
+      }
+    chain.push_back(frame->second);
+    if (s == frame->second->keyframe)
+      {
+      break;
+      }
+    if (m_last && m_lastStep == s - 1)
+      {
+      reference = m_last;
+      break;
+      }
+    }
+  }
+  std::reverse(chain.begin(), chain.end());
+
+  vtkSmartPointer<vtkImageData> result =
+      volTimeSeriesStore::replay(chain, reference, stepLayout);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (stepLayout == m_layout)
+    {
+    m_lastStep = step;
+    m_last = result;
+    }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeriesStore::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_frames.size();
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeriesStore::storedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_storedBytes;
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeriesStore::rawBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_frames.empty())
+    {
+    return 0;
+    }
+  return m_frames.size() * m_layout.numberOfValues * m_layout.valueSize;
+}
+
+//------------------------------------------------------------------------------
+double volTimeSeriesStore::compressionRatio() const
+{
+  const size_t raw = this->rawBytes();
+  const size_t stored = this->storedBytes();
+  return stored > 0 ? static_cast<double>(raw) / stored : 1.;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::clearLocked()
+{
+  m_frames.clear();
+  m_storedBytes = 0;
+  m_last = nullptr;
+}
+
+//------------------------------------------------------------------------------
+void volTimeSeriesStore::evict(size_t keep)
+{
+  // Called with m_mutex held. Groups are evicted whole, since the steps of a
+  // group depend on all steps before them. The groups holding the current
+  // step and keep stay.
+  while (m_storedBytes > m_budget)
+    {
+    auto current = m_frames.find(m_currentStep);
+    auto kept = m_frames.find(keep);
+    const size_t currentGroup = current != m_frames.end() ?
+          current->second->keyframe : m_currentStep;
+    const size_t keptGroup = kept != m_frames.end() ?
+          kept->second->keyframe : keep;
+
+    bool found = false;
+    size_t victim = 0;
+    for (auto it = m_frames.begin(); it != m_frames.end(); ++it)
+      {
+      const size_t group = it->second->keyframe;
+      if (group == currentGroup || group == keptGroup ||
+          (found && this->distance(group) <= this->distance(victim)))
+        {
+        continue;
+        }
+      victim = group;
+      found = true;
+      }
+    if (!found)
+      {
+      return;
+      }
+
+    for (auto it = m_frames.begin(); it != m_frames.end(); )
+      {
+      if (it->second->keyframe == victim)
+        {
+        m_storedBytes -= it->second->bytes;
+        it = m_frames.erase(it);
+        }
+      else
+        {
+        ++it;
+        }
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t volTimeSeriesStore::distance(size_t step) const
+{
+  const size_t n = std::max(m_numberOfSteps, std::max(step, m_currentStep) + 1);
+  return (step + n - m_currentStep) % n;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData>
+volTimeSeriesStore::replay(const std::vector<FramePointer> &chain,
+                           vtkImageData *reference,
+                           const Layout &stepLayout)
+{
+  const size_t numBlocks = chain.back()->blocks.size();
+  std::vector<const std::vector<Delta>*> deltas;
+  for (size_t i = 0; i < chain.size(); ++i)
+    {
+    deltas.push_back(&chain[i]->blocks);
+    }
+
+  vtkSmartPointer<vtkDataArray> scalars;
+  scalars.TakeReference(vtkDataArray::CreateDataArray(stepLayout.scalarType));
+  scalars->SetNumberOfComponents(stepLayout.numberOfComponents);
+  scalars->SetNumberOfTuples(static_cast<vtkIdType>(
+      stepLayout.numberOfValues / stepLayout.numberOfComponents));
+  if (!stepLayout.scalarName.empty())
+    {
+    scalars->SetName(stepLayout.scalarName.c_str());
+    }
+
+  ReplayFunctor functor;
+  functor.reference = reference ? scalarBytes(reference) : nullptr;
+  functor.chain = &deltas;
+  functor.numberOfValues = stepLayout.numberOfValues;
+  functor.valueSize = stepLayout.valueSize;
+  functor.values = static_cast<unsigned char*>(scalars->GetVoidPointer(0));
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numBlocks), 1, functor);
+
+  vtkSmartPointer<vtkImageData> result = vtkSmartPointer<vtkImageData>::New();
+  result->SetExtent(stepLayout.extent.data());
+  result->SetOrigin(stepLayout.origin.data());
+  result->SetSpacing(stepLayout.spacing.data());
+  result->GetPointData()->SetScalars(scalars);
+  return result;
+}
@@ -0,0 +1,150 @@
+#ifndef VOLTIMESERIESSTORE_H
+#define VOLTIMESERIESSTORE_H
+
+#include <vtkSmartPointer.h>
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class vtkImageData;
+
+/**
+ * @brief The volTimeSeriesStore class keeps the steps of a time series in
+ * memory, delta compressed.
+ *
+ * The point scalars of a step are kept as they were read: same type, number
+ * of components and name. Their bytes are split into blocks, and steps are
+ * stored as groups: a keyframe followed by steps holding only the blocks that
+ * changed since the step before them. A changed block is stored as the XOR of
+ * its bytes with the previous step's block, split into one byte plane per
+ * byte of a value and run-length encoded. Values of slowly varying fields
+ * share their high bytes, so most of the XOR is zero bytes; unchanged blocks
+ * cost nothing.
+ *
+ * decode() rebuilds a step by replaying its group from the keyframe (or from
+ * the last decoded step, if that is on the way), with the blocks decompressed
+ * in parallel. When the budget is exceeded, the groups furthest ahead of the
+ * current step are dropped first.
+ *
+ * All methods are thread safe.
+ */
+class volTimeSeriesStore
+{
+public:
+  /** Bytes of compressed steps kept by default. */
+  static const size_t DefaultBudget = size_t(1) << 30;
+
+  /** Steps between keyframes by default. Bounds the work of decode(). */
+  static const size_t DefaultKeyframeInterval = 16;
+
+  explicit volTimeSeriesStore(size_t budget = DefaultBudget);
+  ~volTimeSeriesStore();
+
+  /** Upper bound on the bytes of compressed steps. */
+  size_t budget() const;
+  void setBudget(size_t bytes);
+
+  size_t keyframeInterval() const;
+  void setKeyframeInterval(size_t steps);
+
+  /** Number of steps in the series. Clears the store if it changes. */
+  void setNumberOfSteps(size_t steps);
+
+  /** The step being shown; groups ahead of it are evicted last. */
+  void setCurrentStep(size_t step);
+
+  /** Drop all steps. */
+  void clear();
+
+  /**
+   * Compress and keep the point scalars of step. Ignored if the step is
+   * already stored. A step with a different extent, geometry or scalar
+   * array layout than the stored ones clears the store. image must not be
+   * modified afterwards.
+   */
+  void add(size_t step, vtkImageData *image);
+
+  bool contains(size_t step) const;
+
+  /**
+   * Decompress step, or return null if it is not stored. The result has the
+   * extent, geometry and point scalars of the image added, and must not be
+   * modified.
+   */
+  vtkSmartPointer<vtkImageData> decode(size_t step);
+
+  /** Number of steps stored. */
+  size_t size() const;
+
+  /** Bytes used by the compressed steps. */
+  size_t storedBytes() const;
+
+  /** Bytes the scalars of the stored steps use uncompressed. */
+  size_t rawBytes() const;
+
+  /** rawBytes() / storedBytes(), or 1 if empty. */
+  double compressionRatio() const;
+
+private:
+  // Not implemented:
+  volTimeSeriesStore(const volTimeSeriesStore&);
+  volTimeSeriesStore& operator=(const volTimeSeriesStore&);
+
+  // A compressed block; null if the block equals the reference block.
+  using Delta = std::shared_ptr<const std::vector<unsigned char> >;
+
+  struct Frame
+  {
+    size_t keyframe{0}; // First step of the group.
+    std::vector<Delta> blocks;
+    size_t bytes{0};
+  };
+  using FramePointer = std::shared_ptr<const Frame>;
+
+  // Extent, geometry and scalar array of a step:
+  struct Layout
+  {
+    std::array<int, 6> extent;
+    std::array<double, 3> origin;
+    std::array<double, 3> spacing;
+    int scalarType{0};
+    int numberOfComponents{0};
+    std::string scalarName;
+    size_t valueSize{0}; // Bytes per component.
+    size_t numberOfValues{0};
+
+    bool operator==(const Layout &other) const;
+    bool operator!=(const Layout &other) const { return !(*this == other); }
+  };
+
+  static bool layout(vtkImageData *image, Layout &result);
+  void clearLocked();
+  void evict(size_t keep);
+  size_t distance(size_t step) const;
+  static vtkSmartPointer<vtkImageData>
+  replay(const std::vector<FramePointer> &chain, vtkImageData *reference,
+         const Layout &stepLayout);
+
+  mutable std::mutex m_mutex;
+  size_t m_budget;
+  size_t m_keyframeInterval;
+  size_t m_numberOfSteps;
+  size_t m_currentStep;
+
+  // Layout shared by all stored steps:
+  Layout m_layout;
+
+  std::map<size_t, FramePointer> m_frames;
+  size_t m_storedBytes;
+
+  // Last step added or decoded, to continue a chain from:
+  size_t m_lastStep;
+  vtkSmartPointer<vtkImageData> m_last;
+};
+
+#endif // VOLTIMESERIESSTORE_H
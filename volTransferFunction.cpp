@@ -0,0 +1,125 @@
+#include "volTransferFunction.h"
+
+#include <vtkColorTransferFunction.h>
+#include <vtkLookupTable.h>
+#include <vtkNew.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+
+namespace {
+
+//------------------------------------------------------------------------------
+unsigned char toByte(double value)
+{
+  return static_cast<unsigned char>(
+        std::min(std::max(value, 0.), 1.) * 255. + 0.5);
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+volTransferFunction::volTransferFunction()
+  : m_resolution(DefaultResolution),
+    m_bytes(vtkSmartPointer<vtkUnsignedCharArray>::New())
+{
+  m_bytes->SetNumberOfComponents(4);
+  this->build();
+}
+
+//------------------------------------------------------------------------------
+volTransferFunction::~volTransferFunction()
+{
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction::setResolution(size_t entries)
+{
+  entries = std::max(entries, size_t(2));
+  if (entries != m_resolution)
+    {
+    m_resolution = entries;
+    this->build();
+    }
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction::setTable(const double *rgba, size_t entries)
+{
+  m_source.assign(rgba, rgba + 4 * entries);
+  this->build();
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction::exportColor(vtkColorTransferFunction *color,
+                                      const std::array<double, 2> &range) const
+{
+  // const_cast because VTK is not const correct:
+  color->BuildFunctionFromTable(range[0], range[1],
+                                static_cast<int>(m_resolution),
+                                const_cast<double*>(m_rgb.data()));
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction::exportOpacity(
+    vtkPiecewiseFunction *opacity, const std::array<double, 2> &range) const
+{
+  opacity->BuildFunctionFromTable(range[0], range[1],
+                                  static_cast<int>(m_resolution),
+                                  const_cast<double*>(m_opacity.data()));
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction::exportLookupTable(vtkLookupTable *lut) const
+{
+  // Each lookup table gets its own copy, as it appends its special colors
+  // (NaN, below and above range) to the table.
+  vtkNew<vtkUnsignedCharArray> table;
+  table->DeepCopy(m_bytes.Get());
+  lut->SetTable(table.Get());
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction::build()
+{
+  m_table.resize(4 * m_resolution);
+  m_rgb.resize(3 * m_resolution);
+  m_opacity.resize(m_resolution);
+  m_bytes->SetNumberOfTuples(static_cast<vtkIdType>(m_resolution));
+  unsigned char *bytes = m_bytes->GetPointer(0);
+
+  // Resample the source linearly, its first and last entries falling on ours:
+  const size_t sourceEntries = m_source.size() / 4;
+  const double scale = sourceEntries > 1
+      ? static_cast<double>(sourceEntries - 1) / (m_resolution - 1) : 0.;
+  for (size_t i = 0; i < m_resolution; ++i)
+    {
+    double rgba[4] = { 0., 0., 0., 0. };
+    if (sourceEntries > 0)
+      {
+      const double x = i * scale;
+      const size_t j = std::min(static_cast<size_t>(x), sourceEntries - 1);
+      const size_t k = std::min(j + 1, sourceEntries - 1);
+      const double t = x - j;
+      for (int c = 0; c < 4; ++c)
+        {
+        rgba[c] = (1. - t) * m_source[4 * j + c] + t * m_source[4 * k + c];
+        }
+      }
+
+    for (int c = 0; c < 4; ++c)
+      {
+      m_table[4 * i + c] = static_cast<float>(rgba[c]);
+      }
+    for (int c = 0; c < 3; ++c)
+      {
+      m_rgb[3 * i + c] = rgba[c];
+      bytes[4 * i + c] = toByte(rgba[c]);
+      }
+    m_opacity[i] = rgba[3];
+    bytes[4 * i + 3] = 255;
+    }
+
+  m_timeStamp.Modified();
+}
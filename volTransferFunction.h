@@ -0,0 +1,83 @@
+#ifndef VOLTRANSFERFUNCTION_H
+#define VOLTRANSFERFUNCTION_H
+
+#include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+class vtkColorTransferFunction;
+class vtkLookupTable;
+class vtkPiecewiseFunction;
+class vtkUnsignedCharArray;
+
+/**
+ * @brief The volTransferFunction class is a color map as a table of equally
+ * spaced RGBA entries, converted once for all of its users.
+ *
+ * setTable() takes the RGBA values exported by the transfer function dialogs
+ * and resamples them to resolution() entries. The tables the VTK objects need
+ * -- RGB and opacity nodes for the volume property, bytes for the lookup
+ * tables of the geometry, isosurfaces and slices -- are built in the same
+ * pass, so exporting to a VTK object copies a table instead of inserting
+ * entries one at a time (each of which sorts the nodes and modifies the
+ * object).
+ */
+class volTransferFunction
+{
+public:
+  /** Entries of the table by default. */
+  static const size_t DefaultResolution = 256;
+
+  volTransferFunction();
+  ~volTransferFunction();
+
+  /** Entries of the table; at least 2. Resamples the current table. */
+  size_t resolution() const { return m_resolution; }
+  void setResolution(size_t entries);
+
+  /**
+   * Set the table from entries RGBA values in [0, 1], the first one for the
+   * lowest scalar value, the last one for the highest.
+   */
+  void setTable(const double *rgba, size_t entries);
+
+  /** resolution() RGBA values in [0, 1]. */
+  const std::vector<float>& table() const { return m_table; }
+
+  /** Modified whenever the table changes. */
+  unsigned long int timeStamp() const { return m_timeStamp.GetMTime(); }
+
+  /** Replace the nodes of color, spread evenly over range. */
+  void exportColor(vtkColorTransferFunction *color,
+                   const std::array<double, 2> &range) const;
+
+  /** Replace the nodes of opacity, spread evenly over range. */
+  void exportOpacity(vtkPiecewiseFunction *opacity,
+                     const std::array<double, 2> &range) const;
+
+  /**
+   * Replace the table of lut. Opacity is left out -- the users of lookup
+   * tables set it on their actors.
+   */
+  void exportLookupTable(vtkLookupTable *lut) const;
+
+private:
+  // Not implemented:
+  volTransferFunction(const volTransferFunction&);
+  volTransferFunction& operator=(const volTransferFunction&);
+
+  void build();
+
+  size_t m_resolution;
+  std::vector<double> m_source; // RGBA, as given to setTable()
+  std::vector<float> m_table;
+  std::vector<double> m_rgb;
+  std::vector<double> m_opacity;
+  vtkSmartPointer<vtkUnsignedCharArray> m_bytes; // opaque RGBA
+  vtkTimeStamp m_timeStamp;
+};
+
+#endif // VOLTRANSFERFUNCTION_H
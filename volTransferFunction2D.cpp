@@ -0,0 +1,93 @@
+#include "volTransferFunction2D.h"
+
+#include <algorithm>
+#include <cmath>
+
+const size_t volTransferFunction2D::ValueEntries;
+const size_t volTransferFunction2D::MagnitudeEntries;
+
+//------------------------------------------------------------------------------
+volTransferFunction2D::volTransferFunction2D()
+{
+  this->build();
+}
+
+//------------------------------------------------------------------------------
+volTransferFunction2D::~volTransferFunction2D()
+{
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction2D::setRegions(const std::vector<Region> &regions)
+{
+  m_regions = regions;
+  this->build();
+}
+
+//------------------------------------------------------------------------------
+void volTransferFunction2D::build()
+{
+  const size_t V = ValueEntries;
+  const size_t M = MagnitudeEntries;
+  std::vector<double> transparency(V * M, 1.);
+  std::vector<double> weight(V * M, 0.);
+  std::vector<double> color(3 * V * M, 0.);
+
+  for (size_t r = 0; r < m_regions.size(); ++r)
+    {
+    const Region &region = m_regions[r];
+    const double center = 0.5 * (region.value[0] + region.value[1]);
+    const double halfWidth = 0.5 * (region.value[1] - region.value[0]);
+    const double alpha = std::min(std::max(region.rgba[3], 0.), 1.);
+    if (halfWidth < 0. || region.magnitude[1] < region.magnitude[0] ||
+        alpha <= 0.)
+      {
+      continue;
+      }
+
+    // Only the entries in the region's box:
+    const size_t v0 = static_cast<size_t>(std::max(
+          std::ceil(region.value[0] * (V - 1)), 0.));
+    const size_t v1 = static_cast<size_t>(std::max(std::min(
+          std::floor(region.value[1] * (V - 1)), V - 1.), -1.) + 1.);
+    const size_t m0 = static_cast<size_t>(std::max(
+          std::ceil(region.magnitude[0] * (M - 1)), 0.));
+    const size_t m1 = static_cast<size_t>(std::max(std::min(
+          std::floor(region.magnitude[1] * (M - 1)), M - 1.), -1.) + 1.);
+    for (size_t v = v0; v < v1; ++v)
+      {
+      const double x = static_cast<double>(v) / (V - 1);
+      const double a = halfWidth > 0.
+          ? alpha * std::max(1. - std::fabs(x - center) / halfWidth, 0.)
+          : alpha;
+      if (a <= 0.)
+        {
+        continue;
+        }
+      for (size_t m = m0; m < m1; ++m)
+        {
+        const size_t entry = v + V * m;
+        transparency[entry] *= 1. - a;
+        weight[entry] += a;
+        for (int c = 0; c < 3; ++c)
+          {
+          color[3 * entry + c] += a * region.rgba[c];
+          }
+        }
+      }
+    }
+
+  m_table.resize(4 * V * M);
+  for (size_t entry = 0; entry < V * M; ++entry)
+    {
+    for (int c = 0; c < 3; ++c)
+      {
+      m_table[4 * entry + c] = weight[entry] > 0.
+          ? static_cast<float>(std::min(std::max(
+                color[3 * entry + c] / weight[entry], 0.), 1.))
+          : 0.f;
+      }
+    m_table[4 * entry + 3] = static_cast<float>(1. - transparency[entry]);
+    }
+  m_timeStamp.Modified();
+}
@@ -0,0 +1,70 @@
+#ifndef VOLTRANSFERFUNCTION2D_H
+#define VOLTRANSFERFUNCTION2D_H
+
+#include <vtkTimeStamp.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The volTransferFunction2D class maps a sample's scalar value and
+ * gradient magnitude to a color and opacity.
+ *
+ * Both axes are normalized to [0, 1]: values over the scalar range,
+ * magnitudes over the largest gradient magnitude of the volume (see
+ * volGradientVolume::maximumMagnitude()). The function is a set of regions,
+ * boxes painted over the joint histogram (see volJointHistogram) in which
+ * the boundary between two materials shows as an arc. A region's opacity
+ * peaks at its center value and falls off linearly to its value edges,
+ * so that a narrow region over an arc picks out the boundary with a soft
+ * edge, and is constant over its magnitudes. Overlapping regions combine as
+ * layers: their transparencies multiply and their colors are averaged,
+ * weighted by opacity.
+ *
+ * The regions are rasterized once per change into table(), which
+ * volSampleTable2D turns into what the ray caster samples.
+ */
+class volTransferFunction2D
+{
+public:
+  struct Region
+  {
+    std::array<double, 2> value;     // lowest, highest
+    std::array<double, 2> magnitude; // lowest, highest
+    std::array<double, 4> rgba;      // opacity at the center value
+  };
+
+  /** Entries of table() along the value and the magnitude axes. */
+  static const size_t ValueEntries = 256;
+  static const size_t MagnitudeEntries = 64;
+
+  volTransferFunction2D();
+  ~volTransferFunction2D();
+
+  const std::vector<Region>& regions() const { return m_regions; }
+  void setRegions(const std::vector<Region> &regions);
+
+  /**
+   * RGBA in [0, 1], not premultiplied, of value entry v and magnitude entry
+   * m at table()[4 * (v + ValueEntries * m)]. Entry 0 is for the lowest
+   * value or magnitude, the last entry for the highest.
+   */
+  const std::vector<float>& table() const { return m_table; }
+
+  /** Modified whenever the table changes. */
+  unsigned long int timeStamp() const { return m_timeStamp.GetMTime(); }
+
+private:
+  // Not implemented:
+  volTransferFunction2D(const volTransferFunction2D&);
+  volTransferFunction2D& operator=(const volTransferFunction2D&);
+
+  void build();
+
+  std::vector<Region> m_regions;
+  std::vector<float> m_table;
+  vtkTimeStamp m_timeStamp;
+};
+
+#endif // VOLTRANSFERFUNCTION2D_H
@@ -0,0 +1,293 @@
+// STD includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkDataCompressor.h>
+#include <vtkImageCast.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkVersion.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+#include <vtkZLibDataCompressor.h>
+
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+#include <vtkLZ4DataCompressor.h>
+#define VOL_HAVE_LZ4
+#endif
+
+// VolumeViewer includes
+#include "volVTIReader.h"
+
+/* How one copy of a file is written: */
+struct Layout
+{
+  const char *name;
+  bool base64;
+  const char *compressor;
+  bool headerUInt32;
+};
+
+const Layout Layouts[] = {
+  { "raw", false, nullptr, false },
+  { "raw-zlib", false, "zlib", false },
+#ifdef VOL_HAVE_LZ4
+  { "raw-lz4", false, "lz4", false },
+#endif
+  { "raw-zlib-uint32", false, "zlib", true },
+  { "base64", true, nullptr, false },
+  { "base64-zlib", true, "zlib", false } };
+
+void printUsage(void)
+{
+  std::cout << "\nvolVTIBench - Check and time volVTIReader against vtkXMLImageDataReader" << std::endl;
+  std::cout << "\nUSAGE:\n\t./volVTIBench [options] <file.vti>..." << std::endl;
+  std::cout << "\nEach file is written again with appended data, raw and base64" << std::endl;
+  std::cout << "encoded, uncompressed and compressed, as it is and cast to" << std::endl;
+  std::cout << "Float32. Every copy is read with both readers, and the run fails" << std::endl;
+  std::cout << "if volVTIReader can't read one or its arrays differ." << std::endl;
+  std::cout << "\nWhere:" << std::endl;
+  std::cout << "\t-o <string>, -output <string>" << std::endl;
+  std::cout << "\tDirectory to write the copies to. Defaults to the current one.\n" << std::endl;
+  std::cout << "\t-r <digit>, -repetitions <digit>" << std::endl;
+  std::cout << "\tReads of each copy, of which the fastest is reported. Defaults" << std::endl;
+  std::cout << "\tto 3.\n" << std::endl;
+  std::cout << "\t-b <digit>, -blockSize <digit>" << std::endl;
+  std::cout << "\tBytes per compressed block. Defaults to 65536, so that even the" << std::endl;
+  std::cout << "\tsmall files split into many blocks.\n" << std::endl;
+  std::cout << "\t-h, -help" << std::endl;
+  std::cout << "\tDisplay this usage information and exit.\n" << std::endl;
+}
+
+/*
+ * newCompressor - A new instance of the named compressor, or null for none.
+ *
+ * parameter name - const char*
+ *
+ */
+vtkDataCompressor* newCompressor(const char *name)
+{
+  if(name && strcmp(name, "zlib")==0)
+    {
+    return vtkZLibDataCompressor::New();
+    }
+#ifdef VOL_HAVE_LZ4
+  if(name && strcmp(name, "lz4")==0)
+    {
+    return vtkLZ4DataCompressor::New();
+    }
+#endif
+  return nullptr;
+}
+
+/*
+ * sameArrays - Whether both images have the same extent and point arrays,
+ *              value for value.
+ *
+ * parameter expected - vtkImageData*
+ * parameter actual - vtkImageData*
+ *
+ */
+bool sameArrays(vtkImageData *expected, vtkImageData *actual)
+{
+  int expectedExtent[6];
+  int actualExtent[6];
+  expected->GetExtent(expectedExtent);
+  actual->GetExtent(actualExtent);
+  if(!std::equal(expectedExtent, expectedExtent + 6, actualExtent))
+    {
+    return false;
+    }
+  vtkPointData *expectedData = expected->GetPointData();
+  vtkPointData *actualData = actual->GetPointData();
+  if(expectedData->GetNumberOfArrays() != actualData->GetNumberOfArrays())
+    {
+    return false;
+    }
+  for(int a = 0; a < expectedData->GetNumberOfArrays(); ++a)
+    {
+    vtkDataArray *e = expectedData->GetArray(a);
+    vtkDataArray *v = e ? actualData->GetArray(e->GetName()) : nullptr;
+    if(!e || !v || e->GetDataType() != v->GetDataType() ||
+       e->GetNumberOfComponents() != v->GetNumberOfComponents() ||
+       e->GetNumberOfTuples() != v->GetNumberOfTuples())
+      {
+      return false;
+      }
+    const size_t bytes = static_cast<size_t>(e->GetNumberOfTuples()) *
+      e->GetNumberOfComponents() * e->GetDataTypeSize();
+    if(bytes > 0 &&
+       memcmp(e->GetVoidPointer(0), v->GetVoidPointer(0), bytes) != 0)
+      {
+      return false;
+      }
+    }
+  vtkDataArray *scalars = expectedData->GetScalars();
+  return !scalars || (actualData->GetScalars() &&
+    strcmp(scalars->GetName(), actualData->GetScalars()->GetName())==0);
+}
+
+/*
+ * main - Write, read and compare the copies of the files named on the
+ *        command line.
+ *
+ * parameter argc - int
+ * parameter argv - char**
+ *
+ */
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> sources;
+  std::string directory(".");
+  int repetitions = 3;
+  int blockSize = 65536;
+
+  /* Parse the command-line arguments */
+  for(int i = 1; i < argc; ++i)
+    {
+    if((strcmp(argv[i], "-o")==0 || strcmp(argv[i], "-output")==0) &&
+       i + 1 < argc)
+      {
+      directory.assign(argv[++i]);
+      }
+    else if((strcmp(argv[i], "-r")==0 || strcmp(argv[i], "-repetitions")==0) &&
+            i + 1 < argc)
+      {
+      repetitions = std::max(atoi(argv[++i]), 1);
+      }
+    else if((strcmp(argv[i], "-b")==0 || strcmp(argv[i], "-blockSize")==0) &&
+            i + 1 < argc)
+      {
+      blockSize = std::max(atoi(argv[++i]), 256);
+      }
+    else if(strcmp(argv[i], "-h")==0 || strcmp(argv[i], "-help")==0)
+      {
+      printUsage();
+      return 0;
+      }
+    else
+      {
+      sources.push_back(argv[i]);
+      }
+    }
+
+  if(sources.empty())
+    {
+    printUsage();
+    return 1;
+    }
+
+  bool passed = true;
+  std::cout << std::left << std::setw(40) << "copy" << std::right
+            << std::setw(16) << "vtkXML ms" << std::setw(16)
+            << "volVTIReader ms" << std::endl;
+  for(size_t s = 0; s < sources.size(); ++s)
+    {
+    vtkNew<vtkXMLImageDataReader> sourceReader;
+    sourceReader->SetFileName(sources[s].c_str());
+    sourceReader->Update();
+    if(!sourceReader->GetOutput()->GetPointData()->GetScalars())
+      {
+      std::cerr << "Could not read scalars from " << sources[s] << "."
+                << std::endl;
+      passed = false;
+      continue;
+      }
+
+    /* The fixtures are all UInt8; a Float32 copy checks wider words: */
+    vtkNew<vtkImageCast> cast;
+    cast->SetInputConnection(sourceReader->GetOutputPort());
+    cast->SetOutputScalarTypeToFloat();
+    cast->Update();
+    vtkImageData *images[2] = { sourceReader->GetOutput(), cast->GetOutput() };
+    const char *types[2] = { "", "-float" };
+
+    std::string base = sources[s].substr(sources[s].find_last_of('/') + 1);
+    base = base.substr(0, base.rfind(".vti"));
+    for(int t = 0; t < 2; ++t)
+      {
+      for(size_t l = 0; l < sizeof(Layouts) / sizeof(Layouts[0]); ++l)
+        {
+        const Layout &layout = Layouts[l];
+        const std::string copy = directory + "/" + base + types[t] + "-" +
+          layout.name + ".vti";
+        vtkNew<vtkXMLImageDataWriter> writer;
+        writer->SetInputData(images[t]);
+        writer->SetFileName(copy.c_str());
+        writer->SetDataModeToAppended();
+        writer->SetEncodeAppendedData(layout.base64 ? 1 : 0);
+        writer->SetBlockSize(blockSize);
+        if(layout.headerUInt32)
+          {
+          writer->SetHeaderTypeToUInt32();
+          }
+        else
+          {
+          writer->SetHeaderTypeToUInt64();
+          }
+        vtkSmartPointer<vtkDataCompressor> compressor;
+        compressor.TakeReference(newCompressor(layout.compressor));
+        writer->SetCompressor(compressor);
+        if(!writer->Write())
+          {
+          std::cerr << "Could not write " << copy << "." << std::endl;
+          passed = false;
+          continue;
+          }
+
+        /* The fastest of the repetitions, each with a fresh reader: */
+        double vtkTime = 0.0;
+        double volTime = 0.0;
+        vtkSmartPointer<vtkImageData> expected;
+        vtkSmartPointer<vtkImageData> actual;
+        for(int r = 0; r < repetitions; ++r)
+          {
+          std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+          vtkNew<vtkXMLImageDataReader> reader;
+          reader->SetFileName(copy.c_str());
+          reader->Update();
+          expected = reader->GetOutput();
+          double elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+          vtkTime = r == 0 ? elapsed : std::min(vtkTime, elapsed);
+
+          start = std::chrono::steady_clock::now();
+          actual = volVTIReader::read(copy);
+          elapsed = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+          volTime = r == 0 ? elapsed : std::min(volTime, elapsed);
+          }
+
+        std::cout << std::left << std::setw(40) << (base + types[t] + "-" +
+          layout.name) << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(16) << vtkTime << std::setw(16) << volTime;
+        if(!actual)
+          {
+          std::cout << "  not read" << std::endl;
+          passed = false;
+          }
+        else if(!sameArrays(expected, actual))
+          {
+          std::cout << "  differs" << std::endl;
+          passed = false;
+          }
+        else
+          {
+          std::cout << std::endl;
+          }
+        }
+      }
+    }
+  return passed ? 0 : 1;
+}
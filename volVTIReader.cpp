@@ -0,0 +1,701 @@
+#include "volVTIReader.h"
+
+#include "volArrayPool.h"
+
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkDataCompressor.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSMPTools.h>
+#include <vtkType.h>
+#include <vtkVersion.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLDataParser.h>
+#include <vtkZLibDataCompressor.h>
+
+#if VTK_MAJOR_VERSION > 8 || (VTK_MAJOR_VERSION == 8 && VTK_MINOR_VERSION >= 2)
+#include <vtkLZ4DataCompressor.h>
+#define VOL_HAVE_LZ4
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//------------------------------------------------------------------------------
+// A read-only mapping of a whole file.
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string &fileName)
+    : m_data(nullptr),
+      m_size(0)
+  {
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+      {
+      return;
+      }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+      {
+      void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                        MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+        {
+        m_data = static_cast<const char*>(data);
+        m_size = static_cast<size_t>(info.st_size);
+        }
+      }
+    ::close(fd);
+  }
+
+  ~MappedFile()
+  {
+    if (m_data)
+      {
+      munmap(const_cast<char*>(m_data), m_size);
+      }
+  }
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  // Not implemented:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  const char *m_data;
+  size_t m_size;
+};
+
+//------------------------------------------------------------------------------
+// The VTK type of a DataArray type attribute, or -1.
+int arrayType(const char *type)
+{
+  static const struct { const char *name; int type; } types[] = {
+    { "Int8", VTK_TYPE_INT8 },
+    { "UInt8", VTK_TYPE_UINT8 },
+    { "Int16", VTK_TYPE_INT16 },
+    { "UInt16", VTK_TYPE_UINT16 },
+    { "Int32", VTK_TYPE_INT32 },
+    { "UInt32", VTK_TYPE_UINT32 },
+    { "Int64", VTK_TYPE_INT64 },
+    { "UInt64", VTK_TYPE_UINT64 },
+    { "Float32", VTK_TYPE_FLOAT32 },
+    { "Float64", VTK_TYPE_FLOAT64 } };
+  for (size_t i = 0; type && i < sizeof(types) / sizeof(types[0]); ++i)
+    {
+    if (std::strcmp(type, types[i].name) == 0)
+      {
+      return types[i].type;
+      }
+    }
+  return -1;
+}
+
+//------------------------------------------------------------------------------
+// A new instance of the compressor named in the file, or null if VTK does not
+// provide it.
+vtkDataCompressor* newCompressor(const std::string &name)
+{
+  if (name == "vtkZLibDataCompressor")
+    {
+    return vtkZLibDataCompressor::New();
+    }
+#ifdef VOL_HAVE_LZ4
+  if (name == "vtkLZ4DataCompressor")
+    {
+    return vtkLZ4DataCompressor::New();
+    }
+#endif
+  return nullptr;
+}
+
+//------------------------------------------------------------------------------
+uint64_t headerWord(const unsigned char *p, size_t wordSize)
+{
+  if (wordSize == 4)
+    {
+    uint32_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+    }
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+//------------------------------------------------------------------------------
+// Number of base64 characters encoding bytes bytes.
+size_t base64Length(uint64_t bytes)
+{
+  return static_cast<size_t>((bytes + 2) / 3 * 4);
+}
+
+//------------------------------------------------------------------------------
+// Decodes 4 characters into 3 bytes per index. Groups are independent, so
+// any range of them can be decoded on its own.
+struct Base64Functor
+{
+  const unsigned char *in;
+  unsigned char *out;
+  size_t outSize;
+  std::atomic<bool> *failed;
+
+  static const signed char* table()
+  {
+    static const struct Table
+    {
+      signed char values[256];
+      Table()
+      {
+        static const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::memset(this->values, -1, sizeof(this->values));
+        for (int i = 0; i < 64; ++i)
+          {
+          this->values[static_cast<unsigned char>(alphabet[i])] =
+              static_cast<signed char>(i);
+          }
+        this->values[static_cast<unsigned char>('=')] = 0;
+      }
+    } decode;
+    return decode.values;
+  }
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    const signed char *decode = table();
+    for (vtkIdType g = begin; g < end; ++g)
+      {
+      const unsigned char *c = this->in + 4 * g;
+      const int v[4] = { decode[c[0]], decode[c[1]], decode[c[2]],
+                         decode[c[3]] };
+      if ((v[0] | v[1] | v[2] | v[3]) < 0)
+        {
+        *this->failed = true;
+        return;
+        }
+      const unsigned char bytes[3] = {
+        static_cast<unsigned char>((v[0] << 2) | (v[1] >> 4)),
+        static_cast<unsigned char>(((v[1] & 0xf) << 4) | (v[2] >> 2)),
+        static_cast<unsigned char>(((v[2] & 0x3) << 6) | v[3]) };
+      const size_t first = 3 * static_cast<size_t>(g);
+      for (size_t i = 0; i < 3 && first + i < this->outSize; ++i)
+        {
+        this->out[first + i] = bytes[i];
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+bool decodeBase64(const char *in, size_t inSize, unsigned char *out,
+                  uint64_t outSize)
+{
+  if (base64Length(outSize) > inSize)
+    {
+    return false;
+    }
+  std::atomic<bool> failed(false);
+  Base64Functor functor;
+  functor.in = reinterpret_cast<const unsigned char*>(in);
+  functor.out = out;
+  functor.outSize = static_cast<size_t>(outSize);
+  functor.failed = &failed;
+  vtkSMPTools::For(0, static_cast<vtkIdType>((outSize + 2) / 3), 1 << 14,
+                   functor);
+  return !failed;
+}
+
+//------------------------------------------------------------------------------
+struct CopyFunctor
+{
+  const char *in;
+  unsigned char *out;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    std::memcpy(this->out + begin, this->in + begin,
+                static_cast<size_t>(end - begin));
+  }
+};
+
+//------------------------------------------------------------------------------
+void copyBytes(const char *in, unsigned char *out, uint64_t size)
+{
+  CopyFunctor functor;
+  functor.in = in;
+  functor.out = out;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(size), 1 << 20, functor);
+}
+
+//------------------------------------------------------------------------------
+// Decompresses each block straight into its place in the output.
+struct InflateFunctor
+{
+  const unsigned char *in;
+  unsigned char *out;
+  const std::string *compressor;
+  const std::vector<uint64_t> *offsets; // of each block in in, and the end
+  uint64_t blockSize;
+  uint64_t lastBlockSize;
+  std::atomic<bool> *failed;
+
+  void operator()(vtkIdType begin, vtkIdType end) const
+  {
+    vtkSmartPointer<vtkDataCompressor> decompressor;
+    decompressor.TakeReference(newCompressor(*this->compressor));
+    const size_t numberOfBlocks = this->offsets->size() - 1;
+    for (vtkIdType b = begin; b < end && !*this->failed; ++b)
+      {
+      const size_t block = static_cast<size_t>(b);
+      const uint64_t size = block + 1 == numberOfBlocks ? this->lastBlockSize
+                                                        : this->blockSize;
+      const uint64_t compressedSize =
+          (*this->offsets)[block + 1] - (*this->offsets)[block];
+      if (decompressor->Uncompress(this->in + (*this->offsets)[block],
+                                   static_cast<size_t>(compressedSize),
+                                   this->out + block * this->blockSize,
+                                   static_cast<size_t>(size)) != size)
+        {
+        *this->failed = true;
+        }
+      }
+  }
+};
+
+//------------------------------------------------------------------------------
+// The appended data section of a file, and how it is stored.
+struct AppendedData
+{
+  const char *data;
+  size_t size;
+  bool base64;
+  size_t wordSize; // 4 or 8, from header_type
+  std::string compressor;
+
+  bool decode(uint64_t offset, unsigned char *out, uint64_t outSize) const;
+
+private:
+  uint64_t dataSize(const std::vector<unsigned char> &header) const;
+  bool decodeHeader(const char *in, size_t inSize,
+                    std::vector<unsigned char> &header,
+                    uint64_t &headerSize) const;
+  bool inflate(const unsigned char *in, uint64_t inSize,
+               const std::vector<unsigned char> &header, unsigned char *out,
+               uint64_t outSize) const;
+};
+
+//------------------------------------------------------------------------------
+// Reads the block header of an array: the byte count of uncompressed data,
+// or the block count, sizes and compressed sizes of compressed data.
+// headerSize is its size in decoded bytes.
+bool AppendedData::decodeHeader(const char *in, size_t inSize,
+                                std::vector<unsigned char> &header,
+                                uint64_t &headerSize) const
+{
+  const size_t words = this->compressor.empty() ? 1 : 3;
+  header.resize(words * this->wordSize);
+  if (this->base64)
+    {
+    if (!decodeBase64(in, inSize, header.data(), header.size()))
+      {
+      return false;
+      }
+    }
+  else if (header.size() <= inSize)
+    {
+    std::memcpy(header.data(), in, header.size());
+    }
+  else
+    {
+    return false;
+    }
+  headerSize = header.size();
+  if (words == 1)
+    {
+    return true;
+    }
+
+  // Compressed size of each block follows:
+  const uint64_t numberOfBlocks = headerWord(header.data(), this->wordSize);
+  if (numberOfBlocks > inSize / this->wordSize)
+    {
+    return false;
+    }
+  headerSize = (3 + numberOfBlocks) * this->wordSize;
+  header.resize(static_cast<size_t>(headerSize));
+  if (this->base64)
+    {
+    return decodeBase64(in, inSize, header.data(), headerSize);
+    }
+  if (headerSize > inSize)
+    {
+    return false;
+    }
+  std::memcpy(header.data(), in, static_cast<size_t>(headerSize));
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Bytes of (compressed) data following the header.
+uint64_t AppendedData::dataSize(const std::vector<unsigned char> &header) const
+{
+  const size_t w = this->wordSize;
+  if (this->compressor.empty())
+    {
+    return headerWord(header.data(), w);
+    }
+  uint64_t size = 0;
+  const uint64_t numberOfBlocks = headerWord(header.data(), w);
+  for (size_t b = 0; b < numberOfBlocks; ++b)
+    {
+    size += headerWord(header.data() + (3 + b) * w, w);
+    }
+  return size;
+}
+
+//------------------------------------------------------------------------------
+bool AppendedData::inflate(const unsigned char *in, uint64_t inSize,
+                           const std::vector<unsigned char> &header,
+                           unsigned char *out, uint64_t outSize) const
+{
+  const size_t w = this->wordSize;
+  const uint64_t numberOfBlocks = headerWord(header.data(), w);
+  const uint64_t blockSize = headerWord(header.data() + w, w);
+  uint64_t lastBlockSize = headerWord(header.data() + 2 * w, w);
+  if (numberOfBlocks == 0)
+    {
+    return outSize == 0;
+    }
+  if (lastBlockSize == 0)
+    {
+    lastBlockSize = blockSize;
+    }
+  if (lastBlockSize > blockSize ||
+      (numberOfBlocks - 1) * blockSize + lastBlockSize != outSize)
+    {
+    return false;
+    }
+
+  std::vector<uint64_t> offsets(static_cast<size_t>(numberOfBlocks) + 1, 0);
+  for (size_t b = 0; b < numberOfBlocks; ++b)
+    {
+    offsets[b + 1] = offsets[b] + headerWord(header.data() + (3 + b) * w, w);
+    }
+  if (offsets.back() > inSize)
+    {
+    return false;
+    }
+
+  std::atomic<bool> failed(false);
+  InflateFunctor functor;
+  functor.in = in;
+  functor.out = out;
+  functor.compressor = &this->compressor;
+  functor.offsets = &offsets;
+  functor.blockSize = blockSize;
+  functor.lastBlockSize = lastBlockSize;
+  functor.failed = &failed;
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numberOfBlocks), 1, functor);
+  return !failed;
+}
+
+//------------------------------------------------------------------------------
+bool AppendedData::decode(uint64_t offset, unsigned char *out,
+                          uint64_t outSize) const
+{
+  if (offset >= this->size)
+    {
+    return false;
+    }
+  const char *in = this->data + offset;
+  const size_t inSize = this->size - static_cast<size_t>(offset);
+
+  std::vector<unsigned char> header;
+  uint64_t headerSize = 0;
+  if (!this->decodeHeader(in, inSize, header, headerSize))
+    {
+    return false;
+    }
+  const uint64_t dataSize = this->dataSize(header);
+  if (this->compressor.empty() && dataSize != outSize)
+    {
+    return false;
+    }
+
+  // Where the (still encoded) data starts. Base64 data is normally encoded
+  // apart from its header; if the header's padding is missing, the two were
+  // encoded as one stream, which has to be decoded whole.
+  const char *encoded = in + headerSize;
+  std::vector<unsigned char> decoded;
+  if (this->base64)
+    {
+    const size_t headerLength = base64Length(headerSize);
+    const bool separate = headerSize % 3 == 0 ||
+        (headerLength <= inSize && in[headerLength - 1] == '=');
+    if (separate)
+      {
+      encoded = in + headerLength;
+      if (this->compressor.empty())
+        {
+        return decodeBase64(encoded, inSize - headerLength, out, outSize);
+        }
+      decoded.resize(static_cast<size_t>(dataSize));
+      if (!decodeBase64(encoded, inSize - headerLength, decoded.data(),
+                        dataSize))
+        {
+        return false;
+        }
+      }
+    else
+      {
+      decoded.resize(static_cast<size_t>(headerSize + dataSize));
+      if (!decodeBase64(in, inSize, decoded.data(), decoded.size()))
+        {
+        return false;
+        }
+      decoded.erase(decoded.begin(),
+                    decoded.begin() + static_cast<ptrdiff_t>(headerSize));
+      }
+    }
+  else if (headerSize + dataSize > inSize)
+    {
+    return false;
+    }
+
+  if (this->compressor.empty())
+    {
+    // Raw data is copied, base64 data was decoded into a temporary above:
+    copyBytes(decoded.empty() ? encoded
+                              : reinterpret_cast<const char*>(decoded.data()),
+              out, outSize);
+    return true;
+    }
+  return this->inflate(decoded.empty()
+                         ? reinterpret_cast<const unsigned char*>(encoded)
+                         : decoded.data(),
+                       dataSize, header, out, outSize);
+}
+
+//------------------------------------------------------------------------------
+// Reads the DataArrays of a PointData or CellData element into attributes.
+bool readArrays(vtkXMLDataElement *element, const AppendedData &appended,
+                vtkIdType numberOfTuples, vtkDataSetAttributes *attributes)
+{
+  if (!element)
+    {
+    return true;
+    }
+  for (int i = 0; i < element->GetNumberOfNestedElements(); ++i)
+    {
+    vtkXMLDataElement *arrayElement = element->GetNestedElement(i);
+    const char *format = arrayElement->GetAttribute("format");
+    const char *offset = arrayElement->GetAttribute("offset");
+    const int type = arrayType(arrayElement->GetAttribute("type"));
+    int components = 1;
+    arrayElement->GetScalarAttribute("NumberOfComponents", components);
+    if (std::strcmp(arrayElement->GetName(), "DataArray") != 0 ||
+        !format || std::strcmp(format, "appended") != 0 || !offset ||
+        type < 0 || components < 1)
+      {
+      return false;
+      }
+
+    // Time series playback reads one step after the other:
+    vtkSmartPointer<vtkDataArray> array =
+        volArrayPool::instance().newArray(type, numberOfTuples, components);
+    if (const char *name = arrayElement->GetAttribute("Name"))
+      {
+      array->SetName(name);
+      }
+    const uint64_t size = static_cast<uint64_t>(numberOfTuples) * components *
+        static_cast<uint64_t>(array->GetDataTypeSize());
+    if (!appended.decode(std::strtoull(offset, nullptr, 10),
+                         static_cast<unsigned char*>(array->GetVoidPointer(0)),
+                         size))
+      {
+      return false;
+      }
+    attributes->AddArray(array);
+    }
+
+  // Active attributes are named on the element:
+  if (const char *name = element->GetAttribute("Scalars"))
+    {
+    attributes->SetActiveScalars(name);
+    }
+  if (const char *name = element->GetAttribute("Vectors"))
+    {
+    attributes->SetActiveVectors(name);
+    }
+  if (const char *name = element->GetAttribute("Normals"))
+    {
+    attributes->SetActiveNormals(name);
+    }
+  if (const char *name = element->GetAttribute("TCoords"))
+    {
+    attributes->SetActiveTCoords(name);
+    }
+  if (const char *name = element->GetAttribute("Tensors"))
+    {
+    attributes->SetActiveTensors(name);
+    }
+  return true;
+}
+
+} // end anon namespace
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> volVTIReader::read(const std::string &fileName)
+{
+  std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!stream)
+    {
+    return nullptr;
+    }
+  vtkNew<vtkXMLDataParser> parser;
+  parser->SetStream(&stream);
+  if (!parser->Parse())
+    {
+    return nullptr;
+    }
+
+  vtkXMLDataElement *root = parser->GetRootElement();
+  const char *type = root ? root->GetAttribute("type") : nullptr;
+  if (!type || std::strcmp(type, "ImageData") != 0)
+    {
+    return nullptr;
+    }
+
+  // The data is used as it is in the file:
+  const uint16_t one = 1;
+  const bool littleEndian = *reinterpret_cast<const unsigned char*>(&one) == 1;
+  const char *byteOrder = root->GetAttribute("byte_order");
+  if (!byteOrder || std::strcmp(byteOrder, littleEndian ? "LittleEndian"
+                                                        : "BigEndian") != 0)
+    {
+    return nullptr;
+    }
+
+  AppendedData appended;
+  appended.base64 = false;
+  appended.wordSize = 4;
+  if (const char *headerType = root->GetAttribute("header_type"))
+    {
+    if (std::strcmp(headerType, "UInt64") == 0)
+      {
+      appended.wordSize = 8;
+      }
+    else if (std::strcmp(headerType, "UInt32") != 0)
+      {
+      return nullptr;
+      }
+    }
+  if (const char *compressor = root->GetAttribute("compressor"))
+    {
+    appended.compressor = compressor;
+    vtkSmartPointer<vtkDataCompressor> known;
+    known.TakeReference(newCompressor(appended.compressor));
+    if (!known)
+      {
+      return nullptr;
+      }
+    }
+
+  vtkXMLDataElement *imageElement = root->FindNestedElementWithName("ImageData");
+  vtkXMLDataElement *appendedElement =
+      root->FindNestedElementWithName("AppendedData");
+  if (!imageElement || !appendedElement)
+    {
+    return nullptr;
+    }
+  const char *encoding = appendedElement->GetAttribute("encoding");
+  if (!encoding ||
+      (std::strcmp(encoding, "raw") != 0 &&
+       std::strcmp(encoding, "base64") != 0))
+    {
+    return nullptr;
+    }
+  appended.base64 = std::strcmp(encoding, "base64") == 0;
+
+  int wholeExtent[6];
+  double origin[3] = { 0., 0., 0. };
+  double spacing[3] = { 1., 1., 1. };
+  if (imageElement->GetVectorAttribute("WholeExtent", 6, wholeExtent) != 6)
+    {
+    return nullptr;
+    }
+  imageElement->GetVectorAttribute("Origin", 3, origin);
+  imageElement->GetVectorAttribute("Spacing", 3, spacing);
+
+  // Oriented images would need more than origin and spacing:
+  double direction[9];
+  if (imageElement->GetVectorAttribute("Direction", 9, direction) == 9)
+    {
+    for (int i = 0; i < 9; ++i)
+      {
+      if (direction[i] != (i % 4 == 0 ? 1. : 0.))
+        {
+        return nullptr;
+        }
+      }
+    }
+
+  // A single piece covering the whole extent, and no field data:
+  vtkXMLDataElement *piece = nullptr;
+  for (int i = 0; i < imageElement->GetNumberOfNestedElements(); ++i)
+    {
+    vtkXMLDataElement *nested = imageElement->GetNestedElement(i);
+    if (std::strcmp(nested->GetName(), "Piece") != 0 || piece)
+      {
+      return nullptr;
+      }
+    piece = nested;
+    }
+  int extent[6];
+  if (!piece || piece->GetVectorAttribute("Extent", 6, extent) != 6 ||
+      !std::equal(extent, extent + 6, wholeExtent))
+    {
+    return nullptr;
+    }
+
+  const MappedFile file(fileName);
+  const size_t position = static_cast<size_t>(parser->GetAppendedDataPosition());
+  if (!file.data() || position > file.size())
+    {
+    return nullptr;
+    }
+  appended.data = file.data() + position;
+  appended.size = file.size() - position;
+
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetExtent(extent);
+  image->SetOrigin(origin);
+  image->SetSpacing(spacing);
+  if (!readArrays(piece->FindNestedElementWithName("PointData"), appended,
+                  image->GetNumberOfPoints(), image->GetPointData()) ||
+      !readArrays(piece->FindNestedElementWithName("CellData"), appended,
+                  image->GetNumberOfCells(), image->GetCellData()))
+    {
+    return nullptr;
+    }
+  return image;
+}
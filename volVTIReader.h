@@ -0,0 +1,33 @@
+#ifndef VOLVTIREADER_H
+#define VOLVTIREADER_H
+
+#include <vtkSmartPointer.h>
+
+#include <string>
+
+class vtkImageData;
+
+/**
+ * @brief The volVTIReader class reads .vti files with appended data using all
+ * cores.
+ *
+ * vtkXMLImageDataReader decodes the blocks of compressed or base64 encoded
+ * appended data one after the other, so reading is bound by a single core.
+ * Here the XML header is parsed with vtkXMLDataParser, and then the file is
+ * mapped into memory and its blocks are decoded in parallel, each straight
+ * into its place in the final array.
+ *
+ * Only the common layout is handled: a single piece whose arrays are all in
+ * the appended section, raw or base64 encoded, uncompressed or compressed
+ * with a compressor VTK provides, in the byte order of this machine. read()
+ * returns null for anything else, and the caller falls back to
+ * vtkXMLImageDataReader.
+ */
+class volVTIReader
+{
+public:
+  /** The image data in fileName, or null if it can't be read here. */
+  static vtkSmartPointer<vtkImageData> read(const std::string &fileName);
+};
+
+#endif // VOLVTIREADER_H
@@ -1,20 +1,31 @@
 #include "volVolume.h"
 
 #include "volApplicationState.h"
+#include "volBrickCache.h"
 #include "volContextState.h"
+#include "volDataClipper.h"
+#include "volPreIntegrationTable.h"
+#include "volRayCastMapper.h"
 #include "volReader.h"
+#include "volSampleTable2D.h"
+#include "volTransferFunction.h"
+#include "volTransferFunction2D.h"
 
 #include <GL/GLContextData.h>
 
 #include <vtkColorTransferFunction.h>
 #include <vtkDataObject.h>
 #include <vtkExternalOpenGLRenderer.h>
+#include <vtkImageData.h>
 #include <vtkPiecewiseFunction.h>
+#include <vtkPlaneCollection.h>
 #include <vtkSmartVolumeMapper.h>
 #include <vtkVolume.h>
 #include <vtkVolumeProperty.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 //------------------------------------------------------------------------------
 volVolume::DataItem::DataItem()
@@ -24,12 +35,18 @@ volVolume::DataItem::DataItem()
 
 //------------------------------------------------------------------------------
 volVolume::volVolume()
+  : m_hiResTable(std::make_shared<volPreIntegrationTable>()),
+    m_loResTable(std::make_shared<volPreIntegrationTable>()),
+    m_hiResTable2D(std::make_shared<volSampleTable2D>()),
+    m_loResTable2D(std::make_shared<volSampleTable2D>())
 {
   m_property->ShadeOff();
   m_property->SetScalarOpacityUnitDistance(1.0);
   m_property->SetInterpolationTypeToLinear();
   m_property->SetColor(m_color.Get());
   m_property->SetScalarOpacity(m_opacity.Get());
+  m_cropBounds.fill(0.);
+  m_reducedCropBounds.fill(0.);
 }
 
 //------------------------------------------------------------------------------
@@ -61,24 +78,114 @@ void volVolume::syncApplicationState(const vvApplicationState &appState)
   // Update color/opacity lookups
   const volApplicationState &state =
       static_cast<const volApplicationState&>(appState);
-  if (state.reader().dataObject() &&
-      (state.reader().dataObject()->GetMTime() > m_color->GetMTime() ||
-       state.colorMapTimeStamp() > m_color->GetMTime()))
+  // Until the file is read, the range comes from the preview:
+  vtkDataObject *rangeData = state.reader().dataObject()
+      ? state.reader().dataObject() : state.reader().reducedDataObject();
+  if (rangeData &&
+      (rangeData->GetMTime() > m_color->GetMTime() ||
+       state.transferFunction().timeStamp() > m_color->GetMTime()))
     {
-    m_color->RemoveAllPoints();
-    m_opacity->RemoveAllPoints();
-    std::array<double, 2> scalarRange = state.reader().scalarRange();
-    double step = (scalarRange[1] - scalarRange[0]) / 255.0;
-    for (vtkIdType i = 0; i < 255; ++i)
+    const std::array<double, 2> scalarRange = state.reader().scalarRange();
+    state.transferFunction().exportColor(m_color.Get(), scalarRange);
+    state.transferFunction().exportOpacity(m_opacity.Get(), scalarRange);
+    }
+
+  // The ray cast modes render the same data as the others (see
+  // syncContextState()):
+  if (this->rayCast())
+    {
+    m_rayCastReduced = m_lowResolution || state.forceLowResolution() ||
+        state.reader().brickPager() || !state.reader().dataObject();
+    m_rayCastVolume = m_rayCastReduced ? state.reader().reducedBrickCache()
+                                       : state.reader().brickCache();
+    if (!m_rayCastVolume)
       {
-      m_color->AddRGBPoint(scalarRange[0] + (i * step),
-                           state.colorMap()[4*i + 0],
-                           state.colorMap()[4*i + 1],
-                           state.colorMap()[4*i + 2]);
-      m_opacity->AddPoint(scalarRange[0] + (i * step),
-                          state.colorMap()[4*i + 3]);
+      m_rayCastReduced = true;
+      m_rayCastVolume = state.reader().reducedBrickCache();
+      }
+    if (m_rayCastVolume)
+      {
+      const std::array<double, 3> &spacing = m_rayCastVolume->spacing();
+      const double voxel = std::min(std::fabs(spacing[0]),
+                                    std::min(std::fabs(spacing[1]),
+                                             std::fabs(spacing[2])));
+      volPreIntegrationTable &table =
+          m_rayCastReduced ? *m_loResTable : *m_hiResTable;
+      table.update(state.transferFunction(), m_sampleDistance * voxel,
+                   m_property->GetScalarOpacityUnitDistance());
+      if (m_renderMode == RenderMode::TransferFunction2D)
+        {
+        volSampleTable2D &table2D =
+            m_rayCastReduced ? *m_loResTable2D : *m_hiResTable2D;
+        table2D.update(state.transferFunction2D(), m_sampleDistance * voxel,
+                       m_property->GetScalarOpacityUnitDistance());
+        }
+      }
+    m_rayCastGradients.reset();
+    if (this->needsGradients())
+      {
+      m_rayCastGradients = m_rayCastReduced ? state.reader().reducedGradients()
+                                            : state.reader().gradients();
       }
     }
+  else
+    {
+    m_rayCastVolume.reset();
+    m_rayCastGradients.reset();
+    }
+
+  // Update cropping/clipping from the clipping planes and the region of
+  // interest. The ROI only applies to the full resolution data.
+  vtkDataObject *data = state.reader().dataObject();
+  vtkDataObject *reducedData = state.reader().reducedDataObject();
+  if (state.clippingPlanesTimeStamp() > m_clippingTime.GetMTime() ||
+      state.regionOfInterestTimeStamp() > m_clippingTime.GetMTime() ||
+      (data && data->GetMTime() > m_clippingTime.GetMTime()) ||
+      (reducedData && reducedData->GetMTime() > m_clippingTime.GetMTime()))
+    {
+    const std::vector<volApplicationState::ClipPlane> &planes =
+        state.clippingPlanes();
+    volDataClipper::fillPlaneCollection(planes, m_clippingPlanes.Get());
+
+    vtkImageData *images[2] = { state.reader().typedDataObject(),
+                                state.reader().typedReducedDataObject() };
+    std::array<double, 6> *bounds[2] = { &m_cropBounds,
+                                         &m_reducedCropBounds };
+    bool *cropping[2] = { &m_cropping, &m_reducedCropping };
+    for (int i = 0; i < 2; ++i)
+      {
+      const bool roi = i == 0 && state.hasRegionOfInterest();
+      *cropping[i] = images[i] && (roi || !planes.empty());
+      if (!*cropping[i])
+        {
+        continue;
+        }
+      std::array<int, 6> extent =
+          volDataClipper::unclippedExtent(images[i], planes);
+      if (roi)
+        {
+        std::array<int, 6> roiExtent = volDataClipper::regionExtent(
+              images[i], state.regionOfInterest());
+        for (int j = 0; j < 3; ++j)
+          {
+          extent[2 * j] = std::max(extent[2 * j], roiExtent[2 * j]);
+          extent[2 * j + 1] = std::max(extent[2 * j],
+                                       std::min(extent[2 * j + 1],
+                                                roiExtent[2 * j + 1]));
+          }
+        }
+      double origin[3];
+      double spacing[3];
+      images[i]->GetOrigin(origin);
+      images[i]->GetSpacing(spacing);
+      for (int j = 0; j < 6; ++j)
+        {
+        (*bounds[i])[j] = origin[j / 2] + extent[j] * spacing[j / 2];
+        }
+      }
+
+    m_clippingTime.Modified();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -94,18 +201,108 @@ void volVolume::syncContextState(const vvApplicationState &appState,
   const volApplicationState &state =
       static_cast<const volApplicationState&>(appState);
 
-  if (state.forceLowResolution())
+  // Out of core, the full resolution data holds no scalars. While the file
+  // is read, only the preview is there:
+  const bool reduced = m_lowResolution || state.forceLowResolution() ||
+      state.reader().brickPager() || !state.reader().dataObject();
+  vtkImageData *image = nullptr;
+  if (reduced)
     {
     dataItem->mapper->SetInputDataObject(state.reader().reducedDataObject());
+    dataItem->mapper->SetCroppingRegionPlanes(m_reducedCropBounds.data());
+    dataItem->mapper->SetCropping(m_reducedCropping ? 1 : 0);
+    image = state.reader().typedReducedDataObject();
     }
   else
     {
     dataItem->mapper->SetInputDataObject(state.reader().dataObject());
+    dataItem->mapper->SetCroppingRegionPlanes(m_cropBounds.data());
+    dataItem->mapper->SetCropping(m_cropping ? 1 : 0);
+    image = state.reader().typedDataObject();
+    }
+
+  // At full quality the smart mapper picks its own sample distance. Below it,
+  // the distance follows the frame rate controller: the smart mapper has no
+  // image sample distance, so fewer rays per pixel become longer samples.
+  if (image && (m_sampleDistance > 1. || m_imageSampleDistance > 1.))
+    {
+    double spacing[3];
+    image->GetSpacing(spacing);
+    const double minSpacing =
+        std::min(std::fabs(spacing[0]),
+                 std::min(std::fabs(spacing[1]), std::fabs(spacing[2])));
+    dataItem->mapper->AutoAdjustSampleDistancesOff();
+    dataItem->mapper->SetSampleDistance(
+          static_cast<float>(minSpacing * m_sampleDistance *
+                             m_imageSampleDistance));
+    }
+  else
+    {
+    dataItem->mapper->AutoAdjustSampleDistancesOn();
     }
+  dataItem->mapper->SetClippingPlanes(m_clippingPlanes.Get());
   dataItem->actor->SetVisibility(m_visible ? 1 : 0);
 
-  if (m_visible)
+  if (m_visible && this->rayCast())
     {
+    // The input only provides the bounds of the volume:
+    volRayCastMapper *rayCastMapper = dataItem->rayCastMapper.Get();
+    rayCastMapper->SetInputDataObject(
+          m_rayCastReduced ? state.reader().reducedDataObject()
+                           : state.reader().dataObject());
+    rayCastMapper->setImageSampleDistance(m_imageSampleDistance);
+    volRayCaster &rayCaster = rayCastMapper->rayCaster();
+    rayCaster.setVolume(m_rayCastVolume);
+    rayCaster.setTable(m_rayCastReduced ? m_loResTable : m_hiResTable);
+    rayCaster.setClassification(m_renderMode == RenderMode::PreIntegrated
+                                ? volRayCaster::PreIntegrated
+                                : volRayCaster::PostClassified);
+    switch (m_renderMode)
+      {
+      case RenderMode::MaximumIntensity:
+        rayCaster.setProjection(volRayCaster::MaximumIntensity);
+        break;
+      case RenderMode::MinimumIntensity:
+        rayCaster.setProjection(volRayCaster::MinimumIntensity);
+        break;
+      case RenderMode::AverageIntensity:
+        rayCaster.setProjection(volRayCaster::AverageIntensity);
+        break;
+      default:
+        rayCaster.setProjection(volRayCaster::Composite);
+        break;
+      }
+    rayCaster.setGradients(m_rayCastGradients);
+    rayCaster.setShading(m_shading);
+    if (m_renderMode == RenderMode::TransferFunction2D)
+      {
+      rayCaster.setTable2D(m_rayCastReduced ? m_loResTable2D
+                                            : m_hiResTable2D);
+      }
+    else
+      {
+      rayCaster.setTable2D(nullptr);
+      }
+    rayCaster.setLighting(m_property->GetAmbient(), m_property->GetDiffuse(),
+                          m_property->GetSpecular(),
+                          m_property->GetSpecularPower());
+    rayCaster.setScalarRange(state.reader().scalarRange());
+    rayCaster.setClippingPlanes(state.clippingPlanes());
+    rayCaster.setCropping(
+          m_rayCastReduced ? m_reducedCropping : m_cropping,
+          m_rayCastReduced ? m_reducedCropBounds : m_cropBounds);
+    if (dataItem->actor->GetMapper() != rayCastMapper)
+      {
+      dataItem->actor->SetMapper(rayCastMapper);
+      }
+    }
+  else if (m_visible)
+    {
+    if (dataItem->actor->GetMapper() != dataItem->mapper.Get())
+      {
+      dataItem->actor->SetMapper(dataItem->mapper.Get());
+      }
+
     switch (m_renderMode)
       {
       case RenderMode::Default:
@@ -163,3 +360,72 @@ void volVolume::setRenderMode(RenderMode val)
 {
   m_renderMode = val;
 }
+
+//------------------------------------------------------------------------------
+bool volVolume::rayCast() const
+{
+  return m_renderMode == RenderMode::PreIntegrated ||
+      m_renderMode == RenderMode::CPU ||
+      m_renderMode == RenderMode::MaximumIntensity ||
+      m_renderMode == RenderMode::MinimumIntensity ||
+      m_renderMode == RenderMode::AverageIntensity ||
+      m_renderMode == RenderMode::TransferFunction2D;
+}
+
+//------------------------------------------------------------------------------
+double volVolume::sampleDistance() const
+{
+  return m_sampleDistance;
+}
+
+//------------------------------------------------------------------------------
+void volVolume::setSampleDistance(double distance)
+{
+  if (distance > 0.)
+    {
+    m_sampleDistance = distance;
+    }
+}
+
+//------------------------------------------------------------------------------
+double volVolume::imageSampleDistance() const
+{
+  return m_imageSampleDistance;
+}
+
+//------------------------------------------------------------------------------
+void volVolume::setImageSampleDistance(double distance)
+{
+  m_imageSampleDistance = std::max(distance, 1.);
+}
+
+//------------------------------------------------------------------------------
+bool volVolume::lowResolution() const
+{
+  return m_lowResolution;
+}
+
+//------------------------------------------------------------------------------
+void volVolume::setLowResolution(bool lowResolution)
+{
+  m_lowResolution = lowResolution;
+}
+
+//------------------------------------------------------------------------------
+bool volVolume::shading() const
+{
+  return m_shading;
+}
+
+//------------------------------------------------------------------------------
+void volVolume::setShading(bool shading)
+{
+  m_shading = shading;
+  m_property->SetShade(shading ? 1 : 0);
+}
+
+//------------------------------------------------------------------------------
+bool volVolume::needsGradients() const
+{
+  return m_shading || m_renderMode == RenderMode::TransferFunction2D;
+}
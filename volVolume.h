@@ -4,9 +4,19 @@
 #include <vvGLObject.h>
 
 #include <vtkNew.h>
+#include <vtkTimeStamp.h>
 
+#include <array>
+#include <memory>
+
+class volBrickCache;
+class volGradientVolume;
+class volPreIntegrationTable;
+class volRayCastMapper;
+class volSampleTable2D;
 class vtkColorTransferFunction;
 class vtkPiecewiseFunction;
+class vtkPlaneCollection;
 class vtkSmartVolumeMapper;
 class vtkVolume;
 class vtkVolumeProperty;
@@ -22,7 +32,20 @@ public:
     RayCastAndTexture,
     RayCast,
     Texture,
-    GPU
+    GPU,
+    // Our own CPU ray caster (volRayCaster), with pre-integrated
+    // classification:
+    PreIntegrated,
+    // The same, classifying each sample like the modes above:
+    CPU,
+    // Projections of the maximum, minimum and average scalar along the rays,
+    // also by volRayCaster:
+    MaximumIntensity,
+    MinimumIntensity,
+    AverageIntensity,
+    // volRayCaster classifying the samples by value and gradient magnitude
+    // (see volTransferFunction2D):
+    TransferFunction2D
     };
 
   struct DataItem : public Superclass::DataItem
@@ -30,6 +53,7 @@ public:
     DataItem();
 
     vtkNew<vtkSmartVolumeMapper> mapper;
+    vtkNew<volRayCastMapper> rayCastMapper;
     vtkNew<vtkVolume> actor;
   };
 
@@ -49,13 +73,81 @@ public:
   RenderMode renderMode() const;
   void setRenderMode(RenderMode val);
 
+  /** True for the modes rendered by volRayCaster. */
+  bool rayCast() const;
+
+  /**
+   * Distance between the samples along the rays, in units of the smallest
+   * voxel spacing. As the slabs between samples are integrated exactly, the
+   * PreIntegrated mode can use a much larger distance than the other modes
+   * need for sharp transfer functions. Above 1, it also turns off the
+   * automatic sample distance of the vtkSmartVolumeMapper modes.
+   */
+  double sampleDistance() const;
+  void setSampleDistance(double distance);
+
+  /** Viewport pixels per ray along each axis in the ray cast modes; at
+   *  least 1. The vtkSmartVolumeMapper modes lengthen their sample distance
+   *  by the same factor instead. */
+  double imageSampleDistance() const;
+  void setImageSampleDistance(double distance);
+
+  /**
+   * Render the reduced data, whatever the application's forceLowResolution().
+   * Together with the distances above, this trades quality for frame rate
+   * while the view is navigated (see volFrameRateController).
+   */
+  bool lowResolution() const;
+  void setLowResolution(bool lowResolution);
+
+  /**
+   * Shade the volume by the lighting of the volume property. The ray cast
+   * modes shade with the reader's gradients (see
+   * volReader::setGradientsEnabled()), and render unshaded until they are
+   * computed. Off by default.
+   */
+  bool shading() const;
+  void setShading(bool shading);
+
+  /**
+   * True if rendering needs the reader's gradients: for shading(), and for
+   * the TransferFunction2D mode, which renders with the 1D transfer function
+   * until they are computed.
+   */
+  bool needsGradients() const;
+
 private:
   bool m_visible{false};
   RenderMode m_renderMode{RenderMode::GPU};
+  double m_sampleDistance{1.};
+  double m_imageSampleDistance{1.};
+  bool m_lowResolution{false};
+  bool m_shading{false};
+
+  // Ray cast modes: the volume to ray cast -- the reduced data if
+  // m_rayCastReduced -- and the tables classifying its samples at each
+  // resolution, shared by the mappers of all contexts.
+  std::shared_ptr<const volBrickCache> m_rayCastVolume;
+  std::shared_ptr<const volGradientVolume> m_rayCastGradients;
+  bool m_rayCastReduced{false};
+  std::shared_ptr<volPreIntegrationTable> m_hiResTable;
+  std::shared_ptr<volPreIntegrationTable> m_loResTable;
+  std::shared_ptr<volSampleTable2D> m_hiResTable2D;
+  std::shared_ptr<volSampleTable2D> m_loResTable2D;
 
   vtkNew<vtkColorTransferFunction> m_color;
   vtkNew<vtkPiecewiseFunction> m_opacity;
   vtkNew<vtkVolumeProperty> m_property;
+
+  // Clipping: the mapper is cropped to the bricks that survive the clipping
+  // planes (and to the region of interest for the full resolution data), and
+  // clips exactly against the planes themselves.
+  vtkNew<vtkPlaneCollection> m_clippingPlanes;
+  std::array<double, 6> m_cropBounds;
+  std::array<double, 6> m_reducedCropBounds;
+  bool m_cropping{false};
+  bool m_reducedCropping{false};
+  vtkTimeStamp m_clippingTime;
 };
 
 #endif // VOLVOLUME_H